@@ -19,6 +19,18 @@
 // #define AZLogDebug( message )    LogD( message )
 //
 
+/**
+ * 
+ * Configuring middleware to use the deferred binary logging of azure_iot_log.h
+ * 
+ * Note: records are drained with AzureIoTLog_DeferredRead() and
+ *  decoded on the host with tools/azure_iot_log_decode.py.
+ * 
+ * */
+// #define azureiotconfigUSE_DEFERRED_LOGGING    1
+// #define azureiotconfigDEFERRED_LOG_BUFFER_SIZE    ( 2048U )
+//
+
 /**
  * 
  * Configuring middleware to use FreeRTOS logging
@@ -81,6 +93,11 @@
  */
 // #define azureiotconfigTOPIC_MAX    ( 128U )
 
+/**
+ * @brief Keep runtime statistics in each hub client, read with AzureIoTHubClient_GetStatistics().
+ */
+// #define azureiotconfigUSE_HUB_CLIENT_STATISTICS    1
+
 /**
  * @brief Max provisioning response payload supported.
  *
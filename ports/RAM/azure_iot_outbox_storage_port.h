@@ -0,0 +1,47 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_outbox_storage_port.h
+ * @brief Defines a RAM backed Azure IoT outbox storage port.
+ *
+ * Pending telemetry does not survive a reset with this port. It is meant as a reference for
+ * flash backed ports and for testing on hosts.
+ */
+
+#ifndef AZURE_IOT_OUTBOX_STORAGE_PORT_H
+#define AZURE_IOT_OUTBOX_STORAGE_PORT_H
+
+#include <stdint.h>
+
+#include "azure_iot_result.h"
+
+typedef struct AzureIoTRAMOutboxStorage
+{
+    uint8_t * pucBuffer;
+    uint32_t ulSlotCount;
+    uint32_t ulSlotSize;
+    uint32_t ulHead;
+    uint32_t ulTail;
+} AzureIoTRAMOutboxStorage_t;
+
+/* Maps RAM storage directly to AzureIoTOutboxStorage */
+typedef AzureIoTRAMOutboxStorage_t AzureIoTOutboxStorage_t;
+
+/**
+ * @brief Initialize the RAM outbox storage.
+ *
+ * Each slot takes four bytes for the record length on top of \p ulSlotSize.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to initialize.
+ * @param pucBuffer The buffer holding the slots.
+ * @param ulBufferLength The length of \p pucBuffer.
+ * @param ulSlotSize The largest record a slot can hold.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTRAMOutboxStorage_Init( AzureIoTOutboxStorage_t * const pxStorage,
+                                                uint8_t * pucBuffer,
+                                                uint32_t ulBufferLength,
+                                                uint32_t ulSlotSize );
+
+#endif /* AZURE_IOT_OUTBOX_STORAGE_PORT_H */
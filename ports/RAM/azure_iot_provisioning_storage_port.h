@@ -0,0 +1,41 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_storage_port.h
+ * @brief Defines a RAM backed Azure IoT provisioning storage port.
+ *
+ * The record only survives as long as the buffer it is kept in. It is meant as a reference for
+ * flash backed ports and for testing on hosts.
+ */
+
+#ifndef AZURE_IOT_PROVISIONING_STORAGE_PORT_H
+#define AZURE_IOT_PROVISIONING_STORAGE_PORT_H
+
+#include <stdint.h>
+
+#include "azure_iot_result.h"
+
+typedef struct AzureIoTRAMProvisioningStorage
+{
+    uint8_t * pucBuffer;
+    uint32_t ulBufferLength;
+    uint32_t ulRecordLength;
+} AzureIoTRAMProvisioningStorage_t;
+
+/* Maps RAM storage directly to AzureIoTProvisioningStorage */
+typedef AzureIoTRAMProvisioningStorage_t AzureIoTProvisioningStorage_t;
+
+/**
+ * @brief Initialize the RAM provisioning storage with no record.
+ *
+ * @param pxStorage The #AzureIoTProvisioningStorage_t to initialize.
+ * @param pucBuffer The buffer holding the record.
+ * @param ulBufferLength The length of \p pucBuffer.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTRAMProvisioningStorage_Init( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                      uint8_t * pucBuffer,
+                                                      uint32_t ulBufferLength );
+
+#endif /* AZURE_IOT_PROVISIONING_STORAGE_PORT_H */
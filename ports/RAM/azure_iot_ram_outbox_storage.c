@@ -0,0 +1,117 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include "azure_iot_outbox_storage.h"
+
+#include <string.h>
+
+#include "azure_iot.h"
+
+/* Each slot starts with the length of the record it holds. */
+#define azureiotramoutboxRECORD_LENGTH_SIZE    ( sizeof( uint32_t ) )
+
+static uint8_t * prvGetSlot( AzureIoTOutboxStorage_t * const pxStorage,
+                             uint32_t ulSlot )
+{
+    return pxStorage->pucBuffer + ( ulSlot * ( azureiotramoutboxRECORD_LENGTH_SIZE + pxStorage->ulSlotSize ) );
+}
+
+AzureIoTResult_t AzureIoTRAMOutboxStorage_Init( AzureIoTOutboxStorage_t * const pxStorage,
+                                                uint8_t * pucBuffer,
+                                                uint32_t ulBufferLength,
+                                                uint32_t ulSlotSize )
+{
+    if( ( pxStorage == NULL ) || ( pucBuffer == NULL ) || ( ulSlotSize == 0 ) ||
+        ( ulBufferLength < ( azureiotramoutboxRECORD_LENGTH_SIZE + ulSlotSize ) ) )
+    {
+        AZLogError( ( "AzureIoTRAMOutboxStorage_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxStorage, 0, sizeof( AzureIoTOutboxStorage_t ) );
+    pxStorage->pucBuffer = pucBuffer;
+    pxStorage->ulSlotSize = ulSlotSize;
+    pxStorage->ulSlotCount = ulBufferLength / ( azureiotramoutboxRECORD_LENGTH_SIZE + ulSlotSize );
+
+    return eAzureIoTSuccess;
+}
+
+uint32_t AzureIoTOutboxStorage_GetSlotCount( AzureIoTOutboxStorage_t * const pxStorage )
+{
+    return pxStorage->ulSlotCount;
+}
+
+uint32_t AzureIoTOutboxStorage_GetSlotSize( AzureIoTOutboxStorage_t * const pxStorage )
+{
+    return pxStorage->ulSlotSize;
+}
+
+AzureIoTResult_t AzureIoTOutboxStorage_WriteRecord( AzureIoTOutboxStorage_t * const pxStorage,
+                                                    uint32_t ulSlot,
+                                                    const uint8_t * pucRecord,
+                                                    uint32_t ulRecordLength )
+{
+    uint8_t * pucSlot;
+
+    if( ( ulSlot >= pxStorage->ulSlotCount ) || ( ulRecordLength > pxStorage->ulSlotSize ) )
+    {
+        AZLogError( ( "AzureIoTOutboxStorage_WriteRecord failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pucSlot = prvGetSlot( pxStorage, ulSlot );
+    memcpy( pucSlot, &ulRecordLength, azureiotramoutboxRECORD_LENGTH_SIZE );
+    memcpy( pucSlot + azureiotramoutboxRECORD_LENGTH_SIZE, pucRecord, ulRecordLength );
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTOutboxStorage_ReadRecord( AzureIoTOutboxStorage_t * const pxStorage,
+                                                   uint32_t ulSlot,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint32_t * pulRecordLength )
+{
+    uint8_t * pucSlot;
+    uint32_t ulRecordLength;
+
+    if( ulSlot >= pxStorage->ulSlotCount )
+    {
+        AZLogError( ( "AzureIoTOutboxStorage_ReadRecord failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pucSlot = prvGetSlot( pxStorage, ulSlot );
+    memcpy( &ulRecordLength, pucSlot, azureiotramoutboxRECORD_LENGTH_SIZE );
+
+    if( ulRecordLength > ulBufferLength )
+    {
+        AZLogError( ( "AzureIoTOutboxStorage_ReadRecord failed: buffer too small" ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    memcpy( pucBuffer, pucSlot + azureiotramoutboxRECORD_LENGTH_SIZE, ulRecordLength );
+    *pulRecordLength = ulRecordLength;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTOutboxStorage_WriteIndices( AzureIoTOutboxStorage_t * const pxStorage,
+                                                     uint32_t ulHead,
+                                                     uint32_t ulTail )
+{
+    pxStorage->ulHead = ulHead;
+    pxStorage->ulTail = ulTail;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTOutboxStorage_ReadIndices( AzureIoTOutboxStorage_t * const pxStorage,
+                                                    uint32_t * pulHead,
+                                                    uint32_t * pulTail )
+{
+    *pulHead = pxStorage->ulHead;
+    *pulTail = pxStorage->ulTail;
+
+    return eAzureIoTSuccess;
+}
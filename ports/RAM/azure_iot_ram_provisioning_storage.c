@@ -0,0 +1,70 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include "azure_iot_provisioning_storage.h"
+
+#include <string.h>
+
+#include "azure_iot.h"
+
+AzureIoTResult_t AzureIoTRAMProvisioningStorage_Init( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                      uint8_t * pucBuffer,
+                                                      uint32_t ulBufferLength )
+{
+    if( ( pxStorage == NULL ) || ( pucBuffer == NULL ) || ( ulBufferLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTRAMProvisioningStorage_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxStorage->pucBuffer = pucBuffer;
+    pxStorage->ulBufferLength = ulBufferLength;
+    pxStorage->ulRecordLength = 0;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTProvisioningStorage_Write( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                    const uint8_t * pucRecord,
+                                                    uint32_t ulRecordLength )
+{
+    if( ( pucRecord == NULL ) || ( ulRecordLength == 0 ) || ( ulRecordLength > pxStorage->ulBufferLength ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningStorage_Write failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memcpy( pxStorage->pucBuffer, pucRecord, ulRecordLength );
+    pxStorage->ulRecordLength = ulRecordLength;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTProvisioningStorage_Read( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint32_t * pulRecordLength )
+{
+    if( pxStorage->ulRecordLength == 0 )
+    {
+        return eAzureIoTErrorItemNotFound;
+    }
+
+    if( pxStorage->ulRecordLength > ulBufferLength )
+    {
+        AZLogError( ( "AzureIoTProvisioningStorage_Read failed: buffer too small" ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    memcpy( pucBuffer, pxStorage->pucBuffer, pxStorage->ulRecordLength );
+    *pulRecordLength = pxStorage->ulRecordLength;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTProvisioningStorage_Erase( AzureIoTProvisioningStorage_t * const pxStorage )
+{
+    pxStorage->ulRecordLength = 0;
+
+    return eAzureIoTSuccess;
+}
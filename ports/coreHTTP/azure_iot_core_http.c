@@ -70,6 +70,18 @@ static AzureIoTHTTPResult_t prvTranslateToAzureIoTHTTPResult( HTTPStatus_t xResu
     return eAzureIoTHTTPError;
 }
 
+/* Drop the range header added by the previous request, keeping the headers built at init. */
+static void prvRestoreHeaderTemplate( AzureIoTHTTPHandle_t xHTTPHandle )
+{
+    if( xHTTPHandle->xTemplateHeadersLength >= 2 )
+    {
+        xHTTPHandle->xRequestHeaders.headersLen = xHTTPHandle->xTemplateHeadersLength;
+
+        /* Adding a header overwrote the final line separator of the template, put it back. */
+        ( void ) memcpy( xHTTPHandle->xRequestHeaders.pBuffer + xHTTPHandle->xTemplateHeadersLength - 2, "\r\n", 2 );
+    }
+}
+
 
 AzureIoTHTTPResult_t AzureIoTHTTP_Init( AzureIoTHTTPHandle_t xHTTPHandle,
                                         AzureIoTTransportInterface_t * pxHTTPTransport,
@@ -104,7 +116,8 @@ AzureIoTHTTPResult_t AzureIoTHTTP_Init( AzureIoTHTTPHandle_t xHTTPHandle,
 
     xHTTPHandle->pxHTTPTransport = pxHTTPTransport;
 
-    HTTPClient_InitializeRequestHeaders( &xHTTPHandle->xRequestHeaders, &xHTTPHandle->xRequestInfo );
+    xHttpLibraryStatus = HTTPClient_InitializeRequestHeaders( &xHTTPHandle->xRequestHeaders, &xHTTPHandle->xRequestInfo );
+    xHTTPHandle->xTemplateHeadersLength = xHTTPHandle->xRequestHeaders.headersLen;
 
     return prvTranslateToAzureIoTHTTPResult( xHttpLibraryStatus );
 }
@@ -122,6 +135,9 @@ AzureIoTHTTPResult_t AzureIoTHTTP_Request( AzureIoTHTTPHandle_t xHTTPHandle,
     xHTTPHandle->xResponse.pBuffer = ( uint8_t * ) pucDataBuffer;
     xHTTPHandle->xResponse.bufferLen = ulDataBufferLength;
 
+    /* Headers are built once at init, only the range is patched per request. */
+    prvRestoreHeaderTemplate( xHTTPHandle );
+
     if( !( ( lRangeStart == 0 ) && ( lRangeEnd == azureiothttpHttpRangeRequestEndOfFile ) ) )
     {
         /* Add range headers if not the whole image. */
@@ -201,7 +217,8 @@ AzureIoTHTTPResult_t AzureIoTHTTP_RequestSizeInit( AzureIoTHTTPHandle_t xHTTPHan
 
     xHTTPHandle->pxHTTPTransport = pxHTTPTransport;
 
-    HTTPClient_InitializeRequestHeaders( &xHTTPHandle->xRequestHeaders, &xHTTPHandle->xRequestInfo );
+    xHttpLibraryStatus = HTTPClient_InitializeRequestHeaders( &xHTTPHandle->xRequestHeaders, &xHTTPHandle->xRequestInfo );
+    xHTTPHandle->xTemplateHeadersLength = xHTTPHandle->xRequestHeaders.headersLen;
 
     return prvTranslateToAzureIoTHTTPResult( xHttpLibraryStatus );
 }
@@ -243,9 +260,15 @@ int32_t AzureIoTHTTP_RequestSize( AzureIoTHTTPHandle_t xHTTPHandle,
 
 AzureIoTHTTPResult_t AzureIoTHTTP_Deinit( AzureIoTHTTPHandle_t xHTTPHandle )
 {
-    ( void ) xHTTPHandle;
-
     HTTPStatus_t xHttpLibraryStatus = HTTPSuccess;
 
+    if( xHTTPHandle == NULL )
+    {
+        return eAzureIoTHTTPInvalidParameter;
+    }
+
+    /* The transport, and the connection it holds, is owned by the application and left open. */
+    ( void ) memset( xHTTPHandle, 0, sizeof( *xHTTPHandle ) );
+
     return prvTranslateToAzureIoTHTTPResult( xHttpLibraryStatus );
 }
@@ -22,6 +22,7 @@ typedef struct AzureIoTCoreHTTPContext
     HTTPRequestHeaders_t xRequestHeaders;
     HTTPResponse_t xResponse;
     AzureIoTTransportInterface_t * pxHTTPTransport;
+    size_t xTemplateHeadersLength; /* Length of the headers built at init, before any range header. */
 } AzureIoTCoreHTTPContext_t;
 
 /* Maps HTTPContext directly to AzureIoTHTTP */
@@ -0,0 +1,429 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include "azure_iot_crypto.h"
+
+#include <string.h>
+
+#include "azure_iot.h"
+
+#include "azure_iot_crypto_port.h"
+
+#include "mbedtls/base64.h"
+#include "mbedtls/md.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/sha256.h"
+
+#define azureiotcryptoHMAC_IPAD    ( 0x36 )
+#define azureiotcryptoHMAC_OPAD    ( 0x5C )
+
+/* Base64 characters of a long key decoded at once, a multiple of the 4 characters of a group */
+#define azureiotcryptoHMAC_KEY_CHUNK    ( 64U )
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Calculate( const char * pucInputPtr,
+                                                 uint64_t ulInputSize,
+                                                 const char * pucOutputPtr,
+                                                 uint64_t ulOutputSize )
+{
+    int32_t lMbedTLSResult;
+
+    if( ( ( pucInputPtr == NULL ) && ( ulInputSize > 0 ) ) ||
+        ( pucOutputPtr == NULL ) || ( ulOutputSize < azureiotcryptoSHA256_SIZE ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_SHA256Calculate failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        lMbedTLSResult = mbedtls_sha256( ( const uint8_t * ) pucInputPtr, ( size_t ) ulInputSize, ( uint8_t * ) pucOutputPtr, 0 );
+    #else
+        lMbedTLSResult = mbedtls_sha256_ret( ( const uint8_t * ) pucInputPtr, ( size_t ) ulInputSize, ( uint8_t * ) pucOutputPtr, 0 );
+    #endif
+
+    return ( lMbedTLSResult == 0 ) ? eAzureIoTSuccess : eAzureIoTErrorFailed;
+}
+
+AzureIoTResult_t AzureIoTCrypto_RS256Verify( const char * pucInputPtr,
+                                             uint64_t ulInputSize,
+                                             const char * pucSignaturePtr,
+                                             uint64_t ulSignatureSize,
+                                             const char * pucN,
+                                             uint64_t ullNSize,
+                                             const char * pucE,
+                                             uint64_t ullESize,
+                                             const char * pucBufferPtr,
+                                             uint32_t ulBufferSize )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pucBufferPtr == NULL ) || ( ulBufferSize < azureiotcryptoSHA256_SIZE ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_RS256Verify failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( ( xResult = AzureIoTCrypto_SHA256Calculate( pucInputPtr, ulInputSize,
+                                                    pucBufferPtr, ulBufferSize ) ) != eAzureIoTSuccess )
+    {
+        return xResult;
+    }
+
+    return AzureIoTCrypto_RS256VerifyDigest( ( const uint8_t * ) pucBufferPtr,
+                                             ( const uint8_t * ) pucSignaturePtr, ( uint32_t ) ulSignatureSize,
+                                             ( const uint8_t * ) pucN, ( uint32_t ) ullNSize,
+                                             ( const uint8_t * ) pucE, ( uint32_t ) ullESize );
+}
+
+AzureIoTResult_t AzureIoTCrypto_RS256VerifyDigest( const uint8_t * pucDigest,
+                                                   const uint8_t * pucSignature,
+                                                   uint32_t ulSignatureLength,
+                                                   const uint8_t * pucN,
+                                                   uint32_t ulNLength,
+                                                   const uint8_t * pucE,
+                                                   uint32_t ulELength )
+{
+    AzureIoTResult_t xResult = eAzureIoTErrorFailed;
+    int32_t lMbedTLSResult;
+    mbedtls_rsa_context xRSAContext;
+
+    if( ( pucDigest == NULL ) || ( pucSignature == NULL ) || ( pucN == NULL ) || ( pucE == NULL ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_RS256VerifyDigest failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        mbedtls_rsa_init( &xRSAContext );
+    #else
+        mbedtls_rsa_init( &xRSAContext, MBEDTLS_RSA_PKCS_V15, 0 );
+    #endif
+
+    if( ( lMbedTLSResult = mbedtls_rsa_import_raw( &xRSAContext,
+                                                   pucN, ulNLength,
+                                                   NULL, 0,
+                                                   NULL, 0,
+                                                   NULL, 0,
+                                                   pucE, ulELength ) ) != 0 )
+    {
+        AZLogError( ( "mbedtls_rsa_import_raw failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+    }
+    else if( ( lMbedTLSResult = mbedtls_rsa_complete( &xRSAContext ) ) != 0 )
+    {
+        AZLogError( ( "mbedtls_rsa_complete failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+    }
+    else if( ( lMbedTLSResult = mbedtls_rsa_check_pubkey( &xRSAContext ) ) != 0 )
+    {
+        AZLogError( ( "mbedtls_rsa_check_pubkey failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+    }
+    /* The signature is read for the whole key length, which is past its end if it is shorter */
+    else if( mbedtls_rsa_get_len( &xRSAContext ) != ulSignatureLength )
+    {
+        AZLogError( ( "Signature length does not match the key | expected: %i | actual: %i",
+                      ( int16_t ) mbedtls_rsa_get_len( &xRSAContext ), ( int16_t ) ulSignatureLength ) );
+    }
+    else
+    {
+        #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+            lMbedTLSResult = mbedtls_rsa_pkcs1_verify( &xRSAContext, MBEDTLS_MD_SHA256, azureiotcryptoSHA256_SIZE,
+                                                       pucDigest, pucSignature );
+        #else
+            lMbedTLSResult = mbedtls_rsa_pkcs1_verify( &xRSAContext, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256,
+                                                       azureiotcryptoSHA256_SIZE, pucDigest, pucSignature );
+        #endif
+
+        if( lMbedTLSResult != 0 )
+        {
+            AZLogError( ( "mbedtls_rsa_pkcs1_verify failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+        }
+        else
+        {
+            xResult = eAzureIoTSuccess;
+        }
+    }
+
+    mbedtls_rsa_free( &xRSAContext );
+
+    return xResult;
+}
+
+uint32_t AzureIoTCrypto_HMACSHA256Calculate( const uint8_t * pucKey,
+                                             uint32_t ulKeyLength,
+                                             const uint8_t * pucData,
+                                             uint32_t ulDataLength,
+                                             uint8_t * pucOutput,
+                                             uint32_t ulOutputLength,
+                                             uint32_t * pulBytesCopied )
+{
+    int32_t lMbedTLSResult;
+
+    if( ( pucKey == NULL ) || ( pucData == NULL ) || ( pucOutput == NULL ) ||
+        ( ulOutputLength < azureiotcryptoSHA256_SIZE ) || ( pulBytesCopied == NULL ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_HMACSHA256Calculate failed: invalid argument" ) );
+        return 1;
+    }
+
+    lMbedTLSResult = mbedtls_md_hmac( mbedtls_md_info_from_type( MBEDTLS_MD_SHA256 ),
+                                      pucKey, ulKeyLength, pucData, ulDataLength, pucOutput );
+
+    if( lMbedTLSResult != 0 )
+    {
+        AZLogError( ( "mbedtls_md_hmac failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+        return 1;
+    }
+
+    *pulBytesCopied = azureiotcryptoSHA256_SIZE;
+
+    return 0;
+}
+
+/**
+ * Hash a base64 encoded key longer than a block into the start of pucKeyBlock, as RFC 2104 does.
+ * The key is decoded a group of base64 characters at a time, so it never has to fit in memory decoded.
+ */
+static AzureIoTResult_t prvHMACSHA256HashKey( const uint8_t * pucSymmetricKey,
+                                              uint32_t ulSymmetricKeyLength,
+                                              uint8_t * pucKeyBlock )
+{
+    AzureIoTCryptoSHA256Context_t xHash;
+    uint8_t ucDecoded[ ( azureiotcryptoHMAC_KEY_CHUNK / 4U ) * 3U ];
+    size_t xDecodedLength;
+    uint32_t ulOffset;
+    uint32_t ulChunkLength;
+    AzureIoTResult_t xResult;
+
+    xResult = AzureIoTCrypto_SHA256Init( &xHash );
+
+    for( ulOffset = 0; ( xResult == eAzureIoTSuccess ) && ( ulOffset < ulSymmetricKeyLength ); ulOffset += ulChunkLength )
+    {
+        ulChunkLength = ulSymmetricKeyLength - ulOffset;
+        ulChunkLength = ( ulChunkLength > azureiotcryptoHMAC_KEY_CHUNK ) ? azureiotcryptoHMAC_KEY_CHUNK : ulChunkLength;
+
+        if( mbedtls_base64_decode( ucDecoded, sizeof( ucDecoded ), &xDecodedLength,
+                                   pucSymmetricKey + ulOffset, ulChunkLength ) != 0 )
+        {
+            AZLogError( ( "AzureIoTCrypto_HMACSHA256Init failed to decode key" ) );
+            xResult = eAzureIoTErrorFailed;
+        }
+        else
+        {
+            xResult = AzureIoTCrypto_SHA256Update( &xHash, ucDecoded, ( uint32_t ) xDecodedLength );
+        }
+    }
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        xResult = AzureIoTCrypto_SHA256Finish( &xHash, pucKeyBlock, azureiotcryptoSHA256_SIZE );
+    }
+    else
+    {
+        mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ) );
+    }
+
+    memset( ucDecoded, 0, sizeof( ucDecoded ) );
+
+    return xResult;
+}
+
+AzureIoTResult_t AzureIoTCrypto_HMACSHA256Init( AzureIoTCryptoHMACSHA256Context_t * pxContext,
+                                                const uint8_t * pucSymmetricKey,
+                                                uint32_t ulSymmetricKeyLength )
+{
+    AzureIoTResult_t xResult;
+    int32_t lMbedTLSResult;
+    uint8_t ucKeyBlock[ azureiotcryptoSHA256_BLOCK_SIZE ] = { 0 };
+    size_t xKeyLength;
+    uint32_t ulIndex;
+
+    if( ( pxContext == NULL ) || ( pucSymmetricKey == NULL ) || ( ulSymmetricKeyLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_HMACSHA256Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* Both states are freed together on any failure below, so start them both from a known state */
+    mbedtls_sha256_init( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xInner ) );
+    mbedtls_sha256_init( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xOuter ) );
+
+    /* The key is zero padded to a block, which is what HMAC does with keys shorter than a block */
+    lMbedTLSResult = mbedtls_base64_decode( ucKeyBlock, sizeof( ucKeyBlock ), &xKeyLength,
+                                            pucSymmetricKey, ulSymmetricKeyLength );
+
+    if( lMbedTLSResult == MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL )
+    {
+        /* Longer keys are replaced by their hash, zero padded the same way */
+        memset( ucKeyBlock, 0, sizeof( ucKeyBlock ) );
+        xResult = prvHMACSHA256HashKey( pucSymmetricKey, ulSymmetricKeyLength, ucKeyBlock );
+    }
+    else if( lMbedTLSResult != 0 )
+    {
+        AZLogError( ( "mbedtls_base64_decode failed: 0x%08x", ( uint16_t ) lMbedTLSResult ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        xResult = eAzureIoTSuccess;
+    }
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        for( ulIndex = 0; ulIndex < sizeof( ucKeyBlock ); ulIndex++ )
+        {
+            ucKeyBlock[ ulIndex ] ^= azureiotcryptoHMAC_IPAD;
+        }
+
+        if( ( ( xResult = AzureIoTCrypto_SHA256Init( &pxContext->xInner ) ) == eAzureIoTSuccess ) &&
+            ( ( xResult = AzureIoTCrypto_SHA256Update( &pxContext->xInner, ucKeyBlock, sizeof( ucKeyBlock ) ) ) == eAzureIoTSuccess ) )
+        {
+            for( ulIndex = 0; ulIndex < sizeof( ucKeyBlock ); ulIndex++ )
+            {
+                ucKeyBlock[ ulIndex ] ^= azureiotcryptoHMAC_IPAD ^ azureiotcryptoHMAC_OPAD;
+            }
+
+            if( ( xResult = AzureIoTCrypto_SHA256Init( &pxContext->xOuter ) ) == eAzureIoTSuccess )
+            {
+                xResult = AzureIoTCrypto_SHA256Update( &pxContext->xOuter, ucKeyBlock, sizeof( ucKeyBlock ) );
+            }
+        }
+    }
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xInner ) );
+        mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xOuter ) );
+    }
+
+    memset( ucKeyBlock, 0, sizeof( ucKeyBlock ) );
+
+    return xResult;
+}
+
+uint32_t AzureIoTCrypto_HMACSHA256Sign( void * pvHMACContext,
+                                        const uint8_t * pucData,
+                                        uint32_t ulDataLength,
+                                        uint8_t * pucOutput,
+                                        uint32_t ulOutputLength,
+                                        uint32_t * pulBytesCopied )
+{
+    AzureIoTCryptoHMACSHA256Context_t * pxContext = ( AzureIoTCryptoHMACSHA256Context_t * ) pvHMACContext;
+    AzureIoTCryptoSHA256Context_t xHash;
+    uint8_t ucInnerHash[ azureiotcryptoSHA256_SIZE ];
+    AzureIoTResult_t xResult;
+
+    if( ( pxContext == NULL ) || ( ( pucData == NULL ) && ( ulDataLength > 0 ) ) || ( pucOutput == NULL ) ||
+        ( ulOutputLength < azureiotcryptoSHA256_SIZE ) || ( pulBytesCopied == NULL ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_HMACSHA256Sign failed: invalid argument" ) );
+        return 1;
+    }
+
+    /* Resume from the prepared states, leaving them as they are for the next signature */
+    mbedtls_sha256_init( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ) );
+    mbedtls_sha256_clone( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ), azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xInner ) );
+
+    if( ( xResult = AzureIoTCrypto_SHA256Update( &xHash, pucData, ulDataLength ) ) != eAzureIoTSuccess )
+    {
+        mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ) );
+    }
+    else if( ( xResult = AzureIoTCrypto_SHA256Finish( &xHash, ucInnerHash, sizeof( ucInnerHash ) ) ) == eAzureIoTSuccess )
+    {
+        mbedtls_sha256_init( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ) );
+        mbedtls_sha256_clone( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ), azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xOuter ) );
+
+        if( ( xResult = AzureIoTCrypto_SHA256Update( &xHash, ucInnerHash, sizeof( ucInnerHash ) ) ) != eAzureIoTSuccess )
+        {
+            mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &xHash ) );
+        }
+        else
+        {
+            xResult = AzureIoTCrypto_SHA256Finish( &xHash, pucOutput, ulOutputLength );
+        }
+    }
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTCrypto_HMACSHA256Sign failed: 0x%08x", xResult ) );
+        return 1;
+    }
+
+    *pulBytesCopied = azureiotcryptoSHA256_SIZE;
+
+    return 0;
+}
+
+void AzureIoTCrypto_HMACSHA256Deinit( AzureIoTCryptoHMACSHA256Context_t * pxContext )
+{
+    if( pxContext == NULL )
+    {
+        AZLogError( ( "AzureIoTCrypto_HMACSHA256Deinit failed: invalid argument" ) );
+        return;
+    }
+
+    mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xInner ) );
+    mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( &pxContext->xOuter ) );
+}
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Init( AzureIoTCryptoSHA256Context_t * pxContext )
+{
+    int32_t lMbedTLSResult;
+
+    if( pxContext == NULL )
+    {
+        AZLogError( ( "AzureIoTCrypto_SHA256Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    mbedtls_sha256_init( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ) );
+
+    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        lMbedTLSResult = mbedtls_sha256_starts( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), 0 );
+    #else
+        lMbedTLSResult = mbedtls_sha256_starts_ret( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), 0 );
+    #endif
+
+    return ( lMbedTLSResult == 0 ) ? eAzureIoTSuccess : eAzureIoTErrorFailed;
+}
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Update( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              const uint8_t * pucInput,
+                                              uint32_t ulInputLength )
+{
+    int32_t lMbedTLSResult;
+
+    if( ( pxContext == NULL ) || ( ( pucInput == NULL ) && ( ulInputLength > 0 ) ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_SHA256Update failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        lMbedTLSResult = mbedtls_sha256_update( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucInput, ulInputLength );
+    #else
+        lMbedTLSResult = mbedtls_sha256_update_ret( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucInput, ulInputLength );
+    #endif
+
+    return ( lMbedTLSResult == 0 ) ? eAzureIoTSuccess : eAzureIoTErrorFailed;
+}
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Finish( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              uint8_t * pucOutput,
+                                              uint32_t ulOutputLength )
+{
+    int32_t lMbedTLSResult;
+
+    if( ( pxContext == NULL ) || ( pucOutput == NULL ) || ( ulOutputLength < azureiotcryptoSHA256_SIZE ) )
+    {
+        AZLogError( ( "AzureIoTCrypto_SHA256Finish failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
+        lMbedTLSResult = mbedtls_sha256_finish( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucOutput );
+    #else
+        lMbedTLSResult = mbedtls_sha256_finish_ret( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucOutput );
+    #endif
+
+    mbedtls_sha256_free( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ) );
+
+    return ( lMbedTLSResult == 0 ) ? eAzureIoTSuccess : eAzureIoTErrorFailed;
+}
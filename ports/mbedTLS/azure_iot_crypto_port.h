@@ -0,0 +1,26 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_crypto_port.h
+ * @brief Defines Azure IoT crypto port based on mbedTLS. Private to the port.
+ *
+ */
+
+#ifndef AZURE_IOT_CRYPTO_PORT_H
+#define AZURE_IOT_CRYPTO_PORT_H
+
+#include "mbedtls/sha256.h"
+
+#include "azure_iot_crypto.h"
+
+/* Maps SHA256 context directly to mbedTLS. Only the port includes this header. */
+typedef mbedtls_sha256_context AzureIoTCryptoPortSHA256Context_t;
+
+/* The port state lives in the storage of the public context */
+#define azureiotcryptoPORT_SHA256_CONTEXT( pxContext )    ( ( AzureIoTCryptoPortSHA256Context_t * ) ( pxContext )->_internal.ucState )
+
+/* Fails to compile if the port state does not fit #azureiotcryptoSHA256_CONTEXT_SIZE */
+typedef char AzureIoTCryptoPortSHA256ContextSizeCheck_t[ ( sizeof( AzureIoTCryptoPortSHA256Context_t ) <= azureiotcryptoSHA256_CONTEXT_SIZE ) ? 1 : -1 ];
+
+#endif /* AZURE_IOT_CRYPTO_PORT_H */
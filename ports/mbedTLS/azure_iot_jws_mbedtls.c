@@ -3,6 +3,8 @@
 
 #include "azure_iot_jws.h"
 
+#include <string.h>
+
 #include "azure/az_core.h"
 #include "azure/az_iot.h"
 
@@ -10,13 +12,7 @@
 #include "azure_iot_result.h"
 #include "azure_iot_json_reader.h"
 #include "azure_iot_adu_client.h"
-
-#include "mbedtls/base64.h"
-#include "mbedtls/rsa.h"
-#include "mbedtls/pk.h"
-#include "mbedtls/ctr_drbg.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/cipher.h"
+#include "azure_iot_crypto.h"
 
 /**
  * @brief Convenience macro to return if an operation failed.
@@ -31,8 +27,6 @@
         }                                            \
     } while( 0 )
 
-#define azureiotjwsPKCS7_PAYLOAD_OFFSET    19
-
 static const uint8_t jws_sha256_json_value[] = "sha256";
 static const uint8_t jws_sjwk_json_value[] = "sjwk";
 static const uint8_t jws_kid_json_value[] = "kid";
@@ -41,47 +35,15 @@ static const uint8_t jws_e_json_value[] = "e";
 static const uint8_t jws_alg_json_value[] = "alg";
 static const uint8_t jws_alg_rs256[] = "RS256";
 
-typedef struct prvJWSValidationContext
-{
-    int32_t outParsedManifestShaSize;
-    uint8_t * ucJWSHeader;
-    uint8_t * ucJWKHeader;
-    uint8_t * ucJWKPayload;
-    uint8_t * ucJWKSignature;
-    uint8_t * ucScratchCalculationBuffer;
-    uint8_t * ucJWSPayload;
-    uint8_t * ucJWSSignature;
-    uint8_t * ucSigningKeyN;
-    uint8_t * ucSigningKeyE;
-    uint8_t * ucManifestSHACalculation;
-    uint8_t * ucParsedManifestSha;
-    uint8_t * pucBase64EncodedHeader;
-    uint8_t * pucBase64EncodedPayload;
-    uint8_t * pucBase64EncodedSignature;
-    uint8_t * pucJWKBase64EncodedHeader;
-    uint8_t * pucJWKBase64EncodedPayload;
-    uint8_t * pucJWKBase64EncodedSignature;
-    uint32_t ulBase64EncodedHeaderLength;
-    uint32_t ulBase64EncodedPayloadLength;
-    uint32_t ulBase64SignatureLength;
-    uint32_t ulJWKBase64EncodedHeaderLength;
-    uint32_t ulJWKBase64EncodedPayloadLength;
-    uint32_t ulJWKBase64EncodedSignatureLength;
-    int32_t outSigningKeyELength;
-    int32_t outSigningKeyNLength;
-    int32_t outJWSHeaderLength;
-    int32_t outJWSPayloadLength;
-    int32_t outJWSSignatureLength;
-    int32_t outJWKHeaderLength;
-    int32_t outJWKPayloadLength;
-    int32_t outJWKSignatureLength;
-    az_span kidSpan;
-    az_span sha256Span;
-    az_span xBase64EncodedNSpan;
-    az_span xBase64EncodedESpan;
-    az_span xAlgSpan;
-    az_span xJWKManifestSpan;
-} prvJWSValidationContext_t;
+/* Steps of the manifest authentication, see AzureIoTJWS_ManifestAuthenticateStep() */
+#define azureiotjwsSTEP_SPLIT                 ( 0 )
+#define azureiotjwsSTEP_DECODE_HEADER         ( 1 )
+#define azureiotjwsSTEP_DECODE_JWK            ( 2 )
+#define azureiotjwsSTEP_VERIFY_JWK            ( 3 )
+#define azureiotjwsSTEP_DECODE_SIGNING_KEY    ( 4 )
+#define azureiotjwsSTEP_VERIFY_JWS            ( 5 )
+#define azureiotjwsSTEP_COMPARE_SHA           ( 6 )
+#define azureiotjwsSTEP_DONE                  ( 7 )
 
 /* prvSplitJWS takes a JWS payload and returns pointers to its constituent header, payload, and signature parts. */
 static AzureIoTResult_t prvSplitJWS( uint8_t * pucJWS,
@@ -153,128 +115,105 @@ static AzureIoTResult_t prvJWS_SHA256Calculate( const uint8_t * pucInput,
                                                 uint32_t ulInputLength,
                                                 uint8_t * pucOutput )
 {
-    mbedtls_md_context_t ctx;
-    mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
+    AzureIoTCryptoSHA256Context_t xContext;
 
-    mbedtls_md_init( &ctx );
-    mbedtls_md_setup( &ctx, mbedtls_md_info_from_type( md_type ), 0 );
-    mbedtls_md_starts( &ctx );
-    mbedtls_md_update( &ctx, pucInput, ulInputLength );
-    mbedtls_md_finish( &ctx, pucOutput );
-    mbedtls_md_free( &ctx );
+    azureiotresultRETURN_IF_FAILED( AzureIoTCrypto_SHA256Init( &xContext ) );
+    azureiotresultRETURN_IF_FAILED( AzureIoTCrypto_SHA256Update( &xContext, pucInput, ulInputLength ) );
 
-    return eAzureIoTSuccess;
+    return AzureIoTCrypto_SHA256Finish( &xContext, pucOutput, azureiotjwsSHA256_SIZE );
 }
 
 /**
- * @brief Verify the manifest via RS256 for the JWS.
+ * @brief Get the value of a base64 or base64url character.
  *
- * @param pucInput The input over which the RS256 will be verified.
- * @param ulInputLength The length of \p pucInput.
- * @param pucSignature The encrypted signature which will be decrypted by \p pucN and \p pucE.
- * @param ulSignatureLength The length of \p pucSignature.
- * @param pucN The key's modulus which is used to decrypt \p signature.
- * @param ulNLength The length of \p pucN.
- * @param pucE The exponent used for the key.
- * @param ulELength The length of \p pucE.
- * @param pucBuffer The buffer used as scratch space to make the calculations. It should be at least
- * `azureiotjwsSHA256_SIZE` in size.
- * @param ulBufferLength The length of \p pucBuffer.
- * @return uint32_t The result of the operation.
- * @retval 0 if successful.
- * @retval Non-0 if not successful.
+ * @return The 6 bit value, or -1 if \p ucCharacter is not in either alphabet.
  */
-static AzureIoTResult_t prvJWS_RS256Verify( uint8_t * pucInput,
-                                            uint32_t ulInputLength,
-                                            uint8_t * pucSignature,
-                                            uint32_t ulSignatureLength,
-                                            uint8_t * pucN,
-                                            uint32_t ulNLength,
-                                            uint8_t * pucE,
-                                            uint32_t ulELength,
-                                            uint8_t * pucBuffer,
-                                            uint32_t ulBufferLength )
+static int32_t prvBase64Value( uint8_t ucCharacter )
 {
-    AzureIoTResult_t xResult;
-    int32_t lMbedTLSResult;
-    mbedtls_rsa_context ctx;
-
-    if( ulBufferLength < azureiotjwsSHA_CALCULATION_SCRATCH_SIZE )
+    if( ( ucCharacter >= 'A' ) && ( ucCharacter <= 'Z' ) )
     {
-        AZLogError( ( "[JWS] Buffer Not Large Enough" ) );
-        return eAzureIoTErrorOutOfMemory;
+        return ucCharacter - 'A';
     }
-
-    /* The signature is encrypted using the input key. We need to decrypt the */
-    /* signature which gives us the SHA256 inside a PKCS7 structure. We then compare */
-    /* that to the SHA256 of the input. */
-    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
-        mbedtls_rsa_init( &ctx );
-    #else
-        mbedtls_rsa_init( &ctx, MBEDTLS_RSA_PKCS_V15, 0 );
-    #endif
-
-    lMbedTLSResult = mbedtls_rsa_import_raw( &ctx,
-                                             pucN, ulNLength,
-                                             NULL, 0,
-                                             NULL, 0,
-                                             NULL, 0,
-                                             pucE, ulELength );
-
-    if( lMbedTLSResult != 0 )
+    else if( ( ucCharacter >= 'a' ) && ( ucCharacter <= 'z' ) )
     {
-        AZLogError( ( "[JWS] mbedtls_rsa_import_raw res: %08x", ( uint16_t ) lMbedTLSResult ) );
-        mbedtls_rsa_free( &ctx );
-        return eAzureIoTErrorFailed;
+        return ucCharacter - 'a' + 26;
     }
-
-    lMbedTLSResult = mbedtls_rsa_complete( &ctx );
-
-    if( lMbedTLSResult != 0 )
+    else if( ( ucCharacter >= '0' ) && ( ucCharacter <= '9' ) )
     {
-        AZLogError( ( "[JWS] mbedtls_rsa_complete res: %08x", ( uint16_t ) lMbedTLSResult ) );
-        mbedtls_rsa_free( &ctx );
-        return eAzureIoTErrorFailed;
+        return ucCharacter - '0' + 52;
     }
-
-    lMbedTLSResult = mbedtls_rsa_check_pubkey( &ctx );
-
-    if( lMbedTLSResult != 0 )
+    else if( ( ucCharacter == '+' ) || ( ucCharacter == '-' ) )
     {
-        AZLogError( ( "[JWS] mbedtls_rsa_check_pubkey res: %08x", ( uint16_t ) lMbedTLSResult ) );
-        mbedtls_rsa_free( &ctx );
-        return eAzureIoTErrorFailed;
+        return 62;
+    }
+    else if( ( ucCharacter == '/' ) || ( ucCharacter == '_' ) )
+    {
+        return 63;
     }
 
-    /* RSA */
-    xResult = prvJWS_SHA256Calculate( pucInput, ulInputLength,
-                                      pucBuffer );
+    return -1;
+}
 
-    if( xResult != eAzureIoTSuccess )
+/**
+ * @brief Decode base64 or base64url in place.
+ *
+ * Every byte is written behind the character being read, so the decoded bytes can overwrite the encoded ones,
+ * and the JWS does not need to be copied to be decoded.
+ *
+ * @param pucBuffer The encoded characters, replaced by the decoded bytes.
+ * @param ulLength The length of \p pucBuffer.
+ * @param pulOutLength The length of the decoded bytes.
+ * @return AzureIoTResult_t The result of the operation.
+ */
+static AzureIoTResult_t prvBase64DecodeInPlace( uint8_t * pucBuffer,
+                                                uint32_t ulLength,
+                                                uint32_t * pulOutLength )
+{
+    uint32_t ulAccumulator = 0;
+    uint32_t ulBitCount = 0;
+    uint32_t ulOutLength = 0;
+    uint32_t ulIndex = 0;
+    int32_t lValue;
+
+    for( ; ( ulIndex < ulLength ) && ( pucBuffer[ ulIndex ] != '=' ); ulIndex++ )
     {
-        AZLogError( ( "[JWS] prvJWS_SHA256Calculate failed" ) );
-        return xResult;
-    }
+        lValue = prvBase64Value( pucBuffer[ ulIndex ] );
+
+        if( lValue < 0 )
+        {
+            AZLogError( ( "[JWS] Invalid base64 character at %i", ( int16_t ) ulIndex ) );
+            return eAzureIoTErrorFailed;
+        }
+
+        ulAccumulator = ( ulAccumulator << 6 ) | ( uint32_t ) lValue;
+        ulBitCount += 6;
 
-    #if MBEDTLS_VERSION_NUMBER >= 0x03000000
-        lMbedTLSResult = mbedtls_rsa_pkcs1_verify( &ctx, MBEDTLS_MD_SHA256, azureiotjwsSHA256_SIZE, pucBuffer, pucSignature );
-    #else
-        lMbedTLSResult = mbedtls_rsa_pkcs1_verify( &ctx, NULL, NULL, MBEDTLS_RSA_PUBLIC, MBEDTLS_MD_SHA256, azureiotjwsSHA256_SIZE, pucBuffer, pucSignature );
-    #endif
+        if( ulBitCount >= 8 )
+        {
+            ulBitCount -= 8;
+            pucBuffer[ ulOutLength++ ] = ( uint8_t ) ( ulAccumulator >> ulBitCount );
+        }
+    }
 
-    if( lMbedTLSResult != 0 )
+    /* Only padding may follow, and a single trailing character cannot make a byte */
+    for( ; ulIndex < ulLength; ulIndex++ )
     {
-        AZLogError( ( "[JWS] SHA of JWK does NOT match (%08x)", ( uint16_t ) lMbedTLSResult ) );
-        xResult = eAzureIoTErrorFailed;
+        if( pucBuffer[ ulIndex ] != '=' )
+        {
+            AZLogError( ( "[JWS] Invalid base64 padding" ) );
+            return eAzureIoTErrorFailed;
+        }
     }
-    else
+
+    if( ulBitCount >= 6 )
     {
-        xResult = eAzureIoTSuccess;
+        AZLogError( ( "[JWS] Invalid base64 length: %i", ( int16_t ) ulLength ) );
+        return eAzureIoTErrorFailed;
     }
 
-    mbedtls_rsa_free( &ctx );
+    *pulOutLength = ulOutLength;
 
-    return xResult;
+    return eAzureIoTSuccess;
 }
 
 static AzureIoTResult_t prvFindSJWKValue( AzureIoTJSONReader_t * pxPayload,
@@ -469,149 +408,75 @@ static AzureIoTResult_t prvFindManifestSHA( AzureIoTJSONReader_t * pxPayload,
     return eAzureIoTSuccess;
 }
 
-static AzureIoTResult_t prvBase64DecodeJWK( prvJWSValidationContext_t * pxManifestContext )
+static AzureIoTResult_t prvBase64DecodeJWK( AzureIoTJWS_ManifestContext_t * pxManifestContext )
 {
-    az_result xCoreResult;
-
-    xCoreResult = az_base64_url_decode( az_span_create( pxManifestContext->ucJWKHeader, azureiotjwsJWK_HEADER_SIZE ),
-                                        az_span_create( pxManifestContext->pucJWKBase64EncodedHeader, pxManifestContext->ulJWKBase64EncodedHeaderLength ),
-                                        &pxManifestContext->outJWKHeaderLength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsJWK_HEADER_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
-
-    xCoreResult = az_base64_url_decode( az_span_create( pxManifestContext->ucJWKPayload, azureiotjwsJWK_PAYLOAD_SIZE ),
-                                        az_span_create( pxManifestContext->pucJWKBase64EncodedPayload, pxManifestContext->ulJWKBase64EncodedPayloadLength ),
-                                        &pxManifestContext->outJWKPayloadLength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsJWK_PAYLOAD_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
-
-    xCoreResult = az_base64_url_decode( az_span_create( pxManifestContext->ucJWKSignature, azureiotjwsSIGNATURE_SIZE ),
-                                        az_span_create( pxManifestContext->pucJWKBase64EncodedSignature, pxManifestContext->ulJWKBase64EncodedSignatureLength ),
-                                        &pxManifestContext->outJWKSignatureLength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsSIGNATURE_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
+    pxManifestContext->_internal.pucJWKHeader = pxManifestContext->_internal.pucJWKBase64EncodedHeader;
+    pxManifestContext->_internal.pucJWKPayload = pxManifestContext->_internal.pucJWKBase64EncodedPayload;
+    pxManifestContext->_internal.pucJWKSignature = pxManifestContext->_internal.pucJWKBase64EncodedSignature;
+
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWKHeader,
+                                                            pxManifestContext->_internal.ulJWKBase64EncodedHeaderLength,
+                                                            &pxManifestContext->_internal.ulJWKHeaderLength ) );
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWKPayload,
+                                                            pxManifestContext->_internal.ulJWKBase64EncodedPayloadLength,
+                                                            &pxManifestContext->_internal.ulJWKPayloadLength ) );
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWKSignature,
+                                                            pxManifestContext->_internal.ulJWKBase64EncodedSignatureLength,
+                                                            &pxManifestContext->_internal.ulJWKSignatureLength ) );
 
     return eAzureIoTSuccess;
 }
 
-static AzureIoTResult_t prvBase64DecodeSigningKey( prvJWSValidationContext_t * pxManifestContext )
+static AzureIoTResult_t prvBase64DecodeSigningKey( AzureIoTJWS_ManifestContext_t * pxManifestContext )
 {
-    az_result xCoreResult;
-
-    xCoreResult = az_base64_decode( az_span_create( pxManifestContext->ucSigningKeyN, azureiotjwsRSA3072_SIZE ),
-                                    pxManifestContext->xBase64EncodedNSpan,
-                                    &pxManifestContext->outSigningKeyNLength );
-
-    if( az_result_failed( xCoreResult ) )
+    pxManifestContext->_internal.pucSigningKeyN = pxManifestContext->_internal.pucBase64EncodedN;
+    pxManifestContext->_internal.pucSigningKeyE = pxManifestContext->_internal.pucBase64EncodedE;
+
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucSigningKeyN,
+                                                            pxManifestContext->_internal.ulBase64EncodedNLength,
+                                                            &pxManifestContext->_internal.ulSigningKeyNLength ) );
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucSigningKeyE,
+                                                            pxManifestContext->_internal.ulBase64EncodedELength,
+                                                            &pxManifestContext->_internal.ulSigningKeyELength ) );
+
+    if( ( pxManifestContext->_internal.ulSigningKeyNLength > azureiotjwsSIGNING_KEY_N_SIZE ) ||
+        ( pxManifestContext->_internal.ulSigningKeyELength > azureiotjwsSIGNING_KEY_E_SIZE ) )
     {
-        AZLogError( ( "[JWS] az_base64_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsRSA3072_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
-
-    xCoreResult = az_base64_decode( az_span_create( pxManifestContext->ucSigningKeyE, azureiotjwsSIGNING_KEY_E_SIZE ),
-                                    pxManifestContext->xBase64EncodedESpan,
-                                    &pxManifestContext->outSigningKeyELength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsSIGNING_KEY_E_SIZE ) );
-        }
-
+        AZLogError( ( "[JWS] Signing key too large | n: %i bytes | e: %i bytes",
+                      ( int16_t ) pxManifestContext->_internal.ulSigningKeyNLength,
+                      ( int16_t ) pxManifestContext->_internal.ulSigningKeyELength ) );
         return eAzureIoTErrorFailed;
     }
 
     return eAzureIoTSuccess;
 }
 
-static AzureIoTResult_t prvBase64DecodeJWSHeaderAndPayload( prvJWSValidationContext_t * pxManifestContext )
+static AzureIoTResult_t prvBase64DecodeJWSHeaderAndPayload( AzureIoTJWS_ManifestContext_t * pxManifestContext )
 {
-    az_result xCoreResult;
-
-    xCoreResult = az_base64_url_decode( az_span_create( pxManifestContext->ucJWSPayload, azureiotjwsJWS_PAYLOAD_SIZE ),
-                                        az_span_create( pxManifestContext->pucBase64EncodedPayload, pxManifestContext->ulBase64EncodedPayloadLength ),
-                                        &pxManifestContext->outJWSPayloadLength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
+    pxManifestContext->_internal.pucJWSPayload = pxManifestContext->_internal.pucBase64EncodedPayload;
+    pxManifestContext->_internal.pucJWSSignature = pxManifestContext->_internal.pucBase64EncodedSignature;
 
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsJWS_PAYLOAD_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
-
-    xCoreResult = az_base64_url_decode( az_span_create( pxManifestContext->ucJWSSignature, azureiotjwsSIGNATURE_SIZE ),
-                                        az_span_create( pxManifestContext->pucBase64EncodedSignature, pxManifestContext->ulBase64SignatureLength ),
-                                        &pxManifestContext->outJWSSignatureLength );
-
-    if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsSIGNATURE_SIZE ) );
-        }
-
-        return eAzureIoTErrorFailed;
-    }
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWSPayload,
+                                                            pxManifestContext->_internal.ulBase64EncodedPayloadLength,
+                                                            &pxManifestContext->_internal.ulJWSPayloadLength ) );
+    azureiotresultRETURN_IF_FAILED( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWSSignature,
+                                                            pxManifestContext->_internal.ulBase64SignatureLength,
+                                                            &pxManifestContext->_internal.ulJWSSignatureLength ) );
 
     return eAzureIoTSuccess;
 }
 
-static AzureIoTResult_t prvValidateRootKey( prvJWSValidationContext_t * pxManifestContext,
+static AzureIoTResult_t prvValidateRootKey( AzureIoTJWS_ManifestContext_t * pxManifestContext,
                                             AzureIoTJWS_RootKey_t * xADURootKeys,
                                             uint32_t ulADURootKeysLength,
                                             int32_t * pulADURootKeyIndex )
 {
     AzureIoTJSONReader_t xJSONReader;
+    az_span xKIDSpan;
 
-    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->ucJWKHeader, pxManifestContext->outJWKHeaderLength );
+    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->_internal.pucJWKHeader, pxManifestContext->_internal.ulJWKHeaderLength );
 
-    if( prvFindRootKeyValue( &xJSONReader, &pxManifestContext->kidSpan ) != eAzureIoTSuccess )
+    if( prvFindRootKeyValue( &xJSONReader, &xKIDSpan ) != eAzureIoTSuccess )
     {
         AZLogError( ( "Could not find kid in JSON" ) );
         return eAzureIoTErrorFailed;
@@ -620,7 +485,7 @@ static AzureIoTResult_t prvValidateRootKey( prvJWSValidationContext_t * pxManife
     for( int i = 0; i < ulADURootKeysLength; i++ )
     {
         if( az_span_is_content_equal( az_span_create( ( uint8_t * ) xADURootKeys[ i ].pucRootKeyId, xADURootKeys[ i ].ulRootKeyIdLength ),
-                                      pxManifestContext->kidSpan ) )
+                                      xKIDSpan ) )
         {
             *pulADURootKeyIndex = i;
             return eAzureIoTSuccess;
@@ -634,17 +499,17 @@ static AzureIoTResult_t prvValidateRootKey( prvJWSValidationContext_t * pxManife
     return eAzureIoTErrorFailed;
 }
 
-static AzureIoTResult_t prvVerifySHAMatch( prvJWSValidationContext_t * pxManifestContext,
+static AzureIoTResult_t prvVerifySHAMatch( AzureIoTJWS_ManifestContext_t * pxManifestContext,
                                            const uint8_t * pucManifest,
                                            uint32_t ulManifestLength )
 {
     AzureIoTJSONReader_t xJSONReader;
     AzureIoTResult_t ulVerificationResult;
-    az_result xCoreResult;
+    az_span xSHA256Span;
 
     ulVerificationResult = prvJWS_SHA256Calculate( pucManifest,
                                                    ulManifestLength,
-                                                   pxManifestContext->ucManifestSHACalculation );
+                                                   pxManifestContext->_internal.pucManifestSHACalculation );
 
     if( ulVerificationResult != eAzureIoTSuccess )
     {
@@ -652,37 +517,28 @@ static AzureIoTResult_t prvVerifySHAMatch( prvJWSValidationContext_t * pxManifes
         return ulVerificationResult;
     }
 
-    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->ucJWSPayload, pxManifestContext->outJWSPayloadLength );
+    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->_internal.pucJWSPayload, pxManifestContext->_internal.ulJWSPayloadLength );
 
-    if( prvFindManifestSHA( &xJSONReader, &pxManifestContext->sha256Span ) != eAzureIoTSuccess )
+    if( prvFindManifestSHA( &xJSONReader, &xSHA256Span ) != eAzureIoTSuccess )
     {
         AZLogError( ( "Error finding manifest signature SHA" ) );
         return eAzureIoTErrorFailed;
     }
 
-    xCoreResult = az_base64_decode( az_span_create( pxManifestContext->ucParsedManifestSha, azureiotjwsSHA256_SIZE ),
-                                    pxManifestContext->sha256Span,
-                                    &pxManifestContext->outParsedManifestShaSize );
-
-    if( az_result_failed( xCoreResult ) )
+    if( prvBase64DecodeInPlace( az_span_ptr( xSHA256Span ), ( uint32_t ) az_span_size( xSHA256Span ),
+                                &pxManifestContext->_internal.ulParsedManifestShaSize ) != eAzureIoTSuccess )
     {
-        AZLogError( ( "[JWS] az_base64_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
-
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsSHA256_SIZE ) );
-        }
-
+        AZLogError( ( "[JWS] Decoding manifest SHA failed" ) );
         return eAzureIoTErrorFailed;
     }
 
-    if( pxManifestContext->outParsedManifestShaSize != azureiotjwsSHA256_SIZE )
+    if( pxManifestContext->_internal.ulParsedManifestShaSize != azureiotjwsSHA256_SIZE )
     {
-        AZLogError( ( "[JWS] Base64 decoded SHA256 is not the correct length | expected: %i | actual: %i", azureiotjwsSHA256_SIZE, ( int16_t ) pxManifestContext->outParsedManifestShaSize ) );
+        AZLogError( ( "[JWS] Base64 decoded SHA256 is not the correct length | expected: %i | actual: %i", azureiotjwsSHA256_SIZE, ( int16_t ) pxManifestContext->_internal.ulParsedManifestShaSize ) );
         return eAzureIoTErrorFailed;
     }
 
-    int32_t lComparisonResult = memcmp( pxManifestContext->ucManifestSHACalculation, pxManifestContext->ucParsedManifestSha, azureiotjwsSHA256_SIZE );
+    int32_t lComparisonResult = memcmp( pxManifestContext->_internal.pucManifestSHACalculation, az_span_ptr( xSHA256Span ), azureiotjwsSHA256_SIZE );
 
     if( lComparisonResult != 0 )
     {
@@ -697,32 +553,58 @@ static AzureIoTResult_t prvVerifySHAMatch( prvJWSValidationContext_t * pxManifes
     return eAzureIoTSuccess;
 }
 
-AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
-                                                   uint32_t ulManifestLength,
-                                                   uint8_t * pucJWS,
-                                                   uint32_t ulJWSLength,
-                                                   AzureIoTJWS_RootKey_t * xADURootKeys,
-                                                   uint32_t ulADURootKeysLength,
-                                                   uint8_t * pucScratchBuffer,
-                                                   uint32_t ulScratchBufferLength )
+static void prvSigningKeyCacheFind( AzureIoTJWS_ManifestContext_t * pxManifestContext )
 {
-    az_result xCoreResult;
-    AzureIoTResult_t xResult;
-    AzureIoTJSONReader_t xJSONReader;
-    prvJWSValidationContext_t xManifestContext = { 0 };
-    int32_t lRootKeyIndex;
+    AzureIoTJWS_SigningKeyCache_t * pxCache = pxManifestContext->_internal.pxSigningKeyCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t * pxEntry;
 
-    /* Break up scratch buffer for reusable and persistant sections */
-    uint8_t * ucPersistentScratchSpaceHead = pucScratchBuffer;
-    uint8_t * ucReusableScratchSpaceRoot = ucPersistentScratchSpaceHead + azureiotjwsJWS_HEADER_SIZE + azureiotjwsJWK_PAYLOAD_SIZE;
-    uint8_t * ucReusableScratchSpaceHead = ucReusableScratchSpaceRoot;
+    for( uint32_t ulIndex = 0; ulIndex < pxCache->_internal.ulEntryCount; ulIndex++ )
+    {
+        pxEntry = &pxCache->_internal.pxEntries[ ulIndex ];
 
-    /*------------------- Parse and Decode the JWS Header ------------------------*/
+        if( ( pxEntry->_internal.ulLastUsed != 0 ) &&
+            ( memcmp( pxEntry->_internal.ucSJWKHash, pxManifestContext->_internal.ucSJWKHash, azureiotjwsSHA256_SIZE ) == 0 ) )
+        {
+            pxEntry->_internal.ulLastUsed = ++pxCache->_internal.ulUseCount;
+            pxManifestContext->_internal.pxSigningKeyCacheEntry = pxEntry;
+            AZLogInfo( ( "[JWS] Signing key found in cache" ) );
+            return;
+        }
+    }
+}
 
-    xResult = prvSplitJWS( pucJWS, ulJWSLength,
-                           &xManifestContext.pucBase64EncodedHeader, &xManifestContext.ulBase64EncodedHeaderLength,
-                           &xManifestContext.pucBase64EncodedPayload, &xManifestContext.ulBase64EncodedPayloadLength,
-                           &xManifestContext.pucBase64EncodedSignature, &xManifestContext.ulBase64SignatureLength );
+static void prvSigningKeyCacheAdd( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTJWS_SigningKeyCache_t * pxCache = pxManifestContext->_internal.pxSigningKeyCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t * pxEntry = &pxCache->_internal.pxEntries[ 0 ];
+
+    /* Replace the least recently used entry, empty entries first */
+    for( uint32_t ulIndex = 1; ulIndex < pxCache->_internal.ulEntryCount; ulIndex++ )
+    {
+        if( pxCache->_internal.pxEntries[ ulIndex ]._internal.ulLastUsed < pxEntry->_internal.ulLastUsed )
+        {
+            pxEntry = &pxCache->_internal.pxEntries[ ulIndex ];
+        }
+    }
+
+    memcpy( pxEntry->_internal.ucSJWKHash, pxManifestContext->_internal.ucSJWKHash, azureiotjwsSHA256_SIZE );
+    memcpy( pxEntry->_internal.ucSigningKeyN, pxManifestContext->_internal.pucSigningKeyN,
+            ( size_t ) pxManifestContext->_internal.ulSigningKeyNLength );
+    pxEntry->_internal.ulSigningKeyNLength = pxManifestContext->_internal.ulSigningKeyNLength;
+    memcpy( pxEntry->_internal.ucSigningKeyE, pxManifestContext->_internal.pucSigningKeyE,
+            ( size_t ) pxManifestContext->_internal.ulSigningKeyELength );
+    pxEntry->_internal.ulSigningKeyELength = pxManifestContext->_internal.ulSigningKeyELength;
+    pxEntry->_internal.ulLastUsed = ++pxCache->_internal.ulUseCount;
+}
+
+static AzureIoTResult_t prvStepSplit( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+
+    xResult = prvSplitJWS( pxManifestContext->_internal.pucJWS, pxManifestContext->_internal.ulJWSLength,
+                           &pxManifestContext->_internal.pucBase64EncodedHeader, &pxManifestContext->_internal.ulBase64EncodedHeaderLength,
+                           &pxManifestContext->_internal.pucBase64EncodedPayload, &pxManifestContext->_internal.ulBase64EncodedPayloadLength,
+                           &pxManifestContext->_internal.pucBase64EncodedSignature, &pxManifestContext->_internal.ulBase64SignatureLength );
 
     if( xResult != eAzureIoTSuccess )
     {
@@ -730,41 +612,78 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
         return xResult;
     }
 
-    xManifestContext.ucJWSHeader = ucPersistentScratchSpaceHead;
-    ucPersistentScratchSpaceHead += azureiotjwsJWS_HEADER_SIZE;
-    xCoreResult = az_base64_url_decode( az_span_create( xManifestContext.ucJWSHeader, azureiotjwsJWS_HEADER_SIZE ),
-                                        az_span_create( xManifestContext.pucBase64EncodedHeader, xManifestContext.ulBase64EncodedHeaderLength ),
-                                        &xManifestContext.outJWSHeaderLength );
+    /* The signing input is hashed before its header and payload are decoded over it */
+    xResult = prvJWS_SHA256Calculate( pxManifestContext->_internal.pucBase64EncodedHeader,
+                                      pxManifestContext->_internal.ulBase64EncodedHeaderLength + pxManifestContext->_internal.ulBase64EncodedPayloadLength + 1,
+                                      pxManifestContext->_internal.pucJWSSigningInputHash );
 
-    if( az_result_failed( xCoreResult ) )
+    if( xResult != eAzureIoTSuccess )
     {
-        AZLogError( ( "[JWS] az_base64_url_decode failed: result 0x%08x", ( uint16_t ) xCoreResult ) );
+        AZLogError( ( "[JWS] SHA256 Calculation failed" ) );
+    }
 
-        if( xCoreResult == AZ_ERROR_NOT_ENOUGH_SPACE )
-        {
-            AZLogError( ( "[JWS] Decode buffer was too small: %i bytes", azureiotjwsJWS_HEADER_SIZE ) );
-        }
+    return xResult;
+}
+
+static AzureIoTResult_t prvStepDecodeHeader( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJSONReader_t xJSONReader;
+    az_span xJWKManifestSpan;
+
+    pxManifestContext->_internal.pucJWSHeader = pxManifestContext->_internal.pucBase64EncodedHeader;
 
+    if( prvBase64DecodeInPlace( pxManifestContext->_internal.pucJWSHeader,
+                                pxManifestContext->_internal.ulBase64EncodedHeaderLength,
+                                &pxManifestContext->_internal.ulJWSHeaderLength ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "[JWS] Decoding JWS header failed" ) );
         return eAzureIoTErrorFailed;
     }
 
-    /*------------------- Parse SJWK JSON Payload ------------------------*/
-
     /* The "sjwk" is the signed signing public key */
-    AzureIoTJSONReader_Init( &xJSONReader, xManifestContext.ucJWSHeader, xManifestContext.outJWSHeaderLength );
+    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->_internal.pucJWSHeader, pxManifestContext->_internal.ulJWSHeaderLength );
 
-    if( prvFindSJWKValue( &xJSONReader, &xManifestContext.xJWKManifestSpan ) != eAzureIoTSuccess )
+    if( prvFindSJWKValue( &xJSONReader, &xJWKManifestSpan ) != eAzureIoTSuccess )
     {
         AZLogError( ( "Error finding sjwk value in payload" ) );
         return eAzureIoTErrorFailed;
     }
 
-    /*------------------- Split JWK and Base64 Decode the JWK Payload ------------------------*/
+    pxManifestContext->_internal.pucJWKManifest = az_span_ptr( xJWKManifestSpan );
+    pxManifestContext->_internal.ulJWKManifestLength = ( uint32_t ) az_span_size( xJWKManifestSpan );
+
+    if( pxManifestContext->_internal.pxSigningKeyCache != NULL )
+    {
+        /* Without its hash, the sjwk must not be looked up in nor added to the cache */
+        xResult = prvJWS_SHA256Calculate( pxManifestContext->_internal.pucJWKManifest,
+                                          pxManifestContext->_internal.ulJWKManifestLength,
+                                          pxManifestContext->_internal.ucSJWKHash );
+
+        if( xResult != eAzureIoTSuccess )
+        {
+            AZLogError( ( "[JWS] SHA256 Calculation of the sjwk failed" ) );
+            return xResult;
+        }
+
+        prvSigningKeyCacheFind( pxManifestContext );
+    }
+
+    return eAzureIoTSuccess;
+}
+
+static AzureIoTResult_t prvStepDecodeJWK( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJSONReader_t xJSONReader;
+    az_span xBase64EncodedNSpan = AZ_SPAN_EMPTY;
+    az_span xBase64EncodedESpan = AZ_SPAN_EMPTY;
+    az_span xAlgSpan = AZ_SPAN_EMPTY;
 
-    xResult = prvSplitJWS( az_span_ptr( xManifestContext.xJWKManifestSpan ), az_span_size( xManifestContext.xJWKManifestSpan ),
-                           &xManifestContext.pucJWKBase64EncodedHeader, &xManifestContext.ulJWKBase64EncodedHeaderLength,
-                           &xManifestContext.pucJWKBase64EncodedPayload, &xManifestContext.ulJWKBase64EncodedPayloadLength,
-                           &xManifestContext.pucJWKBase64EncodedSignature, &xManifestContext.ulJWKBase64EncodedSignatureLength );
+    xResult = prvSplitJWS( pxManifestContext->_internal.pucJWKManifest, pxManifestContext->_internal.ulJWKManifestLength,
+                           &pxManifestContext->_internal.pucJWKBase64EncodedHeader, &pxManifestContext->_internal.ulJWKBase64EncodedHeaderLength,
+                           &pxManifestContext->_internal.pucJWKBase64EncodedPayload, &pxManifestContext->_internal.ulJWKBase64EncodedPayloadLength,
+                           &pxManifestContext->_internal.pucJWKBase64EncodedSignature, &pxManifestContext->_internal.ulJWKBase64EncodedSignatureLength );
 
     if( xResult != eAzureIoTSuccess )
     {
@@ -772,19 +691,28 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
         return xResult;
     }
 
-    xManifestContext.ucJWKHeader = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsJWK_HEADER_SIZE;
-    /* Needs to be persisted so we can parse the signing key N and E later */
-    xManifestContext.ucJWKPayload = ucPersistentScratchSpaceHead;
-    ucPersistentScratchSpaceHead += azureiotjwsJWK_PAYLOAD_SIZE;
-    xManifestContext.ucJWKSignature = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSIGNATURE_SIZE;
+    xResult = prvJWS_SHA256Calculate( pxManifestContext->_internal.pucJWKBase64EncodedHeader,
+                                      pxManifestContext->_internal.ulJWKBase64EncodedHeaderLength + pxManifestContext->_internal.ulJWKBase64EncodedPayloadLength + 1,
+                                      pxManifestContext->_internal.pucJWKSigningInputHash );
 
-    prvBase64DecodeJWK( &xManifestContext );
+    if( xResult != eAzureIoTSuccess )
+    {
+        AZLogError( ( "[JWS] SHA256 Calculation failed" ) );
+        return xResult;
+    }
+
+    xResult = prvBase64DecodeJWK( pxManifestContext );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        AZLogError( ( "[JWS] prvBase64DecodeJWK failed" ) );
+        return xResult;
+    }
 
     /*------------------- Parse root key id ------------------------*/
 
-    xResult = prvValidateRootKey( &xManifestContext, xADURootKeys, ulADURootKeysLength, &lRootKeyIndex );
+    xResult = prvValidateRootKey( pxManifestContext, pxManifestContext->_internal.pxADURootKeys,
+                                  pxManifestContext->_internal.ulADURootKeysLength, &pxManifestContext->_internal.lRootKeyIndex );
 
     if( xResult != eAzureIoTSuccess )
     {
@@ -794,43 +722,51 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
 
     /*------------------- Parse necessary pieces for signing key ------------------------*/
 
-    AzureIoTJSONReader_Init( &xJSONReader, xManifestContext.ucJWKPayload, xManifestContext.outJWKPayloadLength );
+    AzureIoTJSONReader_Init( &xJSONReader, pxManifestContext->_internal.pucJWKPayload, pxManifestContext->_internal.ulJWKPayloadLength );
 
-    if( prvFindKeyParts( &xJSONReader, &xManifestContext.xBase64EncodedNSpan, &xManifestContext.xBase64EncodedESpan, &xManifestContext.xAlgSpan ) != eAzureIoTSuccess )
+    if( prvFindKeyParts( &xJSONReader, &xBase64EncodedNSpan, &xBase64EncodedESpan, &xAlgSpan ) != eAzureIoTSuccess )
     {
         AZLogError( ( "Could not find parts for the signing key" ) );
         return eAzureIoTErrorFailed;
     }
 
-    /*------------------- Verify the signature ------------------------*/
+    pxManifestContext->_internal.pucBase64EncodedN = az_span_ptr( xBase64EncodedNSpan );
+    pxManifestContext->_internal.ulBase64EncodedNLength = ( uint32_t ) az_span_size( xBase64EncodedNSpan );
+    pxManifestContext->_internal.pucBase64EncodedE = az_span_ptr( xBase64EncodedESpan );
+    pxManifestContext->_internal.ulBase64EncodedELength = ( uint32_t ) az_span_size( xBase64EncodedESpan );
+    pxManifestContext->_internal.pucAlg = az_span_ptr( xAlgSpan );
+    pxManifestContext->_internal.ulAlgLength = ( uint32_t ) az_span_size( xAlgSpan );
 
-    xManifestContext.ucScratchCalculationBuffer = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSHA_CALCULATION_SCRATCH_SIZE;
-    xResult = prvJWS_RS256Verify( xManifestContext.pucJWKBase64EncodedHeader, xManifestContext.ulJWKBase64EncodedHeaderLength + xManifestContext.ulJWKBase64EncodedPayloadLength + 1,
-                                  xManifestContext.ucJWKSignature, xManifestContext.outJWKSignatureLength,
-                                  ( uint8_t * ) xADURootKeys[ lRootKeyIndex ].pucRootKeyN, xADURootKeys[ lRootKeyIndex ].ulRootKeyNLength,
-                                  ( uint8_t * ) xADURootKeys[ lRootKeyIndex ].pucRootKeyExponent, xADURootKeys[ lRootKeyIndex ].ulRootKeyExponentLength,
-                                  xManifestContext.ucScratchCalculationBuffer, azureiotjwsSHA_CALCULATION_SCRATCH_SIZE );
+    return eAzureIoTSuccess;
+}
+
+static AzureIoTResult_t prvStepVerifyJWK( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJWS_RootKey_t * pxRootKey = &pxManifestContext->_internal.pxADURootKeys[ pxManifestContext->_internal.lRootKeyIndex ];
+
+    xResult = AzureIoTCrypto_RS256VerifyDigest( pxManifestContext->_internal.pucJWKSigningInputHash,
+                                                pxManifestContext->_internal.pucJWKSignature, pxManifestContext->_internal.ulJWKSignatureLength,
+                                                pxRootKey->pucRootKeyN, pxRootKey->ulRootKeyNLength,
+                                                pxRootKey->pucRootKeyExponent, pxRootKey->ulRootKeyExponentLength );
 
     if( xResult != eAzureIoTSuccess )
     {
-        AZLogError( ( "[JWS] prvJWS_RS256Verify failed" ) );
-        return xResult;
+        AZLogError( ( "[JWS] Verification of the JWK with the root key failed" ) );
     }
 
-    /*------------------- Reuse Buffer Space ------------------------*/
+    return xResult;
+}
 
-    /* The JWK verification is now done, so we can reuse the buffers which it used. */
-    ucReusableScratchSpaceHead = ucReusableScratchSpaceRoot;
+static AzureIoTResult_t prvStepDecodeSigningKey( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJWS_SigningKeyCacheEntry_t * pxEntry = pxManifestContext->_internal.pxSigningKeyCacheEntry;
+    az_span xAlgSpan = az_span_create( pxManifestContext->_internal.pucAlg, pxManifestContext->_internal.ulAlgLength );
 
     /*------------------- Decode remaining values from JWS ------------------------*/
 
-    xManifestContext.ucJWSPayload = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsJWS_PAYLOAD_SIZE;
-    xManifestContext.ucJWSSignature = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSIGNATURE_SIZE;
-
-    xResult = prvBase64DecodeJWSHeaderAndPayload( &xManifestContext );
+    xResult = prvBase64DecodeJWSHeaderAndPayload( pxManifestContext );
 
     if( xResult != eAzureIoTSuccess )
     {
@@ -840,12 +776,18 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
 
     /*------------------- Base64 decode the signing key ------------------------*/
 
-    xManifestContext.ucSigningKeyN = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsRSA3072_SIZE;
-    xManifestContext.ucSigningKeyE = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSIGNING_KEY_E_SIZE;
+    if( pxEntry != NULL )
+    {
+        /* Already decoded, and its algorithm checked, when added to the cache */
+        pxManifestContext->_internal.pucSigningKeyN = pxEntry->_internal.ucSigningKeyN;
+        pxManifestContext->_internal.ulSigningKeyNLength = pxEntry->_internal.ulSigningKeyNLength;
+        pxManifestContext->_internal.pucSigningKeyE = pxEntry->_internal.ucSigningKeyE;
+        pxManifestContext->_internal.ulSigningKeyELength = pxEntry->_internal.ulSigningKeyELength;
+
+        return eAzureIoTSuccess;
+    }
 
-    xResult = prvBase64DecodeSigningKey( &xManifestContext );
+    xResult = prvBase64DecodeSigningKey( pxManifestContext );
 
     if( xResult != eAzureIoTSuccess )
     {
@@ -853,34 +795,236 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
         return xResult;
     }
 
-    /*------------------- Verify that the signature was signed by signing key ------------------------*/
-
-    if( !az_span_is_content_equal( xManifestContext.xAlgSpan, az_span_create( ( uint8_t * ) jws_alg_rs256, sizeof( jws_alg_rs256 ) - 1 ) ) )
+    if( !az_span_is_content_equal( xAlgSpan, az_span_create( ( uint8_t * ) jws_alg_rs256, sizeof( jws_alg_rs256 ) - 1 ) ) )
     {
         AZLogError( ( "[JWS] Algorithm not supported | expected %.*s | actual %.*s",
                       sizeof( jws_alg_rs256 ) - 1, jws_alg_rs256,
-                      ( int16_t ) az_span_size( xManifestContext.xAlgSpan ), az_span_ptr( xManifestContext.xAlgSpan ) ) );
+                      ( int16_t ) az_span_size( xAlgSpan ), az_span_ptr( xAlgSpan ) ) );
         return eAzureIoTErrorFailed;
     }
 
-    xResult = prvJWS_RS256Verify( xManifestContext.pucBase64EncodedHeader, xManifestContext.ulBase64EncodedHeaderLength + xManifestContext.ulBase64EncodedPayloadLength + 1,
-                                  xManifestContext.ucJWSSignature, xManifestContext.outJWSSignatureLength,
-                                  xManifestContext.ucSigningKeyN, xManifestContext.outSigningKeyNLength,
-                                  xManifestContext.ucSigningKeyE, xManifestContext.outSigningKeyELength,
-                                  xManifestContext.ucScratchCalculationBuffer, azureiotjwsSHA_CALCULATION_SCRATCH_SIZE );
+    /* The JWK was verified with the root key in the previous step */
+    if( pxManifestContext->_internal.pxSigningKeyCache != NULL )
+    {
+        prvSigningKeyCacheAdd( pxManifestContext );
+    }
+
+    return eAzureIoTSuccess;
+}
+
+static AzureIoTResult_t prvStepVerifyJWS( AzureIoTJWS_ManifestContext_t * pxManifestContext )
+{
+    AzureIoTResult_t xResult;
+
+    xResult = AzureIoTCrypto_RS256VerifyDigest( pxManifestContext->_internal.pucJWSSigningInputHash,
+                                                pxManifestContext->_internal.pucJWSSignature, pxManifestContext->_internal.ulJWSSignatureLength,
+                                                pxManifestContext->_internal.pucSigningKeyN, pxManifestContext->_internal.ulSigningKeyNLength,
+                                                pxManifestContext->_internal.pucSigningKeyE, pxManifestContext->_internal.ulSigningKeyELength );
 
     if( xResult != eAzureIoTSuccess )
     {
         AZLogError( ( "[JWS] Verification of signed manifest SHA failed" ) );
+    }
+
+    return xResult;
+}
+
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateInit( AzureIoTJWS_ManifestContext_t * pxContext,
+                                                       const uint8_t * pucManifest,
+                                                       uint32_t ulManifestLength,
+                                                       uint8_t * pucJWS,
+                                                       uint32_t ulJWSLength,
+                                                       AzureIoTJWS_RootKey_t * xADURootKeys,
+                                                       uint32_t ulADURootKeysLength,
+                                                       uint8_t * pucScratchBuffer,
+                                                       uint32_t ulScratchBufferLength )
+{
+    if( ( pxContext == NULL ) || ( pucManifest == NULL ) || ( pucJWS == NULL ) ||
+        ( xADURootKeys == NULL ) || ( pucScratchBuffer == NULL ) )
+    {
+        AZLogError( ( "AzureIoTJWS_ManifestAuthenticateInit failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( ulScratchBufferLength < azureiotjwsSCRATCH_BUFFER_SIZE )
+    {
+        AZLogError( ( "[JWS] Scratch buffer too small: %u < %u bytes",
+                      ( unsigned ) ulScratchBufferLength, ( unsigned ) azureiotjwsSCRATCH_BUFFER_SIZE ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    memset( pxContext, 0, sizeof( AzureIoTJWS_ManifestContext_t ) );
+    pxContext->_internal.ulStep = azureiotjwsSTEP_SPLIT;
+    pxContext->_internal.xResult = eAzureIoTErrorPending;
+    pxContext->_internal.pucManifest = pucManifest;
+    pxContext->_internal.ulManifestLength = ulManifestLength;
+    pxContext->_internal.pucJWS = pucJWS;
+    pxContext->_internal.ulJWSLength = ulJWSLength;
+    pxContext->_internal.pxADURootKeys = xADURootKeys;
+    pxContext->_internal.ulADURootKeysLength = ulADURootKeysLength;
+    pxContext->_internal.lRootKeyIndex = -1;
+
+    /* Everything else is decoded in place in pucJWS. The manifest SHA reuses the JWK hash once it is verified. */
+    pxContext->_internal.pucJWSSigningInputHash = pucScratchBuffer;
+    pxContext->_internal.pucJWKSigningInputHash = pucScratchBuffer + azureiotjwsSHA256_SIZE;
+    pxContext->_internal.pucManifestSHACalculation = pxContext->_internal.pucJWKSigningInputHash;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateStep( AzureIoTJWS_ManifestContext_t * pxContext )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxContext == NULL )
+    {
+        AZLogError( ( "AzureIoTJWS_ManifestAuthenticateStep failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxContext->_internal.xResult != eAzureIoTErrorPending )
+    {
+        return pxContext->_internal.xResult;
+    }
+
+    switch( pxContext->_internal.ulStep )
+    {
+        case azureiotjwsSTEP_SPLIT:
+            xResult = prvStepSplit( pxContext );
+            break;
+
+        case azureiotjwsSTEP_DECODE_HEADER:
+            xResult = prvStepDecodeHeader( pxContext );
+            break;
+
+        case azureiotjwsSTEP_DECODE_JWK:
+            xResult = prvStepDecodeJWK( pxContext );
+            break;
+
+        case azureiotjwsSTEP_VERIFY_JWK:
+            xResult = prvStepVerifyJWK( pxContext );
+            break;
+
+        case azureiotjwsSTEP_DECODE_SIGNING_KEY:
+            xResult = prvStepDecodeSigningKey( pxContext );
+            break;
+
+        case azureiotjwsSTEP_VERIFY_JWS:
+            xResult = prvStepVerifyJWS( pxContext );
+            break;
+
+        case azureiotjwsSTEP_COMPARE_SHA:
+            xResult = prvVerifySHAMatch( pxContext, pxContext->_internal.pucManifest, pxContext->_internal.ulManifestLength );
+            break;
+
+        default:
+            xResult = eAzureIoTErrorFailed;
+            break;
+    }
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        pxContext->_internal.xResult = xResult;
         return xResult;
     }
 
-    /*------------------- Verify that the SHAs match ------------------------*/
+    pxContext->_internal.ulStep++;
 
-    xManifestContext.ucManifestSHACalculation = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSHA256_SIZE;
-    xManifestContext.ucParsedManifestSha = ucReusableScratchSpaceHead;
-    ucReusableScratchSpaceHead += azureiotjwsSHA256_SIZE;
+    /* A cached signing key is already decoded and verified */
+    if( ( pxContext->_internal.ulStep == azureiotjwsSTEP_DECODE_JWK ) &&
+        ( pxContext->_internal.pxSigningKeyCacheEntry != NULL ) )
+    {
+        pxContext->_internal.ulStep = azureiotjwsSTEP_DECODE_SIGNING_KEY;
+    }
 
-    return prvVerifySHAMatch( &xManifestContext, pucManifest, ulManifestLength );
+    if( pxContext->_internal.ulStep == azureiotjwsSTEP_DONE )
+    {
+        pxContext->_internal.xResult = eAzureIoTSuccess;
+    }
+
+    return pxContext->_internal.xResult;
+}
+
+AzureIoTResult_t AzureIoTJWS_SigningKeyCacheInit( AzureIoTJWS_SigningKeyCache_t * pxCache,
+                                                  AzureIoTJWS_SigningKeyCacheEntry_t * pxEntries,
+                                                  uint32_t ulEntryCount )
+{
+    if( ( pxCache == NULL ) || ( pxEntries == NULL ) || ( ulEntryCount == 0 ) )
+    {
+        AZLogError( ( "AzureIoTJWS_SigningKeyCacheInit failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxEntries, 0, sizeof( AzureIoTJWS_SigningKeyCacheEntry_t ) * ulEntryCount );
+    memset( pxCache, 0, sizeof( AzureIoTJWS_SigningKeyCache_t ) );
+    pxCache->_internal.pxEntries = pxEntries;
+    pxCache->_internal.ulEntryCount = ulEntryCount;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( AzureIoTJWS_ManifestContext_t * pxContext,
+                                                                     AzureIoTJWS_SigningKeyCache_t * pxCache )
+{
+    if( ( pxContext == NULL ) || ( pxCache == NULL ) ||
+        ( pxContext->_internal.ulStep != azureiotjwsSTEP_SPLIT ) ||
+        ( pxContext->_internal.xResult != eAzureIoTErrorPending ) )
+    {
+        AZLogError( ( "AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxContext->_internal.pxSigningKeyCache = pxCache;
+
+    return eAzureIoTSuccess;
+}
+
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
+                                                   uint32_t ulManifestLength,
+                                                   uint8_t * pucJWS,
+                                                   uint32_t ulJWSLength,
+                                                   AzureIoTJWS_RootKey_t * xADURootKeys,
+                                                   uint32_t ulADURootKeysLength,
+                                                   uint8_t * pucScratchBuffer,
+                                                   uint32_t ulScratchBufferLength )
+{
+    return AzureIoTJWS_ManifestAuthenticateWithCache( pucManifest, ulManifestLength, pucJWS, ulJWSLength,
+                                                      xADURootKeys, ulADURootKeysLength,
+                                                      pucScratchBuffer, ulScratchBufferLength, NULL );
+}
+
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateWithCache( const uint8_t * pucManifest,
+                                                            uint32_t ulManifestLength,
+                                                            uint8_t * pucJWS,
+                                                            uint32_t ulJWSLength,
+                                                            AzureIoTJWS_RootKey_t * xADURootKeys,
+                                                            uint32_t ulADURootKeysLength,
+                                                            uint8_t * pucScratchBuffer,
+                                                            uint32_t ulScratchBufferLength,
+                                                            AzureIoTJWS_SigningKeyCache_t * pxCache )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJWS_ManifestContext_t xManifestContext;
+
+    xResult = AzureIoTJWS_ManifestAuthenticateInit( &xManifestContext, pucManifest, ulManifestLength,
+                                                    pucJWS, ulJWSLength, xADURootKeys, ulADURootKeysLength,
+                                                    pucScratchBuffer, ulScratchBufferLength );
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        return xResult;
+    }
+
+    if( ( pxCache != NULL ) &&
+        ( ( xResult = AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( &xManifestContext, pxCache ) ) != eAzureIoTSuccess ) )
+    {
+        return xResult;
+    }
+
+    do
+    {
+        xResult = AzureIoTJWS_ManifestAuthenticateStep( &xManifestContext );
+    } while( xResult == eAzureIoTErrorPending );
+
+    return xResult;
 }
@@ -21,6 +21,8 @@
 
 /* Using SHA256 hash - needs 32 bytes */
 #define azureiotBASE64_HASH_BUFFER_SIZE    ( 33 )
+#define azureiotFNV1A_32_PRIME             ( 0x01000193U )
+#define azureiotFNV1A_64_PRIME             ( 0x00000100000001B3ULL )
 
 /*-----------------------------------------------------------*/
 
@@ -97,6 +99,33 @@ AzureIoTResult_t AzureIoT_TranslateCoreError( az_result xCoreError )
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * Base64 encode the HMAC hash into the SAS signature.
+ *
+ **/
+static AzureIoTResult_t prvHashBase64Encode( const uint8_t * pucHash,
+                                             uint32_t ulHashLength,
+                                             uint8_t * pucOutput,
+                                             uint32_t ulOutputSize,
+                                             uint32_t * pulOutputLength )
+{
+    az_result xCoreResult;
+    int32_t lEncodedLength;
+    az_span xHashSpan = az_span_create( ( uint8_t * ) pucHash, ( int32_t ) ulHashLength );
+    az_span xOutputEncodedHashSpan = az_span_create( pucOutput, ( int32_t ) ulOutputSize );
+
+    if( az_result_failed( xCoreResult = az_base64_encode( xOutputEncodedHashSpan, xHashSpan, &lEncodedLength ) ) )
+    {
+        AZLogError( ( "az_base64_encode failed: core error=0x%08x", ( uint16_t ) xCoreResult ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    *pulOutputLength = ( uint32_t ) lEncodedLength;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
 AzureIoTResult_t AzureIoT_Init( void )
 {
     #ifdef AZLogInfo
@@ -126,15 +155,10 @@ AzureIoTResult_t AzureIoT_Base64HMACCalculate( AzureIoTGetHMACFunc_t xAzureIoTHM
                                                uint32_t * pulOutputLength )
 {
     az_result xCoreResult;
-    uint8_t * pucHashBuf;
     uint8_t * pucDecodedKeyBuf = pucBuffer;
-    uint32_t ulHashBufSize = azureiotBASE64_HASH_BUFFER_SIZE;
     int32_t lDecodedKeyLength;
-    int32_t lEncodedLength;
     az_span xEncodedKeySpan;
     az_span xOutputDecodedKeySpan;
-    az_span xHashSpan;
-    az_span xOutputEncodedHashSpan;
 
     if( ( xAzureIoTHMACFunction == NULL ) ||
         ( pucKey == NULL ) || ( ulKeySize == 0 ) ||
@@ -158,32 +182,122 @@ AzureIoTResult_t AzureIoT_Base64HMACCalculate( AzureIoTGetHMACFunc_t xAzureIoTHM
     /* Decoded key is less than total decoded buffer size */
     ulBufferLength -= ( uint32_t ) lDecodedKeyLength;
 
+    return AzureIoT_HMACBase64Encode( xAzureIoTHMACFunction,
+                                      pucDecodedKeyBuf, ( uint32_t ) lDecodedKeyLength,
+                                      pucMessage, ulMessageSize,
+                                      pucDecodedKeyBuf + lDecodedKeyLength, ulBufferLength,
+                                      pucOutput, ulOutputSize, pulOutputLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoT_HMACBase64Encode( AzureIoTGetHMACFunc_t xAzureIoTHMACFunction,
+                                            const uint8_t * pucDecodedKey,
+                                            uint32_t ulDecodedKeySize,
+                                            const uint8_t * pucMessage,
+                                            uint32_t ulMessageSize,
+                                            uint8_t * pucBuffer,
+                                            uint32_t ulBufferLength,
+                                            uint8_t * pucOutput,
+                                            uint32_t ulOutputSize,
+                                            uint32_t * pulOutputLength )
+{
+    uint8_t * pucHashBuf = pucBuffer;
+    uint32_t ulHashBufSize = azureiotBASE64_HASH_BUFFER_SIZE;
+
+    if( ( xAzureIoTHMACFunction == NULL ) ||
+        ( pucDecodedKey == NULL ) || ( ulDecodedKeySize == 0 ) ||
+        ( pucMessage == NULL ) || ( ulMessageSize == 0 ) ||
+        ( pucBuffer == NULL ) ||
+        ( pucOutput == NULL ) || ( pulOutputLength == NULL ) )
+    {
+        AZLogError( ( "AzureIoT_HMACBase64Encode failed: Invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
     if( ulHashBufSize > ulBufferLength )
     {
         return eAzureIoTErrorOutOfMemory;
     }
 
-    pucHashBuf = pucDecodedKeyBuf + lDecodedKeyLength;
     memset( pucHashBuf, 0, ulHashBufSize );
 
-    if( xAzureIoTHMACFunction( pucDecodedKeyBuf, ( uint32_t ) lDecodedKeyLength,
+    if( xAzureIoTHMACFunction( pucDecodedKey, ulDecodedKeySize,
                                pucMessage, ( uint32_t ) ulMessageSize,
                                pucHashBuf, ulHashBufSize, &ulHashBufSize ) )
     {
         return eAzureIoTErrorFailed;
     }
 
-    xHashSpan = az_span_create( pucHashBuf, ( int32_t ) ulHashBufSize );
-    xOutputEncodedHashSpan = az_span_create( pucOutput, ( int32_t ) ulOutputSize );
+    return prvHashBase64Encode( pucHashBuf, ulHashBufSize, pucOutput, ulOutputSize, pulOutputLength );
+}
+/*-----------------------------------------------------------*/
 
-    if( az_result_failed( xCoreResult = az_base64_encode( xOutputEncodedHashSpan, xHashSpan, &lEncodedLength ) ) )
+AzureIoTResult_t AzureIoT_HMACContextBase64Encode( AzureIoTGetHMACContextFunc_t xAzureIoTHMACContextFunction,
+                                                   void * pvHMACContext,
+                                                   const uint8_t * pucMessage,
+                                                   uint32_t ulMessageSize,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint8_t * pucOutput,
+                                                   uint32_t ulOutputSize,
+                                                   uint32_t * pulOutputLength )
+{
+    uint8_t * pucHashBuf = pucBuffer;
+    uint32_t ulHashBufSize = azureiotBASE64_HASH_BUFFER_SIZE;
+
+    if( ( xAzureIoTHMACContextFunction == NULL ) ||
+        ( pucMessage == NULL ) || ( ulMessageSize == 0 ) ||
+        ( pucBuffer == NULL ) ||
+        ( pucOutput == NULL ) || ( pulOutputLength == NULL ) )
+    {
+        AZLogError( ( "AzureIoT_HMACContextBase64Encode failed: Invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( ulHashBufSize > ulBufferLength )
+    {
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    memset( pucHashBuf, 0, ulHashBufSize );
+
+    if( xAzureIoTHMACContextFunction( pvHMACContext,
+                                      pucMessage, ulMessageSize,
+                                      pucHashBuf, ulHashBufSize, &ulHashBufSize ) )
     {
-        AZLogError( ( "az_base64_decode failed: core error=0x%08x", ( uint16_t ) xCoreResult ) );
         return eAzureIoTErrorFailed;
     }
 
-    *pulOutputLength = ( uint32_t ) lEncodedLength;
+    return prvHashBase64Encode( pucHashBuf, ulHashBufSize, pucOutput, ulOutputSize, pulOutputLength );
+}
+/*-----------------------------------------------------------*/
 
-    return eAzureIoTSuccess;
+uint32_t AzureIoT_FNV1a32( uint32_t ulHash,
+                           const uint8_t * pucData,
+                           uint32_t ulDataLength )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < ulDataLength; ulIndex++ )
+    {
+        ulHash = ( ulHash ^ pucData[ ulIndex ] ) * azureiotFNV1A_32_PRIME;
+    }
+
+    return ulHash;
+}
+/*-----------------------------------------------------------*/
+
+uint64_t AzureIoT_FNV1a64( uint64_t ullHash,
+                           const uint8_t * pucData,
+                           uint32_t ulDataLength )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < ulDataLength; ulIndex++ )
+    {
+        ullHash = ( ullHash ^ pucData[ ulIndex ] ) * azureiotFNV1A_64_PRIME;
+    }
+
+    return ullHash;
 }
 /*-----------------------------------------------------------*/
@@ -0,0 +1,346 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_adu_download.c
+ * @brief Implementation of the streaming ADU image download.
+ */
+
+#include "azure_iot_adu_download.h"
+
+#include <string.h>
+
+#include "azure_iot.h"
+
+#include "azure/core/az_base64.h"
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Request one range of the image into the active response buffer, retrying on failure.
+ *
+ * */
+static AzureIoTResult_t prvRequestChunk( AzureIoTADUDownload_t * pxDownload,
+                                         uint32_t ulRangeEnd,
+                                         char ** ppcData,
+                                         uint32_t * pulDataLength )
+{
+    AzureIoTHTTPResult_t xHTTPResult;
+    uint32_t ulRequestLength = ulRangeEnd - pxDownload->_internal.ulCommittedOffset + 1;
+    uint32_t ulAttempt;
+
+    for( ulAttempt = 0; ulAttempt <= pxDownload->_internal.xOptions.ulMaxRetries; ulAttempt++ )
+    {
+        *ppcData = NULL;
+        *pulDataLength = 0;
+
+        xHTTPResult = AzureIoTHTTP_Request( pxDownload->_internal.xHTTPHandle,
+                                            ( int32_t ) pxDownload->_internal.ulCommittedOffset,
+                                            ( int32_t ) ulRangeEnd,
+                                            pxDownload->_internal.pcResponseBuffer[ pxDownload->_internal.ulActiveBuffer ],
+                                            pxDownload->_internal.ulResponseBufferLength,
+                                            ppcData,
+                                            pulDataLength );
+
+        if( ( xHTTPResult == eAzureIoTHTTPSuccess ) && ( *ppcData != NULL ) &&
+            ( *pulDataLength > 0 ) && ( *pulDataLength <= ulRequestLength ) )
+        {
+            return eAzureIoTSuccess;
+        }
+
+        AZLogWarn( ( "ADU download range request at offset %d failed: error=%d, attempt=%d",
+                     ( int ) pxDownload->_internal.ulCommittedOffset, xHTTPResult, ( int ) ulAttempt ) );
+    }
+
+    return eAzureIoTErrorFailed;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTADUDownload_OptionsInit( AzureIoTADUDownloadOptions_t * pxOptions )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxOptions == NULL )
+    {
+        AZLogError( ( "AzureIoTADUDownload_OptionsInit failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        memset( pxOptions, 0, sizeof( AzureIoTADUDownloadOptions_t ) );
+        pxOptions->ulChunkSize = azureiotconfigADU_DOWNLOAD_CHUNK_SIZE;
+        pxOptions->ulMaxRetries = azureiotconfigADU_DOWNLOAD_MAX_RETRIES;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTADUDownload_Init( AzureIoTADUDownload_t * pxDownload,
+                                           AzureIoTHTTPHandle_t xHTTPHandle,
+                                           AzureIoTTransportInterface_t * pxHTTPTransport,
+                                           AzureADUImage_t * pxAduImage,
+                                           const char * pcHost,
+                                           uint32_t ulHostLength,
+                                           const char * pcPath,
+                                           uint32_t ulPathLength,
+                                           char * pcHeaderBuffer,
+                                           uint32_t ulHeaderBufferLength,
+                                           char * pcResponseBuffer,
+                                           uint32_t ulResponseBufferLength,
+                                           AzureIoTADUDownloadOptions_t * pxOptions )
+{
+    AzureIoTADUDownloadOptions_t xOptions;
+
+    if( ( pxDownload == NULL ) || ( xHTTPHandle == NULL ) || ( pxHTTPTransport == NULL ) ||
+        ( pxAduImage == NULL ) || ( pcHost == NULL ) || ( ulHostLength == 0 ) ||
+        ( pcPath == NULL ) || ( ulPathLength == 0 ) ||
+        ( pcHeaderBuffer == NULL ) || ( ulHeaderBufferLength == 0 ) ||
+        ( pcResponseBuffer == NULL ) )
+    {
+        AZLogError( ( "AzureIoTADUDownload_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxOptions == NULL )
+    {
+        ( void ) AzureIoTADUDownload_OptionsInit( &xOptions );
+    }
+    else
+    {
+        xOptions = *pxOptions;
+    }
+
+    /* Each half holds the response headers on top of the chunk. */
+    if( ( xOptions.ulChunkSize == 0 ) || ( ( ulResponseBufferLength / 2 ) <= xOptions.ulChunkSize ) )
+    {
+        AZLogError( ( "AzureIoTADUDownload_Init failed: response buffer too small for chunk size" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxDownload, 0, sizeof( AzureIoTADUDownload_t ) );
+
+    pxDownload->_internal.xHTTPHandle = xHTTPHandle;
+    pxDownload->_internal.pxHTTPTransport = pxHTTPTransport;
+    pxDownload->_internal.pxAduImage = pxAduImage;
+    pxDownload->_internal.pcHost = pcHost;
+    pxDownload->_internal.ulHostLength = ulHostLength;
+    pxDownload->_internal.pcPath = pcPath;
+    pxDownload->_internal.ulPathLength = ulPathLength;
+    pxDownload->_internal.pcHeaderBuffer = pcHeaderBuffer;
+    pxDownload->_internal.ulHeaderBufferLength = ulHeaderBufferLength;
+    pxDownload->_internal.ulResponseBufferLength = ulResponseBufferLength / 2;
+    pxDownload->_internal.pcResponseBuffer[ 0 ] = pcResponseBuffer;
+    pxDownload->_internal.pcResponseBuffer[ 1 ] = pcResponseBuffer + pxDownload->_internal.ulResponseBufferLength;
+    pxDownload->_internal.xOptions = xOptions;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTADUDownload_Start( AzureIoTADUDownload_t * pxDownload,
+                                            uint32_t ulResumeOffset )
+{
+    AzureIoTHTTPResult_t xHTTPResult;
+    int32_t lImageSize;
+
+    if( pxDownload == NULL )
+    {
+        AZLogError( ( "AzureIoTADUDownload_Start failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxDownload->_internal.xStarted = false;
+    pxDownload->_internal.xHashing = false;
+    pxDownload->_internal.xDigestReady = false;
+
+    if( ( xHTTPResult = AzureIoTHTTP_RequestSizeInit( pxDownload->_internal.xHTTPHandle,
+                                                      pxDownload->_internal.pxHTTPTransport,
+                                                      pxDownload->_internal.pcHost,
+                                                      pxDownload->_internal.ulHostLength,
+                                                      pxDownload->_internal.pcPath,
+                                                      pxDownload->_internal.ulPathLength,
+                                                      pxDownload->_internal.pcHeaderBuffer,
+                                                      pxDownload->_internal.ulHeaderBufferLength ) ) != eAzureIoTHTTPSuccess )
+    {
+        AZLogError( ( "Failed to initialize ADU image size request: error=%d", xHTTPResult ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    lImageSize = AzureIoTHTTP_RequestSize( pxDownload->_internal.xHTTPHandle,
+                                           pxDownload->_internal.pcResponseBuffer[ 0 ],
+                                           pxDownload->_internal.ulResponseBufferLength );
+
+    if( lImageSize < 0 )
+    {
+        AZLogError( ( "Failed to request ADU image size" ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    if( ulResumeOffset > ( uint32_t ) lImageSize )
+    {
+        AZLogError( ( "AzureIoTADUDownload_Start failed: resume offset past the image size" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* GET headers are built once for the whole download, each request only sets its range. */
+    if( ( xHTTPResult = AzureIoTHTTP_Init( pxDownload->_internal.xHTTPHandle,
+                                           pxDownload->_internal.pxHTTPTransport,
+                                           pxDownload->_internal.pcHost,
+                                           pxDownload->_internal.ulHostLength,
+                                           pxDownload->_internal.pcPath,
+                                           pxDownload->_internal.ulPathLength,
+                                           pxDownload->_internal.pcHeaderBuffer,
+                                           pxDownload->_internal.ulHeaderBufferLength ) ) != eAzureIoTHTTPSuccess )
+    {
+        AZLogError( ( "Failed to initialize ADU image request: error=%d", xHTTPResult ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    pxDownload->_internal.ulImageSize = ( uint32_t ) lImageSize;
+    pxDownload->_internal.ulCommittedOffset = ulResumeOffset;
+    pxDownload->_internal.ulActiveBuffer = 0;
+    pxDownload->_internal.xStarted = true;
+
+    /* Bytes committed before a reboot cannot be hashed without reading them back. */
+    if( ulResumeOffset == 0 )
+    {
+        pxDownload->_internal.xHashing = ( AzureIoTCrypto_SHA256Init( &pxDownload->_internal.xSHA256Context ) == eAzureIoTSuccess );
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTADUDownload_Process( AzureIoTADUDownload_t * pxDownload )
+{
+    AzureIoTResult_t xResult;
+    uint32_t ulRangeEnd;
+    char * pcData;
+    uint32_t ulDataLength;
+
+    if( ( pxDownload == NULL ) || !pxDownload->_internal.xStarted )
+    {
+        AZLogError( ( "AzureIoTADUDownload_Process failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( AzureIoTADUDownload_IsComplete( pxDownload ) )
+    {
+        return eAzureIoTSuccess;
+    }
+
+    ulRangeEnd = pxDownload->_internal.ulImageSize - pxDownload->_internal.ulCommittedOffset;
+
+    if( ulRangeEnd > pxDownload->_internal.xOptions.ulChunkSize )
+    {
+        ulRangeEnd = pxDownload->_internal.xOptions.ulChunkSize;
+    }
+
+    ulRangeEnd += pxDownload->_internal.ulCommittedOffset - 1;
+
+    if( ( xResult = prvRequestChunk( pxDownload, ulRangeEnd, &pcData, &ulDataLength ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to download ADU image chunk, resume from offset %d", ( int ) pxDownload->_internal.ulCommittedOffset ) );
+    }
+    else if( ( xResult = AzureIoTPlatform_WriteBlock( pxDownload->_internal.pxAduImage,
+                                                      pxDownload->_internal.ulCommittedOffset,
+                                                      ( uint8_t * ) pcData,
+                                                      ulDataLength ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to write ADU image block: error=0x%08x", xResult ) );
+    }
+    else
+    {
+        if( pxDownload->_internal.xHashing &&
+            ( AzureIoTCrypto_SHA256Update( &pxDownload->_internal.xSHA256Context,
+                                           ( const uint8_t * ) pcData, ulDataLength ) != eAzureIoTSuccess ) )
+        {
+            AZLogWarn( ( "ADU image hash update failed, image will be verified from flash" ) );
+            pxDownload->_internal.xHashing = false;
+        }
+
+        /* A short body only commits what was received, the rest is requested next. */
+        pxDownload->_internal.ulCommittedOffset += ulDataLength;
+
+        /* Keep the block just written untouched while the next chunk is received. */
+        pxDownload->_internal.ulActiveBuffer ^= 1;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTADUDownload_VerifyImage( AzureIoTADUDownload_t * pxDownload,
+                                                  const AzureIoTADUUpdateManifestFileHash_t * pxFileHash )
+{
+    AzureIoTResult_t xResult;
+    az_result xCoreResult;
+    uint8_t ucExpectedDigest[ azureiotcryptoSHA256_SIZE ];
+    int32_t lExpectedDigestLength;
+
+    if( ( pxFileHash == NULL ) || ( pxFileHash->pucHash == NULL ) || ( pxFileHash->ulHashLength == 0 ) ||
+        !AzureIoTADUDownload_IsComplete( pxDownload ) )
+    {
+        AZLogError( ( "AzureIoTADUDownload_VerifyImage failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxDownload->_internal.xHashing )
+    {
+        if( ( xResult = AzureIoTCrypto_SHA256Finish( &pxDownload->_internal.xSHA256Context,
+                                                     pxDownload->_internal.ucDigest,
+                                                     sizeof( pxDownload->_internal.ucDigest ) ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to finish ADU image hash: error=0x%08x", xResult ) );
+            return xResult;
+        }
+
+        pxDownload->_internal.xHashing = false;
+        pxDownload->_internal.xDigestReady = true;
+    }
+
+    if( !pxDownload->_internal.xDigestReady )
+    {
+        return AzureIoTPlatform_VerifyImage( pxDownload->_internal.pxAduImage,
+                                             pxFileHash->pucHash, pxFileHash->ulHashLength );
+    }
+
+    xCoreResult = az_base64_decode( az_span_create( ucExpectedDigest, sizeof( ucExpectedDigest ) ),
+                                    az_span_create( pxFileHash->pucHash, ( int32_t ) pxFileHash->ulHashLength ),
+                                    &lExpectedDigestLength );
+
+    if( az_result_failed( xCoreResult ) || ( lExpectedDigestLength != ( int32_t ) sizeof( ucExpectedDigest ) ) )
+    {
+        AZLogError( ( "ADU image hash is not a base64 encoded SHA256" ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    if( memcmp( ucExpectedDigest, pxDownload->_internal.ucDigest, sizeof( ucExpectedDigest ) ) != 0 )
+    {
+        AZLogError( ( "ADU image hash does not match" ) );
+        return eAzureIoTErrorFailed;
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+bool AzureIoTADUDownload_IsComplete( AzureIoTADUDownload_t * pxDownload )
+{
+    return ( pxDownload != NULL ) && pxDownload->_internal.xStarted &&
+           ( pxDownload->_internal.ulCommittedOffset == pxDownload->_internal.ulImageSize );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t AzureIoTADUDownload_GetCommittedOffset( AzureIoTADUDownload_t * pxDownload )
+{
+    if( pxDownload == NULL )
+    {
+        return 0;
+    }
+
+    return pxDownload->_internal.ulCommittedOffset;
+}
+/*-----------------------------------------------------------*/
@@ -8,6 +8,8 @@
 
 #include "azure_iot_hub_client.h"
 
+#include <string.h>
+
 /* Kernel includes. */
 #include "FreeRTOS.h"
 #include "task.h"
@@ -33,6 +35,10 @@
     #define azureiothubSUBACK_WAIT_INTERVAL_MS    azureiotconfigSUBACK_WAIT_INTERVAL_MS
 #endif /* azureiothubSUBACK_WAIT_INTERVAL_MS */
 
+#ifndef azureiothubTELEMETRY_PUBACK_TIMEOUT_MS
+    #define azureiothubTELEMETRY_PUBACK_TIMEOUT_MS    azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS
+#endif /* azureiothubTELEMETRY_PUBACK_TIMEOUT_MS */
+
 #ifndef azureiothubUSER_AGENT
     #define azureiothubUSER_AGENT    "c%2F" azureiotVERSION_STRING "%28FreeRTOS%29"
 #endif /* azureiothubUSER_AGENT */
@@ -45,11 +51,13 @@
 #define azureiothubTOPIC_SUBSCRIBE_STATE_SUBACK        ( 0x2 )
 
 /*
- * Indexes of the receive context buffer for each feature
+ * Topic prefixes used to route incoming publishes to a receive context
  */
-#define azureiothubRECEIVE_CONTEXT_INDEX_C2D           ( 0 )
-#define azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS      ( 1 )
-#define azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES    ( 2 )
+#define azureiothubTOPIC_PREFIX_C2D                    "devices/"
+#define azureiothubTOPIC_PREFIX_IOTHUB                 "$iothub/"
+#define azureiothubTOPIC_PREFIX_COMMANDS               "methods/"
+#define azureiothubTOPIC_PREFIX_PROPERTIES             "twin/"
+#define azureiothubTOPIC_PREFIX_LENGTH( x )    ( sizeof( x ) - 1 )
 
 #define azureiothubCOMMAND_EMPTY_RESPONSE              "{}"
 
@@ -57,6 +65,158 @@
 #define azureiothubHMACBufferLength                    ( 48 )
 /*-----------------------------------------------------------*/
 
+#if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+
+/**
+ *
+ * Count a publish sent for a feature, or the failure to send it.
+ *
+ * */
+    static void prvStatisticsRecordPublish( AzureIoTHubClientStatistics_t * pxStatistics,
+                                            AzureIoTHubClientFeatureStatistics_t * pxFeature,
+                                            AzureIoTMQTTResult_t xMQTTResult,
+                                            size_t xPayloadLength )
+    {
+        if( xMQTTResult != eAzureIoTMQTTSuccess )
+        {
+            pxStatistics->ulPublishFailures++;
+        }
+        else
+        {
+            pxFeature->ulMessagesSent++;
+            pxFeature->ulBytesSent += ( uint32_t ) xPayloadLength;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Count a received publish against the receive context which handled it.
+ *
+ * */
+    static void prvStatisticsRecordReceive( AzureIoTHubClientStatistics_t * pxStatistics,
+                                            uint32_t ulIndex,
+                                            size_t xPayloadLength )
+    {
+        AzureIoTHubClientFeatureStatistics_t * pxFeature;
+
+        switch( ulIndex )
+        {
+            case azureiothubRECEIVE_CONTEXT_INDEX_C2D:
+                pxFeature = &pxStatistics->xCloudToDevice;
+                break;
+
+            case azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS:
+                pxFeature = &pxStatistics->xCommands;
+                break;
+
+            case azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES:
+                pxFeature = &pxStatistics->xProperties;
+                break;
+
+            default:
+                pxStatistics->ulUnmatchedTopics++;
+                return;
+        }
+
+        pxFeature->ulMessagesReceived++;
+        pxFeature->ulBytesReceived += ( uint32_t ) xPayloadLength;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Add a PUBACK round trip to the log bucketed histogram, or count its timeout.
+ *
+ * */
+    static void prvStatisticsRecordPuback( AzureIoTHubClientStatistics_t * pxStatistics,
+                                           AzureIoTResult_t xResult,
+                                           uint32_t ulLatencyMs )
+    {
+        uint32_t ulBucket = 0;
+
+        if( xResult != eAzureIoTSuccess )
+        {
+            pxStatistics->ulPubackTimeouts++;
+            return;
+        }
+
+        while( ( ulLatencyMs != 0 ) && ( ulBucket < ( azureiotconfigSTATISTICS_PUBACK_HISTOGRAM_BUCKETS - 1 ) ) )
+        {
+            ulLatencyMs >>= 1;
+            ulBucket++;
+        }
+
+        pxStatistics->ulPubackLatencyHistogram[ ulBucket ]++;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Account the time spent handling one received packet.
+ *
+ * */
+    static void prvStatisticsRecordCallbackTime( AzureIoTHubClientStatistics_t * pxStatistics,
+                                                 uint32_t ulStartTimeMs )
+    {
+        uint32_t ulElapsedMs = AzureIoT_GetTimeMs() - ulStartTimeMs;
+
+        pxStatistics->ulCallbackCount++;
+        pxStatistics->ulCallbackTimeMs += ulElapsedMs;
+
+        if( ulElapsedMs > pxStatistics->ulCallbackMaxTimeMs )
+        {
+            pxStatistics->ulCallbackMaxTimeMs = ulElapsedMs;
+        }
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* azureiotconfigUSE_HUB_CLIENT_STATISTICS */
+
+uint32_t AzureIoTHubClient_GetReceiveContextIndex( const uint8_t * pucTopic,
+                                                  uint16_t usTopicLength )
+{
+    uint32_t ulIndex = azureiothubSUBSCRIBE_FEATURE_COUNT;
+    uint32_t ulIoTHubPrefixLength = azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_IOTHUB );
+
+    if( usTopicLength == 0 )
+    {
+        AZLogDebug( ( "Empty topic has no receive context" ) );
+    }
+    else if( pucTopic[ 0 ] == ( uint8_t ) 'd' )
+    {
+        if( ( usTopicLength > azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_C2D ) ) &&
+            ( memcmp( pucTopic, azureiothubTOPIC_PREFIX_C2D,
+                      azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_C2D ) ) == 0 ) )
+        {
+            ulIndex = azureiothubRECEIVE_CONTEXT_INDEX_C2D;
+        }
+    }
+    else if( ( pucTopic[ 0 ] == ( uint8_t ) '$' ) &&
+             ( usTopicLength > ulIoTHubPrefixLength ) &&
+             ( memcmp( pucTopic, azureiothubTOPIC_PREFIX_IOTHUB, ulIoTHubPrefixLength ) == 0 ) )
+    {
+        pucTopic += ulIoTHubPrefixLength;
+        usTopicLength = ( uint16_t ) ( usTopicLength - ulIoTHubPrefixLength );
+
+        if( ( usTopicLength > azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_PROPERTIES ) ) &&
+            ( memcmp( pucTopic, azureiothubTOPIC_PREFIX_PROPERTIES,
+                      azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_PROPERTIES ) ) == 0 ) )
+        {
+            ulIndex = azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES;
+        }
+        else if( ( usTopicLength > azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_COMMANDS ) ) &&
+                 ( memcmp( pucTopic, azureiothubTOPIC_PREFIX_COMMANDS,
+                           azureiothubTOPIC_PREFIX_LENGTH( azureiothubTOPIC_PREFIX_COMMANDS ) ) == 0 ) )
+        {
+            ulIndex = azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS;
+        }
+    }
+
+    return ulIndex;
+}
+/*-----------------------------------------------------------*/
+
 /**
  *
  * Handle any incoming publish messages.
@@ -77,20 +237,28 @@ static void prvMQTTProcessIncomingPublish( AzureIoTHubClient_t * pxAzureIoTHubCl
         return;
     }
 
-    for( ulIndex = 0; ulIndex < azureiothubSUBSCRIBE_FEATURE_COUNT; ulIndex++ )
+    ulIndex = AzureIoTHubClient_GetReceiveContextIndex( pxPublishInfo->pcTopicName,
+                                                        pxPublishInfo->usTopicNameLength );
+
+    if( ulIndex < azureiothubSUBSCRIBE_FEATURE_COUNT )
     {
         pxContext = &pxAzureIoTHubClient->_internal.xReceiveContext[ ulIndex ];
 
-        if( ( pxContext->_internal.pxProcessFunction != NULL ) &&
+        if( ( pxContext->_internal.pxProcessFunction == NULL ) ||
             ( pxContext->_internal.pxProcessFunction( pxContext,
                                                       pxAzureIoTHubClient,
-                                                      ( void * ) pxPublishInfo ) == eAzureIoTSuccess ) )
+                                                      ( void * ) pxPublishInfo ) != eAzureIoTSuccess ) )
         {
-            break;
+            ulIndex = azureiothubSUBSCRIBE_FEATURE_COUNT;
         }
     }
 
-    /* If reached the end of the list and haven't found a context, log none found */
+    #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+        prvStatisticsRecordReceive( &pxAzureIoTHubClient->_internal.xStatistics,
+                                    ulIndex, pxPublishInfo->xPayloadLength );
+    #endif
+
+    /* If the topic did not route to a context which could handle it, log none found */
     if( ulIndex == azureiothubSUBSCRIBE_FEATURE_COUNT )
     {
         AZLogInfo( ( "No receive context found for incoming publish on topic: %.*s",
@@ -109,31 +277,169 @@ static void prvMQTTProcessSuback( AzureIoTHubClient_t * pxAzureIoTHubClient,
                                   uint16_t usPacketID )
 {
     uint32_t ulIndex;
+    uint32_t ulTopicIndex;
+    uint32_t ulTopicCount;
+    uint32_t ulCodeIndex = 0;
+    uint8_t * pucStatusCodes = NULL;
+    size_t xStatusCodeCount = 0;
+    AzureIoTMQTTResult_t xMQTTResult;
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
     AzureIoTHubClientReceiveContext_t * pxContext;
-
-    ( void ) pxIncomingPacket;
+    AzureIoTHubClientSubscribeCompleteCallback_t xCallback;
+    void * pvCallbackContext;
+    bool xContextFound = false;
+    bool xRejected;
 
     configASSERT( pxIncomingPacket != NULL );
     configASSERT( ( azureiotmqttGET_PACKET_TYPE( pxIncomingPacket->ucType ) ) == azureiotmqttPACKET_TYPE_SUBACK );
 
+    if( ( xMQTTResult = AzureIoTMQTT_GetSubAckStatusCodes( pxIncomingPacket, &pucStatusCodes,
+                                                           &xStatusCodeCount ) ) != eAzureIoTMQTTSuccess )
+    {
+        AZLogError( ( "Failed to parse suback: MQTT error=0x%08x", xMQTTResult ) );
+        xResult = eAzureIoTErrorSubscribeFailed;
+    }
+
     for( ulIndex = 0; ulIndex < azureiothubSUBSCRIBE_FEATURE_COUNT; ulIndex++ )
     {
         pxContext = &pxAzureIoTHubClient->_internal.xReceiveContext[ ulIndex ];
 
-        if( pxContext->_internal.usMqttSubPacketID == usPacketID )
+        /* More than one context shares the packet ID when subscribed through AzureIoTHubClient_SubscribeAll.
+         * Their topics were subscribed in the order of the contexts, properties taking two topics. */
+        if( ( pxContext->_internal.usState == azureiothubTOPIC_SUBSCRIBE_STATE_SUB ) &&
+            ( pxContext->_internal.usMqttSubPacketID == usPacketID ) )
         {
-            /* We assume success since IoT Hub would disconnect if there was a problem subscribing. */
-            pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUBACK;
-            AZLogInfo( ( "Suback receive context found: 0x%08x", ( uint16_t ) ulIndex ) );
-            break;
+            ulTopicCount = ( ulIndex == azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES ) ? 2 : 1;
+            xRejected = ( xMQTTResult != eAzureIoTMQTTSuccess );
+
+            for( ulTopicIndex = 0; ulTopicIndex < ulTopicCount; ulTopicIndex++, ulCodeIndex++ )
+            {
+                if( ( ulCodeIndex < xStatusCodeCount ) &&
+                    ( pucStatusCodes[ ulCodeIndex ] == ( uint8_t ) eMQTTSubAckFailure ) )
+                {
+                    xRejected = true;
+                }
+            }
+
+            if( xRejected )
+            {
+                AZLogError( ( "Suback rejected receive context: 0x%08x", ( uint16_t ) ulIndex ) );
+                memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
+                xResult = eAzureIoTErrorSubscribeFailed;
+            }
+            else
+            {
+                pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUBACK;
+                AZLogInfo( ( "Suback receive context found: 0x%08x", ( uint16_t ) ulIndex ) );
+            }
+
+            xContextFound = true;
         }
     }
 
     /* If reached the end of the list and haven't found a context, log none found */
-    if( ulIndex == azureiothubSUBSCRIBE_FEATURE_COUNT )
+    if( !xContextFound )
     {
         AZLogInfo( ( "No receive context found for incoming suback" ) );
     }
+
+    if( ( pxAzureIoTHubClient->_internal.usSubscribeAllPacketID != 0 ) &&
+        ( pxAzureIoTHubClient->_internal.usSubscribeAllPacketID == usPacketID ) )
+    {
+        xCallback = pxAzureIoTHubClient->_internal.xSubscribeCompleteCallback;
+        pvCallbackContext = pxAzureIoTHubClient->_internal.pvSubscribeCompleteCallbackContext;
+
+        /* Clear before invoking so the callback is free to start another subscribe */
+        pxAzureIoTHubClient->_internal.usSubscribeAllPacketID = 0;
+        pxAzureIoTHubClient->_internal.xSubscribeCompleteCallback = NULL;
+        pxAzureIoTHubClient->_internal.pvSubscribeCompleteCallbackContext = NULL;
+
+        if( xCallback != NULL )
+        {
+            AZLogDebug( ( "Invoking subscribe complete callback" ) );
+            xCallback( xResult, pvCallbackContext );
+            AZLogDebug( ( "Returned from subscribe complete callback" ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Free in-flight window slots and notify the user of each one. On eAzureIoTSuccess, the slot matching the
+ * packet ID is freed. On eAzureIoTErrorPubackWaitTimeout, every expired slot is. Otherwise, the connection
+ * is gone and every slot is freed, as their PUBACK can no longer arrive.
+ *
+ * */
+static void prvTelemetryInFlightRelease( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                         uint16_t usPacketID,
+                                         AzureIoTResult_t xResult )
+{
+    uint32_t ulIndex;
+    uint32_t ulNowMs = AzureIoT_GetTimeMs();
+    uint32_t ulLatencyMs;
+    uint16_t usSlotPacketID;
+    void * pvCookie;
+    bool xRelease;
+    AzureIoTHubClientTelemetryInFlight_t * pxInFlight;
+
+    for( ulIndex = 0; ulIndex < azureiotconfigTELEMETRY_INFLIGHT_MAX; ulIndex++ )
+    {
+        pxInFlight = &pxAzureIoTHubClient->_internal.xTelemetryInFlight[ ulIndex ];
+        usSlotPacketID = pxInFlight->_internal.usPacketID;
+
+        if( usSlotPacketID == 0 )
+        {
+            continue;
+        }
+
+        /* Unsigned subtraction keeps this correct across tick count wrap */
+        ulLatencyMs = ulNowMs - pxInFlight->_internal.ulSendTimeMs;
+
+        if( xResult == eAzureIoTSuccess )
+        {
+            xRelease = ( usSlotPacketID == usPacketID );
+        }
+        else if( xResult == eAzureIoTErrorPubackWaitTimeout )
+        {
+            xRelease = ( ulLatencyMs >= azureiothubTELEMETRY_PUBACK_TIMEOUT_MS );
+        }
+        else
+        {
+            xRelease = true;
+        }
+
+        if( xRelease )
+        {
+            pvCookie = pxInFlight->_internal.pvCookie;
+            memset( pxInFlight, 0, sizeof( AzureIoTHubClientTelemetryInFlight_t ) );
+
+            if( xResult == eAzureIoTErrorPubackWaitTimeout )
+            {
+                AZLogWarn( ( "Telemetry puback wait timed out for packet id: 0x%08x", usSlotPacketID ) );
+            }
+            else if( xResult != eAzureIoTSuccess )
+            {
+                AZLogWarn( ( "Telemetry puback lost with the connection for packet id: 0x%08x", usSlotPacketID ) );
+            }
+
+            #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+                prvStatisticsRecordPuback( &pxAzureIoTHubClient->_internal.xStatistics, xResult, ulLatencyMs );
+            #endif
+
+            if( pxAzureIoTHubClient->_internal.xTelemetryAckCallback != NULL )
+            {
+                AZLogDebug( ( "Invoking telemetry ack callback" ) );
+                pxAzureIoTHubClient->_internal.xTelemetryAckCallback( xResult, usSlotPacketID, pvCookie, ulLatencyMs );
+                AZLogDebug( ( "Returned from telemetry ack callback" ) );
+            }
+
+            if( xResult == eAzureIoTSuccess )
+            {
+                break;
+            }
+        }
+    }
 }
 /*-----------------------------------------------------------*/
 
@@ -159,6 +465,8 @@ static void prvMQTTProcessPuback( AzureIoTHubClient_t * pxAzureIoTHubClient,
         pxAzureIoTHubClient->_internal.xTelemetryCallback( usPacketID );
         AZLogDebug( ( "Returned from telemetry puback callback" ) );
     }
+
+    prvTelemetryInFlightRelease( pxAzureIoTHubClient, usPacketID, eAzureIoTSuccess );
 }
 /*-----------------------------------------------------------*/
 
@@ -174,6 +482,10 @@ static void prvEventCallback( AzureIoTMQTTHandle_t pxMQTTContext,
     /* First element in AzureIoTHubClientHandle */
     AzureIoTHubClient_t * pxAzureIoTHubClient = ( AzureIoTHubClient_t * ) pxMQTTContext;
 
+    #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+        uint32_t ulStartTimeMs = AzureIoT_GetTimeMs();
+    #endif
+
     if( ( azureiotmqttGET_PACKET_TYPE( pxPacketInfo->ucType ) ) == azureiotmqttPACKET_TYPE_PUBLISH )
     {
         prvMQTTProcessIncomingPublish( pxAzureIoTHubClient, pxDeserializedInfo->pxPublishInfo );
@@ -190,6 +502,10 @@ static void prvEventCallback( AzureIoTMQTTHandle_t pxMQTTContext,
     {
         AZLogDebug( ( "AzureIoTHubClient received packet of type: 0x%08x", pxPacketInfo->ucType ) );
     }
+
+    #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+        prvStatisticsRecordCallbackTime( &pxAzureIoTHubClient->_internal.xStatistics, ulStartTimeMs );
+    #endif
 }
 /*-----------------------------------------------------------*/
 
@@ -380,26 +696,6 @@ static uint32_t prvAzureIoTHubClientPropertiesProcess( AzureIoTHubClientReceiveC
 }
 /*-----------------------------------------------------------*/
 
-/**
- *
- * Time callback for MQTT initialization.
- *
- * */
-static uint32_t prvGetTimeMs( void )
-{
-    TickType_t xTickCount;
-    uint32_t ulTimeMs;
-
-    /* Get the current tick count. */
-    xTickCount = xTaskGetTickCount();
-
-    /* Convert the ticks to milliseconds. */
-    ulTimeMs = ( uint32_t ) xTickCount * azureiotMILLISECONDS_PER_TICK;
-
-    return ulTimeMs;
-}
-/*-----------------------------------------------------------*/
-
 /**
  * Get the next request Id available. Currently we are using
  * odd for PropertiesReported property and even for PropertiesGet.
@@ -474,6 +770,13 @@ static AzureIoTResult_t prvWaitForSubAck( AzureIoTHubClient_t * pxAzureIoTHubCli
             break;
         }
 
+        /* The SUBACK rejected the subscribe and cleared the context */
+        if( pxContext->_internal.usState == azureiothubTOPIC_SUBSCRIBE_STATE_NONE )
+        {
+            xResult = eAzureIoTErrorSubscribeFailed;
+            break;
+        }
+
         if( ulTimeoutMilliseconds > azureiothubSUBACK_WAIT_INTERVAL_MS )
         {
             ulTimeoutMilliseconds -= azureiothubSUBACK_WAIT_INTERVAL_MS;
@@ -519,6 +822,7 @@ static uint32_t prvIoTHubClientGetToken( AzureIoTHubClient_t * pxAzureIoTHubClie
     uint8_t * pucHMACBuffer;
     az_span xSpan = az_span_create( pucSASBuffer, ( int32_t ) ulSasBufferLen );
     az_result xCoreResult;
+    AzureIoTResult_t xResult;
     uint32_t ulSignatureLength;
     uint32_t ulBytesUsed;
     uint32_t ulBufferLeft;
@@ -546,11 +850,33 @@ static uint32_t prvIoTHubClientGetToken( AzureIoTHubClient_t * pxAzureIoTHubClie
     ulBufferLeft -= azureiothubHMACBufferLength;
     pucHMACBuffer = pucSASBuffer + ulSasBufferLen - azureiothubHMACBufferLength;
 
-    if( AzureIoT_Base64HMACCalculate( pxAzureIoTHubClient->_internal.xHMACFunction,
-                                      ucKey, ulKeyLen, pucSASBuffer, ulBytesUsed,
-                                      pucSASBuffer + ulBytesUsed, ulBufferLeft,
-                                      pucHMACBuffer, azureiothubHMACBufferLength,
-                                      &ulSignatureLength ) != eAzureIoTSuccess )
+    if( pxAzureIoTHubClient->_internal.xHMACContextFunction != NULL )
+    {
+        xResult = AzureIoT_HMACContextBase64Encode( pxAzureIoTHubClient->_internal.xHMACContextFunction,
+                                                    pxAzureIoTHubClient->_internal.pvHMACContext,
+                                                    pucSASBuffer, ulBytesUsed,
+                                                    pucSASBuffer + ulBytesUsed, ulBufferLeft,
+                                                    pucHMACBuffer, azureiothubHMACBufferLength,
+                                                    &ulSignatureLength );
+    }
+    else
+    {
+        #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+            xResult = AzureIoT_HMACBase64Encode( pxAzureIoTHubClient->_internal.xHMACFunction,
+                                                 ucKey, ulKeyLen, pucSASBuffer, ulBytesUsed,
+                                                 pucSASBuffer + ulBytesUsed, ulBufferLeft,
+                                                 pucHMACBuffer, azureiothubHMACBufferLength,
+                                                 &ulSignatureLength );
+        #else
+            xResult = AzureIoT_Base64HMACCalculate( pxAzureIoTHubClient->_internal.xHMACFunction,
+                                                    ucKey, ulKeyLen, pucSASBuffer, ulBytesUsed,
+                                                    pucSASBuffer + ulBytesUsed, ulBufferLeft,
+                                                    pucHMACBuffer, azureiothubHMACBufferLength,
+                                                    &ulSignatureLength );
+        #endif
+    }
+
+    if( xResult != eAzureIoTSuccess )
     {
         AZLogError( ( "AzureIoTHubClient failed to encode HMAC hash" ) );
         return eAzureIoTErrorFailed;
@@ -580,6 +906,240 @@ static uint32_t prvIoTHubClientGetToken( AzureIoTHubClient_t * pxAzureIoTHubClie
 }
 /*-----------------------------------------------------------*/
 
+/**
+ *
+ * Check if the cached SAS token is within the refresh margin of its expiry.
+ *
+ * */
+static bool prvIoTHubClientTokenRefreshDue( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                            uint64_t ullNowSecs )
+{
+    uint64_t ullExpiryTimeSecs = pxAzureIoTHubClient->_internal.ullSASTokenExpiryTimeSecs;
+    uint32_t ulMarginSecs = pxAzureIoTHubClient->_internal.ulTokenRefreshMarginSecs;
+
+    return ( ullExpiryTimeSecs <= ulMarginSecs ) ||
+           ( ullNowSecs >= ( ullExpiryTimeSecs - ulMarginSecs ) );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Generate SAS tokens from now on, with a refresh margin jittered by the device ID.
+ *
+ * */
+static void prvIoTHubClientSetTokenRefresh( AzureIoTHubClient_t * pxAzureIoTHubClient )
+{
+    uint32_t ulJitterSecs;
+    uint32_t ulMarginSecs;
+
+    /* Spread the refresh of devices connecting at the same time by a jitter derived from the device ID. */
+    ulJitterSecs = AzureIoT_FNV1a32( azureiotFNV1A_32_OFFSET_BASIS,
+                                     pxAzureIoTHubClient->_internal.pucDeviceID,
+                                     pxAzureIoTHubClient->_internal.ulDeviceIDLength );
+
+    ulMarginSecs = azureiotconfigTOKEN_REFRESH_MARGIN_SEC + ( ulJitterSecs % ( azureiotconfigTOKEN_REFRESH_JITTER_SEC + 1U ) );
+
+    /* Never ask for a refresh in the first half of the token lifetime. */
+    if( ulMarginSecs > ( azureiothubDEFAULT_TOKEN_TIMEOUT_IN_SEC / 2U ) )
+    {
+        ulMarginSecs = azureiothubDEFAULT_TOKEN_TIMEOUT_IN_SEC / 2U;
+    }
+
+    pxAzureIoTHubClient->_internal.ulTokenRefreshMarginSecs = ulMarginSecs;
+    pxAzureIoTHubClient->_internal.ulSASTokenLength = 0;
+    pxAzureIoTHubClient->_internal.pxTokenRefresh = prvIoTHubClientGetToken;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Restart the keep-alive period after a packet was sent. The MQTT library schedules its `PING`
+ * from the last packet it sent, so the period is tracked the same way.
+ *
+ * */
+static void prvIoTHubClientKeepAliveRestart( AzureIoTHubClient_t * pxAzureIoTHubClient )
+{
+    pxAzureIoTHubClient->_internal.ulKeepAliveTimeMs = AzureIoT_GetTimeMs();
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Restart the keep-alive period once it has elapsed. The MQTT process loop sends a `PING`
+ * when nothing else was sent during the period, so the next one is due at most one period later.
+ *
+ * */
+static void prvIoTHubClientKeepAliveCheck( AzureIoTHubClient_t * pxAzureIoTHubClient )
+{
+    uint32_t ulNowMs = AzureIoT_GetTimeMs();
+
+    if( pxAzureIoTHubClient->_internal.xConnected &&
+        ( ( ulNowMs - pxAzureIoTHubClient->_internal.ulKeepAliveTimeMs ) >=
+          ( azureiothubKEEP_ALIVE_TIMEOUT_SECONDS * 1000U ) ) )
+    {
+        pxAzureIoTHubClient->_internal.ulKeepAliveTimeMs = ulNowMs;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Lower the wait time to the time left until a period started at ulStartMs elapses.
+ *
+ * */
+static uint32_t prvTimeLeftMs( uint32_t ulNowMs,
+                               uint32_t ulStartMs,
+                               uint32_t ulPeriodMs,
+                               uint32_t ulWaitMs )
+{
+    uint32_t ulElapsedMs = ulNowMs - ulStartMs;
+    uint32_t ulLeftMs = ulElapsedMs >= ulPeriodMs ? 0 : ulPeriodMs - ulElapsedMs;
+
+    return ulLeftMs < ulWaitMs ? ulLeftMs : ulWaitMs;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Reuse the cached SAS token, or generate a new one when there is none or it is about to expire.
+ * Without the token cache, a new token is generated in pucPasswordBuffer every time.
+ *
+ * */
+static AzureIoTResult_t prvIoTHubClientUpdateToken( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                    uint8_t * pucPasswordBuffer,
+                                                    const uint8_t ** ppucPassword )
+{
+    uint64_t ullNowSecs = pxAzureIoTHubClient->_internal.xTimeFunction();
+    uint32_t ulSASTokenLength;
+
+    #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+        const uint8_t * pucKey = pxAzureIoTHubClient->_internal.ucDecodedSymmetricKey;
+        uint32_t ulKeyLength = pxAzureIoTHubClient->_internal.ulDecodedSymmetricKeyLength;
+        uint8_t * pucSASBuffer = pxAzureIoTHubClient->_internal.ucSASToken;
+
+        ( void ) pucPasswordBuffer;
+        *ppucPassword = pucSASBuffer;
+
+        if( ( pxAzureIoTHubClient->_internal.ulSASTokenLength != 0 ) &&
+            !prvIoTHubClientTokenRefreshDue( pxAzureIoTHubClient, ullNowSecs ) )
+        {
+            return eAzureIoTSuccess;
+        }
+    #else
+        const uint8_t * pucKey = pxAzureIoTHubClient->_internal.pucSymmetricKey;
+        uint32_t ulKeyLength = pxAzureIoTHubClient->_internal.ulSymmetricKeyLength;
+        uint8_t * pucSASBuffer = pucPasswordBuffer;
+
+        *ppucPassword = pucSASBuffer;
+    #endif
+
+    pxAzureIoTHubClient->_internal.ulSASTokenLength = 0;
+
+    if( pxAzureIoTHubClient->_internal.pxTokenRefresh( pxAzureIoTHubClient,
+                                                       ullNowSecs + azureiothubDEFAULT_TOKEN_TIMEOUT_IN_SEC,
+                                                       pucKey, ulKeyLength,
+                                                       pucSASBuffer, azureiotconfigPASSWORD_MAX,
+                                                       &ulSASTokenLength ) )
+    {
+        return eAzureIoTErrorFailed;
+    }
+
+    pxAzureIoTHubClient->_internal.ulSASTokenLength = ulSASTokenLength;
+    pxAzureIoTHubClient->_internal.ullSASTokenExpiryTimeSecs = ullNowSecs + azureiothubDEFAULT_TOKEN_TIMEOUT_IN_SEC;
+    pxAzureIoTHubClient->_internal.xTokenRefreshNotified = false;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Notify the application once per token when the SAS token is about to expire.
+ *
+ * */
+static void prvIoTHubClientTokenRefreshCheck( AzureIoTHubClient_t * pxAzureIoTHubClient )
+{
+    if( ( pxAzureIoTHubClient->_internal.xTokenRefreshCallback != NULL ) &&
+        ( pxAzureIoTHubClient->_internal.ulSASTokenLength != 0 ) &&
+        !pxAzureIoTHubClient->_internal.xTokenRefreshNotified &&
+        prvIoTHubClientTokenRefreshDue( pxAzureIoTHubClient, pxAzureIoTHubClient->_internal.xTimeFunction() ) )
+    {
+        AZLogInfo( ( "AzureIoTHubClient SAS token is about to expire, requesting reconnect" ) );
+        pxAzureIoTHubClient->_internal.xTokenRefreshNotified = true;
+        pxAzureIoTHubClient->_internal.xTokenRefreshCallback( pxAzureIoTHubClient,
+                                                              pxAzureIoTHubClient->_internal.pvTokenRefreshCallbackContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Build the telemetry topic from the prefix cached at init and the property bag.
+ * Falls back to the embedded SDK when the prefix was too big to be cached.
+ *
+ * */
+static AzureIoTResult_t prvGetTelemetryTopic( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                              AzureIoTMessageProperties_t * pxProperties,
+                                              uint8_t * pucTopicBuffer,
+                                              uint32_t ulTopicBufferLength,
+                                              uint32_t * pulTopicLength )
+{
+    AzureIoTResult_t xResult;
+    az_result xCoreResult;
+    size_t xTelemetryTopicLength;
+    uint32_t ulPrefixLength = pxAzureIoTHubClient->_internal.usTelemetryTopicPrefixLength;
+    uint32_t ulPropertiesLength = 0;
+
+    if( ulPrefixLength == 0 )
+    {
+        if( az_result_failed(
+                xCoreResult = az_iot_hub_client_telemetry_get_publish_topic( &pxAzureIoTHubClient->_internal.xAzureIoTHubClientCore,
+                                                                             ( pxProperties != NULL ) ? &pxProperties->_internal.xProperties : NULL,
+                                                                             ( char * ) pucTopicBuffer,
+                                                                             ulTopicBufferLength,
+                                                                             &xTelemetryTopicLength ) ) )
+        {
+            AZLogError( ( "Failed to get telemetry topic: core error=0x%08x", ( uint16_t ) xCoreResult ) );
+            xResult = AzureIoT_TranslateCoreError( xCoreResult );
+        }
+        else
+        {
+            *pulTopicLength = ( uint32_t ) xTelemetryTopicLength;
+            xResult = eAzureIoTSuccess;
+        }
+    }
+    else
+    {
+        if( pxProperties != NULL )
+        {
+            ulPropertiesLength = ( uint32_t ) pxProperties->_internal.xProperties._internal.properties_written;
+        }
+
+        if( ( ulPrefixLength + ulPropertiesLength ) > ulTopicBufferLength )
+        {
+            AZLogError( ( "Failed to get telemetry topic: buffer too small" ) );
+            xResult = eAzureIoTErrorOutOfMemory;
+        }
+        else
+        {
+            memcpy( pucTopicBuffer, pxAzureIoTHubClient->_internal.ucTelemetryTopicPrefix, ulPrefixLength );
+
+            if( ulPropertiesLength > 0 )
+            {
+                memcpy( pucTopicBuffer + ulPrefixLength,
+                        az_span_ptr( pxProperties->_internal.xProperties._internal.properties_buffer ),
+                        ulPropertiesLength );
+            }
+
+            *pulTopicLength = ulPrefixLength + ulPropertiesLength;
+            xResult = eAzureIoTSuccess;
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
 AzureIoTResult_t AzureIoTHubClient_OptionsInit( AzureIoTHubClientOptions_t * pxHubClientOptions )
 {
     AzureIoTResult_t xResult;
@@ -622,6 +1182,7 @@ AzureIoTResult_t AzureIoTHubClient_Init( AzureIoTHubClient_t * pxAzureIoTHubClie
     uint32_t ulNetworkBufferLength;
     az_span xHostnameSpan;
     az_span xDeviceIDSpan;
+    size_t xTelemetryTopicPrefixLength;
 
     if( ( pxAzureIoTHubClient == NULL ) ||
         ( pucHostname == NULL ) || ( ulHostnameLength == 0 ) ||
@@ -677,7 +1238,7 @@ AzureIoTResult_t AzureIoTHubClient_Init( AzureIoTHubClient_t * pxAzureIoTHubClie
         }
         /* Initialize AzureIoTMQTT library. */
         else if( ( xMQTTResult = AzureIoTMQTT_Init( &( pxAzureIoTHubClient->_internal.xMQTTContext ), pxTransportInterface,
-                                                    prvGetTimeMs, prvEventCallback,
+                                                    AzureIoT_GetTimeMs, prvEventCallback,
                                                     pucNetworkBuffer, ulNetworkBufferLength ) ) != eAzureIoTMQTTSuccess )
         {
             AZLogError( ( "Failed to initialize AzureIoTMQTT_Init: MQTT error=0x%08x", xMQTTResult ) );
@@ -685,6 +1246,22 @@ AzureIoTResult_t AzureIoTHubClient_Init( AzureIoTHubClient_t * pxAzureIoTHubClie
         }
         else
         {
+            /* Cache the constant telemetry topic prefix. A zero length means it did not fit,
+             * in which case every send generates the full topic. */
+            if( az_result_failed( az_iot_hub_client_telemetry_get_publish_topic( &pxAzureIoTHubClient->_internal.xAzureIoTHubClientCore,
+                                                                                 NULL,
+                                                                                 ( char * ) pxAzureIoTHubClient->_internal.ucTelemetryTopicPrefix,
+                                                                                 sizeof( pxAzureIoTHubClient->_internal.ucTelemetryTopicPrefix ),
+                                                                                 &xTelemetryTopicPrefixLength ) ) )
+            {
+                AZLogWarn( ( "Telemetry topic prefix not cached: increase azureiotconfigTELEMETRY_TOPIC_PREFIX_MAX" ) );
+                pxAzureIoTHubClient->_internal.usTelemetryTopicPrefixLength = 0;
+            }
+            else
+            {
+                pxAzureIoTHubClient->_internal.usTelemetryTopicPrefixLength = ( uint16_t ) xTelemetryTopicPrefixLength;
+            }
+
             pxAzureIoTHubClient->_internal.pucDeviceID = pucDeviceId;
             pxAzureIoTHubClient->_internal.ulDeviceIDLength = ulDeviceIdLength;
             pxAzureIoTHubClient->_internal.pucHostname = pucHostname;
@@ -692,6 +1269,12 @@ AzureIoTResult_t AzureIoTHubClient_Init( AzureIoTHubClient_t * pxAzureIoTHubClie
             pxAzureIoTHubClient->_internal.xTimeFunction = xGetTimeFunction;
             pxAzureIoTHubClient->_internal.xTelemetryCallback =
                 pxHubClientOptions == NULL ? NULL : pxHubClientOptions->xTelemetryCallback;
+            pxAzureIoTHubClient->_internal.xTelemetryAckCallback =
+                pxHubClientOptions == NULL ? NULL : pxHubClientOptions->xTelemetryAckCallback;
+            pxAzureIoTHubClient->_internal.xTokenRefreshCallback =
+                pxHubClientOptions == NULL ? NULL : pxHubClientOptions->xTokenRefreshCallback;
+            pxAzureIoTHubClient->_internal.pvTokenRefreshCallbackContext =
+                pxHubClientOptions == NULL ? NULL : pxHubClientOptions->pvTokenRefreshCallbackContext;
             xResult = eAzureIoTSuccess;
         }
     }
@@ -713,6 +1296,11 @@ AzureIoTResult_t AzureIoTHubClient_SetSymmetricKey( AzureIoTHubClient_t * pxAzur
 {
     AzureIoTResult_t xResult;
 
+    #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+        az_result xCoreResult;
+        int32_t lDecodedKeyLength;
+    #endif
+
     if( ( pxAzureIoTHubClient == NULL ) ||
         ( pucSymmetricKey == NULL ) || ( ulSymmetricKeyLength == 0 ) ||
         ( xHMACFunction == NULL ) )
@@ -720,12 +1308,63 @@ AzureIoTResult_t AzureIoTHubClient_SetSymmetricKey( AzureIoTHubClient_t * pxAzur
         AZLogError( ( "AzureIoTHubClient_SetSymmetricKey failed: invalid argument" ) );
         xResult = eAzureIoTErrorInvalidArgument;
     }
+
+    #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+        else if( az_result_failed( xCoreResult = az_base64_decode( az_span_create( pxAzureIoTHubClient->_internal.ucDecodedSymmetricKey,
+                                                                                   sizeof( pxAzureIoTHubClient->_internal.ucDecodedSymmetricKey ) ),
+                                                                   az_span_create( ( uint8_t * ) pucSymmetricKey, ( int32_t ) ulSymmetricKeyLength ),
+                                                                   &lDecodedKeyLength ) ) )
+        {
+            AZLogError( ( "AzureIoTHubClient_SetSymmetricKey failed to decode key: core error=0x%08x", ( uint16_t ) xCoreResult ) );
+            xResult = AzureIoT_TranslateCoreError( xCoreResult );
+        }
+    #endif
     else
     {
-        pxAzureIoTHubClient->_internal.pucSymmetricKey = pucSymmetricKey;
-        pxAzureIoTHubClient->_internal.ulSymmetricKeyLength = ulSymmetricKeyLength;
-        pxAzureIoTHubClient->_internal.pxTokenRefresh = prvIoTHubClientGetToken;
+        #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+            pxAzureIoTHubClient->_internal.ulDecodedSymmetricKeyLength = ( uint32_t ) lDecodedKeyLength;
+        #else
+            pxAzureIoTHubClient->_internal.pucSymmetricKey = pucSymmetricKey;
+            pxAzureIoTHubClient->_internal.ulSymmetricKeyLength = ulSymmetricKeyLength;
+        #endif
         pxAzureIoTHubClient->_internal.xHMACFunction = xHMACFunction;
+        pxAzureIoTHubClient->_internal.xHMACContextFunction = NULL;
+        pxAzureIoTHubClient->_internal.pvHMACContext = NULL;
+        prvIoTHubClientSetTokenRefresh( pxAzureIoTHubClient );
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClient_SetSymmetricKeyContext( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                           AzureIoTGetHMACContextFunc_t xHMACContextFunction,
+                                                           void * pvHMACContext )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxAzureIoTHubClient == NULL ) ||
+        ( xHMACContextFunction == NULL ) )
+    {
+        AZLogError( ( "AzureIoTHubClient_SetSymmetricKeyContext failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        /* The key is held by the context, forget any key set before */
+        #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+            memset( pxAzureIoTHubClient->_internal.ucDecodedSymmetricKey, 0,
+                    sizeof( pxAzureIoTHubClient->_internal.ucDecodedSymmetricKey ) );
+            pxAzureIoTHubClient->_internal.ulDecodedSymmetricKeyLength = 0;
+        #else
+            pxAzureIoTHubClient->_internal.pucSymmetricKey = NULL;
+            pxAzureIoTHubClient->_internal.ulSymmetricKeyLength = 0;
+        #endif
+        pxAzureIoTHubClient->_internal.xHMACFunction = NULL;
+        pxAzureIoTHubClient->_internal.xHMACContextFunction = xHMACContextFunction;
+        pxAzureIoTHubClient->_internal.pvHMACContext = pvHMACContext;
+        prvIoTHubClientSetTokenRefresh( pxAzureIoTHubClient );
         xResult = eAzureIoTSuccess;
     }
 
@@ -763,21 +1402,21 @@ AzureIoTResult_t AzureIoTHubClient_Connect( AzureIoTHubClient_t * pxAzureIoTHubC
             AZLogError( ( "Failed to get username: core error=0x%08x", ( uint16_t ) xCoreResult ) );
             xResult = AzureIoT_TranslateCoreError( xCoreResult );
         }
-        /* Check if token refresh is set, then generate password */
+        /* Check if token refresh is set, then reuse or generate password */
         else if( ( pxAzureIoTHubClient->_internal.pxTokenRefresh ) &&
-                 ( pxAzureIoTHubClient->_internal.pxTokenRefresh( pxAzureIoTHubClient,
-                                                                  pxAzureIoTHubClient->_internal.xTimeFunction() +
-                                                                  azureiothubDEFAULT_TOKEN_TIMEOUT_IN_SEC,
-                                                                  pxAzureIoTHubClient->_internal.pucSymmetricKey,
-                                                                  pxAzureIoTHubClient->_internal.ulSymmetricKeyLength,
-                                                                  ( uint8_t * ) xConnectInfo.pcPassword, azureiotconfigPASSWORD_MAX,
-                                                                  &ulPasswordLength ) ) )
+                 ( prvIoTHubClientUpdateToken( pxAzureIoTHubClient, ( uint8_t * ) xConnectInfo.pcPassword,
+                                               &xConnectInfo.pcPassword ) != eAzureIoTSuccess ) )
         {
             AZLogError( ( "Failed to generate SAS token" ) );
             xResult = eAzureIoTErrorFailed;
         }
         else
         {
+            if( pxAzureIoTHubClient->_internal.pxTokenRefresh )
+            {
+                ulPasswordLength = pxAzureIoTHubClient->_internal.ulSASTokenLength;
+            }
+
             xConnectInfo.xCleanSession = xCleanSession;
             xConnectInfo.pcClientIdentifier = pxAzureIoTHubClient->_internal.pucDeviceID;
             xConnectInfo.usClientIdentifierLength = ( uint16_t ) pxAzureIoTHubClient->_internal.ulDeviceIDLength;
@@ -802,6 +1441,16 @@ AzureIoTResult_t AzureIoTHubClient_Connect( AzureIoTHubClient_t * pxAzureIoTHubC
                 /* Successfully established a MQTT connection with the broker. */
                 AZLogInfo( ( "An MQTT connection is established with %.*s", pxAzureIoTHubClient->_internal.ulHostnameLength,
                              ( const char * ) pxAzureIoTHubClient->_internal.pucHostname ) );
+                pxAzureIoTHubClient->_internal.xConnected = true;
+                pxAzureIoTHubClient->_internal.ulKeepAliveTimeMs = AzureIoT_GetTimeMs();
+
+                /* The SUBACK of a subscribe sent on a previous connection will never arrive */
+                pxAzureIoTHubClient->_internal.usSubscribeAllPacketID = 0;
+                pxAzureIoTHubClient->_internal.xSubscribeCompleteCallback = NULL;
+                pxAzureIoTHubClient->_internal.pvSubscribeCompleteCallbackContext = NULL;
+
+                /* Neither will the PUBACK of telemetry sent on it, and the new session may reuse its packet IDs */
+                prvTelemetryInFlightRelease( pxAzureIoTHubClient, 0, eAzureIoTErrorFailed );
                 xResult = eAzureIoTSuccess;
             }
         }
@@ -830,6 +1479,8 @@ AzureIoTResult_t AzureIoTHubClient_Disconnect( AzureIoTHubClient_t * pxAzureIoTH
     {
         AZLogInfo( ( "Disconnecting the MQTT connection with %.*s", pxAzureIoTHubClient->_internal.ulHostnameLength,
                      ( const char * ) pxAzureIoTHubClient->_internal.pucHostname ) );
+        pxAzureIoTHubClient->_internal.xConnected = false;
+        prvTelemetryInFlightRelease( pxAzureIoTHubClient, 0, eAzureIoTErrorFailed );
         xResult = eAzureIoTSuccess;
     }
 
@@ -843,34 +1494,60 @@ AzureIoTResult_t AzureIoTHubClient_SendTelemetry( AzureIoTHubClient_t * pxAzureI
                                                   AzureIoTMessageProperties_t * pxProperties,
                                                   AzureIoTHubMessageQoS_t xQOS,
                                                   uint16_t * pusTelemetryPacketID )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxAzureIoTHubClient == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClient_SendTelemetry failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        xResult = AzureIoTHubClient_SendTelemetryWithTopicBuffer( pxAzureIoTHubClient,
+                                                                  pucTelemetryData, ulTelemetryDataLength,
+                                                                  pxProperties, xQOS,
+                                                                  pxAzureIoTHubClient->_internal.pucWorkingBuffer,
+                                                                  pxAzureIoTHubClient->_internal.ulWorkingBufferLength,
+                                                                  pusTelemetryPacketID );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClient_SendTelemetryWithTopicBuffer( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                                 const uint8_t * pucTelemetryData,
+                                                                 uint32_t ulTelemetryDataLength,
+                                                                 AzureIoTMessageProperties_t * pxProperties,
+                                                                 AzureIoTHubMessageQoS_t xQOS,
+                                                                 uint8_t * pucTopicBuffer,
+                                                                 uint32_t ulTopicBufferLength,
+                                                                 uint16_t * pusTelemetryPacketID )
 {
     AzureIoTMQTTResult_t xMQTTResult;
     AzureIoTResult_t xResult;
     AzureIoTMQTTPublishInfo_t xMQTTPublishInfo = { 0 };
     uint16_t usPublishPacketIdentifier = 0;
-    size_t xTelemetryTopicLength;
-    az_result xCoreResult;
+    uint32_t ulTelemetryTopicLength;
 
-    if( pxAzureIoTHubClient == NULL )
+    if( ( pxAzureIoTHubClient == NULL ) ||
+        ( pucTopicBuffer == NULL ) || ( ulTopicBufferLength == 0 ) )
     {
-        AZLogError( ( "AzureIoTHubClient_SendTelemetry failed: invalid argument" ) );
+        AZLogError( ( "AzureIoTHubClient_SendTelemetryWithTopicBuffer failed: invalid argument" ) );
         xResult = eAzureIoTErrorInvalidArgument;
     }
-    else if( az_result_failed(
-                 xCoreResult = az_iot_hub_client_telemetry_get_publish_topic( &pxAzureIoTHubClient->_internal.xAzureIoTHubClientCore,
-                                                                              ( pxProperties != NULL ) ? &pxProperties->_internal.xProperties : NULL,
-                                                                              ( char * ) pxAzureIoTHubClient->_internal.pucWorkingBuffer,
-                                                                              pxAzureIoTHubClient->_internal.ulWorkingBufferLength,
-                                                                              &xTelemetryTopicLength ) ) )
+    else if( ( xResult = prvGetTelemetryTopic( pxAzureIoTHubClient, pxProperties,
+                                               pucTopicBuffer, ulTopicBufferLength,
+                                               &ulTelemetryTopicLength ) ) != eAzureIoTSuccess )
     {
-        AZLogError( ( "Failed to get telemetry topic: core error=0x%08x", ( uint16_t ) xCoreResult ) );
-        xResult = AzureIoT_TranslateCoreError( xCoreResult );
+        AZLogError( ( "Failed to get telemetry topic: error=0x%08x", xResult ) );
     }
     else
     {
         xMQTTPublishInfo.xQOS = xQOS == eAzureIoTHubMessageQoS1 ? eAzureIoTMQTTQoS1 : eAzureIoTMQTTQoS0;
-        xMQTTPublishInfo.pcTopicName = pxAzureIoTHubClient->_internal.pucWorkingBuffer;
-        xMQTTPublishInfo.usTopicNameLength = ( uint16_t ) xTelemetryTopicLength;
+        xMQTTPublishInfo.pcTopicName = pucTopicBuffer;
+        xMQTTPublishInfo.usTopicNameLength = ( uint16_t ) ulTelemetryTopicLength;
         xMQTTPublishInfo.pvPayload = ( const void * ) pucTelemetryData;
         xMQTTPublishInfo.xPayloadLength = ulTelemetryDataLength;
 
@@ -889,6 +1566,8 @@ AzureIoTResult_t AzureIoTHubClient_SendTelemetry( AzureIoTHubClient_t * pxAzureI
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             if( ( xQOS == eAzureIoTHubMessageQoS1 ) && ( pusTelemetryPacketID != NULL ) )
             {
                 *pusTelemetryPacketID = usPublishPacketIdentifier;
@@ -897,6 +1576,69 @@ AzureIoTResult_t AzureIoTHubClient_SendTelemetry( AzureIoTHubClient_t * pxAzureI
             AZLogInfo( ( "Successfully sent telemetry message" ) );
             xResult = eAzureIoTSuccess;
         }
+
+        #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+            prvStatisticsRecordPublish( &pxAzureIoTHubClient->_internal.xStatistics,
+                                        &pxAzureIoTHubClient->_internal.xStatistics.xTelemetry,
+                                        xMQTTResult, xMQTTPublishInfo.xPayloadLength );
+        #endif
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClient_SendTelemetryWithCookie( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                            const uint8_t * pucTelemetryData,
+                                                            uint32_t ulTelemetryDataLength,
+                                                            AzureIoTMessageProperties_t * pxProperties,
+                                                            void * pvCookie,
+                                                            uint16_t * pusTelemetryPacketID )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTHubClientTelemetryInFlight_t * pxInFlight = NULL;
+    uint16_t usPublishPacketIdentifier = 0;
+    uint32_t ulIndex;
+
+    if( pxAzureIoTHubClient == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClient_SendTelemetryWithCookie failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        for( ulIndex = 0; ulIndex < azureiotconfigTELEMETRY_INFLIGHT_MAX; ulIndex++ )
+        {
+            if( pxAzureIoTHubClient->_internal.xTelemetryInFlight[ ulIndex ]._internal.usPacketID == 0 )
+            {
+                pxInFlight = &pxAzureIoTHubClient->_internal.xTelemetryInFlight[ ulIndex ];
+                break;
+            }
+        }
+
+        if( pxInFlight == NULL )
+        {
+            AZLogError( ( "AzureIoTHubClient_SendTelemetryWithCookie failed: in-flight window full" ) );
+            xResult = eAzureIoTErrorBusy;
+        }
+        else if( ( xResult = AzureIoTHubClient_SendTelemetry( pxAzureIoTHubClient,
+                                                              pucTelemetryData, ulTelemetryDataLength,
+                                                              pxProperties, eAzureIoTHubMessageQoS1,
+                                                              &usPublishPacketIdentifier ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to send tracked telemetry: error=0x%08x", xResult ) );
+        }
+        else
+        {
+            pxInFlight->_internal.usPacketID = usPublishPacketIdentifier;
+            pxInFlight->_internal.ulSendTimeMs = AzureIoT_GetTimeMs();
+            pxInFlight->_internal.pvCookie = pvCookie;
+
+            if( pusTelemetryPacketID != NULL )
+            {
+                *pusTelemetryPacketID = usPublishPacketIdentifier;
+            }
+        }
     }
 
     return xResult;
@@ -923,6 +1665,10 @@ AzureIoTResult_t AzureIoTHubClient_ProcessLoop( AzureIoTHubClient_t * pxAzureIoT
     }
     else
     {
+        /* Report telemetry whose PUBACK did not arrive in time */
+        prvTelemetryInFlightRelease( pxAzureIoTHubClient, 0, eAzureIoTErrorPubackWaitTimeout );
+        prvIoTHubClientTokenRefreshCheck( pxAzureIoTHubClient );
+        prvIoTHubClientKeepAliveCheck( pxAzureIoTHubClient );
         xResult = eAzureIoTSuccess;
     }
 
@@ -930,6 +1676,208 @@ AzureIoTResult_t AzureIoTHubClient_ProcessLoop( AzureIoTHubClient_t * pxAzureIoT
 }
 /*-----------------------------------------------------------*/
 
+AzureIoTResult_t AzureIoTHubClient_GetNextDeadline( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                    uint32_t * pulWaitMilliseconds )
+{
+    AzureIoTHubClientTelemetryInFlight_t * pxInFlight;
+    uint64_t ullNowSecs;
+    uint64_t ullRefreshTimeSecs;
+    uint32_t ulNowMs;
+    uint32_t ulWaitMs = UINT32_MAX;
+    uint32_t ulIndex;
+
+    if( ( pxAzureIoTHubClient == NULL ) || ( pulWaitMilliseconds == NULL ) )
+    {
+        AZLogError( ( "AzureIoTHubClient_GetNextDeadline failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ulNowMs = AzureIoT_GetTimeMs();
+
+    if( pxAzureIoTHubClient->_internal.xConnected )
+    {
+        ulWaitMs = prvTimeLeftMs( ulNowMs, pxAzureIoTHubClient->_internal.ulKeepAliveTimeMs,
+                                  azureiothubKEEP_ALIVE_TIMEOUT_SECONDS * 1000U, ulWaitMs );
+    }
+
+    for( ulIndex = 0; ulIndex < azureiotconfigTELEMETRY_INFLIGHT_MAX; ulIndex++ )
+    {
+        pxInFlight = &pxAzureIoTHubClient->_internal.xTelemetryInFlight[ ulIndex ];
+
+        if( pxInFlight->_internal.usPacketID != 0 )
+        {
+            ulWaitMs = prvTimeLeftMs( ulNowMs, pxInFlight->_internal.ulSendTimeMs,
+                                      azureiothubTELEMETRY_PUBACK_TIMEOUT_MS, ulWaitMs );
+        }
+    }
+
+    if( pxAzureIoTHubClient->_internal.xConnected &&
+        ( pxAzureIoTHubClient->_internal.xTokenRefreshCallback != NULL ) &&
+        ( pxAzureIoTHubClient->_internal.ulSASTokenLength != 0 ) &&
+        !pxAzureIoTHubClient->_internal.xTokenRefreshNotified )
+    {
+        ullNowSecs = pxAzureIoTHubClient->_internal.xTimeFunction();
+
+        if( prvIoTHubClientTokenRefreshDue( pxAzureIoTHubClient, ullNowSecs ) )
+        {
+            ulWaitMs = 0;
+        }
+        else
+        {
+            ullRefreshTimeSecs = pxAzureIoTHubClient->_internal.ullSASTokenExpiryTimeSecs -
+                                 pxAzureIoTHubClient->_internal.ulTokenRefreshMarginSecs;
+
+            if( ( ullRefreshTimeSecs - ullNowSecs ) < ( ulWaitMs / 1000U ) )
+            {
+                ulWaitMs = ( uint32_t ) ( ullRefreshTimeSecs - ullNowSecs ) * 1000U;
+            }
+        }
+    }
+
+    *pulWaitMilliseconds = ulWaitMs;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+#if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+
+    AzureIoTResult_t AzureIoTHubClient_GetStatistics( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                      AzureIoTHubClientStatistics_t * pxStatistics )
+    {
+        if( ( pxAzureIoTHubClient == NULL ) || ( pxStatistics == NULL ) )
+        {
+            AZLogError( ( "AzureIoTHubClient_GetStatistics failed: invalid argument" ) );
+            return eAzureIoTErrorInvalidArgument;
+        }
+
+        *pxStatistics = pxAzureIoTHubClient->_internal.xStatistics;
+
+        return eAzureIoTSuccess;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* azureiotconfigUSE_HUB_CLIENT_STATISTICS */
+
+AzureIoTResult_t AzureIoTHubClient_SubscribeAll( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                 AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback,
+                                                 void * pvCloudToDeviceMessageCallbackContext,
+                                                 AzureIoTHubClientCommandCallback_t xCommandCallback,
+                                                 void * pvCommandCallbackContext,
+                                                 AzureIoTHubClientPropertiesCallback_t xPropertiesCallback,
+                                                 void * pvPropertiesCallbackContext,
+                                                 AzureIoTHubClientSubscribeCompleteCallback_t xSubscribeCompleteCallback,
+                                                 void * pvSubscribeCompleteCallbackContext )
+{
+    AzureIoTMQTTSubscribeInfo_t xMqttSubscription[ azureiothubSUBSCRIBE_FEATURE_COUNT + 1 ];
+    size_t xSubscriptionCount = 0;
+    AzureIoTMQTTResult_t xMQTTResult;
+    AzureIoTResult_t xResult;
+    uint16_t usSubscribePacketIdentifier;
+    AzureIoTHubClientReceiveContext_t * pxContext;
+
+    if( ( pxAzureIoTHubClient == NULL ) ||
+        ( ( xCloudToDeviceMessageCallback == NULL ) &&
+          ( xCommandCallback == NULL ) &&
+          ( xPropertiesCallback == NULL ) ) )
+    {
+        AZLogError( ( "AzureIoTHubClient_SubscribeAll failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( pxAzureIoTHubClient->_internal.usSubscribeAllPacketID != 0 )
+    {
+        AZLogError( ( "AzureIoTHubClient_SubscribeAll failed: previous subscribe still waiting for its suback" ) );
+        xResult = eAzureIoTErrorBusy;
+    }
+    else
+    {
+        memset( xMqttSubscription, 0, sizeof( xMqttSubscription ) );
+
+        if( xCloudToDeviceMessageCallback != NULL )
+        {
+            xMqttSubscription[ xSubscriptionCount ].xQoS = eAzureIoTMQTTQoS1;
+            xMqttSubscription[ xSubscriptionCount ].pcTopicFilter = ( const uint8_t * ) AZ_IOT_HUB_CLIENT_C2D_SUBSCRIBE_TOPIC;
+            xMqttSubscription[ xSubscriptionCount ].usTopicFilterLength = ( uint16_t ) sizeof( AZ_IOT_HUB_CLIENT_C2D_SUBSCRIBE_TOPIC ) - 1;
+            xSubscriptionCount++;
+        }
+
+        if( xCommandCallback != NULL )
+        {
+            xMqttSubscription[ xSubscriptionCount ].xQoS = eAzureIoTMQTTQoS0;
+            xMqttSubscription[ xSubscriptionCount ].pcTopicFilter = ( const uint8_t * ) AZ_IOT_HUB_CLIENT_COMMANDS_SUBSCRIBE_TOPIC;
+            xMqttSubscription[ xSubscriptionCount ].usTopicFilterLength = ( uint16_t ) sizeof( AZ_IOT_HUB_CLIENT_COMMANDS_SUBSCRIBE_TOPIC ) - 1;
+            xSubscriptionCount++;
+        }
+
+        if( xPropertiesCallback != NULL )
+        {
+            xMqttSubscription[ xSubscriptionCount ].xQoS = eAzureIoTMQTTQoS0;
+            xMqttSubscription[ xSubscriptionCount ].pcTopicFilter = ( const uint8_t * ) AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_SUBSCRIBE_TOPIC;
+            xMqttSubscription[ xSubscriptionCount ].usTopicFilterLength = ( uint16_t ) sizeof( AZ_IOT_HUB_CLIENT_PROPERTIES_MESSAGE_SUBSCRIBE_TOPIC ) - 1;
+            xSubscriptionCount++;
+            xMqttSubscription[ xSubscriptionCount ].xQoS = eAzureIoTMQTTQoS0;
+            xMqttSubscription[ xSubscriptionCount ].pcTopicFilter = ( const uint8_t * ) AZ_IOT_HUB_CLIENT_PROPERTIES_WRITABLE_UPDATES_SUBSCRIBE_TOPIC;
+            xMqttSubscription[ xSubscriptionCount ].usTopicFilterLength = ( uint16_t ) sizeof( AZ_IOT_HUB_CLIENT_PROPERTIES_WRITABLE_UPDATES_SUBSCRIBE_TOPIC ) - 1;
+            xSubscriptionCount++;
+        }
+
+        usSubscribePacketIdentifier = AzureIoTMQTT_GetPacketId( &( pxAzureIoTHubClient->_internal.xMQTTContext ) );
+
+        AZLogDebug( ( "Attempting to subscribe to %u MQTT topics", ( uint16_t ) xSubscriptionCount ) );
+
+        if( ( xMQTTResult = AzureIoTMQTT_Subscribe( &( pxAzureIoTHubClient->_internal.xMQTTContext ),
+                                                    xMqttSubscription, xSubscriptionCount,
+                                                    usSubscribePacketIdentifier ) ) != eAzureIoTMQTTSuccess )
+        {
+            AZLogError( ( "Subscribe all failed: MQTT error=0x%08x", xMQTTResult ) );
+            xResult = eAzureIoTErrorSubscribeFailed;
+        }
+        else
+        {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
+            if( xCloudToDeviceMessageCallback != NULL )
+            {
+                pxContext = &pxAzureIoTHubClient->_internal.xReceiveContext[ azureiothubRECEIVE_CONTEXT_INDEX_C2D ];
+                pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
+                pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
+                pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientC2DProcess;
+                pxContext->_internal.callbacks.xCloudToDeviceMessageCallback = xCloudToDeviceMessageCallback;
+                pxContext->_internal.pvCallbackContext = pvCloudToDeviceMessageCallbackContext;
+            }
+
+            if( xCommandCallback != NULL )
+            {
+                pxContext = &pxAzureIoTHubClient->_internal.xReceiveContext[ azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS ];
+                pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
+                pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
+                pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientCommandProcess;
+                pxContext->_internal.callbacks.xCommandCallback = xCommandCallback;
+                pxContext->_internal.pvCallbackContext = pvCommandCallbackContext;
+            }
+
+            if( xPropertiesCallback != NULL )
+            {
+                pxContext = &pxAzureIoTHubClient->_internal.xReceiveContext[ azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES ];
+                pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
+                pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
+                pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientPropertiesProcess;
+                pxContext->_internal.callbacks.xPropertiesCallback = xPropertiesCallback;
+                pxContext->_internal.pvCallbackContext = pvPropertiesCallbackContext;
+            }
+
+            pxAzureIoTHubClient->_internal.usSubscribeAllPacketID = usSubscribePacketIdentifier;
+            pxAzureIoTHubClient->_internal.xSubscribeCompleteCallback = xSubscribeCompleteCallback;
+            pxAzureIoTHubClient->_internal.pvSubscribeCompleteCallbackContext = pvSubscribeCompleteCallbackContext;
+
+            xResult = eAzureIoTSuccess;
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
 AzureIoTResult_t AzureIoTHubClient_SubscribeCloudToDeviceMessage( AzureIoTHubClient_t * pxAzureIoTHubClient,
                                                                   AzureIoTHubClientCloudToDeviceMessageCallback_t xCallback,
                                                                   void * prvCallbackContext,
@@ -965,6 +1913,8 @@ AzureIoTResult_t AzureIoTHubClient_SubscribeCloudToDeviceMessage( AzureIoTHubCli
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
             pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
             pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientC2DProcess;
@@ -1016,6 +1966,8 @@ AzureIoTResult_t AzureIoTHubClient_UnsubscribeCloudToDeviceMessage( AzureIoTHubC
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
             xResult = eAzureIoTSuccess;
         }
@@ -1061,6 +2013,8 @@ AzureIoTResult_t AzureIoTHubClient_SubscribeCommand( AzureIoTHubClient_t * pxAzu
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
             pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
             pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientCommandProcess;
@@ -1112,6 +2066,8 @@ AzureIoTResult_t AzureIoTHubClient_UnsubscribeCommand( AzureIoTHubClient_t * pxA
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
             xResult = eAzureIoTSuccess;
         }
@@ -1185,8 +2141,16 @@ AzureIoTResult_t AzureIoTHubClient_SendCommandResponse( AzureIoTHubClient_t * px
             }
             else
             {
+                prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
                 xResult = eAzureIoTSuccess;
             }
+
+            #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+                prvStatisticsRecordPublish( &pxAzureIoTHubClient->_internal.xStatistics,
+                                            &pxAzureIoTHubClient->_internal.xStatistics.xCommands,
+                                            xMQTTResult, xMQTTPublishInfo.xPayloadLength );
+            #endif
         }
     }
 
@@ -1234,6 +2198,8 @@ AzureIoTResult_t AzureIoTHubClient_SubscribeProperties( AzureIoTHubClient_t * px
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             pxContext->_internal.usState = azureiothubTOPIC_SUBSCRIBE_STATE_SUB;
             pxContext->_internal.usMqttSubPacketID = usSubscribePacketIdentifier;
             pxContext->_internal.pxProcessFunction = prvAzureIoTHubClientPropertiesProcess;
@@ -1289,6 +2255,8 @@ AzureIoTResult_t AzureIoTHubClient_UnsubscribeProperties( AzureIoTHubClient_t *
         }
         else
         {
+            prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
             memset( pxContext, 0, sizeof( AzureIoTHubClientReceiveContext_t ) );
             xResult = eAzureIoTSuccess;
         }
@@ -1357,8 +2325,16 @@ AzureIoTResult_t AzureIoTHubClient_SendPropertiesReported( AzureIoTHubClient_t *
             }
             else
             {
+                prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
                 xResult = eAzureIoTSuccess;
             }
+
+            #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+                prvStatisticsRecordPublish( &pxAzureIoTHubClient->_internal.xStatistics,
+                                            &pxAzureIoTHubClient->_internal.xStatistics.xProperties,
+                                            xMQTTResult, xMQTTPublishInfo.xPayloadLength );
+            #endif
         }
     }
 
@@ -1419,8 +2395,16 @@ AzureIoTResult_t AzureIoTHubClient_RequestPropertiesAsync( AzureIoTHubClient_t *
             }
             else
             {
+                prvIoTHubClientKeepAliveRestart( pxAzureIoTHubClient );
+
                 xResult = eAzureIoTSuccess;
             }
+
+            #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+                prvStatisticsRecordPublish( &pxAzureIoTHubClient->_internal.xStatistics,
+                                            &pxAzureIoTHubClient->_internal.xStatistics.xProperties,
+                                            xMQTTResult, xMQTTPublishInfo.xPayloadLength );
+            #endif
         }
     }
 
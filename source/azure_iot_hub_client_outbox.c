@@ -0,0 +1,392 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_outbox.c
+ * @brief Implementation of the Azure IoT Hub Client store-and-forward telemetry outbox.
+ */
+
+#include "azure_iot_hub_client_outbox.h"
+
+#include <string.h>
+
+#include "azure_iot_private.h"
+
+/* MQTT never uses packet id 0, so it marks a record of the in-flight window waiting to be sent again. */
+#define azureiothuboutboxRESEND_PACKET_ID    ( 0U )
+/*-----------------------------------------------------------*/
+
+static uint32_t prvNextIndex( AzureIoTHubClientOutbox_t * pxOutbox,
+                              uint32_t ulIndex )
+{
+    return ( ulIndex + 1 ) % pxOutbox->_internal.ulSlotCount;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Mark the records in flight that are not acknowledged yet to be sent again.
+ * Records already acknowledged, but waiting behind an older one, are not sent twice.
+ *
+ * */
+static void prvRewind( AzureIoTHubClientOutbox_t * pxOutbox )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < pxOutbox->_internal.ulInFlightCount; ulIndex++ )
+    {
+        if( !pxOutbox->_internal.xInFlightAcked[ ulIndex ] )
+        {
+            pxOutbox->_internal.usInFlightPacketID[ ulIndex ] = azureiothuboutboxRESEND_PACKET_ID;
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Pick the position in the in-flight window of the next record to send. Records to send again
+ * are the oldest, so they go first. A new record takes the position after the window.
+ *
+ * */
+static bool prvNextRecord( AzureIoTHubClientOutbox_t * pxOutbox,
+                           uint32_t * pulWindowIndex )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < pxOutbox->_internal.ulInFlightCount; ulIndex++ )
+    {
+        if( pxOutbox->_internal.usInFlightPacketID[ ulIndex ] == azureiothuboutboxRESEND_PACKET_ID )
+        {
+            *pulWindowIndex = ulIndex;
+            return true;
+        }
+    }
+
+    if( ( pxOutbox->_internal.ulSendIndex != pxOutbox->_internal.ulHead ) &&
+        ( pxOutbox->_internal.ulInFlightCount < azureiotconfigTELEMETRY_INFLIGHT_MAX ) )
+    {
+        *pulWindowIndex = pxOutbox->_internal.ulInFlightCount;
+        return true;
+    }
+
+    return false;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Check and consume the drain rate budget for one message.
+ *
+ * */
+static bool prvDrainAllowed( AzureIoTHubClientOutbox_t * pxOutbox )
+{
+    uint32_t ulNowMs;
+
+    if( pxOutbox->_internal.xOptions.ulDrainMaxMessages == 0 )
+    {
+        return true;
+    }
+
+    ulNowMs = AzureIoT_GetTimeMs();
+
+    if( ( ulNowMs - pxOutbox->_internal.ulDrainWindowStartMs ) >= pxOutbox->_internal.xOptions.ulDrainIntervalMilliseconds )
+    {
+        pxOutbox->_internal.ulDrainWindowStartMs = ulNowMs;
+        pxOutbox->_internal.ulDrainWindowCount = 0;
+    }
+
+    if( pxOutbox->_internal.ulDrainWindowCount >= pxOutbox->_internal.xOptions.ulDrainMaxMessages )
+    {
+        return false;
+    }
+
+    pxOutbox->_internal.ulDrainWindowCount++;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientOutbox_OptionsInit( AzureIoTHubClientOutboxOptions_t * pxOptions )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxOptions == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_OptionsInit failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        memset( pxOptions, 0, sizeof( AzureIoTHubClientOutboxOptions_t ) );
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientOutbox_Init( AzureIoTHubClientOutbox_t * pxOutbox,
+                                               AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                               AzureIoTOutboxStorage_t * pxStorage,
+                                               AzureIoTHubClientOutboxOptions_t * pxOptions,
+                                               uint8_t * pucScratchBuffer,
+                                               uint32_t ulScratchBufferLength )
+{
+    AzureIoTResult_t xResult;
+    uint32_t ulHead;
+    uint32_t ulTail;
+
+    if( ( pxOutbox == NULL ) || ( pxAzureIoTHubClient == NULL ) || ( pxStorage == NULL ) ||
+        ( pucScratchBuffer == NULL ) || ( ulScratchBufferLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Init failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( ( AzureIoTOutboxStorage_GetSlotCount( pxStorage ) < 2 ) ||
+             ( AzureIoTOutboxStorage_GetSlotSize( pxStorage ) > ulScratchBufferLength ) )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Init failed: storage does not match scratch buffer" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( ( xResult = AzureIoTOutboxStorage_ReadIndices( pxStorage, &ulHead, &ulTail ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to read outbox indices: error=0x%08x", xResult ) );
+    }
+    else if( ( ulHead >= AzureIoTOutboxStorage_GetSlotCount( pxStorage ) ) ||
+             ( ulTail >= AzureIoTOutboxStorage_GetSlotCount( pxStorage ) ) )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Init failed: corrupted indices" ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        memset( pxOutbox, 0, sizeof( AzureIoTHubClientOutbox_t ) );
+
+        if( pxOptions == NULL )
+        {
+            ( void ) AzureIoTHubClientOutbox_OptionsInit( &pxOutbox->_internal.xOptions );
+        }
+        else
+        {
+            pxOutbox->_internal.xOptions = *pxOptions;
+        }
+
+        pxOutbox->_internal.pxAzureIoTHubClient = pxAzureIoTHubClient;
+        pxOutbox->_internal.pxStorage = pxStorage;
+        pxOutbox->_internal.pucScratchBuffer = pucScratchBuffer;
+        pxOutbox->_internal.ulScratchBufferLength = ulScratchBufferLength;
+        pxOutbox->_internal.ulSlotCount = AzureIoTOutboxStorage_GetSlotCount( pxStorage );
+        pxOutbox->_internal.ulHead = ulHead;
+        pxOutbox->_internal.ulTail = ulTail;
+        pxOutbox->_internal.ulSendIndex = ulTail;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientOutbox_Enqueue( AzureIoTHubClientOutbox_t * pxOutbox,
+                                                  const uint8_t * pucTelemetryData,
+                                                  uint32_t ulTelemetryDataLength )
+{
+    AzureIoTResult_t xResult;
+    uint32_t ulNextHead;
+
+    if( ( pxOutbox == NULL ) || ( pucTelemetryData == NULL ) || ( ulTelemetryDataLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Enqueue failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ulNextHead = prvNextIndex( pxOutbox, pxOutbox->_internal.ulHead );
+
+    if( ( ulNextHead == pxOutbox->_internal.ulTail ) ||
+        ( ulTelemetryDataLength > AzureIoTOutboxStorage_GetSlotSize( pxOutbox->_internal.pxStorage ) ) )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Enqueue failed: outbox full or message too big" ) );
+        xResult = eAzureIoTErrorOutOfMemory;
+    }
+    else if( ( xResult = AzureIoTOutboxStorage_WriteRecord( pxOutbox->_internal.pxStorage,
+                                                            pxOutbox->_internal.ulHead,
+                                                            pucTelemetryData, ulTelemetryDataLength ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to write outbox record: error=0x%08x", xResult ) );
+    }
+    else if( ( xResult = AzureIoTOutboxStorage_WriteIndices( pxOutbox->_internal.pxStorage,
+                                                             ulNextHead, pxOutbox->_internal.ulTail ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to write outbox indices: error=0x%08x", xResult ) );
+    }
+    else
+    {
+        pxOutbox->_internal.ulHead = ulNextHead;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientOutbox_Resume( AzureIoTHubClientOutbox_t * pxOutbox )
+{
+    if( pxOutbox == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Resume failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    prvRewind( pxOutbox );
+    pxOutbox->_internal.ulDrainWindowStartMs = AzureIoT_GetTimeMs();
+    pxOutbox->_internal.ulDrainWindowCount = 0;
+    pxOutbox->_internal.xDraining = true;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientOutbox_Process( AzureIoTHubClientOutbox_t * pxOutbox )
+{
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+    uint32_t ulWindowIndex;
+    uint32_t ulRecordLength;
+    uint16_t usPacketID;
+
+    if( pxOutbox == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientOutbox_Process failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    while( pxOutbox->_internal.xDraining &&
+           prvNextRecord( pxOutbox, &ulWindowIndex ) &&
+           prvDrainAllowed( pxOutbox ) )
+    {
+        /* The in-flight window covers the records from the tail in order */
+        if( ( xResult = AzureIoTOutboxStorage_ReadRecord( pxOutbox->_internal.pxStorage,
+                                                          ( pxOutbox->_internal.ulTail + ulWindowIndex ) %
+                                                          pxOutbox->_internal.ulSlotCount,
+                                                          pxOutbox->_internal.pucScratchBuffer,
+                                                          pxOutbox->_internal.ulScratchBufferLength,
+                                                          &ulRecordLength ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to read outbox record: error=0x%08x", xResult ) );
+            break;
+        }
+
+        xResult = AzureIoTHubClient_SendTelemetryWithCookie( pxOutbox->_internal.pxAzureIoTHubClient,
+                                                             pxOutbox->_internal.pucScratchBuffer, ulRecordLength,
+                                                             NULL, pxOutbox, &usPacketID );
+
+        if( xResult == eAzureIoTErrorBusy )
+        {
+            /* Client in-flight window is taken by other telemetry, give the budget back and retry on the next call */
+            if( pxOutbox->_internal.xOptions.ulDrainMaxMessages != 0 )
+            {
+                pxOutbox->_internal.ulDrainWindowCount--;
+            }
+
+            xResult = eAzureIoTSuccess;
+            break;
+        }
+        else if( xResult != eAzureIoTSuccess )
+        {
+            /* The record stays pending and is sent once AzureIoTHubClientOutbox_Resume() is called */
+            AZLogError( ( "Failed to send outbox record, pausing: error=0x%08x", xResult ) );
+            pxOutbox->_internal.xDraining = false;
+            break;
+        }
+
+        pxOutbox->_internal.usInFlightPacketID[ ulWindowIndex ] = usPacketID;
+
+        if( ulWindowIndex == pxOutbox->_internal.ulInFlightCount )
+        {
+            pxOutbox->_internal.xInFlightAcked[ ulWindowIndex ] = false;
+            pxOutbox->_internal.ulInFlightCount++;
+            pxOutbox->_internal.ulSendIndex = prvNextIndex( pxOutbox, pxOutbox->_internal.ulSendIndex );
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+void AzureIoTHubClientOutbox_TelemetryAckCallback( AzureIoTResult_t xResult,
+                                                   uint16_t usTelemetryPacketID,
+                                                   void * pvCookie,
+                                                   uint32_t ulAckLatencyMilliseconds )
+{
+    AzureIoTHubClientOutbox_t * pxOutbox = ( AzureIoTHubClientOutbox_t * ) pvCookie;
+    uint32_t ulIndex;
+    uint32_t ulAckedCount = 0;
+
+    ( void ) ulAckLatencyMilliseconds;
+
+    if( pxOutbox == NULL )
+    {
+        return;
+    }
+
+    for( ulIndex = 0; ulIndex < pxOutbox->_internal.ulInFlightCount; ulIndex++ )
+    {
+        if( pxOutbox->_internal.usInFlightPacketID[ ulIndex ] == usTelemetryPacketID )
+        {
+            break;
+        }
+    }
+
+    if( ( ulIndex == pxOutbox->_internal.ulInFlightCount ) || ( usTelemetryPacketID == azureiothuboutboxRESEND_PACKET_ID ) )
+    {
+        /* Ack for a record already rewound */
+        return;
+    }
+
+    if( xResult != eAzureIoTSuccess )
+    {
+        /* Only this record is sent again, the others of the window may still be acknowledged */
+        AZLogWarn( ( "Outbox record not acknowledged, resending it: error=0x%08x", xResult ) );
+        pxOutbox->_internal.usInFlightPacketID[ ulIndex ] = azureiothuboutboxRESEND_PACKET_ID;
+        return;
+    }
+
+    pxOutbox->_internal.xInFlightAcked[ ulIndex ] = true;
+
+    /* Only a contiguous run of acked records from the tail can be released */
+    while( ( ulAckedCount < pxOutbox->_internal.ulInFlightCount ) &&
+           pxOutbox->_internal.xInFlightAcked[ ulAckedCount ] )
+    {
+        ulAckedCount++;
+    }
+
+    if( ulAckedCount > 0 )
+    {
+        pxOutbox->_internal.ulInFlightCount -= ulAckedCount;
+        memmove( pxOutbox->_internal.usInFlightPacketID,
+                 &pxOutbox->_internal.usInFlightPacketID[ ulAckedCount ],
+                 pxOutbox->_internal.ulInFlightCount * sizeof( uint16_t ) );
+        memmove( pxOutbox->_internal.xInFlightAcked,
+                 &pxOutbox->_internal.xInFlightAcked[ ulAckedCount ],
+                 pxOutbox->_internal.ulInFlightCount * sizeof( bool ) );
+
+        pxOutbox->_internal.ulTail = ( pxOutbox->_internal.ulTail + ulAckedCount ) % pxOutbox->_internal.ulSlotCount;
+
+        if( AzureIoTOutboxStorage_WriteIndices( pxOutbox->_internal.pxStorage,
+                                                pxOutbox->_internal.ulHead,
+                                                pxOutbox->_internal.ulTail ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to write outbox indices" ) );
+        }
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t AzureIoTHubClientOutbox_GetPendingCount( AzureIoTHubClientOutbox_t * pxOutbox )
+{
+    if( pxOutbox == NULL )
+    {
+        return 0;
+    }
+
+    return ( pxOutbox->_internal.ulHead + pxOutbox->_internal.ulSlotCount - pxOutbox->_internal.ulTail ) %
+           pxOutbox->_internal.ulSlotCount;
+}
+/*-----------------------------------------------------------*/
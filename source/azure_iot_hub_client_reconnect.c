@@ -0,0 +1,360 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_reconnect.c
+ * @brief Implementation of the Azure IoT Hub Client reconnect manager.
+ */
+
+#include "azure_iot_hub_client_reconnect.h"
+
+#include <string.h>
+
+#include "azure_iot_private.h"
+/*-----------------------------------------------------------*/
+
+static bool prvHasSubscriptions( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    return ( pxReconnect->_internal.xCloudToDeviceMessageCallback != NULL ) ||
+           ( pxReconnect->_internal.xCommandCallback != NULL ) ||
+           ( pxReconnect->_internal.xPropertiesCallback != NULL );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Schedule the next attempt after a failure. The delay doubles with every failed attempt, up to the
+ * maximum, and is picked in the upper half of that range. The random sequence is seeded with the
+ * device ID so devices dropped together spread their attempts.
+ *
+ * */
+static void prvScheduleAttempt( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    uint32_t ulDelayMs = pxReconnect->_internal.xOptions.ulBackoffBaseMilliseconds;
+    uint32_t ulMaxMs = pxReconnect->_internal.xOptions.ulBackoffMaxMilliseconds;
+    uint32_t ulState = pxReconnect->_internal.ulJitterState;
+    uint32_t ulAttempt;
+
+    for( ulAttempt = 0; ( ulAttempt < pxReconnect->_internal.ulAttemptCount ) && ( ulDelayMs < ulMaxMs ); ulAttempt++ )
+    {
+        ulDelayMs = ( ulDelayMs > ( ulMaxMs / 2U ) ) ? ulMaxMs : ( ulDelayMs * 2U );
+    }
+
+    if( ulDelayMs > ulMaxMs )
+    {
+        ulDelayMs = ulMaxMs;
+    }
+
+    /* xorshift32 */
+    ulState ^= ulState << 13;
+    ulState ^= ulState >> 17;
+    ulState ^= ulState << 5;
+    pxReconnect->_internal.ulJitterState = ulState;
+
+    ulDelayMs = ( ulDelayMs / 2U ) + ( ulState % ( ( ulDelayMs / 2U ) + 1U ) );
+
+    pxReconnect->_internal.ulAttemptCount++;
+    pxReconnect->_internal.ulNextAttemptTimeMs = AzureIoT_GetTimeMs() + ulDelayMs;
+
+    AZLogInfo( ( "AzureIoTHubClientReconnect next attempt in %u ms", ( uint16_t ) ulDelayMs ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSubscribeComplete( AzureIoTResult_t xResult,
+                                  void * pvContext )
+{
+    AzureIoTHubClientReconnect_t * pxReconnect = ( AzureIoTHubClientReconnect_t * ) pvContext;
+
+    pxReconnect->_internal.xSubscribed = ( xResult == eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSubscribe( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    pxReconnect->_internal.xSubscribed = false;
+
+    return AzureIoTHubClient_SubscribeAll( pxReconnect->_internal.pxAzureIoTHubClient,
+                                           pxReconnect->_internal.xCloudToDeviceMessageCallback,
+                                           pxReconnect->_internal.pvCloudToDeviceMessageCallbackContext,
+                                           pxReconnect->_internal.xCommandCallback,
+                                           pxReconnect->_internal.pvCommandCallbackContext,
+                                           pxReconnect->_internal.xPropertiesCallback,
+                                           pxReconnect->_internal.pvPropertiesCallbackContext,
+                                           prvSubscribeComplete, pxReconnect );
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Disconnect and close the transport. The MQTT DISCONNECT is best effort as the link is usually gone.
+ *
+ * */
+static void prvDropConnection( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    AzureIoTHubClient_t * pxAzureIoTHubClient = pxReconnect->_internal.pxAzureIoTHubClient;
+
+    if( AzureIoTHubClient_Disconnect( pxAzureIoTHubClient ) != eAzureIoTSuccess )
+    {
+        AZLogWarn( ( "AzureIoTHubClientReconnect failed to disconnect" ) );
+    }
+
+    if( pxReconnect->_internal.xCloseTransport( pxAzureIoTHubClient, pxReconnect->_internal.pvContext ) != eAzureIoTSuccess )
+    {
+        AZLogWarn( ( "AzureIoTHubClientReconnect failed to close transport" ) );
+    }
+
+    pxReconnect->_internal.xConnected = false;
+
+    if( pxReconnect->_internal.xConnectionCallback != NULL )
+    {
+        pxReconnect->_internal.xConnectionCallback( pxAzureIoTHubClient, false, pxReconnect->_internal.pvContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvConnect( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    AzureIoTHubClient_t * pxAzureIoTHubClient = pxReconnect->_internal.pxAzureIoTHubClient;
+    AzureIoTResult_t xResult;
+    bool xSessionPresent = false;
+
+    if( ( xResult = pxReconnect->_internal.xOpenTransport( pxAzureIoTHubClient,
+                                                           pxReconnect->_internal.pvContext ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect failed to open transport: error=0x%08x", ( uint16_t ) xResult ) );
+        return xResult;
+    }
+
+    if( ( xResult = AzureIoTHubClient_Connect( pxAzureIoTHubClient, false, &xSessionPresent,
+                                               pxReconnect->_internal.xOptions.ulConnectTimeoutMilliseconds ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect failed to connect: error=0x%08x", ( uint16_t ) xResult ) );
+
+        if( pxReconnect->_internal.xCloseTransport( pxAzureIoTHubClient, pxReconnect->_internal.pvContext ) != eAzureIoTSuccess )
+        {
+            AZLogWarn( ( "AzureIoTHubClientReconnect failed to close transport" ) );
+        }
+
+        return xResult;
+    }
+
+    pxReconnect->_internal.xConnected = true;
+    pxReconnect->_internal.ulAttemptCount = 0;
+
+    if( pxReconnect->_internal.xConnectionCallback != NULL )
+    {
+        pxReconnect->_internal.xConnectionCallback( pxAzureIoTHubClient, true, pxReconnect->_internal.pvContext );
+    }
+
+    /* The hub kept the session, and with it the acknowledged subscriptions. */
+    if( xSessionPresent && pxReconnect->_internal.xSubscribed )
+    {
+        AZLogInfo( ( "AzureIoTHubClientReconnect session present, subscriptions kept" ) );
+    }
+    else if( prvHasSubscriptions( pxReconnect ) &&
+             ( ( xResult = prvSubscribe( pxReconnect ) ) != eAzureIoTSuccess ) )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect failed to subscribe: error=0x%08x", ( uint16_t ) xResult ) );
+        prvDropConnection( pxReconnect );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_OptionsInit( AzureIoTHubClientReconnectOptions_t * pxOptions )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxOptions == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_OptionsInit failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        pxOptions->ulBackoffBaseMilliseconds = azureiotconfigRECONNECT_BACKOFF_BASE_MS;
+        pxOptions->ulBackoffMaxMilliseconds = azureiotconfigRECONNECT_BACKOFF_MAX_MS;
+        pxOptions->ulConnectTimeoutMilliseconds = azureiotconfigCONNACK_RECV_TIMEOUT_MS;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_Init( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                  AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                  AzureIoTHubClientReconnectOptions_t * pxOptions,
+                                                  AzureIoTHubClientReconnectTransportFunc_t xOpenTransport,
+                                                  AzureIoTHubClientReconnectTransportFunc_t xCloseTransport,
+                                                  AzureIoTHubClientReconnectConnectionCallback_t xConnectionCallback,
+                                                  void * pvContext )
+{
+    uint32_t ulSeed;
+
+    if( ( pxReconnect == NULL ) || ( pxAzureIoTHubClient == NULL ) ||
+        ( xOpenTransport == NULL ) || ( xCloseTransport == NULL ) ||
+        ( ( pxOptions != NULL ) &&
+          ( ( pxOptions->ulBackoffBaseMilliseconds == 0 ) ||
+            ( pxOptions->ulBackoffMaxMilliseconds < pxOptions->ulBackoffBaseMilliseconds ) ) ) )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxReconnect, 0, sizeof( AzureIoTHubClientReconnect_t ) );
+
+    if( pxOptions == NULL )
+    {
+        ( void ) AzureIoTHubClientReconnect_OptionsInit( &pxReconnect->_internal.xOptions );
+    }
+    else
+    {
+        pxReconnect->_internal.xOptions = *pxOptions;
+    }
+
+    /* Seeded from the device ID, never zero as xorshift would stay at zero. */
+    ulSeed = AzureIoT_FNV1a32( azureiotFNV1A_32_OFFSET_BASIS,
+                               pxAzureIoTHubClient->_internal.pucDeviceID,
+                               pxAzureIoTHubClient->_internal.ulDeviceIDLength );
+
+    pxReconnect->_internal.ulJitterState = ( ulSeed != 0 ) ? ulSeed : 1U;
+    pxReconnect->_internal.pxAzureIoTHubClient = pxAzureIoTHubClient;
+    pxReconnect->_internal.xOpenTransport = xOpenTransport;
+    pxReconnect->_internal.xCloseTransport = xCloseTransport;
+    pxReconnect->_internal.xConnectionCallback = xConnectionCallback;
+    pxReconnect->_internal.pvContext = pvContext;
+    pxReconnect->_internal.ulNextAttemptTimeMs = AzureIoT_GetTimeMs();
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_SetSubscriptions( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                              AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback,
+                                                              void * pvCloudToDeviceMessageCallbackContext,
+                                                              AzureIoTHubClientCommandCallback_t xCommandCallback,
+                                                              void * pvCommandCallbackContext,
+                                                              AzureIoTHubClientPropertiesCallback_t xPropertiesCallback,
+                                                              void * pvPropertiesCallbackContext )
+{
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+
+    if( ( pxReconnect == NULL ) ||
+        ( ( xCloudToDeviceMessageCallback == NULL ) &&
+          ( xCommandCallback == NULL ) &&
+          ( xPropertiesCallback == NULL ) ) )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_SetSubscriptions failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxReconnect->_internal.xCloudToDeviceMessageCallback = xCloudToDeviceMessageCallback;
+    pxReconnect->_internal.pvCloudToDeviceMessageCallbackContext = pvCloudToDeviceMessageCallbackContext;
+    pxReconnect->_internal.xCommandCallback = xCommandCallback;
+    pxReconnect->_internal.pvCommandCallbackContext = pvCommandCallbackContext;
+    pxReconnect->_internal.xPropertiesCallback = xPropertiesCallback;
+    pxReconnect->_internal.pvPropertiesCallbackContext = pvPropertiesCallbackContext;
+    pxReconnect->_internal.xSubscribed = false;
+
+    if( pxReconnect->_internal.xConnected &&
+        ( ( xResult = prvSubscribe( pxReconnect ) ) != eAzureIoTSuccess ) )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect failed to subscribe: error=0x%08x", ( uint16_t ) xResult ) );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_Process( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                     uint32_t ulTimeoutMilliseconds )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxReconnect == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_Process failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( !pxReconnect->_internal.xConnected )
+    {
+        /* Wrap-around safe check of the attempt time. */
+        if( ( int32_t ) ( AzureIoT_GetTimeMs() - pxReconnect->_internal.ulNextAttemptTimeMs ) < 0 )
+        {
+            return eAzureIoTErrorPending;
+        }
+
+        if( prvConnect( pxReconnect ) != eAzureIoTSuccess )
+        {
+            prvScheduleAttempt( pxReconnect );
+
+            return eAzureIoTErrorPending;
+        }
+    }
+
+    if( ( xResult = AzureIoTHubClient_ProcessLoop( pxReconnect->_internal.pxAzureIoTHubClient,
+                                                   ulTimeoutMilliseconds ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect connection lost: error=0x%08x", ( uint16_t ) xResult ) );
+        prvDropConnection( pxReconnect );
+        prvScheduleAttempt( pxReconnect );
+
+        return eAzureIoTErrorPending;
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_Reconnect( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    if( pxReconnect == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_Reconnect failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxReconnect->_internal.xConnected )
+    {
+        prvDropConnection( pxReconnect );
+    }
+
+    pxReconnect->_internal.ulAttemptCount = 0;
+    pxReconnect->_internal.ulNextAttemptTimeMs = AzureIoT_GetTimeMs();
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientReconnect_GetNextDeadline( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                             uint32_t * pulWaitMilliseconds )
+{
+    int32_t lLeftMs;
+
+    if( ( pxReconnect == NULL ) || ( pulWaitMilliseconds == NULL ) )
+    {
+        AZLogError( ( "AzureIoTHubClientReconnect_GetNextDeadline failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxReconnect->_internal.xConnected )
+    {
+        return AzureIoTHubClient_GetNextDeadline( pxReconnect->_internal.pxAzureIoTHubClient, pulWaitMilliseconds );
+    }
+
+    /* Wrap-around safe difference to the attempt time. */
+    lLeftMs = ( int32_t ) ( pxReconnect->_internal.ulNextAttemptTimeMs - AzureIoT_GetTimeMs() );
+    *pulWaitMilliseconds = lLeftMs > 0 ? ( uint32_t ) lLeftMs : 0;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+bool AzureIoTHubClientReconnect_IsConnected( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    return ( pxReconnect != NULL ) && pxReconnect->_internal.xConnected;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,309 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_send_queue.c
+ * @brief Implementation of the Azure IoT Hub Client multi-producer send queue.
+ *
+ * The ring is the bounded queue of Dmitry Vyukov: every slot carries a sequence number telling whether
+ * it is free for the producer at a given position or holds a message for the consumer at that position.
+ * Producers claim a position with a compare-and-swap, fill the slot and then publish it by moving its
+ * sequence. The single consumer needs no atomic read-modify-write on the positions.
+ */
+
+#include "azure_iot_hub_client_send_queue.h"
+
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "atomic.h"
+
+#define azureiotsendqueueTYPE_TELEMETRY              ( 0x1 )
+#define azureiotsendqueueTYPE_COMMAND_RESPONSE       ( 0x2 )
+#define azureiotsendqueueTYPE_PROPERTIES_REPORTED    ( 0x3 )
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Read a value shared between tasks, with the barrier of the FreeRTOS atomic operations.
+ *
+ * */
+static uint32_t prvAtomicLoad( uint32_t volatile * pulValue )
+{
+    return Atomic_OR_u32( pulValue, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvEnqueue( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                    uint32_t ulProducerID,
+                                    uint32_t ulType,
+                                    AzureIoTHubMessageQoS_t xQOS,
+                                    uint32_t ulStatus,
+                                    const uint8_t * pucRequestID,
+                                    uint16_t usRequestIDLength,
+                                    const uint8_t * pucPayload,
+                                    uint32_t ulPayloadLength )
+{
+    AzureIoTHubClientSendQueueItem_t * pxItem;
+    uint32_t ulPosition;
+    int32_t lDifference;
+
+    ulPosition = prvAtomicLoad( &pxSendQueue->_internal.ulEnqueuePosition );
+
+    for( ; ; )
+    {
+        pxItem = &pxSendQueue->_internal.pxItems[ ulPosition & pxSendQueue->_internal.ulMask ];
+        lDifference = ( int32_t ) ( prvAtomicLoad( &pxItem->_internal.ulSequence ) - ulPosition );
+
+        if( lDifference == 0 )
+        {
+            /* The slot is free, claim the position unless another producer did. */
+            if( Atomic_CompareAndSwap_u32( &pxSendQueue->_internal.ulEnqueuePosition,
+                                           ulPosition + 1, ulPosition ) == ATOMIC_COMPARE_AND_SWAP_SUCCESS )
+            {
+                break;
+            }
+        }
+        else if( lDifference < 0 )
+        {
+            /* The slot still holds the message of the previous lap. */
+            ( void ) Atomic_Increment_u32( &pxSendQueue->_internal.ulRejected[ ulProducerID ] );
+            return eAzureIoTErrorOutOfMemory;
+        }
+
+        ulPosition = prvAtomicLoad( &pxSendQueue->_internal.ulEnqueuePosition );
+    }
+
+    pxItem->_internal.ulType = ulType;
+    pxItem->_internal.xQOS = xQOS;
+    pxItem->_internal.ulStatus = ulStatus;
+    pxItem->_internal.usRequestIDLength = usRequestIDLength;
+    pxItem->_internal.ulPayloadLength = ulPayloadLength;
+
+    if( usRequestIDLength > 0 )
+    {
+        ( void ) memcpy( pxItem->_internal.ucRequestID, pucRequestID, usRequestIDLength );
+    }
+
+    if( ulPayloadLength > 0 )
+    {
+        ( void ) memcpy( pxItem->_internal.ucPayload, pucPayload, ulPayloadLength );
+    }
+
+    /* Hand the slot over to the consumer. */
+    ( void ) Atomic_Increment_u32( &pxItem->_internal.ulSequence );
+    ( void ) Atomic_Increment_u32( &pxSendQueue->_internal.ulAccepted[ ulProducerID ] );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSend( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                 AzureIoTHubClientSendQueueItem_t * pxItem )
+{
+    AzureIoTHubClient_t * pxAzureIoTHubClient = pxSendQueue->_internal.pxAzureIoTHubClient;
+    AzureIoTHubClientCommandRequest_t xRequest;
+    AzureIoTResult_t xResult;
+
+    switch( pxItem->_internal.ulType )
+    {
+        case azureiotsendqueueTYPE_TELEMETRY:
+            xResult = AzureIoTHubClient_SendTelemetry( pxAzureIoTHubClient,
+                                                       pxItem->_internal.ucPayload,
+                                                       pxItem->_internal.ulPayloadLength,
+                                                       NULL, pxItem->_internal.xQOS, NULL );
+            break;
+
+        case azureiotsendqueueTYPE_COMMAND_RESPONSE:
+            memset( &xRequest, 0, sizeof( xRequest ) );
+            xRequest.pucRequestID = pxItem->_internal.ucRequestID;
+            xRequest.usRequestIDLength = pxItem->_internal.usRequestIDLength;
+            xResult = AzureIoTHubClient_SendCommandResponse( pxAzureIoTHubClient, &xRequest,
+                                                             pxItem->_internal.ulStatus,
+                                                             pxItem->_internal.ulPayloadLength > 0 ? pxItem->_internal.ucPayload : NULL,
+                                                             pxItem->_internal.ulPayloadLength );
+            break;
+
+        case azureiotsendqueueTYPE_PROPERTIES_REPORTED:
+            xResult = AzureIoTHubClient_SendPropertiesReported( pxAzureIoTHubClient,
+                                                                pxItem->_internal.ucPayload,
+                                                                pxItem->_internal.ulPayloadLength,
+                                                                NULL );
+            break;
+
+        default:
+            AZLogError( ( "AzureIoTHubClientSendQueue unknown item type: [%u]", ( uint16_t ) pxItem->_internal.ulType ) );
+            configASSERT( false );
+            xResult = eAzureIoTErrorFailed;
+            break;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_Init( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                  AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                  AzureIoTHubClientSendQueueItem_t * pxItems,
+                                                  uint32_t ulItemCount )
+{
+    uint32_t ulIndex;
+
+    /* A single slot cannot tell a free slot from a full one. */
+    if( ( pxSendQueue == NULL ) || ( pxAzureIoTHubClient == NULL ) || ( pxItems == NULL ) ||
+        ( ulItemCount < 2 ) || ( ( ulItemCount & ( ulItemCount - 1 ) ) != 0 ) )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxSendQueue, 0, sizeof( AzureIoTHubClientSendQueue_t ) );
+    memset( pxItems, 0, sizeof( AzureIoTHubClientSendQueueItem_t ) * ulItemCount );
+
+    for( ulIndex = 0; ulIndex < ulItemCount; ulIndex++ )
+    {
+        pxItems[ ulIndex ]._internal.ulSequence = ulIndex;
+    }
+
+    pxSendQueue->_internal.pxAzureIoTHubClient = pxAzureIoTHubClient;
+    pxSendQueue->_internal.pxItems = pxItems;
+    pxSendQueue->_internal.ulMask = ulItemCount - 1;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueueTelemetry( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                              uint32_t ulProducerID,
+                                                              const uint8_t * pucTelemetryData,
+                                                              uint32_t ulTelemetryDataLength,
+                                                              AzureIoTHubMessageQoS_t xQOS )
+{
+    if( ( pxSendQueue == NULL ) || ( ulProducerID >= azureiotconfigSEND_QUEUE_PRODUCER_MAX ) ||
+        ( pucTelemetryData == NULL ) || ( ulTelemetryDataLength == 0 ) ||
+        ( ulTelemetryDataLength > azureiotconfigSEND_QUEUE_PAYLOAD_MAX ) )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_EnqueueTelemetry failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    return prvEnqueue( pxSendQueue, ulProducerID, azureiotsendqueueTYPE_TELEMETRY, xQOS, 0,
+                       NULL, 0, pucTelemetryData, ulTelemetryDataLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueueCommandResponse( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                    uint32_t ulProducerID,
+                                                                    const AzureIoTHubClientCommandRequest_t * pxMessage,
+                                                                    uint32_t ulStatus,
+                                                                    const uint8_t * pucCommandPayload,
+                                                                    uint32_t ulCommandPayloadLength )
+{
+    if( ( pxSendQueue == NULL ) || ( ulProducerID >= azureiotconfigSEND_QUEUE_PRODUCER_MAX ) ||
+        ( pxMessage == NULL ) || ( pxMessage->pucRequestID == NULL ) || ( pxMessage->usRequestIDLength == 0 ) ||
+        ( pxMessage->usRequestIDLength > azureiotconfigSEND_QUEUE_REQUEST_ID_MAX ) ||
+        ( ( pucCommandPayload == NULL ) && ( ulCommandPayloadLength != 0 ) ) ||
+        ( ulCommandPayloadLength > azureiotconfigSEND_QUEUE_PAYLOAD_MAX ) )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_EnqueueCommandResponse failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    return prvEnqueue( pxSendQueue, ulProducerID, azureiotsendqueueTYPE_COMMAND_RESPONSE, eAzureIoTHubMessageQoS0, ulStatus,
+                       pxMessage->pucRequestID, pxMessage->usRequestIDLength, pucCommandPayload, ulCommandPayloadLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueuePropertiesReported( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                       uint32_t ulProducerID,
+                                                                       const uint8_t * pucReportedPayload,
+                                                                       uint32_t ulReportedPayloadLength )
+{
+    if( ( pxSendQueue == NULL ) || ( ulProducerID >= azureiotconfigSEND_QUEUE_PRODUCER_MAX ) ||
+        ( pucReportedPayload == NULL ) || ( ulReportedPayloadLength == 0 ) ||
+        ( ulReportedPayloadLength > azureiotconfigSEND_QUEUE_PAYLOAD_MAX ) )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_EnqueuePropertiesReported failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    return prvEnqueue( pxSendQueue, ulProducerID, azureiotsendqueueTYPE_PROPERTIES_REPORTED, eAzureIoTHubMessageQoS0, 0,
+                       NULL, 0, pucReportedPayload, ulReportedPayloadLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_Drain( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                   uint32_t ulMaxItems )
+{
+    AzureIoTHubClientSendQueueItem_t * pxItem;
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+    AzureIoTResult_t xSendResult;
+    uint32_t ulPosition;
+    uint32_t ulSent = 0;
+
+    if( pxSendQueue == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_Drain failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    while( ( ulMaxItems == 0 ) || ( ulSent < ulMaxItems ) )
+    {
+        ulPosition = pxSendQueue->_internal.ulDequeuePosition;
+        pxItem = &pxSendQueue->_internal.pxItems[ ulPosition & pxSendQueue->_internal.ulMask ];
+
+        /* Not published yet by its producer, or the queue is empty. */
+        if( ( int32_t ) ( prvAtomicLoad( &pxItem->_internal.ulSequence ) - ( ulPosition + 1 ) ) < 0 )
+        {
+            break;
+        }
+
+        if( ( xSendResult = prvSend( pxSendQueue, pxItem ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "AzureIoTHubClientSendQueue failed to send: error=0x%08x", ( uint16_t ) xSendResult ) );
+
+            /* Only a failed publish can succeed on the next drain. Any other error, such as a topic not fitting
+             * the working buffer of the hub client, would fail again forever and block the queue. */
+            if( xSendResult == eAzureIoTErrorPublishFailed )
+            {
+                return xSendResult;
+            }
+
+            xResult = xSendResult;
+        }
+
+        /* Free the slot for the producers of the next lap. */
+        ( void ) Atomic_Add_u32( &pxItem->_internal.ulSequence, pxSendQueue->_internal.ulMask );
+        pxSendQueue->_internal.ulDequeuePosition = ulPosition + 1;
+        ulSent++;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientSendQueue_GetProducerCounters( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                 uint32_t ulProducerID,
+                                                                 uint32_t * pulAccepted,
+                                                                 uint32_t * pulRejected )
+{
+    if( ( pxSendQueue == NULL ) || ( ulProducerID >= azureiotconfigSEND_QUEUE_PRODUCER_MAX ) )
+    {
+        AZLogError( ( "AzureIoTHubClientSendQueue_GetProducerCounters failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pulAccepted != NULL )
+    {
+        *pulAccepted = prvAtomicLoad( &pxSendQueue->_internal.ulAccepted[ ulProducerID ] );
+    }
+
+    if( pulRejected != NULL )
+    {
+        *pulRejected = prvAtomicLoad( &pxSendQueue->_internal.ulRejected[ ulProducerID ] );
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
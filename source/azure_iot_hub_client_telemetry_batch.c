@@ -0,0 +1,305 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_telemetry_batch.c
+ * @brief Implementation of the Azure IoT Hub Client telemetry batcher.
+ */
+
+#include "azure_iot_hub_client_telemetry_batch.h"
+
+#include <string.h>
+
+#include "azure_iot_private.h"
+
+/* One byte of the arena is kept for the closing bracket of the array. */
+#define azureiothubtelemetrybatchARRAY_END_SIZE    ( 1U )
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvBatchReset( AzureIoTHubClientTelemetryBatch_t * pxBatch )
+{
+    AzureIoTResult_t xResult;
+
+    pxBatch->_internal.ulRecordCount = 0;
+    pxBatch->_internal.ulRecordBytes = 0;
+
+    if( ( xResult = AzureIoTJSONWriter_Init( &pxBatch->_internal.xJSONWriter,
+                                             pxBatch->_internal.pucArena,
+                                             pxBatch->_internal.ulArenaLength - azureiothubtelemetrybatchARRAY_END_SIZE ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to initialize batch writer: error=0x%08x", xResult ) );
+    }
+    else if( ( xResult = AzureIoTJSONWriter_AppendBeginArray( &pxBatch->_internal.xJSONWriter ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "Failed to begin batch array: error=0x%08x", xResult ) );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+static bool prvBatchThresholdReached( AzureIoTHubClientTelemetryBatch_t * pxBatch )
+{
+    AzureIoTHubClientTelemetryBatchOptions_t * pxOptions = &pxBatch->_internal.xOptions;
+    uint32_t ulBytesUsed;
+
+    if( pxBatch->_internal.ulRecordCount == 0 )
+    {
+        return false;
+    }
+
+    ulBytesUsed = ( uint32_t ) AzureIoTJSONWriter_GetBytesUsed( &pxBatch->_internal.xJSONWriter ) +
+                  azureiothubtelemetrybatchARRAY_END_SIZE;
+
+    return ( ( pxOptions->ulMaxBytes != 0 ) && ( ulBytesUsed >= pxOptions->ulMaxBytes ) ) ||
+           ( ( pxOptions->ulMaxRecords != 0 ) && ( pxBatch->_internal.ulRecordCount >= pxOptions->ulMaxRecords ) ) ||
+           ( ( pxOptions->ulMaxAgeMilliseconds != 0 ) &&
+             ( ( AzureIoT_GetTimeMs() - pxBatch->_internal.ulFirstRecordTimeMs ) >= pxOptions->ulMaxAgeMilliseconds ) );
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvBatchAppend( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                        const uint8_t * pucRecord,
+                                        uint32_t ulRecordLength )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTJSONWriter_t xSavedWriter = pxBatch->_internal.xJSONWriter;
+
+    if( ( xResult = AzureIoTJSONWriter_AppendJSONText( &pxBatch->_internal.xJSONWriter,
+                                                       pucRecord, ulRecordLength ) ) != eAzureIoTSuccess )
+    {
+        /* The writer may have been left mid-record, roll it back to the last complete record. */
+        pxBatch->_internal.xJSONWriter = xSavedWriter;
+    }
+    else
+    {
+        if( pxBatch->_internal.ulRecordCount == 0 )
+        {
+            pxBatch->_internal.ulFirstRecordTimeMs = AzureIoT_GetTimeMs();
+        }
+
+        pxBatch->_internal.ulRecordCount++;
+        pxBatch->_internal.ulRecordBytes += ulRecordLength;
+        pxBatch->_internal.xMetrics.ulRecordsAppended++;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+/* Called once the record is in the batch: a failed send must not make the caller append it again. */
+static AzureIoTResult_t prvBatchFlushOnThreshold( AzureIoTHubClientTelemetryBatch_t * pxBatch )
+{
+    AzureIoTResult_t xResult = eAzureIoTSuccess;
+
+    if( prvBatchThresholdReached( pxBatch ) &&
+        ( ( xResult = AzureIoTHubClientTelemetryBatch_Flush( pxBatch ) ) != eAzureIoTSuccess ) )
+    {
+        AZLogWarn( ( "Record batched but sending the batch failed: error=0x%08x", xResult ) );
+        xResult = eAzureIoTErrorPending;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_OptionsInit( AzureIoTHubClientTelemetryBatchOptions_t * pxOptions )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxOptions == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_OptionsInit failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        memset( pxOptions, 0, sizeof( AzureIoTHubClientTelemetryBatchOptions_t ) );
+        pxOptions->xQOS = eAzureIoTHubMessageQoS0;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Init( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                       AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                       AzureIoTHubClientTelemetryBatchOptions_t * pxOptions,
+                                                       uint8_t * pucArena,
+                                                       uint32_t ulArenaLength )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxBatch == NULL ) || ( pxAzureIoTHubClient == NULL ) ||
+        ( pucArena == NULL ) || ( ulArenaLength <= azureiothubtelemetrybatchARRAY_END_SIZE ) )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_Init failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        memset( pxBatch, 0, sizeof( AzureIoTHubClientTelemetryBatch_t ) );
+
+        if( pxOptions == NULL )
+        {
+            ( void ) AzureIoTHubClientTelemetryBatch_OptionsInit( &pxBatch->_internal.xOptions );
+        }
+        else
+        {
+            pxBatch->_internal.xOptions = *pxOptions;
+        }
+
+        pxBatch->_internal.pxAzureIoTHubClient = pxAzureIoTHubClient;
+        pxBatch->_internal.pucArena = pucArena;
+        pxBatch->_internal.ulArenaLength = ulArenaLength;
+
+        xResult = prvBatchReset( pxBatch );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_AppendRecord( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                               const uint8_t * pucRecord,
+                                                               uint32_t ulRecordLength )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxBatch == NULL ) || ( pucRecord == NULL ) || ( ulRecordLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_AppendRecord failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( ( xResult = prvBatchAppend( pxBatch, pucRecord, ulRecordLength ) ) == eAzureIoTSuccess )
+    {
+        xResult = prvBatchFlushOnThreshold( pxBatch );
+    }
+    else if( ( xResult == eAzureIoTErrorOutOfMemory ) && ( pxBatch->_internal.ulRecordCount > 0 ) )
+    {
+        /* Arena is full, send what is batched and retry in the empty arena */
+        if( ( xResult = AzureIoTHubClientTelemetryBatch_Flush( pxBatch ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to flush full batch: error=0x%08x", xResult ) );
+        }
+        else if( ( xResult = prvBatchAppend( pxBatch, pucRecord, ulRecordLength ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Record does not fit in the batch arena: error=0x%08x", xResult ) );
+        }
+        else
+        {
+            xResult = prvBatchFlushOnThreshold( pxBatch );
+        }
+    }
+    else
+    {
+        AZLogError( ( "Failed to append record to batch: error=0x%08x", xResult ) );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Process( AzureIoTHubClientTelemetryBatch_t * pxBatch )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxBatch == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_Process failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( ( pxBatch->_internal.xOptions.ulMaxAgeMilliseconds != 0 ) &&
+             prvBatchThresholdReached( pxBatch ) )
+    {
+        xResult = AzureIoTHubClientTelemetryBatch_Flush( pxBatch );
+    }
+    else
+    {
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Flush( AzureIoTHubClientTelemetryBatch_t * pxBatch )
+{
+    AzureIoTResult_t xResult;
+    AzureIoTHubClientTelemetryBatchMetrics_t * pxMetrics;
+    uint32_t ulPayloadLength;
+    uint32_t ulLatencyMs;
+
+    if( pxBatch == NULL )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_Flush failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( pxBatch->_internal.ulRecordCount == 0 )
+    {
+        xResult = eAzureIoTSuccess;
+    }
+    else
+    {
+        /* Close the array past the writer's view so a failed publish leaves the writer appendable */
+        ulPayloadLength = ( uint32_t ) AzureIoTJSONWriter_GetBytesUsed( &pxBatch->_internal.xJSONWriter );
+        pxBatch->_internal.pucArena[ ulPayloadLength ] = ']';
+        ulPayloadLength += azureiothubtelemetrybatchARRAY_END_SIZE;
+
+        if( ( xResult = AzureIoTHubClient_SendTelemetry( pxBatch->_internal.pxAzureIoTHubClient,
+                                                         pxBatch->_internal.pucArena, ulPayloadLength,
+                                                         pxBatch->_internal.xOptions.pxProperties,
+                                                         pxBatch->_internal.xOptions.xQOS, NULL ) ) != eAzureIoTSuccess )
+        {
+            AZLogError( ( "Failed to send telemetry batch: error=0x%08x", xResult ) );
+        }
+        else
+        {
+            ulLatencyMs = AzureIoT_GetTimeMs() - pxBatch->_internal.ulFirstRecordTimeMs;
+
+            pxMetrics = &pxBatch->_internal.xMetrics;
+            pxMetrics->ulPublishCount++;
+            pxMetrics->ulRecordsPublished += pxBatch->_internal.ulRecordCount;
+            pxMetrics->ullRecordBytes += pxBatch->_internal.ulRecordBytes;
+            pxMetrics->ullPublishedBytes += ulPayloadLength;
+            pxMetrics->ulLastFlushLatencyMs = ulLatencyMs;
+
+            if( ulLatencyMs > pxMetrics->ulMaxFlushLatencyMs )
+            {
+                pxMetrics->ulMaxFlushLatencyMs = ulLatencyMs;
+            }
+
+            AZLogDebug( ( "Sent telemetry batch: records=%u, bytes=%u",
+                          ( uint16_t ) pxBatch->_internal.ulRecordCount, ( uint16_t ) ulPayloadLength ) );
+
+            xResult = prvBatchReset( pxBatch );
+        }
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_GetMetrics( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                             AzureIoTHubClientTelemetryBatchMetrics_t * pxMetrics )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxBatch == NULL ) || ( pxMetrics == NULL ) )
+    {
+        AZLogError( ( "AzureIoTHubClientTelemetryBatch_GetMetrics failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        *pxMetrics = pxBatch->_internal.xMetrics;
+        pxMetrics->ulCompressionRatioX100 = ( pxMetrics->ulPublishCount == 0 ) ? 0 :
+                                            ( uint32_t ) ( ( ( uint64_t ) pxMetrics->ulRecordsPublished * 100U ) /
+                                                           pxMetrics->ulPublishCount );
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,423 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_log.c
+ *
+ * @brief Deferred logging backend writing binary records to a ring buffer.
+ *
+ */
+
+#include "azure_iot_log.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "task.h"
+
+#if ( azureiotconfigUSE_DEFERRED_LOGGING == 1 )
+
+/* Length, level, flags and tick count */
+    #define azureiotlogHEADER_SIZE        ( sizeof( uint16_t ) + 2 * sizeof( uint8_t ) + sizeof( uint32_t ) )
+
+/* Argument types, by length modifier */
+    #define azureiotlogARG_INT            ( 0 )
+    #define azureiotlogARG_LONG           ( 1 )
+    #define azureiotlogARG_LONG_LONG      ( 2 )
+    #define azureiotlogARG_SIZE           ( 3 )
+/*-----------------------------------------------------------*/
+
+    static uint8_t ucRing[ azureiotconfigDEFERRED_LOG_BUFFER_SIZE ];
+    static uint32_t ulReadPosition;
+    static uint32_t ulUsed;
+    static uint32_t ulDropped;
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Append bytes to the record, flagging it as truncated once full.
+ *
+ * */
+    static bool prvRecordAppend( uint8_t * pucRecord,
+                                 uint32_t * pulLength,
+                                 const void * pvData,
+                                 uint32_t ulDataLength )
+    {
+        if( ( *pulLength + ulDataLength ) > azureiotconfigDEFERRED_LOG_RECORD_MAX )
+        {
+            pucRecord[ sizeof( uint16_t ) + 1 ] |= azureiotlogFLAG_TRUNCATED;
+            return false;
+        }
+
+        memcpy( &pucRecord[ *pulLength ], pvData, ulDataLength );
+        *pulLength += ulDataLength;
+
+        return true;
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Append a string as its length followed by its bytes, capped to azureiotconfigDEFERRED_LOG_STRING_MAX.
+ *
+ * */
+    static bool prvRecordAppendString( uint8_t * pucRecord,
+                                       uint32_t * pulLength,
+                                       const char * pcString,
+                                       int32_t lLength )
+    {
+        uint16_t usLength;
+
+        if( pcString == NULL )
+        {
+            lLength = 0;
+        }
+        else if( lLength < 0 )
+        {
+            /* Stop at the cap, the string may be much longer */
+            for( lLength = 0; ( lLength < ( int32_t ) azureiotconfigDEFERRED_LOG_STRING_MAX ) &&
+                 ( pcString[ lLength ] != '\0' ); lLength++ )
+            {
+            }
+        }
+
+        if( lLength > ( int32_t ) azureiotconfigDEFERRED_LOG_STRING_MAX )
+        {
+            lLength = ( int32_t ) azureiotconfigDEFERRED_LOG_STRING_MAX;
+        }
+
+        usLength = ( uint16_t ) lLength;
+
+        return prvRecordAppend( pucRecord, pulLength, &usLength, sizeof( usLength ) ) &&
+               prvRecordAppend( pucRecord, pulLength, pcString, usLength );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Walk the conversions of the format string and copy each argument raw, with the size
+ * of its promoted type, so the host can format the message later.
+ *
+ * */
+    static void prvRecordAppendArguments( uint8_t * pucRecord,
+                                          uint32_t * pulLength,
+                                          const char * pcFormat,
+                                          va_list xArgs )
+    {
+        int32_t lPrecision;
+        uint32_t ulType;
+        bool xContinue = true;
+        int lValue;
+        long lLongValue;
+        long long llLongLongValue;
+        size_t xSizeValue;
+        double xDoubleValue;
+        void * pvValue;
+
+        while( xContinue && ( *pcFormat != '\0' ) )
+        {
+            if( *pcFormat++ != '%' )
+            {
+                continue;
+            }
+
+            if( *pcFormat == '%' )
+            {
+                pcFormat++;
+                continue;
+            }
+
+            lPrecision = -1;
+            ulType = azureiotlogARG_INT;
+
+            /* Flags and width */
+            while( ( *pcFormat != '\0' ) && ( strchr( "-+ #0123456789", *pcFormat ) != NULL ) )
+            {
+                pcFormat++;
+            }
+
+            if( *pcFormat == '*' )
+            {
+                lValue = va_arg( xArgs, int );
+                xContinue = prvRecordAppend( pucRecord, pulLength, &lValue, sizeof( lValue ) );
+                pcFormat++;
+            }
+
+            /* Precision, which for strings bounds the bytes read */
+            if( *pcFormat == '.' )
+            {
+                pcFormat++;
+
+                if( *pcFormat == '*' )
+                {
+                    /* Kept like any other argument, so the host reads one int per '*' */
+                    lValue = va_arg( xArgs, int );
+                    xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &lValue, sizeof( lValue ) );
+                    lPrecision = ( int32_t ) lValue;
+                    pcFormat++;
+                }
+                else
+                {
+                    lPrecision = 0;
+
+                    while( ( *pcFormat >= '0' ) && ( *pcFormat <= '9' ) )
+                    {
+                        lPrecision = lPrecision * 10 + ( *pcFormat++ - '0' );
+                    }
+                }
+            }
+
+            /* Length modifiers, 'h' arguments are promoted to int */
+            while( ( *pcFormat != '\0' ) && ( strchr( "hlzjt", *pcFormat ) != NULL ) )
+            {
+                if( *pcFormat == 'l' )
+                {
+                    ulType = ( ulType == azureiotlogARG_LONG ) ? azureiotlogARG_LONG_LONG : azureiotlogARG_LONG;
+                }
+                else if( *pcFormat != 'h' )
+                {
+                    /* 'j' and 't' are read as size_t, which has their size on the supported targets */
+                    ulType = azureiotlogARG_SIZE;
+                }
+
+                pcFormat++;
+            }
+
+            switch( *pcFormat )
+            {
+                case 's':
+                    xContinue = xContinue &&
+                                prvRecordAppendString( pucRecord, pulLength, va_arg( xArgs, const char * ), lPrecision );
+                    break;
+
+                case 'p':
+                    pvValue = va_arg( xArgs, void * );
+                    xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &pvValue, sizeof( pvValue ) );
+                    break;
+
+                case 'f':
+                case 'e':
+                case 'g':
+                    xDoubleValue = va_arg( xArgs, double );
+                    xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &xDoubleValue, sizeof( xDoubleValue ) );
+                    break;
+
+                case '\0':
+                    xContinue = false;
+                    break;
+
+                default:
+
+                    if( ulType == azureiotlogARG_INT )
+                    {
+                        lValue = va_arg( xArgs, int );
+                        xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &lValue, sizeof( lValue ) );
+                    }
+                    else if( ulType == azureiotlogARG_LONG )
+                    {
+                        lLongValue = va_arg( xArgs, long );
+                        xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &lLongValue, sizeof( lLongValue ) );
+                    }
+                    else if( ulType == azureiotlogARG_SIZE )
+                    {
+                        xSizeValue = va_arg( xArgs, size_t );
+                        xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &xSizeValue, sizeof( xSizeValue ) );
+                    }
+                    else
+                    {
+                        llLongLongValue = va_arg( xArgs, long long );
+                        xContinue = xContinue && prvRecordAppend( pucRecord, pulLength, &llLongLongValue, sizeof( llLongLongValue ) );
+                    }
+
+                    break;
+            }
+
+            if( *pcFormat != '\0' )
+            {
+                pcFormat++;
+            }
+        }
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Copy bytes into the ring, wrapping around its end.
+ *
+ * */
+    static void prvRingWrite( uint32_t ulPosition,
+                              const uint8_t * pucData,
+                              uint32_t ulDataLength )
+    {
+        uint32_t ulFirst = azureiotconfigDEFERRED_LOG_BUFFER_SIZE - ulPosition;
+
+        if( ulFirst > ulDataLength )
+        {
+            ulFirst = ulDataLength;
+        }
+
+        memcpy( &ucRing[ ulPosition ], pucData, ulFirst );
+        memcpy( ucRing, pucData + ulFirst, ulDataLength - ulFirst );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Copy bytes out of the ring, wrapping around its end.
+ *
+ * */
+    static void prvRingRead( uint32_t ulPosition,
+                             uint8_t * pucData,
+                             uint32_t ulDataLength )
+    {
+        uint32_t ulFirst = azureiotconfigDEFERRED_LOG_BUFFER_SIZE - ulPosition;
+
+        if( ulFirst > ulDataLength )
+        {
+            ulFirst = ulDataLength;
+        }
+
+        memcpy( pucData, &ucRing[ ulPosition ], ulFirst );
+        memcpy( pucData + ulFirst, ucRing, ulDataLength - ulFirst );
+    }
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Encode the record on the stack, then copy it into the ring inside a short critical section.
+ *
+ * */
+    static void prvLogDeferred( uint8_t ucLevel,
+                                const char * pcFormat,
+                                va_list xArgs )
+    {
+        uint8_t ucRecord[ azureiotconfigDEFERRED_LOG_RECORD_MAX ];
+        uint32_t ulLength = azureiotlogHEADER_SIZE;
+        uint32_t ulTickCount = ( uint32_t ) xTaskGetTickCount();
+        uint16_t usLength;
+
+        ucRecord[ sizeof( uint16_t ) ] = ucLevel;
+        ucRecord[ sizeof( uint16_t ) + 1 ] = 0;
+        memcpy( &ucRecord[ sizeof( uint16_t ) + 2 ], &ulTickCount, sizeof( ulTickCount ) );
+
+        if( prvRecordAppend( ucRecord, &ulLength, &pcFormat, sizeof( pcFormat ) ) )
+        {
+            prvRecordAppendArguments( ucRecord, &ulLength, pcFormat, xArgs );
+        }
+
+        usLength = ( uint16_t ) ulLength;
+        memcpy( ucRecord, &usLength, sizeof( usLength ) );
+
+        taskENTER_CRITICAL();
+        {
+            if( ( azureiotconfigDEFERRED_LOG_BUFFER_SIZE - ulUsed ) < ulLength )
+            {
+                ulDropped++;
+            }
+            else
+            {
+                prvRingWrite( ( ulReadPosition + ulUsed ) % azureiotconfigDEFERRED_LOG_BUFFER_SIZE, ucRecord, ulLength );
+                ulUsed += ulLength;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+/*-----------------------------------------------------------*/
+
+    void AzureIoTLog_DeferredError( const char * pcFormat,
+                                    ... )
+    {
+        va_list xArgs;
+
+        va_start( xArgs, pcFormat );
+        prvLogDeferred( azureiotlogLEVEL_ERROR, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+/*-----------------------------------------------------------*/
+
+    void AzureIoTLog_DeferredWarn( const char * pcFormat,
+                                   ... )
+    {
+        va_list xArgs;
+
+        va_start( xArgs, pcFormat );
+        prvLogDeferred( azureiotlogLEVEL_WARN, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+/*-----------------------------------------------------------*/
+
+    void AzureIoTLog_DeferredInfo( const char * pcFormat,
+                                   ... )
+    {
+        va_list xArgs;
+
+        va_start( xArgs, pcFormat );
+        prvLogDeferred( azureiotlogLEVEL_INFO, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+/*-----------------------------------------------------------*/
+
+    void AzureIoTLog_DeferredDebug( const char * pcFormat,
+                                    ... )
+    {
+        va_list xArgs;
+
+        va_start( xArgs, pcFormat );
+        prvLogDeferred( azureiotlogLEVEL_DEBUG, pcFormat, xArgs );
+        va_end( xArgs );
+    }
+/*-----------------------------------------------------------*/
+
+    uint32_t AzureIoTLog_DeferredRead( uint8_t * pucBuffer,
+                                       uint32_t ulBufferLength )
+    {
+        uint32_t ulCopied = 0;
+        uint16_t usLength = 0;
+        bool xRecordCopied = true;
+
+        if( pucBuffer == NULL )
+        {
+            return 0;
+        }
+
+        /* One record per critical section, so producers are not held up by a long read */
+        while( xRecordCopied )
+        {
+            xRecordCopied = false;
+
+            taskENTER_CRITICAL();
+            {
+                if( ulUsed != 0 )
+                {
+                    prvRingRead( ulReadPosition, ( uint8_t * ) &usLength, sizeof( usLength ) );
+
+                    if( ( ulBufferLength - ulCopied ) >= usLength )
+                    {
+                        prvRingRead( ulReadPosition, pucBuffer + ulCopied, usLength );
+                        ulReadPosition = ( ulReadPosition + usLength ) % azureiotconfigDEFERRED_LOG_BUFFER_SIZE;
+                        ulUsed -= usLength;
+                        xRecordCopied = true;
+                    }
+                }
+            }
+            taskEXIT_CRITICAL();
+
+            if( xRecordCopied )
+            {
+                ulCopied += usLength;
+            }
+        }
+
+        return ulCopied;
+    }
+/*-----------------------------------------------------------*/
+
+    uint32_t AzureIoTLog_DeferredGetDropped( void )
+    {
+        return ulDropped;
+    }
+/*-----------------------------------------------------------*/
+
+#endif /* azureiotconfigUSE_DEFERRED_LOGGING */
@@ -10,6 +10,19 @@
 #include "azure/az_core.h"
 #include "azure/core/_az_cfg_prefix.h"
 
+/*
+ * Starting values of the FNV-1a hashes, to pass as the hash of the first call
+ */
+#define azureiotFNV1A_32_OFFSET_BASIS    ( 0x811C9DC5U )
+#define azureiotFNV1A_64_OFFSET_BASIS    ( 0xCBF29CE484222325ULL )
+
+/*
+ * Indexes of the receive context buffer of the hub client for each feature
+ */
+#define azureiothubRECEIVE_CONTEXT_INDEX_C2D           ( 0 )
+#define azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS      ( 1 )
+#define azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES    ( 2 )
+
 /**
  * @brief Translate embedded errors to middleware errors
  *
@@ -19,6 +32,15 @@
  */
 AzureIoTResult_t AzureIoT_TranslateCoreError( az_result xCoreError );
 
+/**
+ * @brief Get the milliseconds elapsed since the scheduler started, from the FreeRTOS tick count.
+ *
+ * @note Wraps around with the tick count, so compare times by subtraction.
+ *
+ * @return The current time in milliseconds.
+ */
+uint32_t AzureIoT_GetTimeMs( void );
+
 /**
  * @brief As part of symmetric key authentication, HMAC256 a buffer of bytes and base64 encode the result.
  *
@@ -48,6 +70,104 @@ AzureIoTResult_t AzureIoT_Base64HMACCalculate( AzureIoTGetHMACFunc_t xAzureIoTHM
                                                uint32_t ulOutputSize,
                                                uint32_t * pulOutputLength );
 
+/**
+ * @brief HMAC256 a buffer of bytes with an already decoded key and base64 encode the result.
+ *
+ * @note Lets callers decode the symmetric key once and reuse it for every token.
+ *
+ * @param[in] xAzureIoTHMACFunction The #AzureIoTGetHMACFunc_t function to use for HMAC256 hashing.
+ * @param[in] pucDecodedKey A pointer to the base64 decoded key.
+ * @param[in] ulDecodedKeySize The length of the \p pucDecodedKey.
+ * @param[in] pucMessage A pointer to the blob to be hashed.
+ * @param[in] ulMessageSize The length of \p pucMessage.
+ * @param[in] pucBuffer An intermediary buffer to put the hash.
+ * @param[in] ulBufferLength The length of \p pucBuffer.
+ * @param[out] pucOutput The buffer into which the resulting HMAC256 hashed, base64 encoded message will
+ * be placed.
+ * @param[in] ulOutputSize Size of \p pucOutput.
+ * @param[out] pulOutputLength The output length of \p pucOutput.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoT_HMACBase64Encode( AzureIoTGetHMACFunc_t xAzureIoTHMACFunction,
+                                            const uint8_t * pucDecodedKey,
+                                            uint32_t ulDecodedKeySize,
+                                            const uint8_t * pucMessage,
+                                            uint32_t ulMessageSize,
+                                            uint8_t * pucBuffer,
+                                            uint32_t ulBufferLength,
+                                            uint8_t * pucOutput,
+                                            uint32_t ulOutputSize,
+                                            uint32_t * pulOutputLength );
+
+/**
+ * @brief HMAC256 a buffer of bytes with a key held by an HMAC context and base64 encode the result.
+ *
+ * @note Lets callers prepare the key once, for example as the inner and outer SHA256 states of the HMAC.
+ *
+ * @param[in] xAzureIoTHMACContextFunction The #AzureIoTGetHMACContextFunc_t function to use for HMAC256 hashing.
+ * @param[in] pvHMACContext The context holding the key, passed to \p xAzureIoTHMACContextFunction.
+ * @param[in] pucMessage A pointer to the blob to be hashed.
+ * @param[in] ulMessageSize The length of \p pucMessage.
+ * @param[in] pucBuffer An intermediary buffer to put the hash.
+ * @param[in] ulBufferLength The length of \p pucBuffer.
+ * @param[out] pucOutput The buffer into which the resulting HMAC256 hashed, base64 encoded message will
+ * be placed.
+ * @param[in] ulOutputSize Size of \p pucOutput.
+ * @param[out] pulOutputLength The output length of \p pucOutput.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoT_HMACContextBase64Encode( AzureIoTGetHMACContextFunc_t xAzureIoTHMACContextFunction,
+                                                   void * pvHMACContext,
+                                                   const uint8_t * pucMessage,
+                                                   uint32_t ulMessageSize,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint8_t * pucOutput,
+                                                   uint32_t ulOutputSize,
+                                                   uint32_t * pulOutputLength );
+
+/**
+ * @brief Continue a 32-bit FNV-1a hash over a buffer of bytes.
+ *
+ * @note Meant to spread or tell apart values, not to resist tampering.
+ *
+ * @param[in] ulHash The hash so far, or #azureiotFNV1A_32_OFFSET_BASIS to start a new one.
+ * @param[in] pucData A pointer to the bytes to hash.
+ * @param[in] ulDataLength The length of \p pucData.
+ * @return The hash of the bytes so far.
+ */
+uint32_t AzureIoT_FNV1a32( uint32_t ulHash,
+                           const uint8_t * pucData,
+                           uint32_t ulDataLength );
+
+/**
+ * @brief Continue a 64-bit FNV-1a hash over a buffer of bytes.
+ *
+ * @note Meant to spread or tell apart values, not to resist tampering.
+ *
+ * @param[in] ullHash The hash so far, or #azureiotFNV1A_64_OFFSET_BASIS to start a new one.
+ * @param[in] pucData A pointer to the bytes to hash.
+ * @param[in] ulDataLength The length of \p pucData.
+ * @return The hash of the bytes so far.
+ */
+uint64_t AzureIoT_FNV1a64( uint64_t ullHash,
+                           const uint8_t * pucData,
+                           uint32_t ulDataLength );
+
+/**
+ * @brief Route an incoming hub topic to the receive context which owns it.
+ *
+ * @note Only the topic prefix is looked at, so the full topic parse is left to the
+ * single process function which can actually handle it.
+ *
+ * @param[in] pucTopic A pointer to the topic of the incoming publish.
+ * @param[in] usTopicLength The length of \p pucTopic.
+ * @return One of the azureiothubRECEIVE_CONTEXT_INDEX_* values, or
+ * #azureiothubSUBSCRIBE_FEATURE_COUNT if no receive context owns \p pucTopic.
+ */
+uint32_t AzureIoTHubClient_GetReceiveContextIndex( const uint8_t * pucTopic,
+                                                  uint16_t usTopicLength );
+
 #include "azure/core/_az_cfg_suffix.h"
 
 #endif /* AZURE_IOT_PRIVATE_H */
@@ -0,0 +1,288 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_cache.c
+ * @brief Implementation of the persistent cache of the Device Provisioning Service assignment.
+ */
+
+#include "azure_iot_provisioning_cache.h"
+
+#include <string.h>
+
+#include "azure_iot_private.h"
+
+#define azureiotprovisioningcacheRECORD_VERSION        ( 0x02 )
+#define azureiotprovisioningcacheLENGTH_SIZE           ( 2U )
+#define azureiotprovisioningcacheHASH_SIZE             ( 8U )
+#define azureiotprovisioningcacheHOSTNAME_OFFSET       ( 1U + azureiotprovisioningcacheHASH_SIZE + azureiotprovisioningcacheLENGTH_SIZE )
+/*-----------------------------------------------------------*/
+
+static uint64_t prvHashAppend( uint64_t ullHash,
+                               const uint8_t * pucData,
+                               uint32_t ulDataLength )
+{
+    uint8_t ucLength[ 4 ];
+
+    /* The length goes first, so moving bytes from one field to the next changes the hash */
+    ucLength[ 0 ] = ( uint8_t ) ( ulDataLength >> 24 );
+    ucLength[ 1 ] = ( uint8_t ) ( ulDataLength >> 16 );
+    ucLength[ 2 ] = ( uint8_t ) ( ulDataLength >> 8 );
+    ucLength[ 3 ] = ( uint8_t ) ulDataLength;
+
+    ullHash = AzureIoT_FNV1a64( ullHash, ucLength, sizeof( ucLength ) );
+
+    return AzureIoT_FNV1a64( ullHash, pucData, ulDataLength );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteHash( uint8_t * pucBuffer,
+                          uint64_t ullHash )
+{
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < azureiotprovisioningcacheHASH_SIZE; ulIndex++ )
+    {
+        pucBuffer[ ulIndex ] = ( uint8_t ) ( ullHash >> ( 56 - ( ulIndex * 8 ) ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvReadHash( const uint8_t * pucBuffer )
+{
+    uint64_t ullHash = 0;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < azureiotprovisioningcacheHASH_SIZE; ulIndex++ )
+    {
+        ullHash = ( ullHash << 8 ) | pucBuffer[ ulIndex ];
+    }
+
+    return ullHash;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLength( uint8_t * pucBuffer,
+                            uint32_t ulLength )
+{
+    pucBuffer[ 0 ] = ( uint8_t ) ( ulLength >> 8 );
+    pucBuffer[ 1 ] = ( uint8_t ) ulLength;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLength( const uint8_t * pucBuffer )
+{
+    return ( ( uint32_t ) pucBuffer[ 0 ] << 8 ) | pucBuffer[ 1 ];
+}
+/*-----------------------------------------------------------*/
+
+static uint8_t * prvGetDeviceID( AzureIoTProvisioningCache_t * pxCache )
+{
+    return pxCache->_internal.ucRecord + azureiotprovisioningcacheHOSTNAME_OFFSET +
+           pxCache->_internal.ulHostnameLength + azureiotprovisioningcacheLENGTH_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Validate the record in ucRecord and extract the lengths of its fields.
+ *
+ * */
+static bool prvParseRecord( AzureIoTProvisioningCache_t * pxCache,
+                            uint32_t ulRecordLength )
+{
+    const uint8_t * pucRecord = pxCache->_internal.ucRecord;
+    uint32_t ulHostnameLength;
+    uint32_t ulDeviceIDLength;
+
+    if( ( ulRecordLength < ( azureiotprovisioningcacheHOSTNAME_OFFSET + azureiotprovisioningcacheLENGTH_SIZE ) ) ||
+        ( pucRecord[ 0 ] != azureiotprovisioningcacheRECORD_VERSION ) )
+    {
+        return false;
+    }
+
+    ulHostnameLength = prvReadLength( pucRecord + 1 + azureiotprovisioningcacheHASH_SIZE );
+
+    if( ( ulHostnameLength == 0 ) || ( ulHostnameLength > azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX ) ||
+        ( ulRecordLength < ( azureiotprovisioningcacheHOSTNAME_OFFSET + ulHostnameLength + azureiotprovisioningcacheLENGTH_SIZE ) ) )
+    {
+        return false;
+    }
+
+    ulDeviceIDLength = prvReadLength( pucRecord + azureiotprovisioningcacheHOSTNAME_OFFSET + ulHostnameLength );
+
+    if( ( ulDeviceIDLength == 0 ) || ( ulDeviceIDLength > azureiotconfigPROVISIONING_CACHE_DEVICE_ID_MAX ) ||
+        ( ulRecordLength != ( azureiotprovisioningcacheHOSTNAME_OFFSET + ulHostnameLength +
+                              azureiotprovisioningcacheLENGTH_SIZE + ulDeviceIDLength ) ) )
+    {
+        return false;
+    }
+
+    pxCache->_internal.ulHostnameLength = ulHostnameLength;
+    pxCache->_internal.ulDeviceIDLength = ulDeviceIDLength;
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningCache_Init( AzureIoTProvisioningCache_t * pxCache,
+                                                 AzureIoTProvisioningStorage_t * pxStorage,
+                                                 const uint8_t * pucEndpoint,
+                                                 uint32_t ulEndpointLength,
+                                                 const uint8_t * pucIDScope,
+                                                 uint32_t ulIDScopeLength,
+                                                 const uint8_t * pucRegistrationID,
+                                                 uint32_t ulRegistrationIDLength )
+{
+    AzureIoTResult_t xResult;
+    uint32_t ulRecordLength;
+    uint64_t ullIdentityHash;
+
+    if( ( pxCache == NULL ) || ( pxStorage == NULL ) ||
+        ( pucEndpoint == NULL ) || ( ulEndpointLength == 0 ) ||
+        ( pucIDScope == NULL ) || ( ulIDScopeLength == 0 ) ||
+        ( pucRegistrationID == NULL ) || ( ulRegistrationIDLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ullIdentityHash = prvHashAppend( azureiotFNV1A_64_OFFSET_BASIS, pucEndpoint, ulEndpointLength );
+    ullIdentityHash = prvHashAppend( ullIdentityHash, pucIDScope, ulIDScopeLength );
+    ullIdentityHash = prvHashAppend( ullIdentityHash, pucRegistrationID, ulRegistrationIDLength );
+
+    memset( pxCache, 0, sizeof( AzureIoTProvisioningCache_t ) );
+    pxCache->_internal.pxStorage = pxStorage;
+    pxCache->_internal.ullIdentityHash = ullIdentityHash;
+
+    xResult = AzureIoTProvisioningStorage_Read( pxStorage, pxCache->_internal.ucRecord,
+                                                sizeof( pxCache->_internal.ucRecord ), &ulRecordLength );
+
+    if( xResult == eAzureIoTErrorItemNotFound )
+    {
+        AZLogInfo( ( "AzureIoTProvisioningCache no assignment cached" ) );
+        xResult = eAzureIoTSuccess;
+    }
+    else if( xResult != eAzureIoTSuccess )
+    {
+        /* The record may still be good, so leave it for the next attempt */
+        AZLogError( ( "AzureIoTProvisioningCache_Init failed to read storage: error=0x%08x", ( uint16_t ) xResult ) );
+    }
+    else if( !prvParseRecord( pxCache, ulRecordLength ) )
+    {
+        AZLogWarn( ( "AzureIoTProvisioningCache dropping corrupt record" ) );
+        ( void ) AzureIoTProvisioningStorage_Erase( pxStorage );
+    }
+    else if( prvReadHash( pxCache->_internal.ucRecord + 1 ) != ullIdentityHash )
+    {
+        /* Cached for another endpoint, ID scope or registration ID, so it does not apply to this device */
+        AZLogWarn( ( "AzureIoTProvisioningCache dropping assignment of another registration" ) );
+        ( void ) AzureIoTProvisioningStorage_Erase( pxStorage );
+    }
+    else
+    {
+        pxCache->_internal.xValid = true;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningCache_GetDeviceAndHub( AzureIoTProvisioningCache_t * pxCache,
+                                                            const uint8_t ** ppucHubHostname,
+                                                            uint32_t * pulHostnameLength,
+                                                            const uint8_t ** ppucDeviceID,
+                                                            uint32_t * pulDeviceIDLength )
+{
+    if( ( pxCache == NULL ) || ( ppucHubHostname == NULL ) || ( pulHostnameLength == NULL ) ||
+        ( ppucDeviceID == NULL ) || ( pulDeviceIDLength == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_GetDeviceAndHub failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( !pxCache->_internal.xValid )
+    {
+        return eAzureIoTErrorItemNotFound;
+    }
+
+    *ppucHubHostname = pxCache->_internal.ucRecord + azureiotprovisioningcacheHOSTNAME_OFFSET;
+    *pulHostnameLength = pxCache->_internal.ulHostnameLength;
+    *ppucDeviceID = prvGetDeviceID( pxCache );
+    *pulDeviceIDLength = pxCache->_internal.ulDeviceIDLength;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningCache_Store( AzureIoTProvisioningCache_t * pxCache,
+                                                  const uint8_t * pucHubHostname,
+                                                  uint32_t ulHostnameLength,
+                                                  const uint8_t * pucDeviceID,
+                                                  uint32_t ulDeviceIDLength )
+{
+    AzureIoTResult_t xResult;
+    uint8_t * pucRecord;
+    uint32_t ulRecordLength;
+
+    if( ( pxCache == NULL ) ||
+        ( pucHubHostname == NULL ) || ( ulHostnameLength == 0 ) ||
+        ( pucDeviceID == NULL ) || ( ulDeviceIDLength == 0 ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Store failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( ( ulHostnameLength > azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX ) ||
+        ( ulDeviceIDLength > azureiotconfigPROVISIONING_CACHE_DEVICE_ID_MAX ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Store failed: assignment does not fit" ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    pucRecord = pxCache->_internal.ucRecord;
+    pucRecord[ 0 ] = azureiotprovisioningcacheRECORD_VERSION;
+    prvWriteHash( pucRecord + 1, pxCache->_internal.ullIdentityHash );
+    prvWriteLength( pucRecord + 1 + azureiotprovisioningcacheHASH_SIZE, ulHostnameLength );
+    memcpy( pucRecord + azureiotprovisioningcacheHOSTNAME_OFFSET, pucHubHostname, ulHostnameLength );
+    pxCache->_internal.ulHostnameLength = ulHostnameLength;
+    prvWriteLength( prvGetDeviceID( pxCache ) - azureiotprovisioningcacheLENGTH_SIZE, ulDeviceIDLength );
+    memcpy( prvGetDeviceID( pxCache ), pucDeviceID, ulDeviceIDLength );
+    pxCache->_internal.ulDeviceIDLength = ulDeviceIDLength;
+    ulRecordLength = azureiotprovisioningcacheHOSTNAME_OFFSET + ulHostnameLength +
+                     azureiotprovisioningcacheLENGTH_SIZE + ulDeviceIDLength;
+
+    if( ( xResult = AzureIoTProvisioningStorage_Write( pxCache->_internal.pxStorage,
+                                                       pucRecord, ulRecordLength ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Store failed to write storage: error=0x%08x", ( uint16_t ) xResult ) );
+        pxCache->_internal.xValid = false;
+        return xResult;
+    }
+
+    pxCache->_internal.xValid = true;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningCache_Invalidate( AzureIoTProvisioningCache_t * pxCache )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxCache == NULL )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Invalidate failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    pxCache->_internal.xValid = false;
+
+    if( ( xResult = AzureIoTProvisioningStorage_Erase( pxCache->_internal.pxStorage ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTProvisioningCache_Invalidate failed to erase storage: error=0x%08x", ( uint16_t ) xResult ) );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
@@ -38,6 +38,10 @@
     #define azureiotprovisioningUSER_AGENT    ""
 #endif /* azureiotprovisioningUSER_AGENT */
 
+#ifndef azureiotprovisioningRESPONSE_TIMEOUT_MS
+    #define azureiotprovisioningRESPONSE_TIMEOUT_MS    azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS
+#endif /* azureiotprovisioningRESPONSE_TIMEOUT_MS */
+
 #ifndef azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS
     #define azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS    ( 500U )
 #endif /* azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS */
@@ -61,6 +65,112 @@
 #define azureiotprovisioningHMACBufferLength                 ( 48 )
 /*-----------------------------------------------------------*/
 
+static uint32_t prvProvClientGetTimeMillseconds( void );
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Invoke the callbacks of an asynchronous registration for the state just entered.
+ *
+ **/
+static void prvProvClientNotify( AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    AzureIoTProvisioningClientProgress_t xProgress;
+
+    switch( pxAzureProvClient->_internal.ulWorkflowState )
+    {
+        case azureiotprovisioningWF_STATE_CONNECT:
+            xProgress = eAzureIoTProvisioningProgressConnecting;
+            break;
+
+        case azureiotprovisioningWF_STATE_SUBSCRIBE:
+            xProgress = eAzureIoTProvisioningProgressSubscribing;
+            break;
+
+        case azureiotprovisioningWF_STATE_REQUEST:
+            xProgress = eAzureIoTProvisioningProgressRequesting;
+            break;
+
+        case azureiotprovisioningWF_STATE_WAITING:
+            xProgress = eAzureIoTProvisioningProgressWaiting;
+            break;
+
+        case azureiotprovisioningWF_STATE_COMPLETE:
+
+            if( pxAzureProvClient->_internal.xCompleteCallback != NULL )
+            {
+                pxAzureProvClient->_internal.xCompleteCallback( pxAzureProvClient,
+                                                                ( AzureIoTResult_t ) pxAzureProvClient->_internal.ulLastOperationResult,
+                                                                pxAzureProvClient->_internal.pvCallbackContext );
+            }
+
+            return;
+
+        default:
+            /* Intermediate states are not reported. */
+            return;
+    }
+
+    if( pxAzureProvClient->_internal.xProgressCallback != NULL )
+    {
+        pxAzureProvClient->_internal.xProgressCallback( pxAzureProvClient, xProgress,
+                                                        pxAzureProvClient->_internal.pvCallbackContext );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ *
+ * Add the time spent in the state being left to the timing of the registration.
+ *
+ **/
+static void prvProvClientUpdateTiming( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                       uint32_t ulPreviousState )
+{
+    AzureIoTProvisioningClientTiming_t * pxTiming = pxAzureProvClient->_internal.pxTiming;
+    uint32_t ulNow = prvProvClientGetTimeMillseconds();
+    uint32_t ulElapsed = ulNow - pxAzureProvClient->_internal.ulStateEnterTimeMs;
+
+    pxAzureProvClient->_internal.ulStateEnterTimeMs = ulNow;
+
+    switch( ulPreviousState )
+    {
+        case azureiotprovisioningWF_STATE_CONNECT:
+            pxTiming->ulConnectMilliseconds += ulElapsed;
+            break;
+
+        case azureiotprovisioningWF_STATE_SUBSCRIBE:
+        case azureiotprovisioningWF_STATE_SUBSCRIBING:
+            pxTiming->ulSubscribeMilliseconds += ulElapsed;
+            break;
+
+        case azureiotprovisioningWF_STATE_REQUEST:
+        case azureiotprovisioningWF_STATE_REQUESTING:
+        case azureiotprovisioningWF_STATE_RESPONSE:
+            pxTiming->ulRequestMilliseconds += ulElapsed;
+            break;
+
+        case azureiotprovisioningWF_STATE_WAITING:
+            pxTiming->ulWaitingMilliseconds += ulElapsed;
+
+            if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_REQUEST )
+            {
+                pxTiming->ulRetryCount++;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+
+    if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_COMPLETE )
+    {
+        pxTiming->ulTotalMilliseconds = ulNow - pxAzureProvClient->_internal.ulStartTimeMs;
+    }
+}
+/*-----------------------------------------------------------*/
+
 /**
  *
  * State transitions :
@@ -134,6 +244,22 @@ static void prvProvClientUpdateState( AzureIoTProvisioningClient_t * pxAzureProv
 
     AZLogDebug( ( "AzureIoTProvisioning updated state from [%u] -> [%u]", ( uint16_t ) ulState,
                   ( uint16_t ) pxAzureProvClient->_internal.ulWorkflowState ) );
+
+    if( ulState != pxAzureProvClient->_internal.ulWorkflowState )
+    {
+        if( ( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_SUBSCRIBING ) ||
+            ( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_REQUESTING ) )
+        {
+            pxAzureProvClient->_internal.ulRequestTimeMs = prvProvClientGetTimeMillseconds();
+        }
+
+        if( pxAzureProvClient->_internal.pxTiming != NULL )
+        {
+            prvProvClientUpdateTiming( pxAzureProvClient, ulState );
+        }
+
+        prvProvClientNotify( pxAzureProvClient );
+    }
 }
 /*-----------------------------------------------------------*/
 
@@ -209,6 +335,7 @@ static void prvProvClientConnect( AzureIoTProvisioningClient_t * pxAzureProvClie
             AZLogInfo( ( "AzureIoTProvisioning established an MQTT connection with %.*s",
                          ( int16_t ) pxAzureProvClient->_internal.ulEndpointLength,
                          pxAzureProvClient->_internal.pucEndpoint ) );
+            pxAzureProvClient->_internal.xConnected = true;
             xResult = eAzureIoTSuccess;
         }
     }
@@ -287,7 +414,7 @@ static void prvProvClientRequest( AzureIoTProvisioningClient_t * pxAzureProvClie
     else
     {
         /* Check if previous this is the 1st request or subsequent query request */
-        if( pxAzureProvClient->_internal.xLastResponsePayloadLength == 0 )
+        if( pxAzureProvClient->_internal.usOperationIDLength == 0 )
         {
             xCoreResult =
                 az_iot_provisioning_client_register_get_publish_topic( &pxAzureProvClient->_internal.xProvisioningClientCore,
@@ -298,7 +425,8 @@ static void prvProvClientRequest( AzureIoTProvisioningClient_t * pxAzureProvClie
         {
             xCoreResult =
                 az_iot_provisioning_client_query_status_get_publish_topic( &pxAzureProvClient->_internal.xProvisioningClientCore,
-                                                                           pxAzureProvClient->_internal.xRegisterResponse.operation_id,
+                                                                           az_span_create( pxAzureProvClient->_internal.ucOperationID,
+                                                                                           ( int32_t ) pxAzureProvClient->_internal.usOperationIDLength ),
                                                                            ( char * ) pxAzureProvClient->_internal.pucScratchBuffer,
                                                                            azureiotconfigTOPIC_MAX, &xMQTTTopicLength );
         }
@@ -348,66 +476,36 @@ static void prvProvClientRequest( AzureIoTProvisioningClient_t * pxAzureProvClie
 
 /**
  *
- * Implementation of parsing response action, this action is only allowed in azureiotprovisioningWF_STATE_RESPONSE
+ * Implementation of response action, this action is only allowed in azureiotprovisioningWF_STATE_RESPONSE.
+ * The response was already parsed when it was received.
  *
  * */
-static void prvProvClientParseResponse( AzureIoTProvisioningClient_t * pxAzureProvClient )
+static void prvProvClientProcessResponse( AzureIoTProvisioningClient_t * pxAzureProvClient )
 {
-    az_result xCoreResult;
-    az_span xTopic = az_span_create( pxAzureProvClient->_internal.ucProvisioningLastResponse,
-                                     ( int32_t ) pxAzureProvClient->_internal.usLastResponseTopicLength );
-    az_span xPayload = az_span_create( pxAzureProvClient->_internal.ucProvisioningLastResponse +
-                                       pxAzureProvClient->_internal.usLastResponseTopicLength,
-                                       ( int32_t ) pxAzureProvClient->_internal.xLastResponsePayloadLength );
-
     /* Check the state.  */
     if( pxAzureProvClient->_internal.ulWorkflowState != azureiotprovisioningWF_STATE_RESPONSE )
     {
-        AZLogWarn( ( "AzureIoTProvisioning parse response action called in wrong state: [%u]",
+        AZLogWarn( ( "AzureIoTProvisioning process response action called in wrong state: [%u]",
                      ( uint16_t ) pxAzureProvClient->_internal.ulWorkflowState ) );
         return;
     }
 
-    if( ( pxAzureProvClient->_internal.usLastResponseTopicLength == 0 ) ||
-        ( pxAzureProvClient->_internal.xLastResponsePayloadLength == 0 ) )
+    if( pxAzureProvClient->_internal.ulResponseParseResult != eAzureIoTSuccess )
     {
-        AZLogError( ( "AzureIoTProvisioning client failed with invalid server response" ) );
-        prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorInvalidResponse );
+        prvProvClientUpdateState( pxAzureProvClient, pxAzureProvClient->_internal.ulResponseParseResult );
         return;
     }
 
-    xCoreResult =
-        az_iot_provisioning_client_parse_received_topic_and_payload( &pxAzureProvClient->_internal.xProvisioningClientCore,
-                                                                     xTopic, xPayload, &pxAzureProvClient->_internal.xRegisterResponse );
-
-    if( xCoreResult == AZ_ERROR_IOT_TOPIC_NO_MATCH )
+    if( az_iot_provisioning_client_operation_complete( ( az_iot_provisioning_client_operation_status )
+                                                       pxAzureProvClient->_internal.ulOperationStatus ) )
     {
-        AZLogInfo( ( "AzureIoTProvisioning ignoring unknown topic." ) );
-        /* Maintaining the same state. */
-        return;
-    }
-    else if( az_result_failed( xCoreResult ) )
-    {
-        AZLogError( ( "AzureIoTProvisioning client failed to parse packet: core error=0x%08x", ( uint16_t ) xCoreResult ) );
-        prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorFailed );
-        return;
-    }
-
-    if( az_iot_provisioning_client_operation_complete( pxAzureProvClient->_internal.xRegisterResponse.operation_status ) )
-    {
-        switch( pxAzureProvClient->_internal.xRegisterResponse.operation_status )
+        switch( pxAzureProvClient->_internal.ulOperationStatus )
         {
             case AZ_IOT_PROVISIONING_STATUS_ASSIGNED:
                 prvProvClientUpdateState( pxAzureProvClient, eAzureIoTSuccess );
                 break;
 
             case AZ_IOT_PROVISIONING_STATUS_FAILED:
-                AZLogError( ( "AzureIoTProvisioning client registration failed with error %u: TrackingID: [%.*s] \"%.*s\"",
-                              ( uint16_t ) pxAzureProvClient->_internal.xRegisterResponse.registration_state.extended_error_code,
-                              ( int16_t ) az_span_size( pxAzureProvClient->_internal.xRegisterResponse.registration_state.error_tracking_id ),
-                              az_span_ptr( pxAzureProvClient->_internal.xRegisterResponse.registration_state.error_tracking_id ),
-                              ( int16_t ) az_span_size( pxAzureProvClient->_internal.xRegisterResponse.registration_state.error_message ),
-                              az_span_ptr( pxAzureProvClient->_internal.xRegisterResponse.registration_state.error_message ) ) );
                 prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorServerError );
                 break;
 
@@ -417,19 +515,19 @@ static void prvProvClientParseResponse( AzureIoTProvisioningClient_t * pxAzurePr
                 break;
 
             default:
-                AZLogError( ( "AzureIoTProvisioning unexpected operation status %d", pxAzureProvClient->_internal.xRegisterResponse.operation_status ) );
+                AZLogError( ( "AzureIoTProvisioning unexpected operation status %d", ( int ) pxAzureProvClient->_internal.ulOperationStatus ) );
         }
     }
     else /* Operation is not complete. */
     {
-        if( pxAzureProvClient->_internal.xRegisterResponse.retry_after_seconds == 0 )
+        if( pxAzureProvClient->_internal.ulRetryAfterSeconds == 0 )
         {
-            pxAzureProvClient->_internal.xRegisterResponse.retry_after_seconds = azureiotconfigPROVISIONING_POLLING_INTERVAL_S;
+            pxAzureProvClient->_internal.ulRetryAfterSeconds = azureiotconfigPROVISIONING_POLLING_INTERVAL_S;
         }
 
         pxAzureProvClient->_internal.ullRetryAfter =
             pxAzureProvClient->_internal.xGetTimeFunction() +
-            pxAzureProvClient->_internal.xRegisterResponse.retry_after_seconds;
+            pxAzureProvClient->_internal.ulRetryAfterSeconds;
         prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorPending );
     }
 }
@@ -444,7 +542,7 @@ static void prvProvClientCheckTimeout( AzureIoTProvisioningClient_t * pxAzurePro
 {
     if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_WAITING )
     {
-        if( pxAzureProvClient->_internal.xGetTimeFunction() >
+        if( pxAzureProvClient->_internal.xGetTimeFunction() >=
             pxAzureProvClient->_internal.ullRetryAfter )
         {
             pxAzureProvClient->_internal.ullRetryAfter = 0;
@@ -454,6 +552,34 @@ static void prvProvClientCheckTimeout( AzureIoTProvisioningClient_t * pxAzurePro
 }
 /*-----------------------------------------------------------*/
 
+/**
+ *
+ * Implementation of the response timeout check. This action is only allowed in azureiotprovisioningWF_STATE_SUBSCRIBING
+ * and azureiotprovisioningWF_STATE_REQUESTING
+ *
+ * */
+static void prvProvClientCheckResponseTimeout( AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    uint32_t ulElapsedMs = prvProvClientGetTimeMillseconds() - pxAzureProvClient->_internal.ulRequestTimeMs;
+
+    if( ulElapsedMs < azureiotprovisioningRESPONSE_TIMEOUT_MS )
+    {
+        return;
+    }
+
+    if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_SUBSCRIBING )
+    {
+        AZLogError( ( "AzureIoTProvisioning timed out waiting for the SUBACK" ) );
+        prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorSubackWaitTimeout );
+    }
+    else
+    {
+        AZLogError( ( "AzureIoTProvisioning timed out waiting for the response" ) );
+        prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorServerError );
+    }
+}
+/*-----------------------------------------------------------*/
+
 /**
  * Trigger state machine action base on the state.
  *
@@ -475,13 +601,17 @@ static void prvProvClientTriggerAction( AzureIoTProvisioningClient_t * pxAzurePr
             break;
 
         case azureiotprovisioningWF_STATE_RESPONSE:
-            prvProvClientParseResponse( pxAzureProvClient );
+            prvProvClientProcessResponse( pxAzureProvClient );
             break;
 
         case azureiotprovisioningWF_STATE_SUBSCRIBING:
         case azureiotprovisioningWF_STATE_REQUESTING:
+            /* These states are waiting for receive path, only the timeout is checked here. */
+            prvProvClientCheckResponseTimeout( pxAzureProvClient );
+            break;
+
         case azureiotprovisioningWF_STATE_COMPLETE:
-            /* None action taken here, as these states are waiting for receive path. */
+            /* None action taken here, as the registration is done. */
             break;
 
         case azureiotprovisioningWF_STATE_WAITING:
@@ -496,6 +626,48 @@ static void prvProvClientTriggerAction( AzureIoTProvisioningClient_t * pxAzurePr
 }
 /*-----------------------------------------------------------*/
 
+/**
+ * Move a new registration to the connect state.
+ *
+ */
+static void prvProvClientStartWorkflow( AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    pxAzureProvClient->_internal.ulWorkflowState = azureiotprovisioningWF_STATE_CONNECT;
+
+    if( pxAzureProvClient->_internal.pxTiming != NULL )
+    {
+        memset( pxAzureProvClient->_internal.pxTiming, 0, sizeof( AzureIoTProvisioningClientTiming_t ) );
+        pxAzureProvClient->_internal.ulStartTimeMs = prvProvClientGetTimeMillseconds();
+        pxAzureProvClient->_internal.ulStateEnterTimeMs = pxAzureProvClient->_internal.ulStartTimeMs;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * Time to spend in the next MQTT loop. While waiting for the retry-after time nothing is expected
+ * from the service, so the loop waits up to the deadline in one go instead of polling.
+ *
+ */
+static uint32_t prvProvClientGetWaitTime( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                          uint32_t ulTimeoutMilliseconds )
+{
+    uint64_t ullNow;
+    uint64_t ullWaitTime = azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS;
+
+    if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_WAITING )
+    {
+        ullNow = pxAzureProvClient->_internal.xGetTimeFunction();
+
+        if( pxAzureProvClient->_internal.ullRetryAfter > ullNow )
+        {
+            ullWaitTime = ( pxAzureProvClient->_internal.ullRetryAfter - ullNow ) * 1000U;
+        }
+    }
+
+    return ullWaitTime < ulTimeoutMilliseconds ? ( uint32_t ) ullWaitTime : ulTimeoutMilliseconds;
+}
+/*-----------------------------------------------------------*/
+
 /**
  *  Run the workflow : trigger action on state and process receive path in MQTT loop
  *
@@ -507,6 +679,13 @@ static AzureIoTResult_t prvProvClientRunWorkflow( AzureIoTProvisioningClient_t *
     AzureIoTResult_t xResult;
     uint32_t ulWaitTime;
 
+    /* The first step of an asynchronous registration is reported by the first run, not by RegisterAsync */
+    if( pxAzureProvClient->_internal.xStartNotifyPending )
+    {
+        pxAzureProvClient->_internal.xStartNotifyPending = false;
+        prvProvClientNotify( pxAzureProvClient );
+    }
+
     do
     {
         if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_COMPLETE )
@@ -515,18 +694,15 @@ static AzureIoTResult_t prvProvClientRunWorkflow( AzureIoTProvisioningClient_t *
             break;
         }
 
-        if( ulTimeoutMilliseconds > azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS )
-        {
-            ulTimeoutMilliseconds -= azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS;
-            ulWaitTime = azureiotprovisioningPROCESS_LOOP_TIMEOUT_MS;
-        }
-        else
+        prvProvClientTriggerAction( pxAzureProvClient );
+
+        if( pxAzureProvClient->_internal.pxTiming != NULL )
         {
-            ulWaitTime = ulTimeoutMilliseconds;
-            ulTimeoutMilliseconds = 0;
+            pxAzureProvClient->_internal.pxTiming->ulPollCount++;
         }
 
-        prvProvClientTriggerAction( pxAzureProvClient );
+        ulWaitTime = prvProvClientGetWaitTime( pxAzureProvClient, ulTimeoutMilliseconds );
+        ulTimeoutMilliseconds -= ulWaitTime;
 
         if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_COMPLETE )
         {
@@ -574,38 +750,124 @@ static void prvProvClientMQTTProcessSubAck( AzureIoTProvisioningClient_t * pxAzu
 /*-----------------------------------------------------------*/
 
 /**
- * Process MQTT Response from Provisioning Service
+ * Copy a field of the response into a buffer of the client.
+ *
+ */
+static bool prvProvClientCopySpan( az_span xSpan,
+                                   uint8_t * pucBuffer,
+                                   uint32_t ulBufferLength,
+                                   uint16_t * pusLength )
+{
+    if( ( uint32_t ) az_span_size( xSpan ) > ulBufferLength )
+    {
+        return false;
+    }
+
+    memcpy( pucBuffer, az_span_ptr( xSpan ), ( size_t ) az_span_size( xSpan ) );
+    *pusLength = ( uint16_t ) az_span_size( xSpan );
+
+    return true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * Keep the fields of a parsed response that the workflow needs.
+ *
+ */
+static AzureIoTResult_t prvProvClientStoreResponse( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                    az_iot_provisioning_client_register_response * pxRegisterResponse )
+{
+    pxAzureProvClient->_internal.ulOperationStatus = ( uint32_t ) pxRegisterResponse->operation_status;
+    pxAzureProvClient->_internal.ulRetryAfterSeconds = pxRegisterResponse->retry_after_seconds;
+    pxAzureProvClient->_internal.ulExtendedErrorCode = pxRegisterResponse->registration_state.extended_error_code;
+
+    if( !prvProvClientCopySpan( pxRegisterResponse->operation_id,
+                                pxAzureProvClient->_internal.ucOperationID,
+                                sizeof( pxAzureProvClient->_internal.ucOperationID ),
+                                &pxAzureProvClient->_internal.usOperationIDLength ) )
+    {
+        AZLogError( ( "AzureIoTProvisioning operation ID is bigger than %u bytes",
+                      ( uint16_t ) sizeof( pxAzureProvClient->_internal.ucOperationID ) ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    if( pxRegisterResponse->operation_status == AZ_IOT_PROVISIONING_STATUS_ASSIGNED )
+    {
+        if( !prvProvClientCopySpan( pxRegisterResponse->registration_state.assigned_hub_hostname,
+                                    pxAzureProvClient->_internal.ucAssignedHubHostname,
+                                    sizeof( pxAzureProvClient->_internal.ucAssignedHubHostname ),
+                                    &pxAzureProvClient->_internal.usAssignedHubHostnameLength ) ||
+            !prvProvClientCopySpan( pxRegisterResponse->registration_state.device_id,
+                                    pxAzureProvClient->_internal.ucDeviceID,
+                                    sizeof( pxAzureProvClient->_internal.ucDeviceID ),
+                                    &pxAzureProvClient->_internal.usDeviceIDLength ) )
+        {
+            AZLogError( ( "AzureIoTProvisioning assigned hub or device ID is too big" ) );
+            return eAzureIoTErrorOutOfMemory;
+        }
+    }
+    else if( pxRegisterResponse->operation_status == AZ_IOT_PROVISIONING_STATUS_FAILED )
+    {
+        /* The error details point into the MQTT buffer, so they are only logged here. */
+        AZLogError( ( "AzureIoTProvisioning client registration failed with error %u: TrackingID: [%.*s] \"%.*s\"",
+                      ( uint16_t ) pxRegisterResponse->registration_state.extended_error_code,
+                      ( int16_t ) az_span_size( pxRegisterResponse->registration_state.error_tracking_id ),
+                      az_span_ptr( pxRegisterResponse->registration_state.error_tracking_id ),
+                      ( int16_t ) az_span_size( pxRegisterResponse->registration_state.error_message ),
+                      az_span_ptr( pxRegisterResponse->registration_state.error_message ) ) );
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * Process MQTT Response from Provisioning Service. The response is parsed in place in the MQTT
+ * receive buffer and only the fields needed by the workflow are kept.
  *
  */
 static void prvProvClientMQTTProcessResponse( AzureIoTProvisioningClient_t * pxAzureProvClient,
                                               AzureIoTMQTTPublishInfo_t * pxPublishInfo )
 {
+    az_iot_provisioning_client_register_response xRegisterResponse;
+    az_result xCoreResult;
+
     if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_REQUESTING )
     {
-        if( ( pxPublishInfo->xPayloadLength + pxPublishInfo->usTopicNameLength ) <=
-            sizeof( pxAzureProvClient->_internal.ucProvisioningLastResponse ) )
+        if( ( pxPublishInfo->usTopicNameLength == 0 ) || ( pxPublishInfo->xPayloadLength == 0 ) )
         {
-            /* Copy topic + payload into the response buffer.
-             * ucProvisioningLastResponse = [ topic payload ] */
-            pxAzureProvClient->_internal.usLastResponseTopicLength =
-                pxPublishInfo->usTopicNameLength;
-            memcpy( pxAzureProvClient->_internal.ucProvisioningLastResponse,
-                    pxPublishInfo->pcTopicName, pxPublishInfo->usTopicNameLength );
-
-            pxAzureProvClient->_internal.xLastResponsePayloadLength =
-                pxPublishInfo->xPayloadLength;
-            memcpy( pxAzureProvClient->_internal.ucProvisioningLastResponse +
-                    pxAzureProvClient->_internal.usLastResponseTopicLength,
-                    pxPublishInfo->pvPayload, pxPublishInfo->xPayloadLength );
-
-            prvProvClientUpdateState( pxAzureProvClient, eAzureIoTSuccess );
+            AZLogError( ( "AzureIoTProvisioning client failed with invalid server response" ) );
+            pxAzureProvClient->_internal.ulResponseParseResult = eAzureIoTErrorInvalidResponse;
         }
         else
         {
-            AZLogError( ( "AzureIoTProvisioning process response failed with buffer too small required size is %d bytes",
-                          pxPublishInfo->xPayloadLength + pxPublishInfo->usTopicNameLength ) );
-            prvProvClientUpdateState( pxAzureProvClient, eAzureIoTErrorOutOfMemory );
+            xCoreResult =
+                az_iot_provisioning_client_parse_received_topic_and_payload( &pxAzureProvClient->_internal.xProvisioningClientCore,
+                                                                             az_span_create( ( uint8_t * ) pxPublishInfo->pcTopicName,
+                                                                                             ( int32_t ) pxPublishInfo->usTopicNameLength ),
+                                                                             az_span_create( ( uint8_t * ) pxPublishInfo->pvPayload,
+                                                                                             ( int32_t ) pxPublishInfo->xPayloadLength ),
+                                                                             &xRegisterResponse );
+
+            if( xCoreResult == AZ_ERROR_IOT_TOPIC_NO_MATCH )
+            {
+                AZLogInfo( ( "AzureIoTProvisioning ignoring unknown topic." ) );
+                /* Maintaining the same state. */
+                return;
+            }
+            else if( az_result_failed( xCoreResult ) )
+            {
+                AZLogError( ( "AzureIoTProvisioning client failed to parse packet: core error=0x%08x", ( uint16_t ) xCoreResult ) );
+                pxAzureProvClient->_internal.ulResponseParseResult = eAzureIoTErrorFailed;
+            }
+            else
+            {
+                pxAzureProvClient->_internal.ulResponseParseResult =
+                    prvProvClientStoreResponse( pxAzureProvClient, &xRegisterResponse );
+            }
         }
+
+        prvProvClientUpdateState( pxAzureProvClient, eAzureIoTSuccess );
     }
 }
 /*-----------------------------------------------------------*/
@@ -653,6 +915,7 @@ static uint32_t prvProvClientGetToken( AzureIoTProvisioningClient_t * pxAzurePro
     uint8_t * pucHMACBuffer;
     az_span xSpan = az_span_create( pucSASBuffer, ( int32_t ) ulSasBufferLen );
     az_result xCoreResult;
+    AzureIoTResult_t xResult;
     uint32_t ulBytesUsed;
     uint32_t ulSignatureLength;
     uint32_t ulBufferLeft;
@@ -680,10 +943,23 @@ static uint32_t prvProvClientGetToken( AzureIoTProvisioningClient_t * pxAzurePro
     ulBufferLeft -= azureiotprovisioningHMACBufferLength;
     pucHMACBuffer = pucSASBuffer + ulSasBufferLen - azureiotprovisioningHMACBufferLength;
 
-    if( AzureIoT_Base64HMACCalculate( pxAzureProvClient->_internal.xHMACFunction,
-                                      ucKey, ulKeyLen, pucSASBuffer, ulBytesUsed, pucSASBuffer + ulBytesUsed, ulBufferLeft,
-                                      pucHMACBuffer, azureiotprovisioningHMACBufferLength,
-                                      &ulSignatureLength ) )
+    if( pxAzureProvClient->_internal.xHMACContextFunction != NULL )
+    {
+        xResult = AzureIoT_HMACContextBase64Encode( pxAzureProvClient->_internal.xHMACContextFunction,
+                                                    pxAzureProvClient->_internal.pvHMACContext,
+                                                    pucSASBuffer, ulBytesUsed, pucSASBuffer + ulBytesUsed, ulBufferLeft,
+                                                    pucHMACBuffer, azureiotprovisioningHMACBufferLength,
+                                                    &ulSignatureLength );
+    }
+    else
+    {
+        xResult = AzureIoT_Base64HMACCalculate( pxAzureProvClient->_internal.xHMACFunction,
+                                                ucKey, ulKeyLen, pucSASBuffer, ulBytesUsed, pucSASBuffer + ulBytesUsed, ulBufferLeft,
+                                                pucHMACBuffer, azureiotprovisioningHMACBufferLength,
+                                                &ulSignatureLength );
+    }
+
+    if( xResult != eAzureIoTSuccess )
     {
         AZLogError( ( "AzureIoTProvisioning failed to encoded HMAC hash" ) );
         return eAzureIoTErrorFailed;
@@ -745,6 +1021,7 @@ AzureIoTResult_t AzureIoTProvisioningClient_OptionsInit( AzureIoTProvisioningCli
     {
         pxProvisioningClientOptions->pucUserAgent = ( const uint8_t * ) azureiotprovisioningUSER_AGENT;
         pxProvisioningClientOptions->ulUserAgentLength = sizeof( azureiotprovisioningUSER_AGENT ) - 1;
+        pxProvisioningClientOptions->pxTiming = NULL;
         xResult = eAzureIoTSuccess;
     }
 
@@ -814,6 +1091,7 @@ AzureIoTResult_t AzureIoTProvisioningClient_Init( AzureIoTProvisioningClient_t *
         {
             xOptions.user_agent = az_span_create( ( uint8_t * ) pxProvisioningClientOptions->pucUserAgent,
                                                   ( int32_t ) pxProvisioningClientOptions->ulUserAgentLength );
+            pxAzureProvClient->_internal.pxTiming = pxProvisioningClientOptions->pxTiming;
         }
         else
         {
@@ -876,6 +1154,35 @@ AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKey( AzureIoTProvisionin
         pxAzureProvClient->_internal.ulSymmetricKeyLength = ulSymmetricKeyLength;
         pxAzureProvClient->_internal.pxTokenRefresh = prvProvClientGetToken;
         pxAzureProvClient->_internal.xHMACFunction = xHmacFunction;
+        pxAzureProvClient->_internal.xHMACContextFunction = NULL;
+        pxAzureProvClient->_internal.pvHMACContext = NULL;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKeyContext( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                                    AzureIoTGetHMACContextFunc_t xHmacContextFunction,
+                                                                    void * pvHmacContext )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxAzureProvClient == NULL ) ||
+        ( xHmacContextFunction == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_SetSymmetricKeyContext failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else
+    {
+        pxAzureProvClient->_internal.pucSymmetricKey = NULL;
+        pxAzureProvClient->_internal.ulSymmetricKeyLength = 0;
+        pxAzureProvClient->_internal.pxTokenRefresh = prvProvClientGetToken;
+        pxAzureProvClient->_internal.xHMACFunction = NULL;
+        pxAzureProvClient->_internal.xHMACContextFunction = xHmacContextFunction;
+        pxAzureProvClient->_internal.pvHMACContext = pvHmacContext;
         xResult = eAzureIoTSuccess;
     }
 
@@ -897,7 +1204,7 @@ AzureIoTResult_t AzureIoTProvisioningClient_Register( AzureIoTProvisioningClient
     {
         if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_INIT )
         {
-            pxAzureProvClient->_internal.ulWorkflowState = azureiotprovisioningWF_STATE_CONNECT;
+            prvProvClientStartWorkflow( pxAzureProvClient );
         }
 
         xResult = prvProvClientRunWorkflow( pxAzureProvClient, ulTimeoutMilliseconds );
@@ -907,6 +1214,156 @@ AzureIoTResult_t AzureIoTProvisioningClient_Register( AzureIoTProvisioningClient
 }
 /*-----------------------------------------------------------*/
 
+AzureIoTResult_t AzureIoTProvisioningClient_RegisterAsync( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                           AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback,
+                                                           AzureIoTProvisioningClientProgressCallback_t xProgressCallback,
+                                                           void * pvContext )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( pxAzureProvClient == NULL ) || ( xCompleteCallback == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_RegisterAsync failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( pxAzureProvClient->_internal.ulWorkflowState != azureiotprovisioningWF_STATE_INIT )
+    {
+        AZLogError( ( "AzureIoTProvisioning client state is not in init" ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        pxAzureProvClient->_internal.xCompleteCallback = xCompleteCallback;
+        pxAzureProvClient->_internal.xProgressCallback = xProgressCallback;
+        pxAzureProvClient->_internal.pvCallbackContext = pvContext;
+        prvProvClientStartWorkflow( pxAzureProvClient );
+
+        /* Callbacks only run from AzureIoTProvisioningClient_ProcessLoop(), so the first step is reported there */
+        pxAzureProvClient->_internal.xStartNotifyPending = true;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningClient_ProcessLoop( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                         uint32_t ulTimeoutMilliseconds )
+{
+    AzureIoTResult_t xResult;
+
+    if( pxAzureProvClient == NULL )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_ProcessLoop failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_INIT )
+    {
+        AZLogError( ( "AzureIoTProvisioning client registration is not started" ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        xResult = prvProvClientRunWorkflow( pxAzureProvClient, ulTimeoutMilliseconds );
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningClient_GetNextDeadline( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                             uint32_t * pulWaitMilliseconds )
+{
+    AzureIoTResult_t xResult;
+    uint64_t ullNow;
+    uint32_t ulElapsedMs;
+
+    if( ( pxAzureProvClient == NULL ) || ( pulWaitMilliseconds == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_GetNextDeadline failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( ( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_INIT ) ||
+             ( pxAzureProvClient->_internal.ulWorkflowState == azureiotprovisioningWF_STATE_COMPLETE ) )
+    {
+        AZLogError( ( "AzureIoTProvisioning client registration is not in progress" ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        switch( pxAzureProvClient->_internal.ulWorkflowState )
+        {
+            case azureiotprovisioningWF_STATE_SUBSCRIBING:
+            case azureiotprovisioningWF_STATE_REQUESTING:
+                /* Only the answer of the service, or its timeout, moves the registration forward. */
+                ulElapsedMs = prvProvClientGetTimeMillseconds() - pxAzureProvClient->_internal.ulRequestTimeMs;
+                *pulWaitMilliseconds = ulElapsedMs >= azureiotprovisioningRESPONSE_TIMEOUT_MS ? 0 :
+                                       azureiotprovisioningRESPONSE_TIMEOUT_MS - ulElapsedMs;
+                break;
+
+            case azureiotprovisioningWF_STATE_WAITING:
+                ullNow = pxAzureProvClient->_internal.xGetTimeFunction();
+
+                if( pxAzureProvClient->_internal.ullRetryAfter <= ullNow )
+                {
+                    *pulWaitMilliseconds = 0;
+                }
+                else if( ( pxAzureProvClient->_internal.ullRetryAfter - ullNow ) >= ( UINT32_MAX / 1000U ) )
+                {
+                    *pulWaitMilliseconds = UINT32_MAX;
+                }
+                else
+                {
+                    *pulWaitMilliseconds = ( uint32_t ) ( pxAzureProvClient->_internal.ullRetryAfter - ullNow ) * 1000U;
+                }
+
+                break;
+
+            default:
+                /* The next step of the workflow can run now. */
+                *pulWaitMilliseconds = 0;
+                break;
+        }
+
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningClient_Disconnect( AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    AzureIoTMQTTResult_t xMQTTResult;
+    AzureIoTResult_t xResult;
+
+    if( pxAzureProvClient == NULL )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_Disconnect failed: invalid argument" ) );
+        xResult = eAzureIoTErrorInvalidArgument;
+    }
+    else if( !pxAzureProvClient->_internal.xConnected )
+    {
+        xResult = eAzureIoTSuccess;
+    }
+    else if( ( xMQTTResult = AzureIoTMQTT_Disconnect( &( pxAzureProvClient->_internal.xMQTTContext ) ) ) != eAzureIoTMQTTSuccess )
+    {
+        AZLogError( ( "AzureIoTProvisioningClient_Disconnect failed to disconnect: MQTT error=0x%08x", ( uint16_t ) xMQTTResult ) );
+        xResult = eAzureIoTErrorFailed;
+    }
+    else
+    {
+        AZLogInfo( ( "AzureIoTProvisioning disconnected the MQTT connection with %.*s",
+                     ( int16_t ) pxAzureProvClient->_internal.ulEndpointLength,
+                     pxAzureProvClient->_internal.pucEndpoint ) );
+        pxAzureProvClient->_internal.xConnected = false;
+        xResult = eAzureIoTSuccess;
+    }
+
+    return xResult;
+}
+/*-----------------------------------------------------------*/
+
 AzureIoTResult_t AzureIoTProvisioningClient_GetDeviceAndHub( AzureIoTProvisioningClient_t * pxAzureProvClient,
                                                              uint8_t * pucHubHostname,
                                                              uint32_t * pulHostnameLength,
@@ -916,8 +1373,6 @@ AzureIoTResult_t AzureIoTProvisioningClient_GetDeviceAndHub( AzureIoTProvisionin
     uint32_t ulHostnameLength;
     uint32_t ulDeviceIDLength;
     AzureIoTResult_t xResult;
-    az_span * pxHostname;
-    az_span * pxDeviceID;
 
     if( ( pxAzureProvClient == NULL ) || ( pucHubHostname == NULL ) ||
         ( pulHostnameLength == NULL ) || ( pucDeviceID == NULL ) || ( pulDeviceIDLength == NULL ) )
@@ -936,10 +1391,8 @@ AzureIoTResult_t AzureIoTProvisioningClient_GetDeviceAndHub( AzureIoTProvisionin
     }
     else
     {
-        pxHostname = &pxAzureProvClient->_internal.xRegisterResponse.registration_state.assigned_hub_hostname;
-        pxDeviceID = &pxAzureProvClient->_internal.xRegisterResponse.registration_state.device_id;
-        ulHostnameLength = ( uint32_t ) az_span_size( *pxHostname );
-        ulDeviceIDLength = ( uint32_t ) az_span_size( *pxDeviceID );
+        ulHostnameLength = pxAzureProvClient->_internal.usAssignedHubHostnameLength;
+        ulDeviceIDLength = pxAzureProvClient->_internal.usDeviceIDLength;
 
         if( ( *pulHostnameLength < ulHostnameLength ) || ( *pulDeviceIDLength < ulDeviceIDLength ) )
         {
@@ -948,8 +1401,8 @@ AzureIoTResult_t AzureIoTProvisioningClient_GetDeviceAndHub( AzureIoTProvisionin
         }
         else
         {
-            memcpy( pucHubHostname, az_span_ptr( *pxHostname ), ulHostnameLength );
-            memcpy( pucDeviceID, az_span_ptr( *pxDeviceID ), ulDeviceIDLength );
+            memcpy( pucHubHostname, pxAzureProvClient->_internal.ucAssignedHubHostname, ulHostnameLength );
+            memcpy( pucDeviceID, pxAzureProvClient->_internal.ucDeviceID, ulDeviceIDLength );
             *pulHostnameLength = ulHostnameLength;
             *pulDeviceIDLength = ulDeviceIDLength;
             xResult = eAzureIoTSuccess;
@@ -978,8 +1431,7 @@ AzureIoTResult_t AzureIoTProvisioningClient_GetExtendedCode( AzureIoTProvisionin
     }
     else
     {
-        *pulExtendedErrorCode =
-            pxAzureProvClient->_internal.xRegisterResponse.registration_state.extended_error_code;
+        *pulExtendedErrorCode = pxAzureProvClient->_internal.ulExtendedErrorCode;
         xResult = eAzureIoTSuccess;
     }
 
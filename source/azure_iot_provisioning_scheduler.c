@@ -0,0 +1,268 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_scheduler.c
+ * @brief Implementation of the provisioning scheduler.
+ */
+
+#include "azure_iot_provisioning_scheduler.h"
+
+#include <string.h>
+
+#define azureiotprovisioningschedulerENTRY_QUEUED      ( 0x1 )
+#define azureiotprovisioningschedulerENTRY_ACTIVE      ( 0x2 )
+#define azureiotprovisioningschedulerENTRY_COMPLETE    ( 0x3 )
+/*-----------------------------------------------------------*/
+
+static void prvSchedulerEntryComplete( AzureIoTProvisioningSchedulerEntry_t * pxEntry,
+                                       AzureIoTResult_t xResult )
+{
+    AzureIoTProvisioningScheduler_t * pxScheduler = pxEntry->_internal.pxScheduler;
+
+    if( pxEntry->_internal.ulState == azureiotprovisioningschedulerENTRY_ACTIVE )
+    {
+        pxScheduler->_internal.ulActiveCount--;
+
+        if( AzureIoTProvisioningClient_Disconnect( pxEntry->_internal.pxAzureProvClient ) != eAzureIoTSuccess )
+        {
+            AZLogWarn( ( "AzureIoTProvisioningScheduler failed to disconnect" ) );
+        }
+
+        if( ( pxScheduler->_internal.xCloseTransport != NULL ) &&
+            ( pxScheduler->_internal.xCloseTransport( pxEntry->_internal.pxAzureProvClient,
+                                                      pxScheduler->_internal.pvContext ) != eAzureIoTSuccess ) )
+        {
+            AZLogWarn( ( "AzureIoTProvisioningScheduler failed to close transport" ) );
+        }
+    }
+
+    pxEntry->_internal.ulState = azureiotprovisioningschedulerENTRY_COMPLETE;
+    pxEntry->_internal.xResult = xResult;
+    pxScheduler->_internal.ulCompleteCount++;
+
+    pxScheduler->_internal.xCompleteCallback( pxEntry->_internal.pxAzureProvClient, xResult,
+                                              pxScheduler->_internal.pvContext );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSchedulerCompleteCallback( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                          AzureIoTResult_t xResult,
+                                          void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+
+    prvSchedulerEntryComplete( ( AzureIoTProvisioningSchedulerEntry_t * ) pvContext, xResult );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSchedulerStartEntry( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                    AzureIoTProvisioningSchedulerEntry_t * pxEntry )
+{
+    AzureIoTResult_t xResult;
+
+    if( ( xResult = pxScheduler->_internal.xOpenTransport( pxEntry->_internal.pxAzureProvClient,
+                                                           pxScheduler->_internal.pvContext ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler failed to open transport: error=0x%08x", ( uint16_t ) xResult ) );
+        prvSchedulerEntryComplete( pxEntry, xResult );
+        return;
+    }
+
+    pxEntry->_internal.ulState = azureiotprovisioningschedulerENTRY_ACTIVE;
+    pxScheduler->_internal.ulActiveCount++;
+
+    if( ( xResult = AzureIoTProvisioningClient_RegisterAsync( pxEntry->_internal.pxAzureProvClient,
+                                                              prvSchedulerCompleteCallback,
+                                                              NULL, pxEntry ) ) != eAzureIoTSuccess )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler failed to start registration: error=0x%08x", ( uint16_t ) xResult ) );
+        prvSchedulerEntryComplete( pxEntry, xResult );
+    }
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningScheduler_Init( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                     AzureIoTProvisioningSchedulerEntry_t * pxEntries,
+                                                     uint32_t ulEntryCount,
+                                                     uint32_t ulMaxActive,
+                                                     AzureIoTGetCurrentTimeFunc_t xGetTimeFunction,
+                                                     AzureIoTProvisioningSchedulerTransportFunc_t xOpenTransport,
+                                                     AzureIoTProvisioningSchedulerTransportFunc_t xCloseTransport,
+                                                     AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback,
+                                                     void * pvContext )
+{
+    if( ( pxScheduler == NULL ) || ( pxEntries == NULL ) || ( ulEntryCount == 0 ) ||
+        ( ulMaxActive == 0 ) || ( xGetTimeFunction == NULL ) ||
+        ( xOpenTransport == NULL ) || ( xCompleteCallback == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_Init failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    memset( pxScheduler, 0, sizeof( AzureIoTProvisioningScheduler_t ) );
+    memset( pxEntries, 0, sizeof( AzureIoTProvisioningSchedulerEntry_t ) * ulEntryCount );
+
+    pxScheduler->_internal.pxEntries = pxEntries;
+    pxScheduler->_internal.ulEntryCapacity = ulEntryCount;
+    pxScheduler->_internal.ulMaxActive = ulMaxActive;
+    pxScheduler->_internal.xGetTimeFunction = xGetTimeFunction;
+    pxScheduler->_internal.xOpenTransport = xOpenTransport;
+    pxScheduler->_internal.xCloseTransport = xCloseTransport;
+    pxScheduler->_internal.xCompleteCallback = xCompleteCallback;
+    pxScheduler->_internal.pvContext = pvContext;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningScheduler_Add( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                    AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    AzureIoTProvisioningSchedulerEntry_t * pxEntry;
+
+    if( ( pxScheduler == NULL ) || ( pxAzureProvClient == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_Add failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxScheduler->_internal.ulEntryCount == pxScheduler->_internal.ulEntryCapacity )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_Add failed: all %u entries are used",
+                      ( uint16_t ) pxScheduler->_internal.ulEntryCapacity ) );
+        return eAzureIoTErrorOutOfMemory;
+    }
+
+    pxEntry = &pxScheduler->_internal.pxEntries[ pxScheduler->_internal.ulEntryCount++ ];
+    pxEntry->_internal.pxScheduler = pxScheduler;
+    pxEntry->_internal.pxAzureProvClient = pxAzureProvClient;
+    pxEntry->_internal.ulState = azureiotprovisioningschedulerENTRY_QUEUED;
+    pxEntry->_internal.xResult = eAzureIoTErrorPending;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningScheduler_Process( AzureIoTProvisioningScheduler_t * pxScheduler )
+{
+    AzureIoTProvisioningSchedulerEntry_t * pxEntry;
+    uint32_t ulWaitMilliseconds;
+    uint32_t ulIndex;
+
+    if( pxScheduler == NULL )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_Process failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    /* Entries are started in the order they were added. */
+    while( ( pxScheduler->_internal.ulNextEntry < pxScheduler->_internal.ulEntryCount ) &&
+           ( pxScheduler->_internal.ulActiveCount < pxScheduler->_internal.ulMaxActive ) )
+    {
+        prvSchedulerStartEntry( pxScheduler, &pxScheduler->_internal.pxEntries[ pxScheduler->_internal.ulNextEntry++ ] );
+    }
+
+    for( ulIndex = 0; ulIndex < pxScheduler->_internal.ulNextEntry; ulIndex++ )
+    {
+        pxEntry = &pxScheduler->_internal.pxEntries[ ulIndex ];
+
+        if( ( pxEntry->_internal.ulState == azureiotprovisioningschedulerENTRY_ACTIVE ) &&
+            ( pxEntry->_internal.xDataPending ||
+              ( ( AzureIoTProvisioningClient_GetNextDeadline( pxEntry->_internal.pxAzureProvClient,
+                                                              &ulWaitMilliseconds ) == eAzureIoTSuccess ) &&
+                ( ulWaitMilliseconds == 0 ) ) ) )
+        {
+            pxEntry->_internal.xDataPending = false;
+
+            /* Completion is reported through prvSchedulerCompleteCallback. */
+            ( void ) AzureIoTProvisioningClient_ProcessLoop( pxEntry->_internal.pxAzureProvClient,
+                                                             azureiotprovisioningNO_WAIT );
+        }
+    }
+
+    return ( pxScheduler->_internal.ulCompleteCount == pxScheduler->_internal.ulEntryCount ) ?
+           eAzureIoTSuccess : eAzureIoTErrorPending;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningScheduler_NotifyData( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                           AzureIoTProvisioningClient_t * pxAzureProvClient )
+{
+    uint32_t ulIndex;
+
+    if( ( pxScheduler == NULL ) || ( pxAzureProvClient == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_NotifyData failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    for( ulIndex = 0; ulIndex < pxScheduler->_internal.ulNextEntry; ulIndex++ )
+    {
+        if( ( pxScheduler->_internal.pxEntries[ ulIndex ]._internal.pxAzureProvClient == pxAzureProvClient ) &&
+            ( pxScheduler->_internal.pxEntries[ ulIndex ]._internal.ulState == azureiotprovisioningschedulerENTRY_ACTIVE ) )
+        {
+            pxScheduler->_internal.pxEntries[ ulIndex ]._internal.xDataPending = true;
+            return eAzureIoTSuccess;
+        }
+    }
+
+    AZLogError( ( "AzureIoTProvisioningScheduler_NotifyData failed: client is not active" ) );
+
+    return eAzureIoTErrorItemNotFound;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTProvisioningScheduler_GetNextDeadline( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                                uint32_t * pulWaitMilliseconds )
+{
+    AzureIoTProvisioningSchedulerEntry_t * pxEntry;
+    uint32_t ulWaitMilliseconds;
+    uint32_t ulNextWaitMilliseconds = UINT32_MAX;
+    uint32_t ulIndex;
+
+    if( ( pxScheduler == NULL ) || ( pulWaitMilliseconds == NULL ) )
+    {
+        AZLogError( ( "AzureIoTProvisioningScheduler_GetNextDeadline failed: invalid argument" ) );
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    if( pxScheduler->_internal.ulCompleteCount == pxScheduler->_internal.ulEntryCount )
+    {
+        return eAzureIoTErrorFailed;
+    }
+
+    if( ( pxScheduler->_internal.ulNextEntry < pxScheduler->_internal.ulEntryCount ) &&
+        ( pxScheduler->_internal.ulActiveCount < pxScheduler->_internal.ulMaxActive ) )
+    {
+        /* A queued entry can be started now. */
+        *pulWaitMilliseconds = 0;
+        return eAzureIoTSuccess;
+    }
+
+    for( ulIndex = 0; ulIndex < pxScheduler->_internal.ulNextEntry; ulIndex++ )
+    {
+        pxEntry = &pxScheduler->_internal.pxEntries[ ulIndex ];
+
+        if( pxEntry->_internal.ulState != azureiotprovisioningschedulerENTRY_ACTIVE )
+        {
+            continue;
+        }
+
+        if( pxEntry->_internal.xDataPending )
+        {
+            ulNextWaitMilliseconds = 0;
+        }
+        else if( ( AzureIoTProvisioningClient_GetNextDeadline( pxEntry->_internal.pxAzureProvClient,
+                                                               &ulWaitMilliseconds ) == eAzureIoTSuccess ) &&
+                 ( ulWaitMilliseconds < ulNextWaitMilliseconds ) )
+        {
+            ulNextWaitMilliseconds = ulWaitMilliseconds;
+        }
+    }
+
+    *pulWaitMilliseconds = ulNextWaitMilliseconds;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
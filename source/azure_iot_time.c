@@ -0,0 +1,33 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_time.c
+ *
+ * @brief Millisecond clock shared by the hub client and its helpers.
+ *
+ */
+
+#include "azure_iot.h"
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "azure_iot_private.h"
+/*-----------------------------------------------------------*/
+
+uint32_t AzureIoT_GetTimeMs( void )
+{
+    TickType_t xTickCount;
+    uint32_t ulTimeMs;
+
+    /* Get the current tick count. */
+    xTickCount = xTaskGetTickCount();
+
+    /* Convert the ticks to milliseconds. */
+    ulTimeMs = ( uint32_t ) xTickCount * azureiotMILLISECONDS_PER_TICK;
+
+    return ulTimeMs;
+}
+/*-----------------------------------------------------------*/
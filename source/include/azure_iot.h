@@ -67,6 +67,27 @@ typedef uint32_t ( * AzureIoTGetHMACFunc_t )( const uint8_t * pucKey,
                                               uint32_t ulOutputLength,
                                               uint32_t * pulBytesCopied );
 
+/**
+ * @brief The HMAC256 function used by the SDK to generate SAS keys with a key prepared in advance.
+ *
+ * Unlike #AzureIoTGetHMACFunc_t, the key is not passed on each call. It is held in \p pvHMACContext,
+ * which lets the implementation decode the key and hash its padded blocks once for all the tokens.
+ *
+ * @param[in] pvHMACContext The context given with this function, holding the key.
+ * @param[in] pucData The data on which the operation will take place. In this context, the data
+ * will be a certain concatenation of the iot hub name, sas key, and expiration time.
+ * @param[in] ulDataLength The length of \p pucData.
+ * @param[in,out] pucOutput The buffer into which the processed data will be placed.
+ * @param[in] ulOutputLength The size of \p pucOutput.
+ * @param[out] pulBytesCopied The number of bytes copied into \p pucOutput.
+ */
+typedef uint32_t ( * AzureIoTGetHMACContextFunc_t )( void * pvHMACContext,
+                                                     const uint8_t * pucData,
+                                                     uint32_t ulDataLength,
+                                                     uint8_t * pucOutput,
+                                                     uint32_t ulOutputLength,
+                                                     uint32_t * pulBytesCopied );
+
 /**
  * @brief Initialize Azure IoT middleware.
  *
@@ -0,0 +1,173 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_adu_download.h
+ *
+ * @brief Streaming download of an ADU image into the flash platform.
+ *
+ * The image is fetched with sequential HTTP range requests of #azureiotconfigADU_DOWNLOAD_CHUNK_SIZE bytes and
+ * every chunk is handed to AzureIoTPlatform_WriteBlock() straight from the HTTP response buffer. Two response
+ * buffers are used in turn, so the block last given to AzureIoTPlatform_WriteBlock() stays untouched while the
+ * next chunk is received. A flash port that programs asynchronously can therefore overlap the write with the
+ * network receive.
+ *
+ * Only bytes written successfully are counted as committed. After a failure the download resumes from the last
+ * committed offset.
+ *
+ * Every committed chunk is also fed to an incremental SHA256, so the digest of the image is ready when the last
+ * block lands and AzureIoTADUDownload_VerifyImage() does not need to read the flash bank back.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+#ifndef AZURE_IOT_ADU_DOWNLOAD_H
+#define AZURE_IOT_ADU_DOWNLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_result.h"
+#include "azure_iot_adu_client.h"
+#include "azure_iot_crypto.h"
+#include "azure_iot_http.h"
+#include "azure_iot_flash_platform.h"
+
+/**
+ * @brief Options for the ADU image download.
+ */
+typedef struct AzureIoTADUDownloadOptions
+{
+    uint32_t ulChunkSize;  /**< Size of each range request. Defaults to #azureiotconfigADU_DOWNLOAD_CHUNK_SIZE. */
+    uint32_t ulMaxRetries; /**< Times a chunk is requested again before failing. Defaults to #azureiotconfigADU_DOWNLOAD_MAX_RETRIES. */
+} AzureIoTADUDownloadOptions_t;
+
+/**
+ * @brief ADU image download state.
+ */
+typedef struct AzureIoTADUDownload
+{
+    struct
+    {
+        AzureIoTHTTPHandle_t xHTTPHandle;
+        AzureIoTTransportInterface_t * pxHTTPTransport;
+        AzureADUImage_t * pxAduImage;
+        const char * pcHost;
+        uint32_t ulHostLength;
+        const char * pcPath;
+        uint32_t ulPathLength;
+        char * pcHeaderBuffer;
+        uint32_t ulHeaderBufferLength;
+        char * pcResponseBuffer[ 2 ];
+        uint32_t ulResponseBufferLength;
+        uint32_t ulActiveBuffer;
+        AzureIoTADUDownloadOptions_t xOptions;
+        uint32_t ulImageSize;
+        uint32_t ulCommittedOffset;
+        bool xStarted;
+        AzureIoTCryptoSHA256Context_t xSHA256Context;
+        bool xHashing;
+        bool xDigestReady;
+        uint8_t ucDigest[ azureiotcryptoSHA256_SIZE ];
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTADUDownload_t;
+
+/**
+ * @brief Initialize the ADU download options with default values.
+ *
+ * @param[out] pxOptions The #AzureIoTADUDownloadOptions_t instance to set with default values.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTADUDownload_OptionsInit( AzureIoTADUDownloadOptions_t * pxOptions );
+
+/**
+ * @brief Initialize the ADU image download.
+ *
+ * @param[out] pxDownload The #AzureIoTADUDownload_t * to initialize.
+ * @param[in] xHTTPHandle The HTTP handle used for the requests.
+ * @param[in] pxHTTPTransport The transport the HTTP requests are sent on. It must be connected to \p pcHost.
+ * @param[in] pxAduImage The #AzureADUImage_t the image is written to.
+ * @param[in] pcHost The host of the image URL.
+ * @param[in] ulHostLength The length of \p pcHost.
+ * @param[in] pcPath The path of the image URL.
+ * @param[in] ulPathLength The length of \p pcPath.
+ * @param[in] pcHeaderBuffer Buffer for the request headers.
+ * @param[in] ulHeaderBufferLength The length of \p pcHeaderBuffer.
+ * @param[in] pcResponseBuffer Buffer split in two halves, each holding the headers and body of one response.
+ * @param[in] ulResponseBufferLength The length of \p pcResponseBuffer. Each half must be bigger than the chunk size.
+ * @param[in] pxOptions The #AzureIoTADUDownloadOptions_t to use. Can be `NULL` for defaults.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTADUDownload_Init( AzureIoTADUDownload_t * pxDownload,
+                                           AzureIoTHTTPHandle_t xHTTPHandle,
+                                           AzureIoTTransportInterface_t * pxHTTPTransport,
+                                           AzureADUImage_t * pxAduImage,
+                                           const char * pcHost,
+                                           uint32_t ulHostLength,
+                                           const char * pcPath,
+                                           uint32_t ulPathLength,
+                                           char * pcHeaderBuffer,
+                                           uint32_t ulHeaderBufferLength,
+                                           char * pcResponseBuffer,
+                                           uint32_t ulResponseBufferLength,
+                                           AzureIoTADUDownloadOptions_t * pxOptions );
+
+/**
+ * @brief Request the image size and start the download.
+ *
+ * @param[in] pxDownload The #AzureIoTADUDownload_t * to use for this call.
+ * @param[in] ulResumeOffset Offset already committed to the image, for example by a previous boot. `0` to start over.
+ * When not `0`, the bytes before it were not hashed and AzureIoTADUDownload_VerifyImage() falls back to
+ * AzureIoTPlatform_VerifyImage().
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTADUDownload_Start( AzureIoTADUDownload_t * pxDownload,
+                                            uint32_t ulResumeOffset );
+
+/**
+ * @brief Download and write the next chunk of the image.
+ *
+ * Call this until AzureIoTADUDownload_IsComplete() returns `true`. A failed chunk is requested again up to
+ * the configured retries. If this call fails, reconnect the transport and call it again to resume from
+ * AzureIoTADUDownload_GetCommittedOffset().
+ *
+ * @param[in] pxDownload The #AzureIoTADUDownload_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTADUDownload_Process( AzureIoTADUDownload_t * pxDownload );
+
+/**
+ * @brief Verify the downloaded image against its manifest hash.
+ *
+ * Compares \p pxFileHash with the digest calculated while downloading. If the image was not hashed from its first
+ * byte, the check is delegated to AzureIoTPlatform_VerifyImage().
+ *
+ * @param[in] pxDownload The #AzureIoTADUDownload_t * to use for this call.
+ * @param[in] pxFileHash The base64 encoded SHA256 #AzureIoTADUUpdateManifestFileHash_t of the image.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTSuccess if the image matches the hash.
+ * @retval eAzureIoTErrorFailed if the image does not match the hash.
+ */
+AzureIoTResult_t AzureIoTADUDownload_VerifyImage( AzureIoTADUDownload_t * pxDownload,
+                                                  const AzureIoTADUUpdateManifestFileHash_t * pxFileHash );
+
+/**
+ * @brief Check if the whole image was written.
+ *
+ * @param[in] pxDownload The #AzureIoTADUDownload_t * to use for this call.
+ * @return `true` if every byte of the image was committed, `false` otherwise.
+ */
+bool AzureIoTADUDownload_IsComplete( AzureIoTADUDownload_t * pxDownload );
+
+/**
+ * @brief Get the number of bytes of the image written successfully.
+ *
+ * @param[in] pxDownload The #AzureIoTADUDownload_t * to use for this call.
+ * @return The committed offset.
+ */
+uint32_t AzureIoTADUDownload_GetCommittedOffset( AzureIoTADUDownload_t * pxDownload );
+
+#endif /* AZURE_IOT_ADU_DOWNLOAD_H */
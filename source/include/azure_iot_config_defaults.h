@@ -12,6 +12,47 @@
     #define azureiotconfigDEFAULT_TOKEN_TIMEOUT_IN_SEC    ( 60 * 60U )
 #endif
 
+/**
+ * @brief Time before the SAS token expires at which the hub client asks for a reconnect.
+ *
+ * @details See #AzureIoTHubClientOptions_t.xTokenRefreshCallback.
+ */
+#ifndef azureiotconfigTOKEN_REFRESH_MARGIN_SEC
+    #define azureiotconfigTOKEN_REFRESH_MARGIN_SEC    ( 5 * 60U )
+#endif
+
+/**
+ * @brief Max extra time, picked per device, added to #azureiotconfigTOKEN_REFRESH_MARGIN_SEC.
+ *
+ * @details Spreads the reconnects of devices whose tokens were generated at the same time.
+ */
+#ifndef azureiotconfigTOKEN_REFRESH_JITTER_SEC
+    #define azureiotconfigTOKEN_REFRESH_JITTER_SEC    ( 5 * 60U )
+#endif
+
+/**
+ * @brief Set to 1 to keep the decoded symmetric key and the SAS token in each #AzureIoTHubClient_t.
+ *
+ * @details AzureIoTHubClient_Connect() then reuses the SAS token until it is close to expiry, at the cost of
+ * #azureiotconfigSYMMETRIC_KEY_DECODED_MAX plus #azureiotconfigPASSWORD_MAX bytes per client. Set it to 0 to
+ * generate the token in the working buffer on every connect, from the key passed to
+ * AzureIoTHubClient_SetSymmetricKey() which must then outlive the client.
+ */
+#ifndef azureiotconfigUSE_SAS_TOKEN_CACHE
+    #define azureiotconfigUSE_SAS_TOKEN_CACHE    1
+#endif
+
+/**
+ * @brief Max size of the base64 decoded symmetric key cached by the hub client.
+ *
+ * @details Only used when #azureiotconfigUSE_SAS_TOKEN_CACHE is 1. IoT Hub keys decode to 32 or 64 bytes;
+ * a key longer than the 64 byte HMAC-SHA256 block would have to be hashed first, which the client cannot do
+ * with an #AzureIoTGetHMACFunc_t, so such keys are rejected rather than hashed.
+ */
+#ifndef azureiotconfigSYMMETRIC_KEY_DECODED_MAX
+    #define azureiotconfigSYMMETRIC_KEY_DECODED_MAX    ( 64U )
+#endif
+
 /**
  * @brief MQTT keep alive.
  *
@@ -28,6 +69,20 @@
     #define azureiotconfigCONNACK_RECV_TIMEOUT_MS    ( 1000U )
 #endif
 
+/**
+ * @brief Default delay of the reconnect manager before the first attempt after a failure.
+ */
+#ifndef azureiotconfigRECONNECT_BACKOFF_BASE_MS
+    #define azureiotconfigRECONNECT_BACKOFF_BASE_MS    ( 1000U )
+#endif
+
+/**
+ * @brief Default upper bound of the delay of the reconnect manager between attempts.
+ */
+#ifndef azureiotconfigRECONNECT_BACKOFF_MAX_MS
+    #define azureiotconfigRECONNECT_BACKOFF_MAX_MS    ( 2 * 60 * 1000U )
+#endif
+
 /**
  * @brief Wait timeout of MQTT SUBACK.
  */
@@ -35,6 +90,72 @@
     #define azureiotconfigSUBACK_WAIT_INTERVAL_MS    ( 10U )
 #endif
 
+/**
+ * @brief Max QoS 1 telemetry messages tracked while waiting for their PUBACK.
+ *
+ * @details This is the size of the in-flight window used by AzureIoTHubClient_SendTelemetryWithCookie().
+ */
+#ifndef azureiotconfigTELEMETRY_INFLIGHT_MAX
+    #define azureiotconfigTELEMETRY_INFLIGHT_MAX    ( 4U )
+#endif
+
+/**
+ * @brief Wait timeout of MQTT PUBACK for telemetry tracked in the in-flight window.
+ */
+#ifndef azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS
+    #define azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS    ( 30 * 1000U )
+#endif
+
+/**
+ * @brief Set to 1 to keep runtime statistics in each #AzureIoTHubClient_t.
+ *
+ * @details They are read with AzureIoTHubClient_GetStatistics(). Leave it to 0 to save the
+ * memory and the cycles spent counting.
+ */
+#ifndef azureiotconfigUSE_HUB_CLIENT_STATISTICS
+    #define azureiotconfigUSE_HUB_CLIENT_STATISTICS    0
+#endif
+
+/**
+ * @brief Number of buckets of the PUBACK round trip histogram of the hub client statistics.
+ *
+ * @details Each bucket doubles the latency range, the default covers up to 16 seconds.
+ */
+#ifndef azureiotconfigSTATISTICS_PUBACK_HISTOGRAM_BUCKETS
+    #define azureiotconfigSTATISTICS_PUBACK_HISTOGRAM_BUCKETS    ( 16U )
+#endif
+
+/**
+ * @brief Max payload of a message queued with the send queue.
+ */
+#ifndef azureiotconfigSEND_QUEUE_PAYLOAD_MAX
+    #define azureiotconfigSEND_QUEUE_PAYLOAD_MAX    ( 256U )
+#endif
+
+/**
+ * @brief Max size of the command request ID copied by the send queue.
+ */
+#ifndef azureiotconfigSEND_QUEUE_REQUEST_ID_MAX
+    #define azureiotconfigSEND_QUEUE_REQUEST_ID_MAX    ( 32U )
+#endif
+
+/**
+ * @brief Number of producers the send queue keeps counters for.
+ */
+#ifndef azureiotconfigSEND_QUEUE_PRODUCER_MAX
+    #define azureiotconfigSEND_QUEUE_PRODUCER_MAX    ( 4U )
+#endif
+
+/**
+ * @brief Max size of the telemetry topic prefix cached by the hub client.
+ *
+ * @details The prefix is `devices/{deviceId}/messages/events/` (or `devices/{deviceId}/modules/{moduleId}/messages/events/`).
+ * When it does not fit, telemetry topics are generated in full for every message.
+ */
+#ifndef azureiotconfigTELEMETRY_TOPIC_PREFIX_MAX
+    #define azureiotconfigTELEMETRY_TOPIC_PREFIX_MAX    ( 128U )
+#endif
+
 /**
  * @brief Max MQTT username.
  */
@@ -74,6 +195,126 @@
     #define azureiotconfigPROVISIONING_POLLING_INTERVAL_S    ( 3U )
 #endif
 
+/**
+ * @brief Wait timeout of the provisioning client for the SUBACK or the response to a request.
+ *
+ * @details When it expires the registration fails instead of waiting on a connection that is gone.
+ */
+#ifndef azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS
+    #define azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS    ( 30 * 1000U )
+#endif
+
+/**
+ * @brief Max operation ID of a provisioning response kept by the provisioning client.
+ */
+#ifndef azureiotconfigPROVISIONING_OPERATION_ID_MAX
+    #define azureiotconfigPROVISIONING_OPERATION_ID_MAX    ( 96U )
+#endif
+
+/**
+ * @brief Max assigned IoT Hub hostname kept by the provisioning client.
+ */
+#ifndef azureiotconfigPROVISIONING_HUB_HOSTNAME_MAX
+    #define azureiotconfigPROVISIONING_HUB_HOSTNAME_MAX    ( 128U )
+#endif
+
+/**
+ * @brief Max assigned device ID kept by the provisioning client.
+ */
+#ifndef azureiotconfigPROVISIONING_DEVICE_ID_MAX
+    #define azureiotconfigPROVISIONING_DEVICE_ID_MAX    ( 128U )
+#endif
+
+/**
+ * @brief Max IoT Hub hostname kept by the provisioning cache.
+ */
+#ifndef azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX
+    #define azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX    azureiotconfigPROVISIONING_HUB_HOSTNAME_MAX
+#endif
+
+/**
+ * @brief Max device ID kept by the provisioning cache.
+ */
+#ifndef azureiotconfigPROVISIONING_CACHE_DEVICE_ID_MAX
+    #define azureiotconfigPROVISIONING_CACHE_DEVICE_ID_MAX    azureiotconfigPROVISIONING_DEVICE_ID_MAX
+#endif
+
+/**
+ * @brief Size of the range requested for each chunk of an ADU image download.
+ */
+#ifndef azureiotconfigADU_DOWNLOAD_CHUNK_SIZE
+    #define azureiotconfigADU_DOWNLOAD_CHUNK_SIZE    ( 4096U )
+#endif
+
+/**
+ * @brief Number of times a failed chunk of an ADU image download is requested again before giving up.
+ */
+#ifndef azureiotconfigADU_DOWNLOAD_MAX_RETRIES
+    #define azureiotconfigADU_DOWNLOAD_MAX_RETRIES    ( 3U )
+#endif
+
+/**
+ * @brief Set to 1 to map the AZLog macros not defined by the application to the deferred logging
+ * backend of azure_iot_log.h.
+ *
+ * @details Messages are then stored as binary records in a RAM ring buffer instead of being formatted,
+ * and decoded on the host. The backend, and its #azureiotconfigDEFERRED_LOG_BUFFER_SIZE ring, is only
+ * compiled in when this is 1.
+ */
+#ifndef azureiotconfigUSE_DEFERRED_LOGGING
+    #define azureiotconfigUSE_DEFERRED_LOGGING    0
+#endif
+
+/**
+ * @brief Size of the ring buffer of the deferred logging backend.
+ */
+#ifndef azureiotconfigDEFERRED_LOG_BUFFER_SIZE
+    #define azureiotconfigDEFERRED_LOG_BUFFER_SIZE    ( 2048U )
+#endif
+
+/**
+ * @brief Max size of one deferred log record. Arguments past it are dropped.
+ *
+ * @details The record is built on the stack of the logging task.
+ */
+#ifndef azureiotconfigDEFERRED_LOG_RECORD_MAX
+    #define azureiotconfigDEFERRED_LOG_RECORD_MAX    ( 128U )
+#endif
+
+/**
+ * @brief Max bytes of a string argument kept in a deferred log record.
+ */
+#ifndef azureiotconfigDEFERRED_LOG_STRING_MAX
+    #define azureiotconfigDEFERRED_LOG_STRING_MAX    ( 32U )
+#endif
+
+#if ( azureiotconfigUSE_DEFERRED_LOGGING == 1 )
+    extern void AzureIoTLog_DeferredError( const char * pcFormat,
+                                           ... );
+    extern void AzureIoTLog_DeferredWarn( const char * pcFormat,
+                                          ... );
+    extern void AzureIoTLog_DeferredInfo( const char * pcFormat,
+                                          ... );
+    extern void AzureIoTLog_DeferredDebug( const char * pcFormat,
+                                           ... );
+
+    #ifndef AZLogError
+        #define AZLogError( message )    AzureIoTLog_DeferredError message
+    #endif
+
+    #ifndef AZLogWarn
+        #define AZLogWarn( message )    AzureIoTLog_DeferredWarn message
+    #endif
+
+    #ifndef AZLogInfo
+        #define AZLogInfo( message )    AzureIoTLog_DeferredInfo message
+    #endif
+
+    #ifndef AZLogDebug
+        #define AZLogDebug( message )    AzureIoTLog_DeferredDebug message
+    #endif
+#endif /* azureiotconfigUSE_DEFERRED_LOGGING */
+
 /**
  * @brief Macro that is called in the Azure IoT middleware library for logging "Error" level
  * messages.
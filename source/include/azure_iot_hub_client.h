@@ -172,6 +172,18 @@ typedef void ( * AzureIoTHubClientCommandCallback_t ) ( AzureIoTHubClientCommand
 typedef void ( * AzureIoTHubClientPropertiesCallback_t ) ( AzureIoTHubClientPropertiesResponse_t * pxMessage,
                                                            void * pvContext );
 
+/**
+ * @brief Callback to be invoked when a subscribe started with AzureIoTHubClient_SubscribeAll() completes.
+ *
+ * It is invoked from the call to AzureIoTHubClient_ProcessLoop() which received the SUBACK.
+ *
+ * @param[in] xResult The #AzureIoTResult_t with the result of the subscribe: eAzureIoTErrorSubscribeFailed if
+ * IoT Hub rejected any of the topics. The features whose topics were rejected are left unsubscribed.
+ * @param[in] pvContext The context passed back to the caller.
+ */
+typedef void ( * AzureIoTHubClientSubscribeCompleteCallback_t ) ( AzureIoTResult_t xResult,
+                                                                  void * pvContext );
+
 /**
  * @brief Receive context to be used internally for the processing of messages.
  *
@@ -205,6 +217,93 @@ typedef struct AzureIoTHubClientReceiveContext
  */
 typedef void (* AzureIoTTelemetryAckCallback_t)( uint16_t ulTelemetryPacketID );
 
+/**
+ * @brief Callback to send notification that a telemetry message sent with AzureIoTHubClient_SendTelemetryWithCookie()
+ * left the in-flight window.
+ *
+ * @param[in] xResult eAzureIoTSuccess if the PUBACK was received, eAzureIoTErrorPubackWaitTimeout if it did not
+ * arrive within `azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS`, or eAzureIoTErrorFailed if the connection the message
+ * was sent on ended first, with AzureIoTHubClient_Disconnect() or AzureIoTHubClient_Connect().
+ * @param[in] usTelemetryPacketID The packet id for the telemetry message.
+ * @param[in] pvCookie The cookie passed to AzureIoTHubClient_SendTelemetryWithCookie().
+ * @param[in] ulAckLatencyMilliseconds The time in milliseconds between sending the message and this notification.
+ */
+typedef void ( * AzureIoTHubClientTelemetryAckCallback_t )( AzureIoTResult_t xResult,
+                                                            uint16_t usTelemetryPacketID,
+                                                            void * pvCookie,
+                                                            uint32_t ulAckLatencyMilliseconds );
+
+/**
+ * @brief Callback to be invoked when the SAS token of the connection is about to expire.
+ *
+ * It is invoked once per token from AzureIoTHubClient_ProcessLoop(), #azureiotconfigTOKEN_REFRESH_MARGIN_SEC
+ * plus a per device jitter of up to #azureiotconfigTOKEN_REFRESH_JITTER_SEC before the expiry. The application
+ * should call AzureIoTHubClient_Disconnect(), reconnect the transport and call AzureIoTHubClient_Connect(),
+ * which generates a fresh token. It must not do so from within the callback.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * whose token is expiring.
+ * @param[in] pvContext The context passed back to the caller.
+ */
+typedef void ( * AzureIoTHubClientTokenRefreshCallback_t )( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                            void * pvContext );
+
+/**
+ * @brief Outstanding QoS 1 telemetry message to be used internally by the in-flight window.
+ *
+ * @warning Used internally.
+ */
+typedef struct AzureIoTHubClientTelemetryInFlight
+{
+    struct
+    {
+        uint16_t usPacketID;
+        uint32_t ulSendTimeMs;
+        void * pvCookie;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientTelemetryInFlight_t;
+
+#if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+
+/**
+ * @brief Traffic counters of one hub client feature.
+ */
+typedef struct AzureIoTHubClientFeatureStatistics
+{
+    uint32_t ulMessagesSent;     /**< Messages published. */
+    uint32_t ulBytesSent;        /**< Payload bytes published. */
+    uint32_t ulMessagesReceived; /**< Messages received. */
+    uint32_t ulBytesReceived;    /**< Payload bytes received. */
+} AzureIoTHubClientFeatureStatistics_t;
+
+/**
+ * @brief Runtime statistics of a hub client, read with AzureIoTHubClient_GetStatistics().
+ *
+ * Only available when #azureiotconfigUSE_HUB_CLIENT_STATISTICS is set to `1`.
+ */
+typedef struct AzureIoTHubClientStatistics
+{
+    AzureIoTHubClientFeatureStatistics_t xTelemetry;     /**< Telemetry sent. */
+    AzureIoTHubClientFeatureStatistics_t xCloudToDevice; /**< Cloud to device messages received. */
+    AzureIoTHubClientFeatureStatistics_t xCommands;      /**< Command requests received and responses sent. */
+    AzureIoTHubClientFeatureStatistics_t xProperties;    /**< Property messages received, and requests and reported properties sent. */
+    uint32_t ulPublishFailures;                          /**< Publishes which failed to be sent. */
+    uint32_t ulUnmatchedTopics;                          /**< Received messages no subscribed feature could handle. */
+    uint32_t ulPubackTimeouts;                           /**< Telemetry sent with AzureIoTHubClient_SendTelemetryWithCookie() whose PUBACK timed out. */
+
+    /**
+     * PUBACK round trip of telemetry sent with AzureIoTHubClient_SendTelemetryWithCookie(). Bucket `0` counts
+     * round trips under 1 millisecond and bucket `n` those from `2^(n-1)` up to `2^n` milliseconds. The last
+     * bucket also counts anything longer.
+     */
+    uint32_t ulPubackLatencyHistogram[ azureiotconfigSTATISTICS_PUBACK_HISTOGRAM_BUCKETS ];
+
+    uint32_t ulCallbackCount;     /**< Received packets handled, including the callbacks invoked for them. */
+    uint32_t ulCallbackTimeMs;    /**< Total time (in milliseconds) spent handling received packets. */
+    uint32_t ulCallbackMaxTimeMs; /**< Longest time (in milliseconds) spent handling one received packet. */
+} AzureIoTHubClientStatistics_t;
+
+#endif /* azureiotconfigUSE_HUB_CLIENT_STATISTICS */
+
 /**
  * @brief Options list for the hub client.
  */
@@ -225,6 +324,14 @@ typedef struct AzureIoTHubClientOptions
 
     AzureIoTTelemetryAckCallback_t xTelemetryCallback; /**< The callback to invoke to notify user a puback was received for QOS 1.
                                                         *   Can be NULL if user does not want to be notified.*/
+
+    AzureIoTHubClientTelemetryAckCallback_t xTelemetryAckCallback; /**< The callback to invoke when a message sent with
+                                                                    *   AzureIoTHubClient_SendTelemetryWithCookie() is acked or times out.
+                                                                    *   Can be NULL if user does not want to be notified.*/
+
+    AzureIoTHubClientTokenRefreshCallback_t xTokenRefreshCallback; /**< The callback to invoke when the SAS token is about to expire.
+                                                                    *   Can be NULL if user does not want to be notified.*/
+    void * pvTokenRefreshCallbackContext;                          /**< The context passed to \p xTokenRefreshCallback. */
 } AzureIoTHubClientOptions_t;
 
 /**
@@ -241,12 +348,27 @@ struct AzureIoTHubClient
         uint32_t ulWorkingBufferLength;
         az_iot_hub_client xAzureIoTHubClientCore;
 
+        uint8_t ucTelemetryTopicPrefix[ azureiotconfigTELEMETRY_TOPIC_PREFIX_MAX ];
+        uint16_t usTelemetryTopicPrefixLength;
+
         const uint8_t * pucHostname;
         uint16_t ulHostnameLength;
         const uint8_t * pucDeviceID;
         uint16_t ulDeviceIDLength;
-        const uint8_t * pucSymmetricKey;
-        uint32_t ulSymmetricKeyLength;
+        #if ( azureiotconfigUSE_SAS_TOKEN_CACHE == 1 )
+            uint8_t ucDecodedSymmetricKey[ azureiotconfigSYMMETRIC_KEY_DECODED_MAX ];
+            uint32_t ulDecodedSymmetricKeyLength;
+            uint8_t ucSASToken[ azureiotconfigPASSWORD_MAX ];
+        #else
+            const uint8_t * pucSymmetricKey;
+            uint32_t ulSymmetricKeyLength;
+        #endif
+        uint32_t ulSASTokenLength;
+        uint64_t ullSASTokenExpiryTimeSecs;
+        uint32_t ulTokenRefreshMarginSecs;
+        bool xTokenRefreshNotified;
+        AzureIoTHubClientTokenRefreshCallback_t xTokenRefreshCallback;
+        void * pvTokenRefreshCallbackContext;
 
         uint32_t ( * pxTokenRefresh )( AzureIoTHubClient_t * pxAzureIoTHubClient,
                                        uint64_t ullExpiryTimeSecs,
@@ -256,12 +378,28 @@ struct AzureIoTHubClient
                                        uint32_t ulSasBufferLen,
                                        uint32_t * pulSaSLength );
         AzureIoTGetHMACFunc_t xHMACFunction;
+        AzureIoTGetHMACContextFunc_t xHMACContextFunction;
+        void * pvHMACContext;
         AzureIoTGetCurrentTimeFunc_t xTimeFunction;
         AzureIoTTelemetryAckCallback_t xTelemetryCallback;
+        AzureIoTHubClientTelemetryAckCallback_t xTelemetryAckCallback;
 
         uint32_t ulCurrentPropertyRequestID;
 
         AzureIoTHubClientReceiveContext_t xReceiveContext[ azureiothubSUBSCRIBE_FEATURE_COUNT ];
+
+        uint16_t usSubscribeAllPacketID;
+        AzureIoTHubClientSubscribeCompleteCallback_t xSubscribeCompleteCallback;
+        void * pvSubscribeCompleteCallbackContext;
+
+        AzureIoTHubClientTelemetryInFlight_t xTelemetryInFlight[ azureiotconfigTELEMETRY_INFLIGHT_MAX ];
+
+        bool xConnected;
+        uint32_t ulKeepAliveTimeMs;
+
+        #if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+            AzureIoTHubClientStatistics_t xStatistics;
+        #endif
     }
     _internal; /**< @brief Internal to the SDK */
 };
@@ -317,17 +455,45 @@ void AzureIoTHubClient_Deinit( AzureIoTHubClient_t * pxAzureIoTHubClient );
  *
  * @note If using X509 authentication, this is not needed and should not be used.
  *
+ * With #azureiotconfigUSE_SAS_TOKEN_CACHE set to 1, the key is base64 decoded once here and kept by the client, so
+ * \p pucSymmetricKey does not need to outlive this call, and the SAS token generated from it is reused by
+ * AzureIoTHubClient_Connect() until it is close to expiry. The decoded key must then fit in
+ * #azureiotconfigSYMMETRIC_KEY_DECODED_MAX bytes; longer keys are not hashed down as RFC 2104 allows, they are
+ * rejected. With #azureiotconfigUSE_SAS_TOKEN_CACHE set to 0, \p pucSymmetricKey must outlive the client and
+ * the token is generated on every connect.
+ *
  * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
  * @param[in] pucSymmetricKey The symmetric key to use for the connection.
  * @param[in] ulSymmetricKeyLength The length of the \p pucSymmetricKey.
  * @param[in] xHMACFunction The #AzureIoTGetHMACFunc_t function pointer to a function which computes the HMAC256 over a set of bytes.
+ *                          AzureIoTCrypto_HMACSHA256Calculate() of the crypto port can be used.
  * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the SAS token is cached and the decoded key is bigger than
+ * #azureiotconfigSYMMETRIC_KEY_DECODED_MAX.
  */
 AzureIoTResult_t AzureIoTHubClient_SetSymmetricKey( AzureIoTHubClient_t * pxAzureIoTHubClient,
                                                     const uint8_t * pucSymmetricKey,
                                                     uint32_t ulSymmetricKeyLength,
                                                     AzureIoTGetHMACFunc_t xHMACFunction );
 
+/**
+ * @brief Set the symmetric key as an HMAC context prepared in advance.
+ *
+ * Use this instead of AzureIoTHubClient_SetSymmetricKey() when the HMAC implementation can keep a key
+ * schedule, such as AzureIoTCrypto_HMACSHA256Sign() of the crypto port with an
+ * #AzureIoTCryptoHMACSHA256Context_t. Each SAS token then only hashes the token signature, which matters
+ * to gateways refreshing the tokens of many device identities.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[in] xHMACContextFunction The #AzureIoTGetHMACContextFunc_t function pointer to a function which computes
+ *                                 the HMAC256 over a set of bytes with the key held by \p pvHMACContext.
+ * @param[in] pvHMACContext The context passed to \p xHMACContextFunction. It must outlive the client.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClient_SetSymmetricKeyContext( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                           AzureIoTGetHMACContextFunc_t xHMACContextFunction,
+                                                           void * pvHMACContext );
+
 /**
  * @brief Connect via MQTT to the IoT Hub endpoint.
  *
@@ -372,11 +538,64 @@ AzureIoTResult_t AzureIoTHubClient_SendTelemetry( AzureIoTHubClient_t * pxAzureI
                                                   AzureIoTHubMessageQoS_t xQOS,
                                                   uint16_t * pusTelemetryPacketID );
 
+/**
+ * @brief Send telemetry data to IoT Hub, building the topic in a caller-owned buffer.
+ *
+ * The constant `devices/{deviceId}/messages/events/` prefix is computed once in AzureIoTHubClient_Init(),
+ * so only the property suffix is appended per message. Since the shared working buffer is not used,
+ * sends from different tasks do not overwrite each other's topic as long as each uses its own \p pucTopicBuffer.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[in] pucTelemetryData The pointer to the buffer of telemetry data.
+ * @param[in] ulTelemetryDataLength The length of the buffer to send as telemetry.
+ * @param[in] pxProperties The property bag to send with the message. Can be `NULL`.
+ * @param[in] xQOS The QOS to use for the telemetry. Only QOS `0` and `1` are supported.
+ * @param[in] pucTopicBuffer Scratch buffer the topic is built in. It must stay valid until the publish is sent.
+ * @param[in] ulTopicBufferLength The length of \p pucTopicBuffer.
+ * @param[out] pusTelemetryPacketID The packet id for the sent telemetry. Can be `NULL`.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the topic does not fit in \p pucTopicBuffer.
+ */
+AzureIoTResult_t AzureIoTHubClient_SendTelemetryWithTopicBuffer( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                                 const uint8_t * pucTelemetryData,
+                                                                 uint32_t ulTelemetryDataLength,
+                                                                 AzureIoTMessageProperties_t * pxProperties,
+                                                                 AzureIoTHubMessageQoS_t xQOS,
+                                                                 uint8_t * pucTopicBuffer,
+                                                                 uint32_t ulTopicBufferLength,
+                                                                 uint16_t * pusTelemetryPacketID );
+
+/**
+ * @brief Send QoS 1 telemetry data to IoT Hub and track it in the in-flight window until its PUBACK arrives.
+ *
+ * Up to `azureiotconfigTELEMETRY_INFLIGHT_MAX` messages may be outstanding at once, so telemetry can be
+ * pipelined instead of waiting for each PUBACK. The #AzureIoTHubClientOptions_t `xTelemetryAckCallback`
+ * is invoked from AzureIoTHubClient_ProcessLoop() with \p pvCookie once the PUBACK arrives, or once
+ * `azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS` has passed without it. The messages still in the window when the
+ * client disconnects or connects again are reported as failed right away, freeing the window for the new connection.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[in] pucTelemetryData The pointer to the buffer of telemetry data.
+ * @param[in] ulTelemetryDataLength The length of the buffer to send as telemetry.
+ * @param[in] pxProperties The property bag to send with the message.
+ * @param[in] pvCookie A user pointer handed back to the ack callback for this message.
+ * @param[out] pusTelemetryPacketID __[nullable]__ Pointer to a uint16_t which will be populated with the packet ID.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorBusy if the in-flight window is full.
+ */
+AzureIoTResult_t AzureIoTHubClient_SendTelemetryWithCookie( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                            const uint8_t * pucTelemetryData,
+                                                            uint32_t ulTelemetryDataLength,
+                                                            AzureIoTMessageProperties_t * pxProperties,
+                                                            void * pvCookie,
+                                                            uint16_t * pusTelemetryPacketID );
+
 /**
  * @brief Receive any incoming MQTT messages from and manage the MQTT connection to IoT Hub.
  *
  * @note This API will receive any messages sent to the device and manage the connection such as sending
- * `PING` messages.
+ * `PING` messages. It also invokes #AzureIoTHubClientOptions_t.xTokenRefreshCallback when the SAS token is
+ * about to expire.
  *
  * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
  * @param[in] ulTimeoutMilliseconds Minimum time (in milliseconds) for the loop to run. If `0` is passed, it will only run once.
@@ -385,6 +604,39 @@ AzureIoTResult_t AzureIoTHubClient_SendTelemetry( AzureIoTHubClient_t * pxAzureI
 AzureIoTResult_t AzureIoTHubClient_ProcessLoop( AzureIoTHubClient_t * pxAzureIoTHubClient,
                                                 uint32_t ulTimeoutMilliseconds );
 
+/**
+ * @brief Get the time left until the hub client next needs AzureIoTHubClient_ProcessLoop() to be called.
+ *
+ * The deadline is the earliest of the MQTT keep-alive `PING`, counted from the last packet the client sent,
+ * the PUBACK timeout of telemetry sent with AzureIoTHubClient_SendTelemetryWithCookie() and the notification
+ * of #AzureIoTHubClientOptions_t.xTokenRefreshCallback. Until then, the application only has to wake up when
+ * the transport has data, and can let FreeRTOS enter tickless idle in between.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[out] pulWaitMilliseconds The time (in milliseconds) left until the deadline. `0` if it has passed, and
+ * `UINT32_MAX` if the client is not connected and has nothing pending.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClient_GetNextDeadline( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                    uint32_t * pulWaitMilliseconds );
+
+#if ( azureiotconfigUSE_HUB_CLIENT_STATISTICS == 1 )
+
+/**
+ * @brief Get a copy of the runtime statistics of the hub client.
+ *
+ * Only available when #azureiotconfigUSE_HUB_CLIENT_STATISTICS is set to `1`. The counters start at zero on
+ * AzureIoTHubClient_Init() and wrap around.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[out] pxStatistics The #AzureIoTHubClientStatistics_t to copy the statistics into.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClient_GetStatistics( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                  AzureIoTHubClientStatistics_t * pxStatistics );
+
+#endif /* azureiotconfigUSE_HUB_CLIENT_STATISTICS */
+
 /**
  * @brief Subscribe to cloud to device messages.
  *
@@ -399,6 +651,39 @@ AzureIoTResult_t AzureIoTHubClient_SubscribeCloudToDeviceMessage( AzureIoTHubCli
                                                                   void * prvCallbackContext,
                                                                   uint32_t ulTimeoutMilliseconds );
 
+/**
+ * @brief Subscribe to cloud to device messages, commands and properties with a single SUBSCRIBE packet.
+ *
+ * Unlike the per-feature subscribe functions this does not wait for the SUBACK. It returns as soon
+ * as the SUBSCRIBE has been sent, and \p xSubscribeCompleteCallback is invoked from
+ * AzureIoTHubClient_ProcessLoop() once the SUBACK for it arrives. Only one such subscribe may be pending
+ * at a time; a new connection discards the pending one.
+ *
+ * @note Any feature callback may be NULL, in which case that feature is not subscribed. At least one
+ * feature callback must be set.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to use for this call.
+ * @param[in] xCloudToDeviceMessageCallback __[nullable]__ The #AzureIoTHubClientCloudToDeviceMessageCallback_t to invoke when CloudToDevice messages arrive.
+ * @param[in] pvCloudToDeviceMessageCallbackContext A pointer to a context to pass to \p xCloudToDeviceMessageCallback.
+ * @param[in] xCommandCallback __[nullable]__ The #AzureIoTHubClientCommandCallback_t to invoke when command messages arrive.
+ * @param[in] pvCommandCallbackContext A pointer to a context to pass to \p xCommandCallback.
+ * @param[in] xPropertiesCallback __[nullable]__ The #AzureIoTHubClientPropertiesCallback_t to invoke when device property messages arrive.
+ * @param[in] pvPropertiesCallbackContext A pointer to a context to pass to \p xPropertiesCallback.
+ * @param[in] xSubscribeCompleteCallback __[nullable]__ The #AzureIoTHubClientSubscribeCompleteCallback_t to invoke when the SUBACK arrives.
+ * @param[in] pvSubscribeCompleteCallbackContext A pointer to a context to pass to \p xSubscribeCompleteCallback.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorBusy if the SUBACK of a previous call has not arrived yet.
+ */
+AzureIoTResult_t AzureIoTHubClient_SubscribeAll( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                 AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback,
+                                                 void * pvCloudToDeviceMessageCallbackContext,
+                                                 AzureIoTHubClientCommandCallback_t xCommandCallback,
+                                                 void * pvCommandCallbackContext,
+                                                 AzureIoTHubClientPropertiesCallback_t xPropertiesCallback,
+                                                 void * pvPropertiesCallbackContext,
+                                                 AzureIoTHubClientSubscribeCompleteCallback_t xSubscribeCompleteCallback,
+                                                 void * pvSubscribeCompleteCallbackContext );
+
 /**
  * @brief Unsubscribe from cloud to device messages.
  *
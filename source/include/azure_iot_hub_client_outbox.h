@@ -0,0 +1,162 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_outbox.h
+ *
+ * @brief The middleware IoT Hub Client store-and-forward telemetry outbox.
+ *
+ * Telemetry is written to an #AzureIoTOutboxStorage_t ring (see azure_iot_outbox_storage.h) and sent
+ * with QoS 1 while the client is connected. A record only leaves the ring once its PUBACK is received,
+ * so telemetry produced while the link is down, or lost with it, is sent after the next connect.
+ *
+ * Delivery is at-least-once. A record whose PUBACK times out, or is lost with the connection, is sent
+ * again even if the hub already received it, so the cloud side must tolerate duplicates. Records already
+ * acknowledged are never sent again.
+ *
+ * The outbox does not hook into the client by itself. The application sets
+ * AzureIoTHubClientOutbox_TelemetryAckCallback() as the telemetry ack callback of the client, and calls
+ * AzureIoTHubClientOutbox_Resume() after every successful AzureIoTHubClient_Connect().
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_HUB_CLIENT_OUTBOX_H
+#define AZURE_IOT_HUB_CLIENT_OUTBOX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_hub_client.h"
+#include "azure_iot_outbox_storage.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Options for the telemetry outbox.
+ */
+typedef struct AzureIoTHubClientOutboxOptions
+{
+    uint32_t ulDrainMaxMessages;          /**< Max messages sent per drain interval. `0` for no limit. */
+    uint32_t ulDrainIntervalMilliseconds; /**< Length of the drain interval. */
+} AzureIoTHubClientOutboxOptions_t;
+
+/**
+ * @brief Store-and-forward telemetry outbox bound to an #AzureIoTHubClient_t.
+ */
+typedef struct AzureIoTHubClientOutbox
+{
+    struct
+    {
+        AzureIoTHubClient_t * pxAzureIoTHubClient;
+        AzureIoTOutboxStorage_t * pxStorage;
+        AzureIoTHubClientOutboxOptions_t xOptions;
+        uint8_t * pucScratchBuffer;
+        uint32_t ulScratchBufferLength;
+        uint32_t ulSlotCount;
+        uint32_t ulHead;
+        uint32_t ulTail;
+        uint32_t ulSendIndex;
+        uint16_t usInFlightPacketID[ azureiotconfigTELEMETRY_INFLIGHT_MAX ];
+        bool xInFlightAcked[ azureiotconfigTELEMETRY_INFLIGHT_MAX ];
+        uint32_t ulInFlightCount;
+        bool xDraining;
+        uint32_t ulDrainWindowStartMs;
+        uint32_t ulDrainWindowCount;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientOutbox_t;
+
+/**
+ * @brief Initialize the outbox options with default values.
+ *
+ * @param[out] pxOptions The #AzureIoTHubClientOutboxOptions_t instance to set with default values.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientOutbox_OptionsInit( AzureIoTHubClientOutboxOptions_t * pxOptions );
+
+/**
+ * @brief Initialize the outbox.
+ *
+ * Records left in \p pxStorage by a previous run are kept and sent once draining starts.
+ *
+ * @note The outbox is notified of PUBACKs through AzureIoTHubClientOutbox_TelemetryAckCallback(). Set it as the
+ * `xTelemetryAckCallback` option of the hub client, or call it from your own callback when `pvCookie`
+ * is \p pxOutbox.
+ *
+ * @param[out] pxOutbox The #AzureIoTHubClientOutbox_t * to initialize.
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * used to send the telemetry.
+ * @param[in] pxStorage The initialized #AzureIoTOutboxStorage_t holding the ring. It must have at least two slots.
+ * @param[in] pxOptions The #AzureIoTHubClientOutboxOptions_t to use. Can be `NULL` for defaults.
+ * @param[in] pucScratchBuffer Buffer a record is read into before it is sent.
+ * @param[in] ulScratchBufferLength The length of \p pucScratchBuffer. It must hold a full slot.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientOutbox_Init( AzureIoTHubClientOutbox_t * pxOutbox,
+                                               AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                               AzureIoTOutboxStorage_t * pxStorage,
+                                               AzureIoTHubClientOutboxOptions_t * pxOptions,
+                                               uint8_t * pucScratchBuffer,
+                                               uint32_t ulScratchBufferLength );
+
+/**
+ * @brief Store a telemetry message in the outbox.
+ *
+ * @param[in] pxOutbox The #AzureIoTHubClientOutbox_t * to use for this call.
+ * @param[in] pucTelemetryData The pointer to the buffer of telemetry data.
+ * @param[in] ulTelemetryDataLength The length of the buffer to store.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the outbox is full or the message is bigger than a slot.
+ */
+AzureIoTResult_t AzureIoTHubClientOutbox_Enqueue( AzureIoTHubClientOutbox_t * pxOutbox,
+                                                  const uint8_t * pucTelemetryData,
+                                                  uint32_t ulTelemetryDataLength );
+
+/**
+ * @brief Start draining the outbox.
+ *
+ * Call this after every successful AzureIoTHubClient_Connect(). Every record not yet acknowledged is sent
+ * again, as its PUBACK cannot arrive on the new connection.
+ *
+ * @param[in] pxOutbox The #AzureIoTHubClientOutbox_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientOutbox_Resume( AzureIoTHubClientOutbox_t * pxOutbox );
+
+/**
+ * @brief Send pending records, within the in-flight window and the drain rate.
+ *
+ * Call this periodically, for example next to AzureIoTHubClient_ProcessLoop(). If a send fails, draining
+ * stops until AzureIoTHubClientOutbox_Resume() is called again.
+ *
+ * @param[in] pxOutbox The #AzureIoTHubClientOutbox_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientOutbox_Process( AzureIoTHubClientOutbox_t * pxOutbox );
+
+/**
+ * @brief Telemetry ack callback advancing the outbox tail.
+ *
+ * Matches #AzureIoTHubClientTelemetryAckCallback_t. \p pvCookie must be the #AzureIoTHubClientOutbox_t.
+ * A PUBACK timeout makes only that record be sent again.
+ */
+void AzureIoTHubClientOutbox_TelemetryAckCallback( AzureIoTResult_t xResult,
+                                                   uint16_t usTelemetryPacketID,
+                                                   void * pvCookie,
+                                                   uint32_t ulAckLatencyMilliseconds );
+
+/**
+ * @brief Get the number of records not yet acknowledged by the hub.
+ *
+ * @param[in] pxOutbox The #AzureIoTHubClientOutbox_t * to use for this call.
+ * @return The number of pending records.
+ */
+uint32_t AzureIoTHubClientOutbox_GetPendingCount( AzureIoTHubClientOutbox_t * pxOutbox );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_HUB_CLIENT_OUTBOX_H */
@@ -0,0 +1,198 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_reconnect.h
+ *
+ * @brief Keeps an #AzureIoTHubClient_t connected to IoT Hub.
+ *
+ * AzureIoTHubClientReconnect_Process() runs AzureIoTHubClient_ProcessLoop() while the client is connected.
+ * When the loop fails, the transport is closed and the connection is attempted again after a jittered
+ * exponential backoff, so devices losing the hub at the same time do not all come back at the same time.
+ * The connection uses a persistent session: when the hub reports the session as present the subscriptions
+ * are still in place and only the ones never acknowledged are sent again; otherwise the subscriptions set
+ * with AzureIoTHubClientReconnect_SetSubscriptions() are replayed with AzureIoTHubClient_SubscribeAll().
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_HUB_CLIENT_RECONNECT_H
+#define AZURE_IOT_HUB_CLIENT_RECONNECT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_hub_client.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Function opening or closing the transport of the hub client.
+ *
+ * The transport is the one given to AzureIoTHubClient_Init().
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * whose transport is opened or closed.
+ * @param[in] pvContext The context passed to AzureIoTHubClientReconnect_Init().
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+typedef AzureIoTResult_t ( * AzureIoTHubClientReconnectTransportFunc_t )( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                                          void * pvContext );
+
+/**
+ * @brief Callback invoked when the connection to IoT Hub is established or lost.
+ *
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * whose connection changed.
+ * @param[in] xConnected `true` once connected, `false` once the connection is lost.
+ * @param[in] pvContext The context passed to AzureIoTHubClientReconnect_Init().
+ */
+typedef void ( * AzureIoTHubClientReconnectConnectionCallback_t )( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                                   bool xConnected,
+                                                                   void * pvContext );
+
+/**
+ * @brief Options for the reconnect manager.
+ */
+typedef struct AzureIoTHubClientReconnectOptions
+{
+    uint32_t ulBackoffBaseMilliseconds;    /**< Delay before the first attempt after a failure. */
+    uint32_t ulBackoffMaxMilliseconds;     /**< Upper bound of the delay between attempts. */
+    uint32_t ulConnectTimeoutMilliseconds; /**< The maximum time to wait for a CONNACK. */
+} AzureIoTHubClientReconnectOptions_t;
+
+/**
+ * @brief Reconnect manager bound to an #AzureIoTHubClient_t.
+ */
+typedef struct AzureIoTHubClientReconnect
+{
+    struct
+    {
+        AzureIoTHubClient_t * pxAzureIoTHubClient;
+        AzureIoTHubClientReconnectOptions_t xOptions;
+        AzureIoTHubClientReconnectTransportFunc_t xOpenTransport;
+        AzureIoTHubClientReconnectTransportFunc_t xCloseTransport;
+        AzureIoTHubClientReconnectConnectionCallback_t xConnectionCallback;
+        void * pvContext;
+
+        bool xConnected;
+        bool xSubscribed;
+        uint32_t ulAttemptCount;
+        uint32_t ulNextAttemptTimeMs;
+        uint32_t ulJitterState;
+
+        AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback;
+        void * pvCloudToDeviceMessageCallbackContext;
+        AzureIoTHubClientCommandCallback_t xCommandCallback;
+        void * pvCommandCallbackContext;
+        AzureIoTHubClientPropertiesCallback_t xPropertiesCallback;
+        void * pvPropertiesCallbackContext;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientReconnect_t;
+
+/**
+ * @brief Initialize the reconnect options with default values.
+ *
+ * @param[out] pxOptions The #AzureIoTHubClientReconnectOptions_t instance to set with default values.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_OptionsInit( AzureIoTHubClientReconnectOptions_t * pxOptions );
+
+/**
+ * @brief Initialize the reconnect manager.
+ *
+ * The hub client must be initialized and have its credentials set. It is connected by the first
+ * call to AzureIoTHubClientReconnect_Process().
+ *
+ * @param[out] pxReconnect The #AzureIoTHubClientReconnect_t * to initialize.
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * to keep connected.
+ * @param[in] pxOptions The #AzureIoTHubClientReconnectOptions_t to use. Can be `NULL` for defaults.
+ * @param[in] xOpenTransport The #AzureIoTHubClientReconnectTransportFunc_t connecting the transport before each attempt.
+ * @param[in] xCloseTransport The #AzureIoTHubClientReconnectTransportFunc_t closing the transport once the connection is lost.
+ * @param[in] xConnectionCallback __[nullable]__ The #AzureIoTHubClientReconnectConnectionCallback_t to invoke when the connection changes.
+ * @param[in] pvContext The context passed back to the transport functions and to \p xConnectionCallback.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_Init( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                  AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                  AzureIoTHubClientReconnectOptions_t * pxOptions,
+                                                  AzureIoTHubClientReconnectTransportFunc_t xOpenTransport,
+                                                  AzureIoTHubClientReconnectTransportFunc_t xCloseTransport,
+                                                  AzureIoTHubClientReconnectConnectionCallback_t xConnectionCallback,
+                                                  void * pvContext );
+
+/**
+ * @brief Set the features to subscribe to on every connection.
+ *
+ * The callbacks are the ones of AzureIoTHubClient_SubscribeAll(). If the client is connected, the
+ * subscription is sent right away.
+ *
+ * @param[in] pxReconnect The #AzureIoTHubClientReconnect_t * to use for this call.
+ * @param[in] xCloudToDeviceMessageCallback __[nullable]__ The #AzureIoTHubClientCloudToDeviceMessageCallback_t to invoke when CloudToDevice messages arrive.
+ * @param[in] pvCloudToDeviceMessageCallbackContext A pointer to a context to pass to \p xCloudToDeviceMessageCallback.
+ * @param[in] xCommandCallback __[nullable]__ The #AzureIoTHubClientCommandCallback_t to invoke when command messages arrive.
+ * @param[in] pvCommandCallbackContext A pointer to a context to pass to \p xCommandCallback.
+ * @param[in] xPropertiesCallback __[nullable]__ The #AzureIoTHubClientPropertiesCallback_t to invoke when device property messages arrive.
+ * @param[in] pvPropertiesCallbackContext A pointer to a context to pass to \p xPropertiesCallback.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_SetSubscriptions( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                              AzureIoTHubClientCloudToDeviceMessageCallback_t xCloudToDeviceMessageCallback,
+                                                              void * pvCloudToDeviceMessageCallbackContext,
+                                                              AzureIoTHubClientCommandCallback_t xCommandCallback,
+                                                              void * pvCommandCallbackContext,
+                                                              AzureIoTHubClientPropertiesCallback_t xPropertiesCallback,
+                                                              void * pvPropertiesCallbackContext );
+
+/**
+ * @brief Process the connection: run the MQTT loop while connected, or reconnect once the backoff delay elapsed.
+ *
+ * This call does not wait for the backoff delay, it returns right away until the delay elapsed.
+ *
+ * @param[in] pxReconnect The #AzureIoTHubClientReconnect_t * to use for this call.
+ * @param[in] ulTimeoutMilliseconds Passed to AzureIoTHubClient_ProcessLoop() while connected.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTSuccess if the client is connected.
+ * @retval eAzureIoTErrorPending if the client is not connected and a new attempt is scheduled.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_Process( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                     uint32_t ulTimeoutMilliseconds );
+
+/**
+ * @brief Drop the connection and connect again on the next call to AzureIoTHubClientReconnect_Process(), without backoff.
+ *
+ * Use it from the application task, for example after #AzureIoTHubClientOptions_t.xTokenRefreshCallback
+ * was invoked, to connect with a fresh SAS token.
+ *
+ * @param[in] pxReconnect The #AzureIoTHubClientReconnect_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_Reconnect( AzureIoTHubClientReconnect_t * pxReconnect );
+
+/**
+ * @brief Get the time left until AzureIoTHubClientReconnect_Process() next needs to be called.
+ *
+ * While connected it is the deadline given by AzureIoTHubClient_GetNextDeadline(), otherwise the time of the
+ * next connection attempt.
+ *
+ * @param[in] pxReconnect The #AzureIoTHubClientReconnect_t * to use for this call.
+ * @param[out] pulWaitMilliseconds The time (in milliseconds) left until the deadline. `0` if it has passed.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientReconnect_GetNextDeadline( AzureIoTHubClientReconnect_t * pxReconnect,
+                                                             uint32_t * pulWaitMilliseconds );
+
+/**
+ * @brief Whether the hub client is connected.
+ *
+ * @param[in] pxReconnect The #AzureIoTHubClientReconnect_t * to use for this call.
+ * @return `true` if connected.
+ */
+bool AzureIoTHubClientReconnect_IsConnected( AzureIoTHubClientReconnect_t * pxReconnect );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_HUB_CLIENT_RECONNECT_H */
@@ -0,0 +1,171 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_send_queue.h
+ *
+ * @brief Lets several tasks send through one #AzureIoTHubClient_t.
+ *
+ * The hub client is not thread safe: it shares one working buffer between every message it sends. With the
+ * send queue, producer tasks copy telemetry, command responses and reported properties into a bounded
+ * multi-producer single-consumer ring, and the task running AzureIoTHubClient_ProcessLoop() publishes them with
+ * AzureIoTHubClientSendQueue_Drain(). The ring only uses the FreeRTOS atomic operations of atomic.h, which are
+ * short critical sections on most ports: producers never block on the network or on a mutex, but each atomic
+ * operation briefly masks interrupts.
+ *
+ * A producer passes its ID, below #azureiotconfigSEND_QUEUE_PRODUCER_MAX, to every enqueue. The queue counts
+ * the messages accepted and rejected for each one, so a producer outrunning the hub can be spotted.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_HUB_CLIENT_SEND_QUEUE_H
+#define AZURE_IOT_HUB_CLIENT_SEND_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_hub_client.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Slot of the send queue, holding a copy of one message.
+ */
+typedef struct AzureIoTHubClientSendQueueItem
+{
+    struct
+    {
+        volatile uint32_t ulSequence;
+        uint32_t ulType;
+        AzureIoTHubMessageQoS_t xQOS;
+        uint32_t ulStatus;
+        uint16_t usRequestIDLength;
+        uint8_t ucRequestID[ azureiotconfigSEND_QUEUE_REQUEST_ID_MAX ];
+        uint32_t ulPayloadLength;
+        uint8_t ucPayload[ azureiotconfigSEND_QUEUE_PAYLOAD_MAX ];
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientSendQueueItem_t;
+
+/**
+ * @brief Multi-producer send queue bound to an #AzureIoTHubClient_t.
+ */
+typedef struct AzureIoTHubClientSendQueue
+{
+    struct
+    {
+        AzureIoTHubClient_t * pxAzureIoTHubClient;
+        AzureIoTHubClientSendQueueItem_t * pxItems;
+        uint32_t ulMask;
+        volatile uint32_t ulEnqueuePosition;
+        uint32_t ulDequeuePosition;
+        volatile uint32_t ulAccepted[ azureiotconfigSEND_QUEUE_PRODUCER_MAX ];
+        volatile uint32_t ulRejected[ azureiotconfigSEND_QUEUE_PRODUCER_MAX ];
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientSendQueue_t;
+
+/**
+ * @brief Initialize the send queue.
+ *
+ * @param[out] pxSendQueue The #AzureIoTHubClientSendQueue_t * to initialize.
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * the messages are sent with.
+ * @param[in] pxItems Array of #AzureIoTHubClientSendQueueItem_t holding the queued messages.
+ * @param[in] ulItemCount The number of items in \p pxItems. It must be a power of two.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_Init( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                  AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                  AzureIoTHubClientSendQueueItem_t * pxItems,
+                                                  uint32_t ulItemCount );
+
+/**
+ * @brief Queue telemetry to be sent with AzureIoTHubClient_SendTelemetry(). Can be called from any task.
+ *
+ * @param[in] pxSendQueue The #AzureIoTHubClientSendQueue_t * to use for this call.
+ * @param[in] ulProducerID The ID of the calling producer, below #azureiotconfigSEND_QUEUE_PRODUCER_MAX.
+ * @param[in] pucTelemetryData The pointer to the telemetry data. It is copied.
+ * @param[in] ulTelemetryDataLength The length of the telemetry data, up to #azureiotconfigSEND_QUEUE_PAYLOAD_MAX.
+ * @param[in] xQOS The QOS to use for the telemetry.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the queue is full.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueueTelemetry( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                              uint32_t ulProducerID,
+                                                              const uint8_t * pucTelemetryData,
+                                                              uint32_t ulTelemetryDataLength,
+                                                              AzureIoTHubMessageQoS_t xQOS );
+
+/**
+ * @brief Queue a command response to be sent with AzureIoTHubClient_SendCommandResponse(). Can be called from any task.
+ *
+ * @param[in] pxSendQueue The #AzureIoTHubClientSendQueue_t * to use for this call.
+ * @param[in] ulProducerID The ID of the calling producer, below #azureiotconfigSEND_QUEUE_PRODUCER_MAX.
+ * @param[in] pxMessage The #AzureIoTHubClientCommandRequest_t being answered. Its request ID is copied.
+ * @param[in] ulStatus A code that indicates the result of the command, as defined by the user.
+ * @param[in] pucCommandPayload __[nullable]__ An optional command response payload. It is copied.
+ * @param[in] ulCommandPayloadLength The length of the command response payload, up to #azureiotconfigSEND_QUEUE_PAYLOAD_MAX.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the queue is full.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueueCommandResponse( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                    uint32_t ulProducerID,
+                                                                    const AzureIoTHubClientCommandRequest_t * pxMessage,
+                                                                    uint32_t ulStatus,
+                                                                    const uint8_t * pucCommandPayload,
+                                                                    uint32_t ulCommandPayloadLength );
+
+/**
+ * @brief Queue reported properties to be sent with AzureIoTHubClient_SendPropertiesReported(). Can be called from any task.
+ *
+ * @param[in] pxSendQueue The #AzureIoTHubClientSendQueue_t * to use for this call.
+ * @param[in] ulProducerID The ID of the calling producer, below #azureiotconfigSEND_QUEUE_PRODUCER_MAX.
+ * @param[in] pucReportedPayload The reported properties payload. It is copied.
+ * @param[in] ulReportedPayloadLength The length of the payload, up to #azureiotconfigSEND_QUEUE_PAYLOAD_MAX.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the queue is full.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_EnqueuePropertiesReported( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                       uint32_t ulProducerID,
+                                                                       const uint8_t * pucReportedPayload,
+                                                                       uint32_t ulReportedPayloadLength );
+
+/**
+ * @brief Send the queued messages, oldest first.
+ *
+ * Must only be called from the task calling AzureIoTHubClient_ProcessLoop(). If the MQTT publish fails, the message
+ * is kept at the head of the queue and sent again by the next call. A message failing for any other reason, such as
+ * reported properties sent before the properties are subscribed or a topic not fitting the working buffer of the
+ * hub client, is dropped and the error is returned once the rest of the queue is sent.
+ *
+ * Telemetry is sent with AzureIoTHubClient_SendTelemetry(), so QoS 1 telemetry is not tracked by the in-flight
+ * window of AzureIoTHubClient_SendTelemetryWithCookie().
+ *
+ * @param[in] pxSendQueue The #AzureIoTHubClientSendQueue_t * to use for this call.
+ * @param[in] ulMaxItems The maximum number of messages to send. `0` for no limit.
+ * @return An #AzureIoTResult_t with the result of the operation, or the error of the last failed send.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_Drain( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                   uint32_t ulMaxItems );
+
+/**
+ * @brief Get the number of messages a producer got accepted and rejected because the queue was full.
+ *
+ * @param[in] pxSendQueue The #AzureIoTHubClientSendQueue_t * to use for this call.
+ * @param[in] ulProducerID The ID of the producer.
+ * @param[out] pulAccepted __[nullable]__ The number of messages queued.
+ * @param[out] pulRejected __[nullable]__ The number of messages rejected.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientSendQueue_GetProducerCounters( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                                                 uint32_t ulProducerID,
+                                                                 uint32_t * pulAccepted,
+                                                                 uint32_t * pulRejected );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_HUB_CLIENT_SEND_QUEUE_H */
@@ -0,0 +1,159 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_telemetry_batch.h
+ *
+ * @brief The middleware IoT Hub Client telemetry batcher, coalescing many small telemetry records into one PUBLISH.
+ *
+ * Records are appended to a JSON array built with an #AzureIoTJSONWriter_t in a caller provided arena:
+ *
+ * @code
+ * [{"temperature":21.5},{"temperature":21.6}]
+ * @endcode
+ *
+ * The array is sent with AzureIoTHubClient_SendTelemetry() when one of the size, record count or age
+ * thresholds is reached, or when AzureIoTHubClientTelemetryBatch_Flush() is called.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_HUB_CLIENT_TELEMETRY_BATCH_H
+#define AZURE_IOT_HUB_CLIENT_TELEMETRY_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_hub_client.h"
+#include "azure_iot_json_writer.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Options for the telemetry batcher.
+ */
+typedef struct AzureIoTHubClientTelemetryBatchOptions
+{
+    uint32_t ulMaxBytes;                        /**< Flush once the JSON array reaches this many bytes. `0` uses the whole arena. */
+    uint32_t ulMaxRecords;                      /**< Flush once this many records are batched. `0` for no limit. */
+    uint32_t ulMaxAgeMilliseconds;              /**< Flush once the oldest record is this old. `0` for no limit. */
+    AzureIoTHubMessageQoS_t xQOS;               /**< The QOS used to publish each batch. */
+    AzureIoTMessageProperties_t * pxProperties; /**< The property bag sent with each batch. Can be `NULL`. */
+} AzureIoTHubClientTelemetryBatchOptions_t;
+
+/**
+ * @brief Metrics collected by the telemetry batcher.
+ */
+typedef struct AzureIoTHubClientTelemetryBatchMetrics
+{
+    uint32_t ulRecordsAppended;       /**< Number of records appended. */
+    uint32_t ulRecordsPublished;      /**< Number of records sent in a batch. */
+    uint32_t ulPublishCount;          /**< Number of PUBLISH packets sent. */
+    uint32_t ulCompressionRatioX100;  /**< Records per PUBLISH, multiplied by 100. */
+    uint32_t ulLastFlushLatencyMs;    /**< Age of the oldest record of the last batch when it was sent. */
+    uint32_t ulMaxFlushLatencyMs;     /**< Largest value of `ulLastFlushLatencyMs` seen. */
+    uint64_t ullRecordBytes;          /**< Sum of the length of the records published. */
+    uint64_t ullPublishedBytes;       /**< Sum of the payload length of the PUBLISH packets sent. */
+} AzureIoTHubClientTelemetryBatchMetrics_t;
+
+/**
+ * @brief Telemetry batcher bound to an #AzureIoTHubClient_t.
+ */
+typedef struct AzureIoTHubClientTelemetryBatch
+{
+    struct
+    {
+        AzureIoTHubClient_t * pxAzureIoTHubClient;
+        AzureIoTHubClientTelemetryBatchOptions_t xOptions;
+        AzureIoTJSONWriter_t xJSONWriter;
+        uint8_t * pucArena;
+        uint32_t ulArenaLength;
+        uint32_t ulRecordCount;
+        uint32_t ulRecordBytes;
+        uint32_t ulFirstRecordTimeMs;
+        AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTHubClientTelemetryBatch_t;
+
+/**
+ * @brief Initialize the telemetry batcher options with default values.
+ *
+ * @param[out] pxOptions The #AzureIoTHubClientTelemetryBatchOptions_t instance to set with default values.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_OptionsInit( AzureIoTHubClientTelemetryBatchOptions_t * pxOptions );
+
+/**
+ * @brief Initialize the telemetry batcher.
+ *
+ * @param[out] pxBatch The #AzureIoTHubClientTelemetryBatch_t * to initialize.
+ * @param[in] pxAzureIoTHubClient The #AzureIoTHubClient_t * used to send the batches.
+ * @param[in] pxOptions The #AzureIoTHubClientTelemetryBatchOptions_t to use. Can be `NULL` for defaults.
+ * @param[in] pucArena The buffer the JSON array is built in. It must stay valid while the batcher is in use.
+ * @param[in] ulArenaLength The length of \p pucArena.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Init( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                       AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                                       AzureIoTHubClientTelemetryBatchOptions_t * pxOptions,
+                                                       uint8_t * pucArena,
+                                                       uint32_t ulArenaLength );
+
+/**
+ * @brief Append a JSON record to the batch.
+ *
+ * If the record does not fit in the arena, the pending batch is sent first. The batch is then sent if
+ * any of the thresholds in #AzureIoTHubClientTelemetryBatchOptions_t is reached.
+ *
+ * @param[in] pxBatch The #AzureIoTHubClientTelemetryBatch_t * to use for this call.
+ * @param[in] pucRecord The JSON text of the record, usually an object.
+ * @param[in] ulRecordLength The length of \p pucRecord.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the record does not fit in an empty arena.
+ * @retval eAzureIoTErrorPublishFailed if the pending batch had to be sent to make room and failed.
+ * \p pucRecord was not added and the batched records are kept.
+ * @retval eAzureIoTErrorPending if \p pucRecord was added but sending the batch on a threshold failed.
+ * The records are kept and will be sent with the next flush, so do not append \p pucRecord again.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_AppendRecord( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                               const uint8_t * pucRecord,
+                                                               uint32_t ulRecordLength );
+
+/**
+ * @brief Send the batch if its oldest record reached `ulMaxAgeMilliseconds`.
+ *
+ * @note Call this periodically, for example next to AzureIoTHubClient_ProcessLoop(), so quiet
+ * periods do not hold records back.
+ *
+ * @param[in] pxBatch The #AzureIoTHubClientTelemetryBatch_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Process( AzureIoTHubClientTelemetryBatch_t * pxBatch );
+
+/**
+ * @brief Send the pending records now.
+ *
+ * @param[in] pxBatch The #AzureIoTHubClientTelemetryBatch_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTSuccess if the records were sent or there was nothing to send.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_Flush( AzureIoTHubClientTelemetryBatch_t * pxBatch );
+
+/**
+ * @brief Get the metrics of the batcher.
+ *
+ * @param[in] pxBatch The #AzureIoTHubClientTelemetryBatch_t * to use for this call.
+ * @param[out] pxMetrics The #AzureIoTHubClientTelemetryBatchMetrics_t to fill.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTHubClientTelemetryBatch_GetMetrics( AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                                                             AzureIoTHubClientTelemetryBatchMetrics_t * pxMetrics );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_HUB_CLIENT_TELEMETRY_BATCH_H */
@@ -0,0 +1,108 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_log.h
+ *
+ * @brief Deferred logging backend for the AZLog macros.
+ *
+ * When #azureiotconfigUSE_DEFERRED_LOGGING is set to `1`, the AZLog macros which the application did not
+ * map itself write a compact binary record into a RAM ring buffer instead of formatting the message. A record
+ * holds the address of the format string and the raw arguments, so logging a publish costs a few copies
+ * rather than a `printf`. A low priority task drains the ring with AzureIoTLog_DeferredRead() to a UART,
+ * flash or the network, and `tools/azure_iot_log_decode.py` turns the records back into text on the host,
+ * reading the format strings from the firmware ELF file.
+ *
+ * Each record, in the byte order of the device, is:
+ *  - `uint16_t` length of the whole record,
+ *  - `uint8_t` level, one of the azureiotlogLEVEL_ values,
+ *  - `uint8_t` flags, #azureiotlogFLAG_TRUNCATED if arguments did not fit in the record,
+ *  - `uint32_t` tick count when the message was logged,
+ *  - the address of the format string, of pointer size,
+ *  - the arguments, each with the size of its promoted C type. A `*` width or precision is an `int`, and
+ *    strings are a `uint16_t` length followed by up to #azureiotconfigDEFERRED_LOG_STRING_MAX bytes.
+ *
+ * @note The logging functions use a critical section and must not be called from an interrupt.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_LOG_H
+#define AZURE_IOT_LOG_H
+
+#include <stdint.h>
+
+#include "azure_iot.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Levels of the deferred log records.
+ */
+#define azureiotlogLEVEL_ERROR       ( 1 )
+#define azureiotlogLEVEL_WARN        ( 2 )
+#define azureiotlogLEVEL_INFO        ( 3 )
+#define azureiotlogLEVEL_DEBUG       ( 4 )
+
+/**
+ * @brief Record flag set when arguments were dropped because the record was full.
+ */
+#define azureiotlogFLAG_TRUNCATED    ( 0x1 )
+
+/**
+ * @brief Log an "Error" level message to the ring buffer.
+ *
+ * @param[in] pcFormat The format string. It must stay at the same address, like a string literal.
+ */
+void AzureIoTLog_DeferredError( const char * pcFormat,
+                                ... );
+
+/**
+ * @brief Log a "Warning" level message to the ring buffer.
+ *
+ * @param[in] pcFormat The format string. It must stay at the same address, like a string literal.
+ */
+void AzureIoTLog_DeferredWarn( const char * pcFormat,
+                               ... );
+
+/**
+ * @brief Log an "Info" level message to the ring buffer.
+ *
+ * @param[in] pcFormat The format string. It must stay at the same address, like a string literal.
+ */
+void AzureIoTLog_DeferredInfo( const char * pcFormat,
+                               ... );
+
+/**
+ * @brief Log a "Debug" level message to the ring buffer.
+ *
+ * @param[in] pcFormat The format string. It must stay at the same address, like a string literal.
+ */
+void AzureIoTLog_DeferredDebug( const char * pcFormat,
+                                ... );
+
+/**
+ * @brief Move whole records out of the ring buffer, oldest first.
+ *
+ * @param[out] pucBuffer The buffer to copy the records into.
+ * @param[in] ulBufferLength The length of \p pucBuffer.
+ * @return The number of bytes copied. `0` if the ring is empty or the oldest record does not fit in \p pucBuffer.
+ */
+uint32_t AzureIoTLog_DeferredRead( uint8_t * pucBuffer,
+                                   uint32_t ulBufferLength );
+
+/**
+ * @brief Get the number of records dropped because the ring buffer was full.
+ *
+ * @return The number of records dropped since boot.
+ */
+uint32_t AzureIoTLog_DeferredGetDropped( void );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_LOG_H */
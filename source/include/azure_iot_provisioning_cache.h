@@ -0,0 +1,138 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_cache.h
+ *
+ * @brief Persistent cache of the IoT Hub assignment returned by the Device Provisioning Service.
+ *
+ * After a successful AzureIoTProvisioningClient_Register(), store the result of
+ * AzureIoTProvisioningClient_GetDeviceAndHub() with AzureIoTProvisioningCache_Store(). On the next boot,
+ * AzureIoTProvisioningCache_GetDeviceAndHub() returns it so the device connects straight to the hub.
+ * When the hub then refuses the MQTT connection, call AzureIoTProvisioningCache_Invalidate() and provision again.
+ *
+ * The assignment is kept in an #AzureIoTProvisioningStorage_t (see azure_iot_provisioning_storage.h), along
+ * with a hash of the endpoint, ID scope and registration ID it was provisioned for. A record made for another
+ * registration, for example after the device is moved to another ID scope, is dropped when it is loaded.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_PROVISIONING_CACHE_H
+#define AZURE_IOT_PROVISIONING_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot.h"
+#include "azure_iot_result.h"
+#include "azure_iot_provisioning_storage.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+/**
+ * @brief Size of a cache record: a version byte, an eight byte hash of the registration, then the hostname
+ * and the device ID, each after a two byte length.
+ */
+#define azureiotprovisioningcacheRECORD_MAX \
+    ( 1U + 8U + 2U + azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX + 2U + azureiotconfigPROVISIONING_CACHE_DEVICE_ID_MAX )
+
+/**
+ * @brief Provisioning cache bound to an #AzureIoTProvisioningStorage_t.
+ */
+typedef struct AzureIoTProvisioningCache
+{
+    struct
+    {
+        AzureIoTProvisioningStorage_t * pxStorage;
+        uint8_t ucRecord[ azureiotprovisioningcacheRECORD_MAX ];
+        uint32_t ulHostnameLength;
+        uint32_t ulDeviceIDLength;
+        uint64_t ullIdentityHash;
+        bool xValid;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTProvisioningCache_t;
+
+/**
+ * @brief Initialize the cache and load the assignment kept in \p pxStorage, if any.
+ *
+ * The registration is the one passed to AzureIoTProvisioningClient_Init(). A record that cannot be parsed,
+ * or that was stored for another registration, is erased. A record that cannot be read is kept.
+ *
+ * @param[out] pxCache The #AzureIoTProvisioningCache_t * to initialize.
+ * @param[in] pxStorage The initialized #AzureIoTProvisioningStorage_t holding the record.
+ * @param[in] pucEndpoint The endpoint of the Device Provisioning Service.
+ * @param[in] ulEndpointLength The length of \p pucEndpoint.
+ * @param[in] pucIDScope The ID scope of the Device Provisioning Service.
+ * @param[in] ulIDScopeLength The length of \p pucIDScope.
+ * @param[in] pucRegistrationID The registration ID of the device.
+ * @param[in] ulRegistrationIDLength The length of \p pucRegistrationID.
+ * @return An #AzureIoTResult_t with the result of the operation. Errors of AzureIoTProvisioningStorage_Read(),
+ * other than eAzureIoTErrorItemNotFound, are returned as they are. The cache is then usable but holds no
+ * assignment, and the stored record is left as it is.
+ */
+AzureIoTResult_t AzureIoTProvisioningCache_Init( AzureIoTProvisioningCache_t * pxCache,
+                                                 AzureIoTProvisioningStorage_t * pxStorage,
+                                                 const uint8_t * pucEndpoint,
+                                                 uint32_t ulEndpointLength,
+                                                 const uint8_t * pucIDScope,
+                                                 uint32_t ulIDScopeLength,
+                                                 const uint8_t * pucRegistrationID,
+                                                 uint32_t ulRegistrationIDLength );
+
+/**
+ * @brief Get the cached IoT Hub hostname and device ID.
+ *
+ * The returned pointers stay valid until the next call to AzureIoTProvisioningCache_Store() or
+ * AzureIoTProvisioningCache_Invalidate().
+ *
+ * @param[in] pxCache The #AzureIoTProvisioningCache_t * to use for this call.
+ * @param[out] ppucHubHostname The pointer to the cached hostname.
+ * @param[out] pulHostnameLength The length of the hostname.
+ * @param[out] ppucDeviceID The pointer to the cached device ID.
+ * @param[out] pulDeviceIDLength The length of the device ID.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorItemNotFound if nothing is cached and the device must be provisioned.
+ */
+AzureIoTResult_t AzureIoTProvisioningCache_GetDeviceAndHub( AzureIoTProvisioningCache_t * pxCache,
+                                                            const uint8_t ** ppucHubHostname,
+                                                            uint32_t * pulHostnameLength,
+                                                            const uint8_t ** ppucDeviceID,
+                                                            uint32_t * pulDeviceIDLength );
+
+/**
+ * @brief Cache and persist the IoT Hub hostname and device ID of a successful registration.
+ *
+ * @param[in] pxCache The #AzureIoTProvisioningCache_t * to use for this call.
+ * @param[in] pucHubHostname The IoT Hub hostname returned by AzureIoTProvisioningClient_GetDeviceAndHub().
+ * @param[in] ulHostnameLength The length of \p pucHubHostname.
+ * @param[in] pucDeviceID The device ID returned by AzureIoTProvisioningClient_GetDeviceAndHub().
+ * @param[in] ulDeviceIDLength The length of \p pucDeviceID.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if the hostname or device ID is bigger than configured.
+ */
+AzureIoTResult_t AzureIoTProvisioningCache_Store( AzureIoTProvisioningCache_t * pxCache,
+                                                  const uint8_t * pucHubHostname,
+                                                  uint32_t ulHostnameLength,
+                                                  const uint8_t * pucDeviceID,
+                                                  uint32_t ulDeviceIDLength );
+
+/**
+ * @brief Forget the cached assignment, in memory and in storage.
+ *
+ * Call this when AzureIoTHubClient_Connect() fails on a transport that did connect to the cached hub, so that
+ * the next boot provisions the device again. Network failures should not invalidate the cache.
+ *
+ * @param[in] pxCache The #AzureIoTProvisioningCache_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTProvisioningCache_Invalidate( AzureIoTProvisioningCache_t * pxCache );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_PROVISIONING_CACHE_H */
@@ -15,6 +15,8 @@
 #ifndef AZURE_IOT_PROVISIONING_CLIENT_H
 #define AZURE_IOT_PROVISIONING_CLIENT_H
 
+#include <stdbool.h>
+
 #include "FreeRTOS.h"
 
 #include "azure_iot.h"
@@ -30,25 +32,81 @@
 
 /**
  * @brief The maximum size of the response buffer.
+ *
+ * @deprecated Responses are parsed in place from the MQTT receive buffer, so the client no longer keeps
+ * a response buffer of this size. Kept for applications sizing their own buffers with it.
  */
 #define azureiotprovisioningRESPONSE_MAX    ( azureiotconfigTOPIC_MAX + azureiotconfigPROVISIONING_REQUEST_PAYLOAD_MAX )
 
 #define azureiotprovisioningNO_WAIT         ( 0 )                       /**< @brief Do not wait on the function call */
 #define azureiotprovisioningWAIT_FOREVER    ( ( uint32_t ) 0xFFFFFFFF ) /**< @brief Wait as long as it takes to complete the operation (success or failure) */
 
+typedef struct AzureIoTProvisioningClient   AzureIoTProvisioningClient_t;
+
+/**
+ * @brief Steps of the registration reported to #AzureIoTProvisioningClientProgressCallback_t.
+ */
+typedef enum AzureIoTProvisioningClientProgress
+{
+    eAzureIoTProvisioningProgressConnecting = 0, /**< Connecting to the provisioning service. */
+    eAzureIoTProvisioningProgressSubscribing,    /**< Subscribing to the response topic. */
+    eAzureIoTProvisioningProgressRequesting,     /**< Registration or status query sent, waiting for the response. */
+    eAzureIoTProvisioningProgressWaiting         /**< Waiting for the retry-after time of the service before the next query. */
+} AzureIoTProvisioningClientProgress_t;
+
+/**
+ * @brief Callback invoked when an asynchronous registration moves to the next step.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * running the registration.
+ * @param[in] xProgress The #AzureIoTProvisioningClientProgress_t step the registration moved to.
+ * @param[in] pvContext The context passed to AzureIoTProvisioningClient_RegisterAsync().
+ */
+typedef void ( * AzureIoTProvisioningClientProgressCallback_t )( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                                 AzureIoTProvisioningClientProgress_t xProgress,
+                                                                 void * pvContext );
+
+/**
+ * @brief Callback invoked once when an asynchronous registration completes.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * running the registration.
+ * @param[in] xResult The result of the registration, as AzureIoTProvisioningClient_Register() would return it.
+ * @param[in] pvContext The context passed to AzureIoTProvisioningClient_RegisterAsync().
+ */
+typedef void ( * AzureIoTProvisioningClientCompleteCallback_t )( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                                 AzureIoTResult_t xResult,
+                                                                 void * pvContext );
+
+/**
+ * @brief Where the time of a registration went, in milliseconds of the FreeRTOS tick count.
+ *
+ * Each field adds up the time spent in the matching steps of the registration. Set with
+ * #AzureIoTProvisioningClientOptions_t.pxTiming and read once the registration completes.
+ */
+typedef struct AzureIoTProvisioningClientTiming
+{
+    uint32_t ulConnectMilliseconds;   /**< Connecting to the service (MQTT CONNECT and CONNACK). */
+    uint32_t ulSubscribeMilliseconds; /**< Subscribing to the response topic, until the SUBACK. */
+    uint32_t ulRequestMilliseconds;   /**< Sending the registration and status queries until their responses are handled. */
+    uint32_t ulWaitingMilliseconds;   /**< Waiting for the retry-after time of the service between queries. */
+    uint32_t ulTotalMilliseconds;     /**< From the start of the registration until it completes. */
+    uint32_t ulPollCount;             /**< Iterations of the workflow, each one running the MQTT loop once. */
+    uint32_t ulRetryCount;            /**< Status queries sent after the registration request. */
+} AzureIoTProvisioningClientTiming_t;
+
 /**
  * @brief The options for the Azure IoT Device Provisioning client.
  */
 typedef struct AzureIoTProvisioningClientOptions
 {
-    const uint8_t * pucUserAgent; /**< The user agent to use for this device. */
-    uint32_t ulUserAgentLength;   /**< The length of the user agent. */
+    const uint8_t * pucUserAgent;                  /**< The user agent to use for this device. */
+    uint32_t ulUserAgentLength;                    /**< The length of the user agent. */
+    AzureIoTProvisioningClientTiming_t * pxTiming; /**< Timing of the registration, filled while it runs. Can be `NULL`. */
 } AzureIoTProvisioningClientOptions_t;
 
 /**
  * @brief The Azure IoT Device Provisioning client
  */
-typedef struct AzureIoTProvisioningClient
+struct AzureIoTProvisioningClient
 {
     struct
     {
@@ -73,6 +131,8 @@ typedef struct AzureIoTProvisioningClient
                                        uint32_t ulSasBufferLen,
                                        uint32_t * pulSaSLength );
         AzureIoTGetHMACFunc_t xHMACFunction;
+        AzureIoTGetHMACContextFunc_t xHMACContextFunction;
+        void * pvHMACContext;
         AzureIoTGetCurrentTimeFunc_t xGetTimeFunction;
 
         az_iot_provisioning_client xProvisioningClientCore;
@@ -80,15 +140,34 @@ typedef struct AzureIoTProvisioningClient
         uint32_t ulWorkflowState;
         uint32_t ulLastOperationResult;
         uint64_t ullRetryAfter;
+        uint32_t ulRequestTimeMs;
 
         uint8_t * pucScratchBuffer;
         uint32_t ulScratchBufferLength;
-        uint8_t ucProvisioningLastResponse[ azureiotprovisioningRESPONSE_MAX ];
-        size_t xLastResponsePayloadLength;
-        uint16_t usLastResponseTopicLength;
-        az_iot_provisioning_client_register_response xRegisterResponse;
+
+        /* Fields of the last response, parsed in place when it is received */
+        uint32_t ulResponseParseResult;
+        uint32_t ulOperationStatus;
+        uint32_t ulRetryAfterSeconds;
+        uint32_t ulExtendedErrorCode;
+        uint8_t ucOperationID[ azureiotconfigPROVISIONING_OPERATION_ID_MAX ];
+        uint16_t usOperationIDLength;
+        uint8_t ucAssignedHubHostname[ azureiotconfigPROVISIONING_HUB_HOSTNAME_MAX ];
+        uint16_t usAssignedHubHostnameLength;
+        uint8_t ucDeviceID[ azureiotconfigPROVISIONING_DEVICE_ID_MAX ];
+        uint16_t usDeviceIDLength;
+
+        AzureIoTProvisioningClientTiming_t * pxTiming;
+        uint32_t ulStartTimeMs;
+        uint32_t ulStateEnterTimeMs;
+
+        AzureIoTProvisioningClientProgressCallback_t xProgressCallback;
+        AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback;
+        void * pvCallbackContext;
+        bool xStartNotifyPending;
+        bool xConnected;
     } _internal; /**< @brief Internal to the SDK */
-} AzureIoTProvisioningClient_t;
+};
 
 /**
  * @brief Initialize the Azure IoT Provisioning Options with default values.
@@ -144,6 +223,7 @@ void AzureIoTProvisioningClient_Deinit( AzureIoTProvisioningClient_t * pxAzurePr
  * @param[in] pucSymmetricKey The symmetric key to use for the connection.
  * @param[in] ulSymmetricKeyLength The length of the \p pucSymmetricKey.
  * @param[in] xHmacFunction The #AzureIoTGetHMACFunc_t function pointer to a function which computes the HMAC256 over a set of bytes.
+ *                          AzureIoTCrypto_HMACSHA256Calculate() of the crypto port can be used.
  * @return An #AzureIoTResult_t with the result of the operation.
  */
 AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKey( AzureIoTProvisioningClient_t * pxAzureProvClient,
@@ -151,6 +231,22 @@ AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKey( AzureIoTProvisionin
                                                              uint32_t ulSymmetricKeyLength,
                                                              AzureIoTGetHMACFunc_t xHmacFunction );
 
+/**
+ * @brief Set the symmetric key as an HMAC context prepared in advance.
+ *
+ * Use this instead of AzureIoTProvisioningClient_SetSymmetricKey() when the HMAC implementation can keep a key
+ * schedule, such as AzureIoTCrypto_HMACSHA256Sign() of the crypto port with an #AzureIoTCryptoHMACSHA256Context_t.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to use for this call.
+ * @param[in] xHmacContextFunction The #AzureIoTGetHMACContextFunc_t function pointer to a function which computes
+ *                                 the HMAC256 over a set of bytes with the key held by \p pvHmacContext.
+ * @param[in] pvHmacContext The context passed to \p xHmacContextFunction. It must outlive the client.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKeyContext( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                                    AzureIoTGetHMACContextFunc_t xHmacContextFunction,
+                                                                    void * pvHmacContext );
+
 /**
  * @brief Begin the provisioning process.
  *
@@ -172,6 +268,68 @@ AzureIoTResult_t AzureIoTProvisioningClient_SetSymmetricKey( AzureIoTProvisionin
 AzureIoTResult_t AzureIoTProvisioningClient_Register( AzureIoTProvisioningClient_t * pxAzureProvClient,
                                                       uint32_t ulTimeoutMilliseconds );
 
+/**
+ * @brief Start the provisioning process without blocking.
+ *
+ * The registration is driven by AzureIoTProvisioningClient_ProcessLoop(). \p xProgressCallback is invoked
+ * each time the registration moves to the next step and \p xCompleteCallback once when it completes. Both are
+ * invoked from AzureIoTProvisioningClient_ProcessLoop(), never from this function: the
+ * #eAzureIoTProvisioningProgressConnecting step is reported by the first process loop. Between calls the application can sleep until the
+ * time left given by AzureIoTProvisioningClient_GetNextDeadline().
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to use for this call.
+ * @param[in] xCompleteCallback The #AzureIoTProvisioningClientCompleteCallback_t to invoke when the registration completes.
+ * @param[in] xProgressCallback The #AzureIoTProvisioningClientProgressCallback_t to invoke on each step. Can be `NULL`.
+ * @param[in] pvContext The context passed back to the callbacks.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTProvisioningClient_RegisterAsync( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                           AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback,
+                                                           AzureIoTProvisioningClientProgressCallback_t xProgressCallback,
+                                                           void * pvContext );
+
+/**
+ * @brief Drive a registration started with AzureIoTProvisioningClient_RegisterAsync().
+ *
+ * While waiting for the retry-after time of the service, the connection is serviced in a single wait up to the
+ * deadline instead of being polled in short slices.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to use for this call.
+ * @param[in] ulTimeoutMilliseconds Maximum time in milliseconds to spend in this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ *      - eAzureIoTErrorPending registration is still in progess.
+ *      - Otherwise the result also passed to the #AzureIoTProvisioningClientCompleteCallback_t.
+ */
+AzureIoTResult_t AzureIoTProvisioningClient_ProcessLoop( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                         uint32_t ulTimeoutMilliseconds );
+
+/**
+ * @brief Get the time left before the registration next needs AzureIoTProvisioningClient_ProcessLoop() to be called.
+ *
+ * While the registration waits for the retry-after time of the service this is the time left in that wait. While it
+ * waits for the SUBACK or the response of the service, this is the time left before the registration fails with a
+ * timeout (#azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS): the application should also wake up when the transport
+ * has data. Otherwise the next step can run now and the wait is 0.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to use for this call.
+ * @param[out] pulWaitMilliseconds The time left, in milliseconds.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorFailed if no registration is in progress.
+ */
+AzureIoTResult_t AzureIoTProvisioningClient_GetNextDeadline( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                             uint32_t * pulWaitMilliseconds );
+
+/**
+ * @brief Disconnect the MQTT connection of the registration.
+ *
+ * Call this once the registration is complete, before closing the transport. Nothing is sent if the
+ * registration never connected.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTProvisioningClient_Disconnect( AzureIoTProvisioningClient_t * pxAzureProvClient );
+
 /**
  * @brief After a registration has been completed, get the IoT Hub hostname and device ID.
  *
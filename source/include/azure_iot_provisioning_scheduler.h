@@ -0,0 +1,167 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_scheduler.h
+ *
+ * @brief Drives the registration of many #AzureIoTProvisioningClient_t from a single task.
+ *
+ * Each client keeps its own MQTT connection. The scheduler opens the transport of at most
+ * `ulMaxActive` clients at a time, starts them with AzureIoTProvisioningClient_RegisterAsync() and
+ * only calls AzureIoTProvisioningClient_ProcessLoop() on the clients whose deadline is reached or whose
+ * transport has data. The retry-after waits of the service of all active clients therefore overlap.
+ * When a client completes, its MQTT connection is disconnected, its transport is closed and the next
+ * queued client is started.
+ *
+ * @note You MUST NOT use any symbols (macros, functions, structures, enums, etc.)
+ * prefixed with an underscore ('_') directly in your application code. These symbols
+ * are part of Azure SDK's internal implementation; we do not document these symbols
+ * and they are subject to change in future versions of the SDK which would break your code.
+ *
+ */
+
+#ifndef AZURE_IOT_PROVISIONING_SCHEDULER_H
+#define AZURE_IOT_PROVISIONING_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "azure_iot_provisioning_client.h"
+
+/* Azure SDK for Embedded C includes */
+#include "azure/core/_az_cfg_prefix.h"
+
+typedef struct AzureIoTProvisioningScheduler   AzureIoTProvisioningScheduler_t;
+
+/**
+ * @brief Function opening or closing the transport of a client.
+ *
+ * The transport is the one given to AzureIoTProvisioningClient_Init() for \p pxAzureProvClient.
+ *
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * whose transport is opened or closed.
+ * @param[in] pvContext The context passed to AzureIoTProvisioningScheduler_Init().
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+typedef AzureIoTResult_t ( * AzureIoTProvisioningSchedulerTransportFunc_t )( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                                                             void * pvContext );
+
+/**
+ * @brief Registration slot of the scheduler.
+ */
+typedef struct AzureIoTProvisioningSchedulerEntry
+{
+    struct
+    {
+        AzureIoTProvisioningScheduler_t * pxScheduler;
+        AzureIoTProvisioningClient_t * pxAzureProvClient;
+        uint32_t ulState;
+        AzureIoTResult_t xResult;
+        bool xDataPending;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTProvisioningSchedulerEntry_t;
+
+/**
+ * @brief Provisioning scheduler.
+ */
+struct AzureIoTProvisioningScheduler
+{
+    struct
+    {
+        AzureIoTProvisioningSchedulerEntry_t * pxEntries;
+        uint32_t ulEntryCapacity;
+        uint32_t ulEntryCount;
+        uint32_t ulNextEntry;
+        uint32_t ulMaxActive;
+        uint32_t ulActiveCount;
+        uint32_t ulCompleteCount;
+        AzureIoTGetCurrentTimeFunc_t xGetTimeFunction;
+        AzureIoTProvisioningSchedulerTransportFunc_t xOpenTransport;
+        AzureIoTProvisioningSchedulerTransportFunc_t xCloseTransport;
+        AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback;
+        void * pvContext;
+    } _internal; /**< @brief Internal to the SDK */
+};
+
+/**
+ * @brief Initialize the provisioning scheduler.
+ *
+ * @param[out] pxScheduler The #AzureIoTProvisioningScheduler_t * to initialize.
+ * @param[in] pxEntries Array of #AzureIoTProvisioningSchedulerEntry_t, one per client to register.
+ * @param[in] ulEntryCount The number of entries in \p pxEntries.
+ * @param[in] ulMaxActive The maximum number of clients connected to the service at the same time.
+ * @param[in] xGetTimeFunction The #AzureIoTGetCurrentTimeFunc_t given to the clients.
+ * @param[in] xOpenTransport The #AzureIoTProvisioningSchedulerTransportFunc_t connecting the transport of a client before it is started.
+ * @param[in] xCloseTransport The #AzureIoTProvisioningSchedulerTransportFunc_t closing the transport of a client once it completes and is disconnected. Can be `NULL`.
+ * @param[in] xCompleteCallback The #AzureIoTProvisioningClientCompleteCallback_t invoked once for each client when its registration completes.
+ * @param[in] pvContext The context passed back to the transport functions and to \p xCompleteCallback.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ */
+AzureIoTResult_t AzureIoTProvisioningScheduler_Init( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                     AzureIoTProvisioningSchedulerEntry_t * pxEntries,
+                                                     uint32_t ulEntryCount,
+                                                     uint32_t ulMaxActive,
+                                                     AzureIoTGetCurrentTimeFunc_t xGetTimeFunction,
+                                                     AzureIoTProvisioningSchedulerTransportFunc_t xOpenTransport,
+                                                     AzureIoTProvisioningSchedulerTransportFunc_t xCloseTransport,
+                                                     AzureIoTProvisioningClientCompleteCallback_t xCompleteCallback,
+                                                     void * pvContext );
+
+/**
+ * @brief Queue a client for registration.
+ *
+ * The client must be initialized, have its credentials set and not be registering yet.
+ *
+ * @param[in] pxScheduler The #AzureIoTProvisioningScheduler_t * to use for this call.
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * to register.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorOutOfMemory if every entry is used.
+ */
+AzureIoTResult_t AzureIoTProvisioningScheduler_Add( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                    AzureIoTProvisioningClient_t * pxAzureProvClient );
+
+/**
+ * @brief Start queued clients while connections are available and process the clients whose deadline is reached
+ * or whose transport has data.
+ *
+ * This call does not block on the clients. Between calls the application can sleep for the time given by
+ * AzureIoTProvisioningScheduler_GetNextDeadline(), or until one of the transports has data, which it reports with
+ * AzureIoTProvisioningScheduler_NotifyData().
+ *
+ * @param[in] pxScheduler The #AzureIoTProvisioningScheduler_t * to use for this call.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorPending if some registrations are not complete.
+ * @retval eAzureIoTSuccess if every queued registration is complete. The result of each one is given to the
+ * #AzureIoTProvisioningClientCompleteCallback_t.
+ */
+AzureIoTResult_t AzureIoTProvisioningScheduler_Process( AzureIoTProvisioningScheduler_t * pxScheduler );
+
+/**
+ * @brief Report that the transport of an active client has data.
+ *
+ * The next AzureIoTProvisioningScheduler_Process() processes \p pxAzureProvClient even if its deadline is not reached.
+ *
+ * @param[in] pxScheduler The #AzureIoTProvisioningScheduler_t * to use for this call.
+ * @param[in] pxAzureProvClient The #AzureIoTProvisioningClient_t * whose transport has data.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorItemNotFound if \p pxAzureProvClient is not registering.
+ */
+AzureIoTResult_t AzureIoTProvisioningScheduler_NotifyData( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                           AzureIoTProvisioningClient_t * pxAzureProvClient );
+
+/**
+ * @brief Get the time left before AzureIoTProvisioningScheduler_Process() has work to do.
+ *
+ * While the clients wait for the service this is the earliest of their response timeouts: the application should
+ * also wake up when a transport has data.
+ *
+ * @param[in] pxScheduler The #AzureIoTProvisioningScheduler_t * to use for this call.
+ * @param[out] pulWaitMilliseconds The time left, in milliseconds.
+ * @return An #AzureIoTResult_t with the result of the operation.
+ * @retval eAzureIoTErrorFailed if no registration is queued or in progress.
+ */
+AzureIoTResult_t AzureIoTProvisioningScheduler_GetNextDeadline( AzureIoTProvisioningScheduler_t * pxScheduler,
+                                                                uint32_t * pulWaitMilliseconds );
+
+#include "azure/core/_az_cfg_suffix.h"
+
+#endif /* AZURE_IOT_PROVISIONING_SCHEDULER_H */
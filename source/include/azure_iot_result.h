@@ -49,7 +49,11 @@ typedef enum AzureIoTResult
     /* === JSON: Error results === */
     eAzureIoTErrorJSONInvalidState,    /**< The kind of the token being read is not compatible with the expected type of the value. */
     eAzureIoTErrorJSONNestingOverflow, /**< The JSON depth is too large. */
-    eAzureIoTErrorJSONReaderDone       /**< No more JSON text left to process. */
+    eAzureIoTErrorJSONReaderDone,      /**< No more JSON text left to process. */
+
+    /* === Core: Error results, added after the JSON results to keep the values above stable === */
+    eAzureIoTErrorPubackWaitTimeout, /**< There was timeout while waiting for PUBACK. */
+    eAzureIoTErrorBusy               /**< The resource is in use, try again later. */
 } AzureIoTResult_t;
 
 #endif /* AZURE_IOT_RESULT_H */
@@ -6,14 +6,66 @@
  *
  * @brief The port file for crypto APIs
  *
- * Used for verifying the ADU image payload.
+ * All the cryptography of the middleware goes through these functions: hashing the ADU image while it
+ * downloads, verifying the JWS of the ADU manifest, and the HMAC of the SAS tokens. The implementation is
+ * picked at link time with `AZURE_IOT_CRYPTO_PORT`, so a hardware accelerated port can replace the mbedTLS
+ * one in `ports/mbedTLS` without changing the middleware.
  *
  */
 
+#ifndef AZURE_IOT_CRYPTO_H
+#define AZURE_IOT_CRYPTO_H
+
 #include <stdint.h>
 
 #include "azure_iot_result.h"
 
+/**
+ * @brief Size of a SHA256 digest.
+ */
+#define azureiotcryptoSHA256_SIZE          ( 32U )
+
+/**
+ * @brief Size of a SHA256 input block. Longer HMAC SHA256 keys are hashed first.
+ */
+#define azureiotcryptoSHA256_BLOCK_SIZE    ( 64U )
+
+/**
+ * @brief Bytes reserved for the SHA256 state of the crypto port.
+ *
+ * The mbedTLS port needs about 110 bytes. A port with a larger state defines it at build time.
+ */
+#ifndef azureiotcryptoSHA256_CONTEXT_SIZE
+    #define azureiotcryptoSHA256_CONTEXT_SIZE    ( 128U )
+#endif
+
+/**
+ * @brief SHA256 state of the crypto port.
+ *
+ * Only the port knows its layout, in its private `azure_iot_crypto_port.h`.
+ */
+typedef struct AzureIoTCryptoSHA256Context
+{
+    union
+    {
+        uint64_t ullAlignment;
+        void * pvAlignment;
+        uint8_t ucState[ azureiotcryptoSHA256_CONTEXT_SIZE ];
+    } _internal; /**< @brief Internal to the crypto port */
+} AzureIoTCryptoSHA256Context_t;
+
+/**
+ * @brief HMAC SHA256 key schedule, prepared once by AzureIoTCrypto_HMACSHA256Init().
+ *
+ * It holds the SHA256 states after hashing the inner and outer padded key blocks, so signing
+ * only hashes the message and the inner digest.
+ */
+typedef struct AzureIoTCryptoHMACSHA256Context
+{
+    AzureIoTCryptoSHA256Context_t xInner;
+    AzureIoTCryptoSHA256Context_t xOuter;
+} AzureIoTCryptoHMACSHA256Context_t;
+
 /**
  * @brief Calculate a SHA256 hash.
  *
@@ -53,3 +105,126 @@ AzureIoTResult_t AzureIoTCrypto_RS256Verify( const char * pucInputPtr,
                                              uint64_t ullESize,
                                              const char * pucBufferPtr,
                                              uint32_t ulBufferSize );
+
+/**
+ * @brief Verify an RS256 signature over a SHA256 digest which is already calculated.
+ *
+ * @param[in] pucDigest The SHA256 of the signed input. It must be #azureiotcryptoSHA256_SIZE bytes.
+ * @param[in] pucSignature The signature of the input.
+ * @param[in] ulSignatureLength The length of \p pucSignature. It must be the length of the key.
+ * @param[in] pucN The pointer to the key modulus.
+ * @param[in] ulNLength The length of \p pucN.
+ * @param[in] pucE The pointer to the key exponent.
+ * @param[in] ulELength The length of \p pucE.
+ * @return AzureIoTResult_t
+ * @retval eAzureIoTSuccess if the signature is valid.
+ * @retval Otherwise if the signature is invalid or could not be checked.
+ */
+AzureIoTResult_t AzureIoTCrypto_RS256VerifyDigest( const uint8_t * pucDigest,
+                                                   const uint8_t * pucSignature,
+                                                   uint32_t ulSignatureLength,
+                                                   const uint8_t * pucN,
+                                                   uint32_t ulNLength,
+                                                   const uint8_t * pucE,
+                                                   uint32_t ulELength );
+
+/**
+ * @brief Calculate an HMAC SHA256.
+ *
+ * It is a #AzureIoTGetHMACFunc_t, so it can be given to AzureIoTHubClient_SetSymmetricKey() and
+ * AzureIoTProvisioningClient_SetSymmetricKey() to sign the SAS tokens with the crypto port.
+ *
+ * @param[in] pucKey The key of the HMAC.
+ * @param[in] ulKeyLength The length of \p pucKey.
+ * @param[in] pucData The data to sign.
+ * @param[in] ulDataLength The length of \p pucData.
+ * @param[out] pucOutput The buffer into which the HMAC will be placed.
+ * @param[in] ulOutputLength The length of \p pucOutput. It must be at least #azureiotcryptoSHA256_SIZE.
+ * @param[out] pulBytesCopied The number of bytes copied into \p pucOutput.
+ * @return `0` if successful, non-`0` otherwise.
+ */
+uint32_t AzureIoTCrypto_HMACSHA256Calculate( const uint8_t * pucKey,
+                                             uint32_t ulKeyLength,
+                                             const uint8_t * pucData,
+                                             uint32_t ulDataLength,
+                                             uint8_t * pucOutput,
+                                             uint32_t ulOutputLength,
+                                             uint32_t * pulBytesCopied );
+
+/**
+ * @brief Prepare an HMAC SHA256 key schedule from a base64 encoded symmetric key.
+ *
+ * The key is decoded once and only the inner and outer SHA256 states are kept. A key longer than
+ * #azureiotcryptoSHA256_BLOCK_SIZE once decoded is replaced by its SHA256 hash, as RFC 2104 specifies.
+ *
+ * @param[out] pxContext The #AzureIoTCryptoHMACSHA256Context_t to initialize.
+ * @param[in] pucSymmetricKey The base64 encoded symmetric key, as given by IoT Hub or DPS.
+ * @param[in] ulSymmetricKeyLength The length of \p pucSymmetricKey.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTCrypto_HMACSHA256Init( AzureIoTCryptoHMACSHA256Context_t * pxContext,
+                                                const uint8_t * pucSymmetricKey,
+                                                uint32_t ulSymmetricKeyLength );
+
+/**
+ * @brief Calculate an HMAC SHA256 with a key schedule prepared by AzureIoTCrypto_HMACSHA256Init().
+ *
+ * It is a #AzureIoTGetHMACContextFunc_t, so it can be given to AzureIoTHubClient_SetSymmetricKeyContext() and
+ * AzureIoTProvisioningClient_SetSymmetricKeyContext() with the context. The context is not modified, so one
+ * context can sign for several clients.
+ *
+ * @param[in] pvHMACContext The #AzureIoTCryptoHMACSHA256Context_t holding the key.
+ * @param[in] pucData The data to sign.
+ * @param[in] ulDataLength The length of \p pucData.
+ * @param[out] pucOutput The buffer into which the HMAC will be placed.
+ * @param[in] ulOutputLength The length of \p pucOutput. It must be at least #azureiotcryptoSHA256_SIZE.
+ * @param[out] pulBytesCopied The number of bytes copied into \p pucOutput.
+ * @return `0` if successful, non-`0` otherwise.
+ */
+uint32_t AzureIoTCrypto_HMACSHA256Sign( void * pvHMACContext,
+                                        const uint8_t * pucData,
+                                        uint32_t ulDataLength,
+                                        uint8_t * pucOutput,
+                                        uint32_t ulOutputLength,
+                                        uint32_t * pulBytesCopied );
+
+/**
+ * @brief Clear an HMAC SHA256 key schedule.
+ *
+ * @param[in] pxContext The #AzureIoTCryptoHMACSHA256Context_t to clear.
+ */
+void AzureIoTCrypto_HMACSHA256Deinit( AzureIoTCryptoHMACSHA256Context_t * pxContext );
+
+/**
+ * @brief Start an incremental SHA256 calculation.
+ *
+ * @param[out] pxContext The #AzureIoTCryptoSHA256Context_t to initialize.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTCrypto_SHA256Init( AzureIoTCryptoSHA256Context_t * pxContext );
+
+/**
+ * @brief Feed bytes to an incremental SHA256 calculation.
+ *
+ * @param[in] pxContext The #AzureIoTCryptoSHA256Context_t started with AzureIoTCrypto_SHA256Init().
+ * @param[in] pucInput The bytes to add to the calculation.
+ * @param[in] ulInputLength The length of \p pucInput.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTCrypto_SHA256Update( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              const uint8_t * pucInput,
+                                              uint32_t ulInputLength );
+
+/**
+ * @brief Finish an incremental SHA256 calculation.
+ *
+ * @param[in] pxContext The #AzureIoTCryptoSHA256Context_t to finish.
+ * @param[out] pucOutput The buffer into which the digest will be placed.
+ * @param[in] ulOutputLength The length of \p pucOutput. It must be at least #azureiotcryptoSHA256_SIZE.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTCrypto_SHA256Finish( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              uint8_t * pucOutput,
+                                              uint32_t ulOutputLength );
+
+#endif /* AZURE_IOT_CRYPTO_H */
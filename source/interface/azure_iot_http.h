@@ -79,6 +79,9 @@ AzureIoTHTTPResult_t AzureIoTHTTP_Init( AzureIoTHTTPHandle_t xHTTPHandle,
 /**
  * @brief Send an HTTP GET request.
  *
+ * The headers built by AzureIoTHTTP_Init() are reused and only the range is set for each call, so any number of
+ * requests can be sent on the same keep-alive connection after a single init.
+ *
  * @param[in] xHTTPHandle The HTTP handle to use for this operation.
  * @param[in] lRangeStart The start point for the request payload.
  * @param[in] lRangeEnd The end point for the request payload.
@@ -135,6 +138,8 @@ int32_t AzureIoTHTTP_RequestSize( AzureIoTHTTPHandle_t xHTTPHandle,
 /**
  * @brief Deinitialize the Azure HTTP client.
  *
+ * The transport is owned by the caller and is not closed.
+ *
  * @param[in] xHTTPHandle The HTTP handle to use for this operation.
  * @return AzureIoTHTTPResult_t
  * @retval eAzureIoTHTTPSuccess if success.
@@ -43,13 +43,119 @@ typedef struct AzureIoTJWS_RootKey
 /**
  * @brief The minimum amount of space needed to authenticate a JWS signature.
  *
- * @note azureiotjwsJWS_PAYLOAD_SIZE, one azureiotjwsSIGNATURE_SIZE, and one azureiotjwsSHA256_SIZE are excluded since
- * they will reuse buffer space.
+ * @note The JWS is base64url decoded in place, so the scratch buffer only holds the SHA256 of the JWS and JWK
+ * signing inputs. The other size macros are kept for applications which size their own buffers with them.
  */
-#define azureiotjwsSCRATCH_BUFFER_SIZE                                                            \
-    ( azureiotjwsJWS_HEADER_SIZE + azureiotjwsJWK_HEADER_SIZE + azureiotjwsJWK_PAYLOAD_SIZE       \
-      + azureiotjwsSIGNATURE_SIZE + azureiotjwsSIGNING_KEY_N_SIZE + azureiotjwsSIGNING_KEY_E_SIZE \
-      + azureiotjwsSHA_CALCULATION_SCRATCH_SIZE )
+#define azureiotjwsSCRATCH_BUFFER_SIZE    ( 2 * azureiotjwsSHA256_SIZE )
+
+/**
+ * @brief Entry of a #AzureIoTJWS_SigningKeyCache_t, holding one verified signing key.
+ */
+typedef struct AzureIoTJWS_SigningKeyCacheEntry
+{
+    struct
+    {
+        uint32_t ulLastUsed;
+        uint8_t ucSJWKHash[ azureiotjwsSHA256_SIZE ];
+        uint8_t ucSigningKeyN[ azureiotjwsSIGNING_KEY_N_SIZE ];
+        uint32_t ulSigningKeyNLength;
+        uint8_t ucSigningKeyE[ azureiotjwsSIGNING_KEY_E_SIZE ];
+        uint32_t ulSigningKeyELength;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTJWS_SigningKeyCacheEntry_t;
+
+/**
+ * @brief Cache of the signing keys already verified with a root key.
+ *
+ * ADU signs many manifests with the same signing key. The cache keeps the decoded signing key of each `sjwk`
+ * it verified, keyed by the SHA256 of the `sjwk` string, so authenticating the next manifest signed with it
+ * takes one RSA verification instead of two. The least recently used entry is replaced when the cache is full.
+ *
+ * @note Initialize the cache again when the root keys change, so keys verified with a removed root key are dropped.
+ */
+typedef struct AzureIoTJWS_SigningKeyCache
+{
+    struct
+    {
+        AzureIoTJWS_SigningKeyCacheEntry_t * pxEntries;
+        uint32_t ulEntryCount;
+        uint32_t ulUseCount;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTJWS_SigningKeyCache_t;
+
+/**
+ * @brief Context of an incremental manifest authentication.
+ *
+ * Authenticating a manifest takes two RSA-3072 verifications and several base64 decodes. With
+ * AzureIoTJWS_ManifestAuthenticateInit() and AzureIoTJWS_ManifestAuthenticateStep(), the work is split into
+ * steps which each return to the caller, so the task can call AzureIoTHubClient_ProcessLoop() between them,
+ * or run the steps from a lower priority task.
+ */
+typedef struct AzureIoTJWS_ManifestContext
+{
+    struct
+    {
+        uint32_t ulStep;
+        AzureIoTResult_t xResult;
+        const uint8_t * pucManifest;
+        uint32_t ulManifestLength;
+        uint8_t * pucJWS;
+        uint32_t ulJWSLength;
+        AzureIoTJWS_RootKey_t * pxADURootKeys;
+        uint32_t ulADURootKeysLength;
+        int32_t lRootKeyIndex;
+        AzureIoTJWS_SigningKeyCache_t * pxSigningKeyCache;
+        AzureIoTJWS_SigningKeyCacheEntry_t * pxSigningKeyCacheEntry;
+        uint8_t ucSJWKHash[ azureiotjwsSHA256_SIZE ];
+
+        /* Base64 encoded parts, pointing into the JWS */
+        uint8_t * pucBase64EncodedHeader;
+        uint32_t ulBase64EncodedHeaderLength;
+        uint8_t * pucBase64EncodedPayload;
+        uint32_t ulBase64EncodedPayloadLength;
+        uint8_t * pucBase64EncodedSignature;
+        uint32_t ulBase64SignatureLength;
+        uint8_t * pucJWKManifest;
+        uint32_t ulJWKManifestLength;
+        uint8_t * pucJWKBase64EncodedHeader;
+        uint32_t ulJWKBase64EncodedHeaderLength;
+        uint8_t * pucJWKBase64EncodedPayload;
+        uint32_t ulJWKBase64EncodedPayloadLength;
+        uint8_t * pucJWKBase64EncodedSignature;
+        uint32_t ulJWKBase64EncodedSignatureLength;
+        uint8_t * pucBase64EncodedN;
+        uint32_t ulBase64EncodedNLength;
+        uint8_t * pucBase64EncodedE;
+        uint32_t ulBase64EncodedELength;
+        uint8_t * pucAlg;
+        uint32_t ulAlgLength;
+
+        /* Decoded parts, in the JWS over their base64 encoded parts. The signing key may instead
+         * point into the signing key cache. */
+        uint8_t * pucJWSHeader;
+        uint32_t ulJWSHeaderLength;
+        uint8_t * pucJWSPayload;
+        uint32_t ulJWSPayloadLength;
+        uint8_t * pucJWSSignature;
+        uint32_t ulJWSSignatureLength;
+        uint8_t * pucJWKHeader;
+        uint32_t ulJWKHeaderLength;
+        uint8_t * pucJWKPayload;
+        uint32_t ulJWKPayloadLength;
+        uint8_t * pucJWKSignature;
+        uint32_t ulJWKSignatureLength;
+        uint8_t * pucSigningKeyN;
+        uint32_t ulSigningKeyNLength;
+        uint8_t * pucSigningKeyE;
+        uint32_t ulSigningKeyELength;
+        uint32_t ulParsedManifestShaSize;
+
+        /* Hashes, in the scratch buffer */
+        uint8_t * pucJWSSigningInputHash;
+        uint8_t * pucJWKSigningInputHash;
+        uint8_t * pucManifestSHACalculation;
+    } _internal; /**< @brief Internal to the SDK */
+} AzureIoTJWS_ManifestContext_t;
 
 /**
  * @brief Authenticate the manifest from ADU.
@@ -58,8 +164,9 @@ typedef struct AzureIoTJWS_RootKey
  * (`pucUpdateManifest` from #AzureIoTADUUpdateRequest_t).
  * @param[in] ulManifestLength The length of \p pucManifest.
  * (`ulUpdateManifestLength` from #AzureIoTADUUpdateRequest_t).
- * @param[in] pucJWS The JWS signature used to authenticate \p pucManifest.
+ * @param[in,out] pucJWS The JWS signature used to authenticate \p pucManifest.
  * (`pucUpdateManifestSignature` from #AzureIoTADUUpdateRequest_t).
+ * It is base64url decoded in place, so its content is overwritten.
  * @param[in] ulJWSLength The length of \p pucJWS.
  * (`ulUpdateManifestSignatureLength` from #AzureIoTADUUpdateRequest_t).
  * @param[in] xADURootKeys An array of root keys that may be used to verify the payload.
@@ -80,4 +187,112 @@ AzureIoTResult_t AzureIoTJWS_ManifestAuthenticate( const uint8_t * pucManifest,
                                                    uint8_t * pucScratchBuffer,
                                                    uint32_t ulScratchBufferLength );
 
+/**
+ * @brief Start an incremental authentication of the manifest from ADU.
+ *
+ * The parameters are the ones of AzureIoTJWS_ManifestAuthenticate(). They, and \p pucScratchBuffer, must stay
+ * valid until the authentication completes.
+ *
+ * @param[out] pxContext The #AzureIoTJWS_ManifestContext_t * to initialize.
+ * @param[in] pucManifest The unescaped manifest from the ADU twin property.
+ * @param[in] ulManifestLength The length of \p pucManifest.
+ * @param[in,out] pucJWS The JWS signature used to authenticate \p pucManifest. It is overwritten.
+ * @param[in] ulJWSLength The length of \p pucJWS.
+ * @param[in] xADURootKeys An array of root keys that may be used to verify the payload.
+ * @param[in] ulADURootKeysLength The length of the array of root keys.
+ * @param[out] pucScratchBuffer Scratch buffer space for calculations. It should be
+ * `azureiotjwsSCRATCH_BUFFER_SIZE` in length.
+ * @param[in] ulScratchBufferLength The length of \p pucScratchBuffer.
+ * @return AzureIoTResult_t The return value of this function.
+ * @retval eAzureIoTSuccess if successful.
+ * @retval eAzureIoTErrorOutOfMemory if \p pucScratchBuffer is too small.
+ * @retval Otherwise if failed.
+ */
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateInit( AzureIoTJWS_ManifestContext_t * pxContext,
+                                                       const uint8_t * pucManifest,
+                                                       uint32_t ulManifestLength,
+                                                       uint8_t * pucJWS,
+                                                       uint32_t ulJWSLength,
+                                                       AzureIoTJWS_RootKey_t * xADURootKeys,
+                                                       uint32_t ulADURootKeysLength,
+                                                       uint8_t * pucScratchBuffer,
+                                                       uint32_t ulScratchBufferLength );
+
+/**
+ * @brief Run the next step of an incremental manifest authentication.
+ *
+ * The steps are: split the JWS, decode its header, decode the signing key JWK, verify the JWK with the root key,
+ * decode the signing key, verify the JWS with the signing key and compare the manifest SHA. The two
+ * verifications are the longest steps, one RSA-3072 public key operation each.
+ *
+ * @param[in] pxContext The #AzureIoTJWS_ManifestContext_t * to use for this call.
+ * @return AzureIoTResult_t The return value of this function.
+ * @retval eAzureIoTErrorPending if more steps remain.
+ * @retval eAzureIoTSuccess if the manifest is authenticated.
+ * @retval Otherwise if failed. Further calls return the same error.
+ */
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateStep( AzureIoTJWS_ManifestContext_t * pxContext );
+
+/**
+ * @brief Initialize a cache of verified signing keys.
+ *
+ * @param[out] pxCache The #AzureIoTJWS_SigningKeyCache_t * to initialize.
+ * @param[in] pxEntries Array of #AzureIoTJWS_SigningKeyCacheEntry_t holding the cached keys.
+ * @param[in] ulEntryCount The number of entries in \p pxEntries.
+ * @return AzureIoTResult_t The return value of this function.
+ * @retval eAzureIoTSuccess if successful.
+ * @retval Otherwise if failed.
+ */
+AzureIoTResult_t AzureIoTJWS_SigningKeyCacheInit( AzureIoTJWS_SigningKeyCache_t * pxCache,
+                                                  AzureIoTJWS_SigningKeyCacheEntry_t * pxEntries,
+                                                  uint32_t ulEntryCount );
+
+/**
+ * @brief Use a cache of verified signing keys for an incremental manifest authentication.
+ *
+ * When the `sjwk` of the JWS is in the cache, the steps decoding and verifying the JWK are skipped. Otherwise,
+ * the signing key is added to the cache once verified.
+ *
+ * @param[in] pxContext The #AzureIoTJWS_ManifestContext_t * initialized with AzureIoTJWS_ManifestAuthenticateInit().
+ * No step must have run yet.
+ * @param[in] pxCache The #AzureIoTJWS_SigningKeyCache_t * to use.
+ * @return AzureIoTResult_t The return value of this function.
+ * @retval eAzureIoTSuccess if successful.
+ * @retval Otherwise if failed.
+ */
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( AzureIoTJWS_ManifestContext_t * pxContext,
+                                                                     AzureIoTJWS_SigningKeyCache_t * pxCache );
+
+/**
+ * @brief Authenticate the manifest from ADU, using a cache of verified signing keys.
+ *
+ * Same as AzureIoTJWS_ManifestAuthenticate(), but when the `sjwk` of the JWS is in \p pxCache, the JWK is
+ * neither decoded nor verified with the root key again. Otherwise, the signing key is added to \p pxCache
+ * once verified.
+ *
+ * @param[in] pucManifest The unescaped manifest from the ADU twin property.
+ * @param[in] ulManifestLength The length of \p pucManifest.
+ * @param[in,out] pucJWS The JWS signature used to authenticate \p pucManifest. It is overwritten.
+ * @param[in] ulJWSLength The length of \p pucJWS.
+ * @param[in] xADURootKeys An array of root keys that may be used to verify the payload.
+ * @param[in] ulADURootKeysLength The length of the array of root keys.
+ * @param[out] pucScratchBuffer Scratch buffer space for calculations. It should be
+ * `azureiotjwsSCRATCH_BUFFER_SIZE` in length.
+ * @param[in] ulScratchBufferLength The length of \p pucScratchBuffer.
+ * @param[in] pxCache The #AzureIoTJWS_SigningKeyCache_t * initialized with AzureIoTJWS_SigningKeyCacheInit(),
+ * or NULL to authenticate without a cache.
+ * @return AzureIoTResult_t The return value of this function.
+ * @retval eAzureIoTSuccess if successful.
+ * @retval Otherwise if failed.
+ */
+AzureIoTResult_t AzureIoTJWS_ManifestAuthenticateWithCache( const uint8_t * pucManifest,
+                                                            uint32_t ulManifestLength,
+                                                            uint8_t * pucJWS,
+                                                            uint32_t ulJWSLength,
+                                                            AzureIoTJWS_RootKey_t * xADURootKeys,
+                                                            uint32_t ulADURootKeysLength,
+                                                            uint8_t * pucScratchBuffer,
+                                                            uint32_t ulScratchBufferLength,
+                                                            AzureIoTJWS_SigningKeyCache_t * pxCache );
+
 #endif /* AZURE_IOT_JWS_H */
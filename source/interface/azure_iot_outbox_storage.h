@@ -0,0 +1,91 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_outbox_storage.h
+ *
+ * @brief Defines the storage interface used by the telemetry outbox to persist pending messages.
+ *
+ * The storage is a fixed number of equally sized slots used as a ring by the outbox, plus the
+ * head and tail indices of that ring so pending telemetry survives a reset.
+ */
+#ifndef AZURE_IOT_OUTBOX_STORAGE_H
+#define AZURE_IOT_OUTBOX_STORAGE_H
+
+#include <stdint.h>
+
+#include "azure_iot_result.h"
+
+#include "azure_iot_outbox_storage_port.h"
+
+/**
+ * @brief Get the number of slots of the storage.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @return uint32_t
+ */
+uint32_t AzureIoTOutboxStorage_GetSlotCount( AzureIoTOutboxStorage_t * const pxStorage );
+
+/**
+ * @brief Get the largest record a single slot can hold.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @return uint32_t
+ */
+uint32_t AzureIoTOutboxStorage_GetSlotSize( AzureIoTOutboxStorage_t * const pxStorage );
+
+/**
+ * @brief Write a record to a slot.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @param ulSlot The index of the slot to write.
+ * @param pucRecord The pointer to the record to write.
+ * @param ulRecordLength The length of \p pucRecord.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTOutboxStorage_WriteRecord( AzureIoTOutboxStorage_t * const pxStorage,
+                                                    uint32_t ulSlot,
+                                                    const uint8_t * pucRecord,
+                                                    uint32_t ulRecordLength );
+
+/**
+ * @brief Read the record stored in a slot.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @param ulSlot The index of the slot to read.
+ * @param pucBuffer The buffer into which the record is copied.
+ * @param ulBufferLength The length of \p pucBuffer.
+ * @param pulRecordLength The length of the record copied to \p pucBuffer.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTOutboxStorage_ReadRecord( AzureIoTOutboxStorage_t * const pxStorage,
+                                                   uint32_t ulSlot,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint32_t * pulRecordLength );
+
+/**
+ * @brief Persist the head and tail indices of the ring.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @param ulHead The index of the next slot to write.
+ * @param ulTail The index of the oldest slot not acknowledged by the hub.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTOutboxStorage_WriteIndices( AzureIoTOutboxStorage_t * const pxStorage,
+                                                     uint32_t ulHead,
+                                                     uint32_t ulTail );
+
+/**
+ * @brief Read the persisted head and tail indices of the ring.
+ *
+ * @param pxStorage The #AzureIoTOutboxStorage_t to use for this operation.
+ * @param pulHead The index of the next slot to write.
+ * @param pulTail The index of the oldest slot not acknowledged by the hub.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTOutboxStorage_ReadIndices( AzureIoTOutboxStorage_t * const pxStorage,
+                                                    uint32_t * pulHead,
+                                                    uint32_t * pulTail );
+
+#endif /* AZURE_IOT_OUTBOX_STORAGE_H */
@@ -0,0 +1,56 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_storage.h
+ *
+ * @brief Defines the storage interface used by the provisioning cache to persist the last assignment.
+ *
+ * The storage holds a single opaque record which must survive a reset for the cache to skip
+ * the Device Provisioning Service on the next boot.
+ */
+#ifndef AZURE_IOT_PROVISIONING_STORAGE_H
+#define AZURE_IOT_PROVISIONING_STORAGE_H
+
+#include <stdint.h>
+
+#include "azure_iot_result.h"
+
+#include "azure_iot_provisioning_storage_port.h"
+
+/**
+ * @brief Write the record, replacing the previous one.
+ *
+ * @param pxStorage The #AzureIoTProvisioningStorage_t to use for this operation.
+ * @param pucRecord The pointer to the record to write.
+ * @param ulRecordLength The length of \p pucRecord.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTProvisioningStorage_Write( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                    const uint8_t * pucRecord,
+                                                    uint32_t ulRecordLength );
+
+/**
+ * @brief Read the record.
+ *
+ * @param pxStorage The #AzureIoTProvisioningStorage_t to use for this operation.
+ * @param pucBuffer The buffer into which the record is copied.
+ * @param ulBufferLength The length of \p pucBuffer.
+ * @param pulRecordLength The length of the record copied to \p pucBuffer.
+ * @return AzureIoTResult_t
+ * @retval eAzureIoTErrorItemNotFound if no record is stored.
+ */
+AzureIoTResult_t AzureIoTProvisioningStorage_Read( AzureIoTProvisioningStorage_t * const pxStorage,
+                                                   uint8_t * pucBuffer,
+                                                   uint32_t ulBufferLength,
+                                                   uint32_t * pulRecordLength );
+
+/**
+ * @brief Erase the record.
+ *
+ * @param pxStorage The #AzureIoTProvisioningStorage_t to use for this operation.
+ * @return AzureIoTResult_t
+ */
+AzureIoTResult_t AzureIoTProvisioningStorage_Erase( AzureIoTProvisioningStorage_t * const pxStorage );
+
+#endif /* AZURE_IOT_PROVISIONING_STORAGE_H */
@@ -13,6 +13,11 @@ extern void vLoggingPrintf( const char * pcFormatString,
 #define AZLogInfo( message )     AZLog( ( "[INFO] [AZ IoT] [%s:%d]", __FILE__, __LINE__ ) ); AZLog( message ); AZLog( ( "\r\n" ) )
 #define AZLogDebug( message )    AZLog( ( "[DEBUG] [AZ IoT] [%s:%d]", __FILE__, __LINE__ ) ); AZLog( message ); AZLog( ( "\r\n" ) )
 
+#define azureiotconfigUSE_HUB_CLIENT_STATISTICS    1
+
+/* Builds the deferred logging backend for its unit test. The AZLog macros above keep logging with printf. */
+#define azureiotconfigUSE_DEFERRED_LOGGING    1
+
 /**
  * This certificate is for test purposes only. See official
  * documentation about certificate management for your released
@@ -76,18 +76,6 @@ TlsTransportStatus_t xConnectToServerWithBackoffRetries( const char * pcHostName
                                                          NetworkCredentials_t * pxNetworkCredentials,
                                                          NetworkContext_t * pxNetworkContext );
 
-/**
- * Calculate HMAC
- *
- **/
-uint32_t ulCalculateHMAC( const uint8_t * pucKey,
-                          uint32_t ulKeyLength,
-                          const uint8_t * pucData,
-                          uint32_t ulDataLength,
-                          uint8_t * pucOutput,
-                          uint32_t ulOutputLength,
-                          uint32_t * pulBytesCopied );
-
 /**
  * Get unix time
  *
@@ -7,6 +7,7 @@
 
 /* Azure IoT library includes */
 #include "azure_iot_adu_client.h"
+#include "azure_iot_crypto.h"
 #include "azure_iot_http.h"
 #include "azure_iot_hub_client.h"
 #include "azure_iot_provisioning_client.h"
@@ -35,6 +36,7 @@ extern char ** ppcArgv;
 static AzureIoTHubClient_t xAzureIoTHubClient;
 static AzureIoTADUClient_t xAzureIoTAduClient;
 static AzureIoTHTTP_t xHTTPClient;
+static AzureIoTCryptoHMACSHA256Context_t xHMACContext;
 static uint8_t ucSharedBuffer[ 5 * 1024 ];
 /*-----------------------------------------------------------*/
 
@@ -101,10 +103,14 @@ static void vTestEntry( void ** ppvState )
                                               NULL ),
                       eAzureIoTSuccess );
 
-    assert_int_equal( AzureIoTHubClient_SetSymmetricKey( &xAzureIoTHubClient,
-                                                         ( const uint8_t * ) ppcArgv[ 4 ],
-                                                         strlen( ppcArgv[ 4 ] ),
-                                                         ulCalculateHMAC ),
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Init( &xHMACContext,
+                                                     ( const uint8_t * ) ppcArgv[ 4 ],
+                                                     strlen( ppcArgv[ 4 ] ) ),
+                      eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKeyContext( &xAzureIoTHubClient,
+                                                                AzureIoTCrypto_HMACSHA256Sign,
+                                                                &xHMACContext ),
                       eAzureIoTSuccess );
 
     assert_int_equal( AzureIoTHubClient_Connect( &xAzureIoTHubClient,
@@ -129,6 +135,7 @@ static void vTestEntry( void ** ppvState )
 
     AzureIoTHubClient_Disconnect( &xAzureIoTHubClient );
     AzureIoTHubClient_Deinit( &xAzureIoTHubClient );
+    AzureIoTCrypto_HMACSHA256Deinit( &xHMACContext );
     TLS_FreeRTOS_Disconnect( &xNetworkContext );
 }
 /*-----------------------------------------------------------*/
@@ -0,0 +1,157 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_adu_download_bench.c
+ * @brief Benchmark for the end-to-end time of downloading and verifying an ADU image.
+ *
+ * The "read back" figure disables the incremental hash, so #AzureIoTADUDownload_VerifyImage falls back to
+ * #AzureIoTPlatform_VerifyImage and the dummy flash port hashes the whole bank again, as before. The
+ * "incremental" figure hashes every chunk as it is written and only compares the digest at the end. HTTP and
+ * flash are RAM backed here, so the read back cost is a lower bound of what a real flash bank adds.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_adu_download.h"
+
+#include "azure/core/az_base64.h"
+/*-----------------------------------------------------------*/
+
+#define benchITERATIONS    ( 50 )
+#define benchIMAGE_SIZE    ( 60 * 1024 )
+#define benchCHUNK_SIZE    ( 4096 )
+#define benchHOST          "unittest.blob.core.windows.net"
+#define benchPATH          "/update/image.bin"
+/*-----------------------------------------------------------*/
+
+extern const uint8_t * pucTestHTTPContent;
+extern uint32_t ulTestHTTPMaxBodyLength;
+
+static AzureIoTHTTP_t xHTTPClient;
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static AzureADUImage_t xAduImage;
+static uint8_t ucImage[ benchIMAGE_SIZE ];
+static uint8_t ucImageHash[ 64 ];
+static char cHeaderBuffer[ 256 ];
+static char cResponseBuffer[ 2 * ( benchCHUNK_SIZE + 256 ) ];
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests();
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvUpdateBench( AzureIoTADUDownload_t * pxDownload,
+                                const AzureIoTADUUpdateManifestFileHash_t * pxFileHash,
+                                bool xIncremental )
+{
+    uint32_t ulChunkCount = ( benchIMAGE_SIZE + benchCHUNK_SIZE - 1 ) / benchCHUNK_SIZE;
+    uint64_t ullStart;
+
+    will_return_count( AzureIoTHTTP_Request, eAzureIoTHTTPSuccess, ulChunkCount * benchITERATIONS );
+    will_return_count( AzureIoTPlatform_WriteBlock, eAzureIoTSuccess, ulChunkCount * benchITERATIONS );
+    will_return_count( AzureIoTHTTP_RequestSize, benchIMAGE_SIZE, benchITERATIONS );
+    ullStart = prvGetNanoseconds();
+
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        assert_int_equal( AzureIoTADUDownload_Start( pxDownload, 0 ), eAzureIoTSuccess );
+        pxDownload->_internal.xHashing = xIncremental;
+
+        while( !AzureIoTADUDownload_IsComplete( pxDownload ) )
+        {
+            ( void ) AzureIoTADUDownload_Process( pxDownload );
+        }
+
+        assert_int_equal( AzureIoTADUDownload_VerifyImage( pxDownload, pxFileHash ), eAzureIoTSuccess );
+    }
+
+    return prvGetNanoseconds() - ullStart;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_UpdateBench( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    AzureIoTADUDownloadOptions_t xOptions;
+    AzureIoTADUUpdateManifestFileHash_t xFileHash;
+    AzureIoTCryptoSHA256Context_t xContext;
+    uint8_t ucDigest[ azureiotcryptoSHA256_SIZE ];
+    int32_t lImageHashLength;
+    uint64_t ullReadBackNs;
+    uint64_t ullIncrementalNs;
+
+    ( void ) ppvState;
+
+    for( uint32_t ulIndex = 0; ulIndex < benchIMAGE_SIZE; ulIndex++ )
+    {
+        ucImage[ ulIndex ] = ( uint8_t ) ( ulIndex * 31 );
+    }
+
+    assert_int_equal( AzureIoTCrypto_SHA256Init( &xContext ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_SHA256Update( &xContext, ucImage, sizeof( ucImage ) ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_SHA256Finish( &xContext, ucDigest, sizeof( ucDigest ) ), eAzureIoTSuccess );
+    assert_false( az_result_failed( az_base64_encode( az_span_create( ucImageHash, sizeof( ucImageHash ) ),
+                                                      az_span_create( ucDigest, sizeof( ucDigest ) ),
+                                                      &lImageHashLength ) ) );
+    xFileHash.pucId = ( uint8_t * ) "sha256";
+    xFileHash.ulIdLength = sizeof( "sha256" ) - 1;
+    xFileHash.pucHash = ucImageHash;
+    xFileHash.ulHashLength = ( uint32_t ) lImageHashLength;
+
+    assert_int_equal( AzureIoTADUDownload_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulChunkSize = benchCHUNK_SIZE;
+    assert_int_equal( AzureIoTADUDownload_Init( &xDownload, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                benchHOST, sizeof( benchHOST ) - 1,
+                                                benchPATH, sizeof( benchPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                &xOptions ),
+                      eAzureIoTSuccess );
+
+    pucTestHTTPContent = ucImage;
+    ulTestHTTPMaxBodyLength = 0;
+    assert_int_equal( AzureIoTPlatform_Init( &xAduImage ), eAzureIoTSuccess );
+
+    ullReadBackNs = prvUpdateBench( &xDownload, &xFileHash, false );
+    ullIncrementalNs = prvUpdateBench( &xDownload, &xFileHash, true );
+
+    printf( "[ BENCH    ] %u byte image | read back: %8llu ns/update | incremental: %8llu ns/update\n",
+            ( unsigned ) benchIMAGE_SIZE,
+            ( unsigned long long ) ( ullReadBackNs / benchITERATIONS ),
+            ( unsigned long long ) ( ullIncrementalNs / benchITERATIONS ) );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTADUDownload_UpdateBench )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_adu_download_bench", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,373 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_adu_download.h"
+/*-----------------------------------------------------------*/
+
+#define testIMAGE           "0123456789"
+#define testIMAGE_SIZE      ( sizeof( testIMAGE ) - 1 )
+#define testCHUNK_SIZE      ( 4 )
+#define testHOST            "unittest.blob.core.windows.net"
+#define testPATH            "/update/image.bin"
+#define testIMAGE_HASH      "hNiYd/DUBB77a/kaFvAkjy/Vc+avBcGflr7bn4gveII="
+#define testOTHER_HASH      "dhnujOpJGH8wlhbjDs9UvgciWbQ3YPH1UKZElF1VcvI="
+/*-----------------------------------------------------------*/
+
+extern const uint8_t * pucTestHTTPContent;
+extern uint32_t ulTestHTTPMaxBodyLength;
+extern char * pcTestHTTPLastResponseBuffer;
+extern uint32_t ulTestHTTPInitCount;
+extern uint8_t ucTestFlash[];
+
+static AzureIoTHTTP_t xHTTPClient;
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static AzureADUImage_t xAduImage;
+static char cHeaderBuffer[ 64 ];
+static char cResponseBuffer[ 2 * ( testCHUNK_SIZE + 4 ) ];
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests();
+
+static void prvSetupTestDownload( AzureIoTADUDownload_t * pxDownload )
+{
+    AzureIoTADUDownloadOptions_t xOptions;
+
+    assert_int_equal( AzureIoTADUDownload_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulChunkSize = testCHUNK_SIZE;
+    xOptions.ulMaxRetries = 1;
+
+    assert_int_equal( AzureIoTADUDownload_Init( pxDownload, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                testHOST, sizeof( testHOST ) - 1,
+                                                testPATH, sizeof( testPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                &xOptions ),
+                      eAzureIoTSuccess );
+
+    pucTestHTTPContent = ( const uint8_t * ) testIMAGE;
+    ulTestHTTPMaxBodyLength = 0;
+    assert_int_equal( AzureIoTPlatform_Init( &xAduImage ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartTestDownload( AzureIoTADUDownload_t * pxDownload,
+                                  uint32_t ulResumeOffset )
+{
+    will_return( AzureIoTHTTP_RequestSize, testIMAGE_SIZE );
+    assert_int_equal( AzureIoTADUDownload_Start( pxDownload, ulResumeOffset ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessChunk( AzureIoTADUDownload_t * pxDownload )
+{
+    will_return( AzureIoTHTTP_Request, eAzureIoTHTTPSuccess );
+    will_return( AzureIoTPlatform_WriteBlock, eAzureIoTSuccess );
+    assert_int_equal( AzureIoTADUDownload_Process( pxDownload ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Init_Failure( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    AzureIoTADUDownloadOptions_t xOptions;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTADUDownload_OptionsInit( NULL ), eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when download is NULL */
+    assert_int_equal( AzureIoTADUDownload_Init( NULL, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                testHOST, sizeof( testHOST ) - 1,
+                                                testPATH, sizeof( testPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when host is NULL */
+    assert_int_equal( AzureIoTADUDownload_Init( &xDownload, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                NULL, 0,
+                                                testPATH, sizeof( testPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when response buffer halves cannot hold the default chunk size */
+    assert_int_equal( AzureIoTADUDownload_Init( &xDownload, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                testHOST, sizeof( testHOST ) - 1,
+                                                testPATH, sizeof( testPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when chunk size is zero */
+    assert_int_equal( AzureIoTADUDownload_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulChunkSize = 0;
+    assert_int_equal( AzureIoTADUDownload_Init( &xDownload, &xHTTPClient, &xTransportInterface, &xAduImage,
+                                                testHOST, sizeof( testHOST ) - 1,
+                                                testPATH, sizeof( testPATH ) - 1,
+                                                cHeaderBuffer, sizeof( cHeaderBuffer ),
+                                                cResponseBuffer, sizeof( cResponseBuffer ),
+                                                &xOptions ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Start_Failure( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+
+    assert_int_equal( AzureIoTADUDownload_Start( NULL, 0 ), eAzureIoTErrorInvalidArgument );
+
+    /* Process before start fails */
+    assert_int_equal( AzureIoTADUDownload_Process( &xDownload ), eAzureIoTErrorInvalidArgument );
+    assert_false( AzureIoTADUDownload_IsComplete( &xDownload ) );
+
+    will_return( AzureIoTHTTP_RequestSize, -1 );
+    assert_int_equal( AzureIoTADUDownload_Start( &xDownload, 0 ), eAzureIoTErrorFailed );
+
+    will_return( AzureIoTHTTP_RequestSize, testIMAGE_SIZE );
+    assert_int_equal( AzureIoTADUDownload_Start( &xDownload, testIMAGE_SIZE + 1 ), eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Process_Success( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    char * pcPreviousResponseBuffer;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+    ulTestHTTPInitCount = 0;
+    prvStartTestDownload( &xDownload, 0 );
+
+    prvProcessChunk( &xDownload );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), testCHUNK_SIZE );
+    pcPreviousResponseBuffer = pcTestHTTPLastResponseBuffer;
+
+    /* Next chunk is received in the other half of the response buffer */
+    prvProcessChunk( &xDownload );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), 2 * testCHUNK_SIZE );
+    assert_ptr_not_equal( pcTestHTTPLastResponseBuffer, pcPreviousResponseBuffer );
+
+    /* Last chunk is short */
+    prvProcessChunk( &xDownload );
+    assert_true( AzureIoTADUDownload_IsComplete( &xDownload ) );
+    assert_memory_equal( ucTestFlash, testIMAGE, testIMAGE_SIZE );
+
+    /* GET headers were built once for all the range requests */
+    assert_int_equal( ulTestHTTPInitCount, 1 );
+
+    /* Nothing left to request */
+    assert_int_equal( AzureIoTADUDownload_Process( &xDownload ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Process_ShortBodySuccess( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+    prvStartTestDownload( &xDownload, 0 );
+
+    /* Only the received bytes are committed */
+    ulTestHTTPMaxBodyLength = 3;
+    prvProcessChunk( &xDownload );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), 3 );
+
+    ulTestHTTPMaxBodyLength = 0;
+
+    while( !AzureIoTADUDownload_IsComplete( &xDownload ) )
+    {
+        prvProcessChunk( &xDownload );
+    }
+
+    assert_memory_equal( ucTestFlash, testIMAGE, testIMAGE_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Process_RetryAndResumeSuccess( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+    prvStartTestDownload( &xDownload, 0 );
+    prvProcessChunk( &xDownload );
+
+    /* One failure is retried within the call */
+    will_return( AzureIoTHTTP_Request, eAzureIoTHTTPNetworkError );
+    prvProcessChunk( &xDownload );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), 2 * testCHUNK_SIZE );
+
+    /* Out of retries, offset is kept for resume */
+    will_return_count( AzureIoTHTTP_Request, eAzureIoTHTTPNetworkError, 2 );
+    assert_int_equal( AzureIoTADUDownload_Process( &xDownload ), eAzureIoTErrorFailed );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), 2 * testCHUNK_SIZE );
+
+    /* Failed flash write is not committed */
+    will_return( AzureIoTHTTP_Request, eAzureIoTHTTPSuccess );
+    will_return( AzureIoTPlatform_WriteBlock, eAzureIoTErrorFailed );
+    assert_int_equal( AzureIoTADUDownload_Process( &xDownload ), eAzureIoTErrorFailed );
+    assert_int_equal( AzureIoTADUDownload_GetCommittedOffset( &xDownload ), 2 * testCHUNK_SIZE );
+
+    prvProcessChunk( &xDownload );
+    assert_true( AzureIoTADUDownload_IsComplete( &xDownload ) );
+    assert_memory_equal( ucTestFlash, testIMAGE, testIMAGE_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_Start_ResumeOffsetSuccess( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+
+    /* Bytes committed by a previous run are not requested again */
+    prvStartTestDownload( &xDownload, 2 * testCHUNK_SIZE );
+    prvProcessChunk( &xDownload );
+    assert_true( AzureIoTADUDownload_IsComplete( &xDownload ) );
+    assert_memory_equal( ucTestFlash + 2 * testCHUNK_SIZE, testIMAGE + 2 * testCHUNK_SIZE,
+                         testIMAGE_SIZE - 2 * testCHUNK_SIZE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestFileHash( AzureIoTADUUpdateManifestFileHash_t * pxFileHash,
+                                  const char * pcHash )
+{
+    pxFileHash->pucId = ( uint8_t * ) "sha256";
+    pxFileHash->ulIdLength = sizeof( "sha256" ) - 1;
+    pxFileHash->pucHash = ( uint8_t * ) pcHash;
+    pxFileHash->ulHashLength = ( uint32_t ) strlen( pcHash );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_VerifyImage_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    AzureIoTADUUpdateManifestFileHash_t xFileHash;
+
+    ( void ) ppvState;
+
+    prvSetupTestFileHash( &xFileHash, testIMAGE_HASH );
+    prvSetupTestDownload( &xDownload );
+
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, NULL ), eAzureIoTErrorInvalidArgument );
+
+    /* Fail verify when the download is not complete */
+    prvStartTestDownload( &xDownload, 0 );
+    prvProcessChunk( &xDownload );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_VerifyImage_Success( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    AzureIoTADUUpdateManifestFileHash_t xFileHash;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+    prvStartTestDownload( &xDownload, 0 );
+
+    /* Retried and short chunks are hashed once */
+    will_return( AzureIoTHTTP_Request, eAzureIoTHTTPNetworkError );
+    ulTestHTTPMaxBodyLength = 3;
+    prvProcessChunk( &xDownload );
+    ulTestHTTPMaxBodyLength = 0;
+
+    will_return( AzureIoTHTTP_Request, eAzureIoTHTTPSuccess );
+    will_return( AzureIoTPlatform_WriteBlock, eAzureIoTErrorFailed );
+    assert_int_equal( AzureIoTADUDownload_Process( &xDownload ), eAzureIoTErrorFailed );
+
+    while( !AzureIoTADUDownload_IsComplete( &xDownload ) )
+    {
+        prvProcessChunk( &xDownload );
+    }
+
+    /* Flash is not read back, the digest was calculated while downloading */
+    memset( ucTestFlash, 0xFF, testIMAGE_SIZE );
+
+    prvSetupTestFileHash( &xFileHash, testIMAGE_HASH );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTSuccess );
+
+    prvSetupTestFileHash( &xFileHash, testOTHER_HASH );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTErrorFailed );
+
+    prvSetupTestFileHash( &xFileHash, "bm90IGEgc2hhMjU2" );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTErrorFailed );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTADUDownload_VerifyImage_ResumeFromFlashSuccess( void ** ppvState )
+{
+    AzureIoTADUDownload_t xDownload;
+    AzureIoTADUUpdateManifestFileHash_t xFileHash;
+
+    ( void ) ppvState;
+
+    prvSetupTestDownload( &xDownload );
+    prvStartTestDownload( &xDownload, 0 );
+    prvProcessChunk( &xDownload );
+    prvProcessChunk( &xDownload );
+
+    /* Resuming after a reboot has no hash of the bytes before the offset, so flash is read back */
+    prvStartTestDownload( &xDownload, 2 * testCHUNK_SIZE );
+    prvProcessChunk( &xDownload );
+    assert_true( AzureIoTADUDownload_IsComplete( &xDownload ) );
+
+    prvSetupTestFileHash( &xFileHash, testIMAGE_HASH );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTSuccess );
+
+    prvSetupTestFileHash( &xFileHash, testOTHER_HASH );
+    assert_int_equal( AzureIoTADUDownload_VerifyImage( &xDownload, &xFileHash ), eAzureIoTErrorFailed );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTADUDownload_Init_Failure ),
+        cmocka_unit_test( testAzureIoTADUDownload_Start_Failure ),
+        cmocka_unit_test( testAzureIoTADUDownload_Process_Success ),
+        cmocka_unit_test( testAzureIoTADUDownload_Process_ShortBodySuccess ),
+        cmocka_unit_test( testAzureIoTADUDownload_Process_RetryAndResumeSuccess ),
+        cmocka_unit_test( testAzureIoTADUDownload_Start_ResumeOffsetSuccess ),
+        cmocka_unit_test( testAzureIoTADUDownload_VerifyImage_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTADUDownload_VerifyImage_Success ),
+        cmocka_unit_test( testAzureIoTADUDownload_VerifyImage_ResumeFromFlashSuccess )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_adu_download_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,178 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_cmocka_crypto.c
+ * @brief Unit test crypto port with a plain SHA256 implementation.
+ *
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_crypto.h"
+#include "azure_iot_crypto_port.h"
+/*-----------------------------------------------------------*/
+
+#define testROTR( x, n )    ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+static const uint32_t ulSHA256K[ 64 ] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+/*-----------------------------------------------------------*/
+
+static void prvSHA256Block( AzureIoTCryptoPortSHA256Context_t * pxContext,
+                            const uint8_t * pucBlock )
+{
+    uint32_t ulW[ 64 ];
+    uint32_t ulV[ 8 ];
+    uint32_t ulT1;
+    uint32_t ulT2;
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < 16; ulIndex++ )
+    {
+        ulW[ ulIndex ] = ( ( uint32_t ) pucBlock[ ulIndex * 4 ] << 24 ) | ( ( uint32_t ) pucBlock[ ulIndex * 4 + 1 ] << 16 ) |
+                         ( ( uint32_t ) pucBlock[ ulIndex * 4 + 2 ] << 8 ) | ( uint32_t ) pucBlock[ ulIndex * 4 + 3 ];
+    }
+
+    for( ulIndex = 16; ulIndex < 64; ulIndex++ )
+    {
+        ulW[ ulIndex ] = ( testROTR( ulW[ ulIndex - 2 ], 17 ) ^ testROTR( ulW[ ulIndex - 2 ], 19 ) ^ ( ulW[ ulIndex - 2 ] >> 10 ) ) +
+                         ulW[ ulIndex - 7 ] +
+                         ( testROTR( ulW[ ulIndex - 15 ], 7 ) ^ testROTR( ulW[ ulIndex - 15 ], 18 ) ^ ( ulW[ ulIndex - 15 ] >> 3 ) ) +
+                         ulW[ ulIndex - 16 ];
+    }
+
+    memcpy( ulV, pxContext->ulState, sizeof( ulV ) );
+
+    for( ulIndex = 0; ulIndex < 64; ulIndex++ )
+    {
+        ulT1 = ulV[ 7 ] + ( testROTR( ulV[ 4 ], 6 ) ^ testROTR( ulV[ 4 ], 11 ) ^ testROTR( ulV[ 4 ], 25 ) ) +
+               ( ( ulV[ 4 ] & ulV[ 5 ] ) ^ ( ~ulV[ 4 ] & ulV[ 6 ] ) ) + ulSHA256K[ ulIndex ] + ulW[ ulIndex ];
+        ulT2 = ( testROTR( ulV[ 0 ], 2 ) ^ testROTR( ulV[ 0 ], 13 ) ^ testROTR( ulV[ 0 ], 22 ) ) +
+               ( ( ulV[ 0 ] & ulV[ 1 ] ) ^ ( ulV[ 0 ] & ulV[ 2 ] ) ^ ( ulV[ 1 ] & ulV[ 2 ] ) );
+        memmove( &ulV[ 1 ], &ulV[ 0 ], 7 * sizeof( uint32_t ) );
+        ulV[ 4 ] += ulT1;
+        ulV[ 0 ] = ulT1 + ulT2;
+    }
+
+    for( ulIndex = 0; ulIndex < 8; ulIndex++ )
+    {
+        pxContext->ulState[ ulIndex ] += ulV[ ulIndex ];
+    }
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSHA256Init( AzureIoTCryptoPortSHA256Context_t * pxContext )
+{
+    static const uint32_t ulInitialState[ 8 ] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy( pxContext->ulState, ulInitialState, sizeof( ulInitialState ) );
+    pxContext->ullLength = 0;
+    pxContext->ulBlockLength = 0;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSHA256Update( AzureIoTCryptoPortSHA256Context_t * pxContext,
+                                         const uint8_t * pucInput,
+                                         uint32_t ulInputLength )
+{
+    pxContext->ullLength += ulInputLength;
+
+    while( ulInputLength > 0 )
+    {
+        pxContext->ucBlock[ pxContext->ulBlockLength++ ] = *pucInput++;
+        ulInputLength--;
+
+        if( pxContext->ulBlockLength == sizeof( pxContext->ucBlock ) )
+        {
+            prvSHA256Block( pxContext, pxContext->ucBlock );
+            pxContext->ulBlockLength = 0;
+        }
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvSHA256Finish( AzureIoTCryptoPortSHA256Context_t * pxContext,
+                                         uint8_t * pucOutput,
+                                         uint32_t ulOutputLength )
+{
+    uint64_t ullBitLength = pxContext->ullLength * 8;
+    uint8_t ucPad = 0x80;
+    uint32_t ulIndex;
+
+    if( ulOutputLength < azureiotcryptoSHA256_SIZE )
+    {
+        return eAzureIoTErrorInvalidArgument;
+    }
+
+    ( void ) prvSHA256Update( pxContext, &ucPad, 1 );
+    ucPad = 0;
+
+    while( pxContext->ulBlockLength != 56 )
+    {
+        ( void ) prvSHA256Update( pxContext, &ucPad, 1 );
+    }
+
+    for( ulIndex = 0; ulIndex < 8; ulIndex++ )
+    {
+        ucPad = ( uint8_t ) ( ullBitLength >> ( 56 - ulIndex * 8 ) );
+        ( void ) prvSHA256Update( pxContext, &ucPad, 1 );
+    }
+
+    for( ulIndex = 0; ulIndex < 8; ulIndex++ )
+    {
+        pucOutput[ ulIndex * 4 ] = ( uint8_t ) ( pxContext->ulState[ ulIndex ] >> 24 );
+        pucOutput[ ulIndex * 4 + 1 ] = ( uint8_t ) ( pxContext->ulState[ ulIndex ] >> 16 );
+        pucOutput[ ulIndex * 4 + 2 ] = ( uint8_t ) ( pxContext->ulState[ ulIndex ] >> 8 );
+        pucOutput[ ulIndex * 4 + 3 ] = ( uint8_t ) pxContext->ulState[ ulIndex ];
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Init( AzureIoTCryptoSHA256Context_t * pxContext )
+{
+    return prvSHA256Init( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ) );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Update( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              const uint8_t * pucInput,
+                                              uint32_t ulInputLength )
+{
+    return prvSHA256Update( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucInput, ulInputLength );
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTResult_t AzureIoTCrypto_SHA256Finish( AzureIoTCryptoSHA256Context_t * pxContext,
+                                              uint8_t * pucOutput,
+                                              uint32_t ulOutputLength )
+{
+    return prvSHA256Finish( azureiotcryptoPORT_SHA256_CONTEXT( pxContext ), pucOutput, ulOutputLength );
+}
+/*-----------------------------------------------------------*/
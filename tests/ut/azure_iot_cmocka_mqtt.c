@@ -27,6 +27,7 @@ uint16_t usTestPacketId = 1;
 const uint8_t * pucPublishPayload = NULL;
 uint16_t usSentQOS = 0xFF;
 uint32_t ulDelayReceivePacket = 0;
+bool xTestSessionPresent = false;
 /*-----------------------------------------------------------*/
 
 AzureIoTMQTTResult_t AzureIoTMQTT_Init( AzureIoTMQTTHandle_t xContext,
@@ -57,7 +58,11 @@ AzureIoTMQTTResult_t AzureIoTMQTT_Connect( AzureIoTMQTTHandle_t xContext,
     ( void ) pxConnectInfo;
     ( void ) pxWillInfo;
     ( void ) ulMilliseconds;
-    ( void ) pxSessionPresent;
+
+    if( pxSessionPresent != NULL )
+    {
+        *pxSessionPresent = xTestSessionPresent;
+    }
 
     return ( AzureIoTMQTTResult_t ) mock();
 }
@@ -163,3 +168,23 @@ uint16_t AzureIoTMQTT_GetPacketId( AzureIoTMQTTHandle_t xContext )
 
     return usTestPacketId;
 }
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_GetSubAckStatusCodes( const AzureIoTMQTTPacketInfo_t * pxSubackPacket,
+                                                        uint8_t ** ppucPayloadStart,
+                                                        size_t * pxPayloadSize )
+{
+    /* The SUBACK payload follows the two bytes of the packet identifier */
+    if( ( pxSubackPacket->pucRemainingData != NULL ) && ( pxSubackPacket->xRemainingLength > 2 ) )
+    {
+        *ppucPayloadStart = pxSubackPacket->pucRemainingData + 2;
+        *pxPayloadSize = pxSubackPacket->xRemainingLength - 2;
+    }
+    else
+    {
+        *ppucPayloadStart = NULL;
+        *pxPayloadSize = 0;
+    }
+
+    return eAzureIoTMQTTSuccess;
+}
@@ -0,0 +1,379 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_crypto_bench.c
+ * @brief Benchmark for the throughput and latency of the crypto port primitives.
+ *
+ * Every primitive is checked against a known answer before it is timed, so a port which is fast but wrong
+ * fails here. The figures are for the mbedTLS port built for the unit tests, with -O0 and coverage, so they
+ * are only meaningful to compare ports or changes built the same way.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "mbedtls/threading.h"
+
+#include "threading_alt.h"
+
+#include "azure_iot_crypto.h"
+/*-----------------------------------------------------------*/
+
+#define benchITERATIONS          ( 200 )
+#define benchRS256_ITERATIONS    ( 20 )
+#define benchMAX_INPUT_SIZE      ( 16 * 1024 )
+#define benchRS256_MESSAGE       "Azure IoT middleware crypto bench"
+#define benchSAS_MESSAGE         "contoso.azure-devices.net%2Fdevices%2Fgateway-device-0001\n1700000000"
+#define benchSAS_KEY             "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8="
+#define benchSAS_KEY_SIZE        ( 32 )
+/*-----------------------------------------------------------*/
+
+/* SHA256 of "abc", from FIPS 180-2 */
+static const uint8_t ucSHA256ABC[ azureiotcryptoSHA256_SIZE ] =
+{
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+    0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+};
+
+/* HMAC SHA256 of "what do ya want for nothing?" keyed with "Jefe", from RFC 4231 */
+static const uint8_t ucHMACSHA256Jefe[ azureiotcryptoSHA256_SIZE ] =
+{
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+};
+
+/* RSA 3072 public key and RS256 signature of benchRS256_MESSAGE */
+static const uint8_t ucRS256N[ 384 ] =
+{
+    0xb7, 0x04, 0x17, 0x2d, 0x90, 0x7a, 0xf7, 0x65, 0xbf, 0x55, 0x3b, 0xf0, 0x6f, 0x52, 0xba, 0xdc,
+    0x11, 0x84, 0xa7, 0x43, 0x4b, 0x97, 0x2b, 0x00, 0x28, 0xa8, 0xed, 0x96, 0xa6, 0x27, 0xa3, 0x86,
+    0x73, 0xf3, 0x36, 0xa0, 0x99, 0x95, 0x57, 0x68, 0x25, 0x01, 0x02, 0x99, 0x17, 0xa9, 0x8e, 0x8b,
+    0x3b, 0xc9, 0x1e, 0x1d, 0x4c, 0x64, 0x89, 0xd6, 0xa3, 0xea, 0xd6, 0x89, 0xa1, 0xa3, 0x57, 0x7f,
+    0x96, 0x45, 0xad, 0x4e, 0x4c, 0x5e, 0x07, 0x95, 0xe6, 0xc9, 0x29, 0x19, 0x3a, 0xdf, 0x30, 0x0e,
+    0x61, 0x09, 0xd4, 0x30, 0x18, 0x6a, 0x4b, 0x6f, 0x6b, 0xce, 0x43, 0xe6, 0x74, 0x5b, 0xcc, 0xf9,
+    0xaf, 0x29, 0xe9, 0xb5, 0x14, 0x3e, 0x89, 0x94, 0xd9, 0x00, 0x3c, 0x54, 0x58, 0xdf, 0xcd, 0xb5,
+    0xfe, 0x02, 0x30, 0x39, 0x73, 0xd7, 0x8e, 0xcb, 0x76, 0x45, 0x99, 0x3c, 0x7a, 0x61, 0xdb, 0x25,
+    0xa1, 0xb6, 0x05, 0x12, 0x89, 0x97, 0x0c, 0xc1, 0xc4, 0x03, 0x6a, 0x83, 0xe6, 0xf9, 0x0b, 0xb9,
+    0x1b, 0x8d, 0xaf, 0x21, 0xf7, 0xca, 0xe1, 0xc7, 0x16, 0xb1, 0x4a, 0xc5, 0x2c, 0x54, 0x2b, 0x33,
+    0x36, 0xc3, 0xbf, 0x2b, 0xaf, 0xe1, 0x82, 0x75, 0x18, 0x0f, 0x1f, 0x7e, 0xad, 0x14, 0x48, 0x57,
+    0x3e, 0x2b, 0x3e, 0x3d, 0x00, 0xb2, 0x59, 0x49, 0x60, 0x8e, 0x66, 0x18, 0xd1, 0xa8, 0xac, 0xbf,
+    0x56, 0x2a, 0xd0, 0x2d, 0x45, 0x52, 0x7b, 0x91, 0xbc, 0x17, 0x3f, 0x22, 0x6a, 0xd1, 0x98, 0x04,
+    0xd2, 0xd3, 0x45, 0x94, 0xe8, 0xb0, 0x36, 0x9c, 0x42, 0xc0, 0x6f, 0x69, 0x8f, 0x00, 0x78, 0x68,
+    0x13, 0xb6, 0x34, 0x9e, 0xc4, 0x43, 0x07, 0x6f, 0x1c, 0xd6, 0xe8, 0xa4, 0xff, 0xc4, 0xc1, 0x7f,
+    0x2a, 0x5e, 0x26, 0x12, 0x57, 0xc3, 0xae, 0x0a, 0x63, 0xf8, 0x9c, 0x31, 0x25, 0xc6, 0x60, 0x17,
+    0xbb, 0xff, 0xbc, 0x24, 0x92, 0xf3, 0x38, 0xb8, 0xed, 0x85, 0x4b, 0x7a, 0x8a, 0x39, 0x37, 0x68,
+    0x52, 0x46, 0xce, 0xba, 0xc8, 0x76, 0xaa, 0xdb, 0x4b, 0xbc, 0x3d, 0x15, 0x4c, 0xc5, 0x5d, 0x24,
+    0xf5, 0x74, 0x63, 0xe9, 0xf8, 0x92, 0x7e, 0xd0, 0x86, 0x1a, 0x56, 0x4b, 0xeb, 0x64, 0x16, 0x08,
+    0x93, 0x67, 0xf5, 0xc2, 0xb9, 0xd6, 0x66, 0x0b, 0x5e, 0x1c, 0x17, 0x2b, 0xb8, 0x65, 0xe5, 0x73,
+    0x3c, 0x34, 0x17, 0xf5, 0x21, 0x72, 0x86, 0x27, 0xb6, 0x33, 0x6b, 0x4c, 0x18, 0xc0, 0x34, 0x4f,
+    0x18, 0x71, 0xf1, 0x7c, 0x62, 0x49, 0xa4, 0xc8, 0x4a, 0xb7, 0x9a, 0xc8, 0xbc, 0xc7, 0x44, 0x56,
+    0xd1, 0x6a, 0xf5, 0x8f, 0x08, 0x8d, 0x7a, 0xb6, 0x5d, 0xb0, 0xb0, 0x98, 0x0b, 0x2e, 0x2d, 0xe4,
+    0x17, 0x7a, 0x60, 0x11, 0x60, 0xd9, 0x2f, 0xd9, 0x58, 0x88, 0xca, 0xc3, 0x06, 0xa8, 0x6a, 0x15
+};
+static const uint8_t ucRS256E[ 3 ] = { 0x01, 0x00, 0x01 };
+static const uint8_t ucRS256Signature[ 384 ] =
+{
+    0x8f, 0xd8, 0xe8, 0xdd, 0x70, 0x31, 0xb7, 0xe7, 0xf1, 0x6a, 0x7c, 0xdb, 0x7b, 0x66, 0x9f, 0x25,
+    0x73, 0xd1, 0x4f, 0x9c, 0xc0, 0x50, 0x42, 0x67, 0x4e, 0x76, 0x71, 0x3c, 0x82, 0xa3, 0x30, 0x2e,
+    0xa5, 0x2a, 0xb9, 0x58, 0x2e, 0xa4, 0xcf, 0xa8, 0xce, 0x0b, 0x46, 0xd5, 0x93, 0x3c, 0x0c, 0x75,
+    0x88, 0xf6, 0xae, 0x00, 0xda, 0xb7, 0x91, 0xcb, 0x65, 0x9f, 0x04, 0xd0, 0xe9, 0xf3, 0x93, 0x6a,
+    0x9f, 0x6d, 0x82, 0xbd, 0xe0, 0x1d, 0x27, 0x1f, 0x64, 0x50, 0xbd, 0x66, 0xae, 0x0f, 0xe6, 0x21,
+    0xa6, 0x72, 0xb2, 0x43, 0xda, 0x32, 0x65, 0xe1, 0xd1, 0x36, 0x4b, 0x96, 0x13, 0xc3, 0x3b, 0x65,
+    0x1e, 0x96, 0xf0, 0x7a, 0x7f, 0x84, 0x99, 0x72, 0x8f, 0xf0, 0xad, 0x22, 0x9e, 0xff, 0x41, 0x3d,
+    0xf8, 0xb1, 0x4a, 0xee, 0x84, 0x51, 0x1c, 0x58, 0x59, 0x01, 0xcc, 0xc1, 0x7d, 0x0d, 0x28, 0x24,
+    0x3e, 0x05, 0x3b, 0xde, 0x1e, 0x3e, 0xaf, 0x88, 0x0c, 0xd5, 0x31, 0x9c, 0x9b, 0x1f, 0x7d, 0xd5,
+    0x35, 0x26, 0x00, 0x17, 0xef, 0xa0, 0xd8, 0x19, 0xc6, 0xbe, 0x4c, 0xd7, 0xd4, 0x4e, 0xaf, 0xbb,
+    0xae, 0xdb, 0x84, 0x2b, 0x57, 0x31, 0x30, 0xd5, 0xb4, 0xca, 0x34, 0x5e, 0x4f, 0xd7, 0x1b, 0xfd,
+    0x2d, 0xe1, 0x19, 0x5b, 0xc4, 0x9f, 0xa1, 0x5d, 0xf7, 0x61, 0x3e, 0x86, 0x95, 0x38, 0x4f, 0xe9,
+    0x32, 0xba, 0xba, 0x2a, 0xfb, 0x95, 0xb2, 0x24, 0x95, 0x25, 0x27, 0x01, 0xd3, 0xbe, 0xd3, 0x97,
+    0x9b, 0xa3, 0x4f, 0xcc, 0x15, 0x85, 0xed, 0x54, 0x26, 0x5f, 0xc1, 0xd3, 0x3a, 0xbc, 0x28, 0xb5,
+    0x2e, 0x8e, 0xcb, 0x68, 0xdf, 0x0c, 0x92, 0xf4, 0xb3, 0x7f, 0x22, 0xf5, 0xba, 0x70, 0xd0, 0x82,
+    0x72, 0xfc, 0x4c, 0x86, 0x84, 0xb0, 0x4d, 0x61, 0x1a, 0xcb, 0xbc, 0xb0, 0x45, 0x8d, 0x8a, 0x35,
+    0xb8, 0x8a, 0x74, 0x6b, 0x4f, 0xfd, 0xac, 0xca, 0xd4, 0xc0, 0xda, 0x81, 0x20, 0x11, 0x67, 0x39,
+    0x74, 0x48, 0x59, 0x8f, 0x06, 0x10, 0xdd, 0x59, 0x6c, 0xb4, 0xce, 0x12, 0x09, 0x3a, 0xaf, 0x5d,
+    0x64, 0x67, 0xb6, 0x8f, 0xc7, 0xb1, 0xd2, 0x6f, 0x0b, 0xbe, 0xd2, 0x8b, 0xa1, 0xf1, 0x98, 0x16,
+    0xe3, 0xbf, 0xcb, 0x35, 0xd5, 0x1c, 0x4d, 0x31, 0xc9, 0x36, 0x80, 0x0c, 0x29, 0x00, 0x0d, 0x96,
+    0x66, 0x89, 0xd4, 0x79, 0x8d, 0x03, 0x05, 0x8a, 0xb6, 0xb8, 0x78, 0x7f, 0xdb, 0x7d, 0x65, 0x93,
+    0x22, 0x8f, 0x47, 0xc0, 0x19, 0x2b, 0xfc, 0x24, 0xcf, 0x31, 0x96, 0x9a, 0x71, 0xbf, 0xc8, 0x11,
+    0x91, 0x19, 0x0e, 0xc7, 0x13, 0x96, 0x1d, 0x6c, 0x1c, 0x2f, 0xf9, 0xda, 0x95, 0x35, 0x34, 0x69,
+    0xfe, 0xc8, 0x0a, 0xff, 0x70, 0x10, 0xb5, 0x4c, 0x8c, 0xed, 0x09, 0x52, 0x85, 0x26, 0x2a, 0x23
+};
+
+static uint8_t ucInput[ benchMAX_INPUT_SIZE ];
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests();
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintBench( const char * pcPrimitive,
+                           uint32_t ulInputLength,
+                           uint64_t ullTotalNs,
+                           uint64_t ullMaxNs,
+                           uint32_t ulIterations )
+{
+    uint64_t ullMeanNs = ullTotalNs / ulIterations;
+
+    printf( "[ BENCH    ] %-11s | %5u bytes | %10llu ns/op | %10llu ns worst case | %8.2f MB/s\n",
+            pcPrimitive, ( unsigned ) ulInputLength,
+            ( unsigned long long ) ullMeanNs, ( unsigned long long ) ullMaxNs,
+            ( ullMeanNs == 0 ) ? 0.0 : ( ( double ) ulInputLength * 1000.0 ) / ( double ) ullMeanNs );
+}
+/*-----------------------------------------------------------*/
+
+static int prvBenchSetup( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    /* Set the mutex functions for mbed TLS thread safety. */
+    mbedtls_threading_set_alt( mbedtls_platform_mutex_init,
+                               mbedtls_platform_mutex_free,
+                               mbedtls_platform_mutex_lock,
+                               mbedtls_platform_mutex_unlock );
+
+    for( uint32_t ulIndex = 0; ulIndex < benchMAX_INPUT_SIZE; ulIndex++ )
+    {
+        ucInput[ ulIndex ] = ( uint8_t ) ( ulIndex * 31 );
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTCrypto_SHA256Bench( void ** ppvState )
+{
+    static const uint32_t ulInputLengths[] = { 64, 1024, benchMAX_INPUT_SIZE };
+    AzureIoTCryptoSHA256Context_t xContext;
+    uint8_t ucDigest[ azureiotcryptoSHA256_SIZE ];
+    uint64_t ullStart;
+    uint64_t ullElapsed;
+    uint64_t ullTotalNs;
+    uint64_t ullMaxNs;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTCrypto_SHA256Calculate( "abc", 3, ( const char * ) ucDigest, sizeof( ucDigest ) ), eAzureIoTSuccess );
+    assert_memory_equal( ucDigest, ucSHA256ABC, sizeof( ucDigest ) );
+
+    /* The incremental API must match the one shot, whatever the split */
+    assert_int_equal( AzureIoTCrypto_SHA256Init( &xContext ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_SHA256Update( &xContext, ( const uint8_t * ) "a", 1 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_SHA256Update( &xContext, ( const uint8_t * ) "bc", 2 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_SHA256Finish( &xContext, ucDigest, sizeof( ucDigest ) ), eAzureIoTSuccess );
+    assert_memory_equal( ucDigest, ucSHA256ABC, sizeof( ucDigest ) );
+
+    for( uint32_t ulLength = 0; ulLength < sizeof( ulInputLengths ) / sizeof( ulInputLengths[ 0 ] ); ulLength++ )
+    {
+        ullTotalNs = 0;
+        ullMaxNs = 0;
+
+        for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+        {
+            ullStart = prvGetNanoseconds();
+            assert_int_equal( AzureIoTCrypto_SHA256Calculate( ( const char * ) ucInput, ulInputLengths[ ulLength ],
+                                                              ( const char * ) ucDigest, sizeof( ucDigest ) ),
+                              eAzureIoTSuccess );
+            ullElapsed = prvGetNanoseconds() - ullStart;
+            ullTotalNs += ullElapsed;
+            ullMaxNs = ( ullElapsed > ullMaxNs ) ? ullElapsed : ullMaxNs;
+        }
+
+        prvPrintBench( "sha256", ulInputLengths[ ulLength ], ullTotalNs, ullMaxNs, benchITERATIONS );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTCrypto_HMACSHA256Bench( void ** ppvState )
+{
+    uint8_t ucHMAC[ azureiotcryptoSHA256_SIZE ];
+    uint32_t ulBytesCopied = 0;
+    uint64_t ullStart;
+    uint64_t ullElapsed;
+    uint64_t ullTotalNs = 0;
+    uint64_t ullMaxNs = 0;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Calculate( ( const uint8_t * ) "Jefe", 4,
+                                                          ( const uint8_t * ) "what do ya want for nothing?", 28,
+                                                          ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+    assert_int_equal( ulBytesCopied, sizeof( ucHMAC ) );
+    assert_memory_equal( ucHMAC, ucHMACSHA256Jefe, sizeof( ucHMAC ) );
+    assert_int_not_equal( AzureIoTCrypto_HMACSHA256Calculate( ( const uint8_t * ) "Jefe", 4,
+                                                              ( const uint8_t * ) "what do ya want for nothing?", 28,
+                                                              ucHMAC, sizeof( ucHMAC ) - 1, &ulBytesCopied ), 0 );
+
+    /* The signature of a SAS token, with a 32 byte device key */
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        ullStart = prvGetNanoseconds();
+        assert_int_equal( AzureIoTCrypto_HMACSHA256Calculate( ucInput, 32,
+                                                              ( const uint8_t * ) benchSAS_MESSAGE, sizeof( benchSAS_MESSAGE ) - 1,
+                                                              ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+        ullElapsed = prvGetNanoseconds() - ullStart;
+        ullTotalNs += ullElapsed;
+        ullMaxNs = ( ullElapsed > ullMaxNs ) ? ullElapsed : ullMaxNs;
+    }
+
+    prvPrintBench( "hmac-sha256", sizeof( benchSAS_MESSAGE ) - 1, ullTotalNs, ullMaxNs, benchITERATIONS );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTCrypto_HMACSHA256ContextBench( void ** ppvState )
+{
+    AzureIoTCryptoHMACSHA256Context_t xContext;
+    uint8_t ucKey[ benchSAS_KEY_SIZE ];
+    uint8_t ucLongKey[ 128 ];
+    uint8_t ucLongDecodedKey[ 96 ];
+    uint8_t ucHMAC[ azureiotcryptoSHA256_SIZE ];
+    uint8_t ucExpectedHMAC[ azureiotcryptoSHA256_SIZE ];
+    uint32_t ulBytesCopied = 0;
+    uint64_t ullStart;
+    uint64_t ullElapsed;
+    uint64_t ullTotalNs = 0;
+    uint64_t ullMaxNs = 0;
+
+    ( void ) ppvState;
+
+    /* "SmVmZQ==" is "Jefe" base64 encoded */
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Init( &xContext, ( const uint8_t * ) "SmVmZQ==", 8 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Sign( &xContext, ( const uint8_t * ) "what do ya want for nothing?", 28,
+                                                     ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+    assert_int_equal( ulBytesCopied, sizeof( ucHMAC ) );
+    assert_memory_equal( ucHMAC, ucHMACSHA256Jefe, sizeof( ucHMAC ) );
+
+    /* Signing leaves the key schedule as it was */
+    memset( ucHMAC, 0, sizeof( ucHMAC ) );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Sign( &xContext, ( const uint8_t * ) "what do ya want for nothing?", 28,
+                                                     ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+    assert_memory_equal( ucHMAC, ucHMACSHA256Jefe, sizeof( ucHMAC ) );
+    assert_int_not_equal( AzureIoTCrypto_HMACSHA256Sign( &xContext, ( const uint8_t * ) "what do ya want for nothing?", 28,
+                                                         ucHMAC, sizeof( ucHMAC ) - 1, &ulBytesCopied ), 0 );
+    AzureIoTCrypto_HMACSHA256Deinit( &xContext );
+
+    /* Keys longer than a block once decoded are hashed first, as the one shot HMAC does. 128 'A' are 96 zero bytes */
+    memset( ucLongKey, 'A', sizeof( ucLongKey ) );
+    memset( ucLongDecodedKey, 0, sizeof( ucLongDecodedKey ) );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Calculate( ucLongDecodedKey, sizeof( ucLongDecodedKey ),
+                                                          ( const uint8_t * ) benchSAS_MESSAGE, sizeof( benchSAS_MESSAGE ) - 1,
+                                                          ucExpectedHMAC, sizeof( ucExpectedHMAC ), &ulBytesCopied ), 0 );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Init( &xContext, ucLongKey, sizeof( ucLongKey ) ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Sign( &xContext,
+                                                     ( const uint8_t * ) benchSAS_MESSAGE, sizeof( benchSAS_MESSAGE ) - 1,
+                                                     ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+    assert_memory_equal( ucHMAC, ucExpectedHMAC, sizeof( ucHMAC ) );
+    AzureIoTCrypto_HMACSHA256Deinit( &xContext );
+
+    assert_int_not_equal( AzureIoTCrypto_HMACSHA256Init( &xContext, ( const uint8_t * ) "Je*e", 4 ), eAzureIoTSuccess );
+
+    /* The signature of a SAS token, with the same 32 byte device key as the one shot HMAC */
+    for( uint32_t ulIndex = 0; ulIndex < sizeof( ucKey ); ulIndex++ )
+    {
+        ucKey[ ulIndex ] = ( uint8_t ) ulIndex;
+    }
+
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Calculate( ucKey, sizeof( ucKey ),
+                                                          ( const uint8_t * ) benchSAS_MESSAGE, sizeof( benchSAS_MESSAGE ) - 1,
+                                                          ucExpectedHMAC, sizeof( ucExpectedHMAC ), &ulBytesCopied ), 0 );
+    assert_int_equal( AzureIoTCrypto_HMACSHA256Init( &xContext, ( const uint8_t * ) benchSAS_KEY, sizeof( benchSAS_KEY ) - 1 ),
+                      eAzureIoTSuccess );
+
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        ullStart = prvGetNanoseconds();
+        assert_int_equal( AzureIoTCrypto_HMACSHA256Sign( &xContext,
+                                                         ( const uint8_t * ) benchSAS_MESSAGE, sizeof( benchSAS_MESSAGE ) - 1,
+                                                         ucHMAC, sizeof( ucHMAC ), &ulBytesCopied ), 0 );
+        ullElapsed = prvGetNanoseconds() - ullStart;
+        ullTotalNs += ullElapsed;
+        ullMaxNs = ( ullElapsed > ullMaxNs ) ? ullElapsed : ullMaxNs;
+    }
+
+    assert_memory_equal( ucHMAC, ucExpectedHMAC, sizeof( ucHMAC ) );
+    AzureIoTCrypto_HMACSHA256Deinit( &xContext );
+
+    prvPrintBench( "hmac-ctx", sizeof( benchSAS_MESSAGE ) - 1, ullTotalNs, ullMaxNs, benchITERATIONS );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTCrypto_RS256VerifyBench( void ** ppvState )
+{
+    uint8_t ucDigest[ azureiotcryptoSHA256_SIZE ];
+    uint8_t ucSignature[ sizeof( ucRS256Signature ) ];
+    uint8_t ucBuffer[ azureiotcryptoSHA256_SIZE ];
+    uint64_t ullStart;
+    uint64_t ullElapsed;
+    uint64_t ullTotalNs = 0;
+    uint64_t ullMaxNs = 0;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTCrypto_SHA256Calculate( benchRS256_MESSAGE, sizeof( benchRS256_MESSAGE ) - 1,
+                                                      ( const char * ) ucDigest, sizeof( ucDigest ) ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTCrypto_RS256Verify( benchRS256_MESSAGE, sizeof( benchRS256_MESSAGE ) - 1,
+                                                  ( const char * ) ucRS256Signature, sizeof( ucRS256Signature ),
+                                                  ( const char * ) ucRS256N, sizeof( ucRS256N ),
+                                                  ( const char * ) ucRS256E, sizeof( ucRS256E ),
+                                                  ( const char * ) ucBuffer, sizeof( ucBuffer ) ),
+                      eAzureIoTSuccess );
+
+    /* A modified signature, or a truncated one, is rejected */
+    memcpy( ucSignature, ucRS256Signature, sizeof( ucSignature ) );
+    ucSignature[ 100 ] ^= 0x01;
+    assert_int_not_equal( AzureIoTCrypto_RS256VerifyDigest( ucDigest, ucSignature, sizeof( ucSignature ),
+                                                            ucRS256N, sizeof( ucRS256N ), ucRS256E, sizeof( ucRS256E ) ),
+                          eAzureIoTSuccess );
+    assert_int_not_equal( AzureIoTCrypto_RS256VerifyDigest( ucDigest, ucRS256Signature, sizeof( ucRS256Signature ) - 1,
+                                                            ucRS256N, sizeof( ucRS256N ), ucRS256E, sizeof( ucRS256E ) ),
+                          eAzureIoTSuccess );
+
+    for( uint32_t ulIteration = 0; ulIteration < benchRS256_ITERATIONS; ulIteration++ )
+    {
+        ullStart = prvGetNanoseconds();
+        assert_int_equal( AzureIoTCrypto_RS256VerifyDigest( ucDigest, ucRS256Signature, sizeof( ucRS256Signature ),
+                                                            ucRS256N, sizeof( ucRS256N ), ucRS256E, sizeof( ucRS256E ) ),
+                          eAzureIoTSuccess );
+        ullElapsed = prvGetNanoseconds() - ullStart;
+        ullTotalNs += ullElapsed;
+        ullMaxNs = ( ullElapsed > ullMaxNs ) ? ullElapsed : ullMaxNs;
+    }
+
+    prvPrintBench( "rs256-3072", azureiotcryptoSHA256_SIZE, ullTotalNs, ullMaxNs, benchRS256_ITERATIONS );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTCrypto_SHA256Bench ),
+        cmocka_unit_test( testAzureIoTCrypto_HMACSHA256Bench ),
+        cmocka_unit_test( testAzureIoTCrypto_HMACSHA256ContextBench ),
+        cmocka_unit_test( testAzureIoTCrypto_RS256VerifyBench )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_crypto_bench", tests, prvBenchSetup, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,32 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_crypto_port.h
+ * @brief Unit test crypto port.
+ *
+ */
+
+#ifndef AZURE_IOT_CRYPTO_PORT_H
+#define AZURE_IOT_CRYPTO_PORT_H
+
+#include <stdint.h>
+
+#include "azure_iot_crypto.h"
+
+/* Plain SHA256 state used by the unit test crypto port */
+typedef struct AzureIoTCryptoPortSHA256Context
+{
+    uint32_t ulState[ 8 ];
+    uint64_t ullLength;
+    uint8_t ucBlock[ 64 ];
+    uint32_t ulBlockLength;
+} AzureIoTCryptoPortSHA256Context_t;
+
+/* The port state lives in the storage of the public context */
+#define azureiotcryptoPORT_SHA256_CONTEXT( pxContext )    ( ( AzureIoTCryptoPortSHA256Context_t * ) ( pxContext )->_internal.ucState )
+
+/* Fails to compile if the port state does not fit #azureiotcryptoSHA256_CONTEXT_SIZE */
+typedef char AzureIoTCryptoPortSHA256ContextSizeCheck_t[ ( sizeof( AzureIoTCryptoPortSHA256Context_t ) <= azureiotcryptoSHA256_CONTEXT_SIZE ) ? 1 : -1 ];
+
+#endif /* AZURE_IOT_CRYPTO_PORT_H */
@@ -0,0 +1,242 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_dps_standin_mqtt.c
+ * @brief Unit test MQTT port answering like the Device Provisioning Service.
+ *
+ * Unlike azure_iot_cmocka_mqtt.c, every connection keeps its own state so many provisioning
+ * clients can register at the same time. A registration request is answered with `assigning`
+ * and a retry-after of #ulStandInRetryAfterSeconds, the following status query with `assigned`.
+ * Every packet is delivered by the next AzureIoTMQTT_ProcessLoop() of its connection, except the responses
+ * while #xStandInHoldResponses is set, which stand for a service that has not answered yet.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_mqtt_port.h"
+/*-----------------------------------------------------------*/
+
+#define standinCONNECTION_MAX        ( 64 )
+#define standinREQUEST_PREFIX        "$dps/registrations/PUT/"
+#define standinASSIGNING_RESPONSE    "{\"operationId\":\"4.002305f54fc89692.b1f11200-8776-4b5d-867b-dc21c4b59c12\",\"status\":\"assigning\"}"
+#define standinASSIGNED_RESPONSE                                                                               \
+    "{\"operationId\":\"4.002305f54fc89692.b1f11200-8776-4b5d-867b-dc21c4b59c12\",\"status\":\"assigned\"," \
+    "\"registrationState\":{\"registrationId\":\"reg_id\",\"assignedHub\":\"unittest.azure-iothub.com\","  \
+    "\"deviceId\":\"UnitTest\",\"status\":\"assigned\",\"substatus\":\"initialAssignment\"}}"
+/*-----------------------------------------------------------*/
+
+typedef struct StandInConnection
+{
+    AzureIoTMQTTHandle_t xContext;
+    AzureIoTMQTTEventCallback_t xCallback;
+    uint8_t ucPendingType;
+    char cTopic[ 64 ];
+    AzureIoTMQTTPublishInfo_t xPublishInfo;
+} StandInConnection_t;
+
+uint32_t ulStandInRetryAfterSeconds = 1;
+uint32_t ulStandInRequestCount = 0;
+uint32_t ulStandInProcessLoopCount = 0;
+uint32_t ulStandInDisconnectCount = 0;
+bool xStandInHoldResponses = false;
+static StandInConnection_t xConnections[ standinCONNECTION_MAX ];
+static uint32_t ulConnectionCount = 0;
+/*-----------------------------------------------------------*/
+
+static StandInConnection_t * prvGetConnection( AzureIoTMQTTHandle_t xContext )
+{
+    for( uint32_t ulIndex = 0; ulIndex < ulConnectionCount; ulIndex++ )
+    {
+        if( xConnections[ ulIndex ].xContext == xContext )
+        {
+            return &xConnections[ ulIndex ];
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Init( AzureIoTMQTTHandle_t xContext,
+                                        const AzureIoTTransportInterface_t * pxTransportInterface,
+                                        AzureIoTMQTTGetCurrentTimeFunc_t xGetTimeFunction,
+                                        AzureIoTMQTTEventCallback_t xUserCallback,
+                                        uint8_t * pucNetworkBuffer,
+                                        size_t xNetworkBufferLength )
+{
+    StandInConnection_t * pxConnection = prvGetConnection( xContext );
+
+    ( void ) pxTransportInterface;
+    ( void ) xGetTimeFunction;
+    ( void ) pucNetworkBuffer;
+    ( void ) xNetworkBufferLength;
+
+    if( pxConnection == NULL )
+    {
+        if( ulConnectionCount == standinCONNECTION_MAX )
+        {
+            return eAzureIoTMQTTNoMemory;
+        }
+
+        pxConnection = &xConnections[ ulConnectionCount++ ];
+    }
+
+    memset( pxConnection, 0, sizeof( StandInConnection_t ) );
+    pxConnection->xContext = xContext;
+    pxConnection->xCallback = xUserCallback;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Connect( AzureIoTMQTTHandle_t xContext,
+                                           const AzureIoTMQTTConnectInfo_t * pxConnectInfo,
+                                           const AzureIoTMQTTPublishInfo_t * pxWillInfo,
+                                           uint32_t ulMilliseconds,
+                                           bool * pxSessionPresent )
+{
+    ( void ) pxConnectInfo;
+    ( void ) pxWillInfo;
+    ( void ) ulMilliseconds;
+
+    if( pxSessionPresent != NULL )
+    {
+        *pxSessionPresent = false;
+    }
+
+    return prvGetConnection( xContext ) != NULL ? eAzureIoTMQTTSuccess : eAzureIoTMQTTBadParameter;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Subscribe( AzureIoTMQTTHandle_t xContext,
+                                             const AzureIoTMQTTSubscribeInfo_t * pxSubscriptionList,
+                                             size_t xSubscriptionCount,
+                                             uint16_t usPacketId )
+{
+    StandInConnection_t * pxConnection = prvGetConnection( xContext );
+
+    ( void ) pxSubscriptionList;
+    ( void ) xSubscriptionCount;
+    ( void ) usPacketId;
+
+    if( pxConnection == NULL )
+    {
+        return eAzureIoTMQTTBadParameter;
+    }
+
+    pxConnection->ucPendingType = azureiotmqttPACKET_TYPE_SUBACK;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Publish( AzureIoTMQTTHandle_t xContext,
+                                           const AzureIoTMQTTPublishInfo_t * pxPublishInfo,
+                                           uint16_t usPacketId )
+{
+    StandInConnection_t * pxConnection = prvGetConnection( xContext );
+    int lLength;
+
+    ( void ) usPacketId;
+
+    if( pxConnection == NULL )
+    {
+        return eAzureIoTMQTTBadParameter;
+    }
+
+    ulStandInRequestCount++;
+
+    if( ( pxPublishInfo->usTopicNameLength >= sizeof( standinREQUEST_PREFIX ) - 1 ) &&
+        ( memcmp( pxPublishInfo->pcTopicName, standinREQUEST_PREFIX, sizeof( standinREQUEST_PREFIX ) - 1 ) == 0 ) )
+    {
+        lLength = snprintf( pxConnection->cTopic, sizeof( pxConnection->cTopic ),
+                            "$dps/registrations/res/202/?$rid=1&retry-after=%u",
+                            ( unsigned ) ulStandInRetryAfterSeconds );
+        pxConnection->xPublishInfo.pvPayload = standinASSIGNING_RESPONSE;
+        pxConnection->xPublishInfo.xPayloadLength = sizeof( standinASSIGNING_RESPONSE ) - 1;
+    }
+    else
+    {
+        lLength = snprintf( pxConnection->cTopic, sizeof( pxConnection->cTopic ),
+                            "$dps/registrations/res/200/?$rid=1" );
+        pxConnection->xPublishInfo.pvPayload = standinASSIGNED_RESPONSE;
+        pxConnection->xPublishInfo.xPayloadLength = sizeof( standinASSIGNED_RESPONSE ) - 1;
+    }
+
+    pxConnection->xPublishInfo.pcTopicName = ( const uint8_t * ) pxConnection->cTopic;
+    pxConnection->xPublishInfo.usTopicNameLength = ( uint16_t ) lLength;
+    pxConnection->ucPendingType = azureiotmqttPACKET_TYPE_PUBLISH;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Unsubscribe( AzureIoTMQTTHandle_t xContext,
+                                               const AzureIoTMQTTSubscribeInfo_t * pxSubscriptionList,
+                                               size_t xSubscriptionCount,
+                                               uint16_t usPacketId )
+{
+    ( void ) xContext;
+    ( void ) pxSubscriptionList;
+    ( void ) xSubscriptionCount;
+    ( void ) usPacketId;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Disconnect( AzureIoTMQTTHandle_t xContext )
+{
+    if( prvGetConnection( xContext ) == NULL )
+    {
+        return eAzureIoTMQTTBadParameter;
+    }
+
+    ulStandInDisconnectCount++;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_ProcessLoop( AzureIoTMQTTHandle_t xContext,
+                                               uint32_t ulMilliseconds )
+{
+    StandInConnection_t * pxConnection = prvGetConnection( xContext );
+    AzureIoTMQTTPacketInfo_t xPacketInfo = { 0 };
+    AzureIoTMQTTDeserializedInfo_t xDeserializedInfo = { 0 };
+
+    ( void ) ulMilliseconds;
+
+    if( pxConnection == NULL )
+    {
+        return eAzureIoTMQTTBadParameter;
+    }
+
+    ulStandInProcessLoopCount++;
+
+    if( ( pxConnection->ucPendingType != 0 ) &&
+        !( xStandInHoldResponses && ( pxConnection->ucPendingType == azureiotmqttPACKET_TYPE_PUBLISH ) ) )
+    {
+        xPacketInfo.ucType = pxConnection->ucPendingType;
+        xDeserializedInfo.pxPublishInfo = &pxConnection->xPublishInfo;
+        pxConnection->ucPendingType = 0;
+        pxConnection->xCallback( xContext, &xPacketInfo, &xDeserializedInfo );
+    }
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t AzureIoTMQTT_GetPacketId( AzureIoTMQTTHandle_t xContext )
+{
+    ( void ) xContext;
+
+    return 1;
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,18 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_flash_platform_port.h
+ * @brief Unit test dummy flash platform port.
+ *
+ */
+
+#ifndef AZURE_IOT_FLASH_PLATFORM_PORT_H
+#define AZURE_IOT_FLASH_PLATFORM_PORT_H
+
+#include <stdint.h>
+
+/* Map test ADU image to int */
+typedef int AzureADUImage_t;
+
+#endif /* AZURE_IOT_FLASH_PLATFORM_PORT_H */
@@ -0,0 +1,18 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_http_port.h
+ * @brief Unit test dummy HTTP port.
+ *
+ */
+
+#ifndef AZURE_IOT_HTTP_PORT_H
+#define AZURE_IOT_HTTP_PORT_H
+
+#include <stdint.h>
+
+/* Map test HTTP to int */
+typedef int AzureIoTHTTP_t;
+
+#endif /* AZURE_IOT_HTTP_PORT_H */
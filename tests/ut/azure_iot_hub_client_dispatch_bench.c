@@ -0,0 +1,190 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_dispatch_bench.c
+ * @brief Micro-benchmark for the routing of incoming publishes in the Azure IoT Hub Client.
+ *
+ * Both figures do the same work for each topic: find the owner of the topic and parse it once
+ * with the parser of that owner. The "linear" figure replays what the client used to do: try the
+ * C2D, command and properties topic parsers in turn until one matches. The "routed" figure calls
+ * #AzureIoTHubClient_GetReceiveContextIndex and then only the parser of the context it returns.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_hub_client.h"
+#include "azure_iot_private.h"
+/*-----------------------------------------------------------*/
+
+#define benchITERATIONS                ( 100000 )
+#define benchHOSTNAME                  "unittest.azure-devices.net"
+#define benchDEVICE_ID                 "unittest"
+#define benchCLOUD_MESSAGE_TOPIC       "devices/unittest/messages/devicebound/test=1"
+#define benchCOMMAND_MESSAGE_TOPIC     "$iothub/methods/POST/echo/?$rid=1"
+#define benchPROPERTY_DESIRED_TOPIC    "$iothub/twin/PATCH/properties/desired/?$version=1"
+/*-----------------------------------------------------------*/
+
+typedef struct BenchTopic
+{
+    const char * pcName;
+    const uint8_t * pucTopic;
+    uint16_t usTopicLength;
+    uint32_t ulExpectedIndex;
+} BenchTopic_t;
+
+static const BenchTopic_t xBenchTopics[] =
+{
+    { "c2d",        ( const uint8_t * ) benchCLOUD_MESSAGE_TOPIC,    sizeof( benchCLOUD_MESSAGE_TOPIC ) - 1,
+      azureiothubRECEIVE_CONTEXT_INDEX_C2D },
+    { "command",    ( const uint8_t * ) benchCOMMAND_MESSAGE_TOPIC,  sizeof( benchCOMMAND_MESSAGE_TOPIC ) - 1,
+      azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS },
+    { "properties", ( const uint8_t * ) benchPROPERTY_DESIRED_TOPIC, sizeof( benchPROPERTY_DESIRED_TOPIC ) - 1,
+      azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES }
+};
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return 1;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+/* Parse the topic with the parser of one receive context, as its process function does. */
+static az_result prvParseTopic( az_iot_hub_client * pxCoreClient,
+                                uint32_t ulIndex,
+                                az_span xTopicSpan )
+{
+    az_iot_hub_client_c2d_request xC2DRequest;
+    az_iot_hub_client_command_request xCommandRequest;
+    az_iot_hub_client_properties_message xPropertiesMessage;
+
+    switch( ulIndex )
+    {
+        case azureiothubRECEIVE_CONTEXT_INDEX_C2D:
+            return az_iot_hub_client_c2d_parse_received_topic( pxCoreClient, xTopicSpan, &xC2DRequest );
+
+        case azureiothubRECEIVE_CONTEXT_INDEX_COMMANDS:
+            return az_iot_hub_client_commands_parse_received_topic( pxCoreClient, xTopicSpan, &xCommandRequest );
+
+        case azureiothubRECEIVE_CONTEXT_INDEX_PROPERTIES:
+            return az_iot_hub_client_properties_parse_received_topic( pxCoreClient, xTopicSpan, &xPropertiesMessage );
+
+        default:
+            return AZ_ERROR_IOT_TOPIC_NO_MATCH;
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Replay of the previous dispatch: every parser is tried in context order until one matches. */
+static uint32_t prvLinearDispatch( az_iot_hub_client * pxCoreClient,
+                                   const BenchTopic_t * pxTopic )
+{
+    az_span xTopicSpan = az_span_create( ( uint8_t * ) pxTopic->pucTopic, pxTopic->usTopicLength );
+    uint32_t ulIndex;
+
+    for( ulIndex = 0; ulIndex < azureiothubSUBSCRIBE_FEATURE_COUNT; ulIndex++ )
+    {
+        if( az_result_succeeded( prvParseTopic( pxCoreClient, ulIndex, xTopicSpan ) ) )
+        {
+            break;
+        }
+    }
+
+    return ulIndex;
+}
+/*-----------------------------------------------------------*/
+
+/* Current dispatch: route by prefix, then parse once with the owner's parser. */
+static uint32_t prvRoutedDispatch( az_iot_hub_client * pxCoreClient,
+                                   const BenchTopic_t * pxTopic )
+{
+    az_span xTopicSpan = az_span_create( ( uint8_t * ) pxTopic->pucTopic, pxTopic->usTopicLength );
+    uint32_t ulIndex = AzureIoTHubClient_GetReceiveContextIndex( pxTopic->pucTopic, pxTopic->usTopicLength );
+
+    if( az_result_failed( prvParseTopic( pxCoreClient, ulIndex, xTopicSpan ) ) )
+    {
+        ulIndex = azureiothubSUBSCRIBE_FEATURE_COUNT;
+    }
+
+    return ulIndex;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvTimeDispatch( uint32_t ( * pxDispatch )( az_iot_hub_client *, const BenchTopic_t * ),
+                                 az_iot_hub_client * pxCoreClient,
+                                 const BenchTopic_t * pxTopic )
+{
+    uint64_t ullStart;
+    uint32_t ulMatched = 0;
+
+    ullStart = prvGetNanoseconds();
+
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        ulMatched += ( pxDispatch( pxCoreClient, pxTopic ) == pxTopic->ulExpectedIndex ) ? 1 : 0;
+    }
+
+    assert_int_equal( ulMatched, benchITERATIONS );
+
+    return prvGetNanoseconds() - ullStart;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_DispatchBench( void ** ppvState )
+{
+    az_iot_hub_client xCoreClient;
+    uint64_t ullLinearNs;
+    uint64_t ullRoutedNs;
+
+    ( void ) ppvState;
+
+    assert_true( az_result_succeeded( az_iot_hub_client_init( &xCoreClient,
+                                                              AZ_SPAN_FROM_STR( benchHOSTNAME ),
+                                                              AZ_SPAN_FROM_STR( benchDEVICE_ID ),
+                                                              NULL ) ) );
+
+    for( size_t index = 0; index < ( sizeof( xBenchTopics ) / sizeof( BenchTopic_t ) ); index++ )
+    {
+        ullLinearNs = prvTimeDispatch( prvLinearDispatch, &xCoreClient, &xBenchTopics[ index ] );
+        ullRoutedNs = prvTimeDispatch( prvRoutedDispatch, &xCoreClient, &xBenchTopics[ index ] );
+
+        printf( "[ BENCH    ] %-10s linear parse: %6llu ns/dispatch | routed parse: %6llu ns/dispatch\n",
+                xBenchTopics[ index ].pcName,
+                ( unsigned long long ) ( ullLinearNs / benchITERATIONS ),
+                ( unsigned long long ) ( ullRoutedNs / benchITERATIONS ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClient_DispatchBench )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_dispatch_bench", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
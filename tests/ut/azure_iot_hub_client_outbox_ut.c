@@ -0,0 +1,398 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+#include "azure_iot_hub_client_outbox.h"
+/*-----------------------------------------------------------*/
+
+#define testSLOT_SIZE        ( 32 )
+#define testSLOT_COUNT       ( 4 )
+#define testRECORD_ONE       "{\"seq\":1}"
+#define testRECORD_TWO       "{\"seq\":2}"
+#define testRECORD_THREE     "{\"seq\":3}"
+#define testDRAIN_INTERVAL   ( 10 )
+/*-----------------------------------------------------------*/
+
+extern AzureIoTMQTTPacketInfo_t xPacketInfo;
+extern AzureIoTMQTTDeserializedInfo_t xDeserializedInfo;
+extern uint16_t usTestPacketId;
+extern const uint8_t * pucPublishPayload;
+extern uint32_t ulDelayReceivePacket;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static uint8_t ucBuffer[ 512 ];
+static uint8_t ucStorageBuffer[ testSLOT_COUNT * ( sizeof( uint32_t ) + testSLOT_SIZE ) ];
+static uint8_t ucScratchBuffer[ testSLOT_SIZE ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static TickType_t xTestTickCount = 1;
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return xTestTickCount;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0xFFFFFFFFFFFFFFFF;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestIoTHubClient( AzureIoTHubClient_t * pxTestIoTHubClient )
+{
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+
+    xHubClientOptions.xTelemetryAckCallback = AzureIoTHubClientOutbox_TelemetryAckCallback;
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( pxTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestOutbox( AzureIoTHubClient_t * pxTestIoTHubClient,
+                                AzureIoTOutboxStorage_t * pxStorage,
+                                AzureIoTHubClientOutbox_t * pxOutbox,
+                                AzureIoTHubClientOutboxOptions_t * pxOptions )
+{
+    prvSetupTestIoTHubClient( pxTestIoTHubClient );
+
+    assert_int_equal( AzureIoTRAMOutboxStorage_Init( pxStorage, ucStorageBuffer, sizeof( ucStorageBuffer ), testSLOT_SIZE ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_Init( pxOutbox, pxTestIoTHubClient, pxStorage, pxOptions,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvEnqueue( AzureIoTHubClientOutbox_t * pxOutbox,
+                        const char * pcRecord )
+{
+    assert_int_equal( AzureIoTHubClientOutbox_Enqueue( pxOutbox, ( const uint8_t * ) pcRecord, ( uint32_t ) strlen( pcRecord ) ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessOne( AzureIoTHubClientOutbox_t * pxOutbox,
+                           const char * pcExpected,
+                           uint16_t usPacketId )
+{
+    usTestPacketId = usPacketId;
+    pucPublishPayload = ( const uint8_t * ) pcExpected;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_Process( pxOutbox ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReceivePuback( AzureIoTHubClient_t * pxTestIoTHubClient,
+                              uint16_t usPacketId )
+{
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBACK;
+    xDeserializedInfo.usPacketIdentifier = usPacketId;
+    ulDelayReceivePacket = 0;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( pxTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    xPacketInfo.ucType = 0;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_Init_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+    assert_int_equal( AzureIoTRAMOutboxStorage_Init( &xStorage, ucStorageBuffer, sizeof( ucStorageBuffer ), testSLOT_SIZE ),
+                      eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClientOutbox_OptionsInit( NULL ), eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when outbox is NULL */
+    assert_int_equal( AzureIoTHubClientOutbox_Init( NULL, &xTestIoTHubClient, &xStorage, NULL,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when client is NULL */
+    assert_int_equal( AzureIoTHubClientOutbox_Init( &xOutbox, NULL, &xStorage, NULL,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when storage is NULL */
+    assert_int_equal( AzureIoTHubClientOutbox_Init( &xOutbox, &xTestIoTHubClient, NULL, NULL,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when scratch buffer cannot hold a slot */
+    assert_int_equal( AzureIoTHubClientOutbox_Init( &xOutbox, &xTestIoTHubClient, &xStorage, NULL,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when storage only has one slot */
+    assert_int_equal( AzureIoTRAMOutboxStorage_Init( &xStorage, ucStorageBuffer, sizeof( uint32_t ) + testSLOT_SIZE, testSLOT_SIZE ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_Init( &xOutbox, &xTestIoTHubClient, &xStorage, NULL,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_Enqueue_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+    uint8_t ucTooBig[ testSLOT_SIZE + 1 ] = { 0 };
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, NULL );
+
+    assert_int_equal( AzureIoTHubClientOutbox_Enqueue( NULL, ( const uint8_t * ) testRECORD_ONE, sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientOutbox_Enqueue( &xOutbox, NULL, sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientOutbox_Enqueue( &xOutbox, ucTooBig, sizeof( ucTooBig ) ),
+                      eAzureIoTErrorOutOfMemory );
+
+    /* One slot always stays empty to tell a full ring from an empty one */
+    for( ulIndex = 0; ulIndex < testSLOT_COUNT - 1; ulIndex++ )
+    {
+        prvEnqueue( &xOutbox, testRECORD_ONE );
+    }
+
+    assert_int_equal( AzureIoTHubClientOutbox_Enqueue( &xOutbox, ( const uint8_t * ) testRECORD_ONE, sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorOutOfMemory );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), testSLOT_COUNT - 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_Process_NotResumedSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+
+    ( void ) ppvState;
+
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, NULL );
+
+    assert_int_equal( AzureIoTHubClientOutbox_Process( NULL ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( NULL ), eAzureIoTErrorInvalidArgument );
+
+    /* Nothing is published until the outbox is resumed */
+    prvEnqueue( &xOutbox, testRECORD_ONE );
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_Process_AckSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+    AzureIoTHubClientOutboxOptions_t xOptions;
+    uint16_t usSavedPacketId = usTestPacketId;
+
+    ( void ) ppvState;
+
+    /* Drain one message per interval so each publish can be checked */
+    assert_int_equal( AzureIoTHubClientOutbox_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulDrainMaxMessages = 1;
+    xOptions.ulDrainIntervalMilliseconds = testDRAIN_INTERVAL * azureiotMILLISECONDS_PER_TICK;
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, &xOptions );
+
+    prvEnqueue( &xOutbox, testRECORD_ONE );
+    prvEnqueue( &xOutbox, testRECORD_TWO );
+
+    xTestTickCount = 1;
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    prvProcessOne( &xOutbox, testRECORD_ONE, 10 );
+
+    /* Rate limited within the interval */
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+
+    xTestTickCount += testDRAIN_INTERVAL;
+    prvProcessOne( &xOutbox, testRECORD_TWO, 11 );
+
+    /* Out of order ack does not move the tail past the first record */
+    prvReceivePuback( &xTestIoTHubClient, 11 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 2 );
+
+    prvReceivePuback( &xTestIoTHubClient, 10 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 0 );
+
+    /* Indices were persisted, a new outbox on the same storage is empty */
+    assert_int_equal( AzureIoTHubClientOutbox_Init( &xOutbox, &xTestIoTHubClient, &xStorage, &xOptions,
+                                                    ucScratchBuffer, sizeof( ucScratchBuffer ) ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 0 );
+
+    xTestTickCount = 1;
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_Process_PublishFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+    uint16_t usSavedPacketId = usTestPacketId;
+
+    ( void ) ppvState;
+
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, NULL );
+    prvEnqueue( &xOutbox, testRECORD_ONE );
+
+    /* Publish failure pauses draining and keeps the record */
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTErrorPublishFailed );
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 1 );
+
+    /* After reconnect the record is sent again */
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    prvProcessOne( &xOutbox, testRECORD_ONE, 20 );
+    prvReceivePuback( &xTestIoTHubClient, 20 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 0 );
+
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_TelemetryAck_TimeoutResendSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+    uint16_t usSavedPacketId = usTestPacketId;
+
+    ( void ) ppvState;
+
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, NULL );
+    prvEnqueue( &xOutbox, testRECORD_THREE );
+
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    prvProcessOne( &xOutbox, testRECORD_THREE, 30 );
+
+    /* Nothing left to send while the record is in flight */
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+
+    /* Unknown packet ids and NULL cookies are ignored */
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTSuccess, 99, &xOutbox, 0 );
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTSuccess, 30, NULL, 0 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 1 );
+
+    /* Timeout rewinds, so the record is sent again */
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTErrorPubackWaitTimeout, 30, &xOutbox, 0 );
+    prvProcessOne( &xOutbox, testRECORD_THREE, 31 );
+
+    /* Ack of the first attempt is ignored, ack of the resend releases it */
+    prvReceivePuback( &xTestIoTHubClient, 30 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 1 );
+    prvReceivePuback( &xTestIoTHubClient, 31 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 0 );
+
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientOutbox_TelemetryAck_TimeoutResendsOnlyUnackedSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTOutboxStorage_t xStorage;
+    AzureIoTHubClientOutbox_t xOutbox;
+    AzureIoTHubClientOutboxOptions_t xOptions;
+    uint16_t usSavedPacketId = usTestPacketId;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientOutbox_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulDrainMaxMessages = 1;
+    xOptions.ulDrainIntervalMilliseconds = testDRAIN_INTERVAL * azureiotMILLISECONDS_PER_TICK;
+    prvSetupTestOutbox( &xTestIoTHubClient, &xStorage, &xOutbox, &xOptions );
+
+    prvEnqueue( &xOutbox, testRECORD_ONE );
+    prvEnqueue( &xOutbox, testRECORD_TWO );
+
+    xTestTickCount = 1;
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    prvProcessOne( &xOutbox, testRECORD_ONE, 40 );
+    xTestTickCount += testDRAIN_INTERVAL;
+    prvProcessOne( &xOutbox, testRECORD_TWO, 41 );
+
+    /* The second record is acknowledged before the first one times out */
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTSuccess, 41, &xOutbox, 0 );
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTErrorPubackWaitTimeout, 40, &xOutbox, 0 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 2 );
+
+    /* Only the first record is sent again */
+    xTestTickCount += testDRAIN_INTERVAL;
+    prvProcessOne( &xOutbox, testRECORD_ONE, 42 );
+    xTestTickCount += testDRAIN_INTERVAL;
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+
+    /* A reconnect does not send the acknowledged record either */
+    assert_int_equal( AzureIoTHubClientOutbox_Resume( &xOutbox ), eAzureIoTSuccess );
+    prvProcessOne( &xOutbox, testRECORD_ONE, 43 );
+    xTestTickCount += testDRAIN_INTERVAL;
+    assert_int_equal( AzureIoTHubClientOutbox_Process( &xOutbox ), eAzureIoTSuccess );
+
+    AzureIoTHubClientOutbox_TelemetryAckCallback( eAzureIoTSuccess, 43, &xOutbox, 0 );
+    assert_int_equal( AzureIoTHubClientOutbox_GetPendingCount( &xOutbox ), 0 );
+
+    xTestTickCount = 1;
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClientOutbox_Init_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_Enqueue_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_Process_NotResumedSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_Process_AckSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_Process_PublishFailure ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_TelemetryAck_TimeoutResendSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientOutbox_TelemetryAck_TimeoutResendsOnlyUnackedSuccess )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_outbox_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,461 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+#include "azure_iot_hub_client_reconnect.h"
+/*-----------------------------------------------------------*/
+
+#define testBACKOFF_BASE_MS    ( 100 )
+#define testBACKOFF_MAX_MS     ( 800 )
+/*-----------------------------------------------------------*/
+
+extern AzureIoTMQTTPacketInfo_t xPacketInfo;
+extern AzureIoTMQTTDeserializedInfo_t xDeserializedInfo;
+extern uint16_t usTestPacketId;
+extern uint32_t ulDelayReceivePacket;
+extern bool xTestSessionPresent;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static uint8_t ucBuffer[ 512 ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static TickType_t xTestTickCount = 1;
+static uint32_t ulOpenCount;
+static uint32_t ulCloseCount;
+static uint32_t ulConnectedCount;
+static uint32_t ulDisconnectedCount;
+static AzureIoTResult_t xOpenResult;
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return xTestTickCount;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0xFFFFFFFFFFFFFFFF;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestCloudMessage( AzureIoTHubClientCloudToDeviceMessageRequest_t * pxMessage,
+                                 void * pvContext )
+{
+    ( void ) pxMessage;
+    ( void ) pvContext;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestCommand( AzureIoTHubClientCommandRequest_t * pxMessage,
+                            void * pvContext )
+{
+    ( void ) pxMessage;
+    ( void ) pvContext;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvOpenTransport( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                          void * pvContext )
+{
+    ( void ) pxAzureIoTHubClient;
+    ( void ) pvContext;
+
+    ulOpenCount++;
+
+    return xOpenResult;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvCloseTransport( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                           void * pvContext )
+{
+    ( void ) pxAzureIoTHubClient;
+    ( void ) pvContext;
+
+    ulCloseCount++;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static void prvConnectionCallback( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                   bool xConnected,
+                                   void * pvContext )
+{
+    ( void ) pxAzureIoTHubClient;
+    ( void ) pvContext;
+
+    if( xConnected )
+    {
+        ulConnectedCount++;
+    }
+    else
+    {
+        ulDisconnectedCount++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestReconnect( AzureIoTHubClient_t * pxTestIoTHubClient,
+                                   AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    AzureIoTHubClientReconnectOptions_t xOptions;
+
+    ulOpenCount = 0;
+    ulCloseCount = 0;
+    ulConnectedCount = 0;
+    ulDisconnectedCount = 0;
+    xOpenResult = eAzureIoTSuccess;
+    xTestSessionPresent = false;
+    xPacketInfo.ucType = 0;
+    ulDelayReceivePacket = 0;
+    xTestTickCount = 1000;
+
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( pxTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClientReconnect_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulBackoffBaseMilliseconds = testBACKOFF_BASE_MS;
+    xOptions.ulBackoffMaxMilliseconds = testBACKOFF_MAX_MS;
+    assert_int_equal( AzureIoTHubClientReconnect_Init( pxReconnect, pxTestIoTHubClient, &xOptions,
+                                                       prvOpenTransport, prvCloseTransport,
+                                                       prvConnectionCallback, NULL ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvConnectAndSubscribe( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    assert_int_equal( AzureIoTHubClientReconnect_SetSubscriptions( pxReconnect,
+                                                                   prvTestCloudMessage, NULL,
+                                                                   prvTestCommand, NULL,
+                                                                   NULL, NULL ),
+                      eAzureIoTSuccess );
+
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( pxReconnect, 0 ), eAzureIoTSuccess );
+
+    /* SUBACK */
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( pxReconnect, 0 ), eAzureIoTSuccess );
+    xPacketInfo.ucType = 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLoseConnection( AzureIoTHubClientReconnect_t * pxReconnect )
+{
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTRecvFailed );
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( pxReconnect, 0 ), eAzureIoTErrorPending );
+    assert_false( AzureIoTHubClientReconnect_IsConnected( pxReconnect ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Init_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+    AzureIoTHubClientReconnectOptions_t xOptions;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientReconnect_OptionsInit( NULL ), eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( AzureIoTHubClientReconnect_Init( NULL, &xTestIoTHubClient, NULL,
+                                                       prvOpenTransport, prvCloseTransport, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientReconnect_Init( &xReconnect, NULL, NULL,
+                                                       prvOpenTransport, prvCloseTransport, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientReconnect_Init( &xReconnect, &xTestIoTHubClient, NULL,
+                                                       NULL, prvCloseTransport, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientReconnect_Init( &xReconnect, &xTestIoTHubClient, NULL,
+                                                       prvOpenTransport, NULL, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Maximum backoff below the base */
+    assert_int_equal( AzureIoTHubClientReconnect_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulBackoffMaxMilliseconds = xOptions.ulBackoffBaseMilliseconds - 1;
+    assert_int_equal( AzureIoTHubClientReconnect_Init( &xReconnect, &xTestIoTHubClient, &xOptions,
+                                                       prvOpenTransport, prvCloseTransport, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( AzureIoTHubClientReconnect_SetSubscriptions( NULL, prvTestCloudMessage, NULL,
+                                                                   NULL, NULL, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( NULL, 0 ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientReconnect_Reconnect( NULL ), eAzureIoTErrorInvalidArgument );
+    assert_false( AzureIoTHubClientReconnect_IsConnected( NULL ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Process_ConnectSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    assert_false( AzureIoTHubClientReconnect_IsConnected( &xReconnect ) );
+
+    prvConnectAndSubscribe( &xReconnect );
+
+    assert_true( AzureIoTHubClientReconnect_IsConnected( &xReconnect ) );
+    assert_int_equal( ulOpenCount, 1 );
+    assert_int_equal( ulCloseCount, 0 );
+    assert_int_equal( ulConnectedCount, 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Process_SessionPresentSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    prvConnectAndSubscribe( &xReconnect );
+    prvLoseConnection( &xReconnect );
+
+    assert_int_equal( ulCloseCount, 1 );
+    assert_int_equal( ulDisconnectedCount, 1 );
+
+    /* No attempt before the backoff delay */
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+    xTestTickCount += ( testBACKOFF_BASE_MS / 2 ) - 1;
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+    assert_int_equal( ulOpenCount, 1 );
+
+    /* The session is present, so nothing is subscribed again */
+    xTestTickCount += ( testBACKOFF_BASE_MS / 2 ) + 1;
+    xTestSessionPresent = true;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    assert_true( AzureIoTHubClientReconnect_IsConnected( &xReconnect ) );
+    assert_int_equal( ulOpenCount, 2 );
+    assert_int_equal( ulConnectedCount, 2 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Process_SessionLostResubscribeSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    prvConnectAndSubscribe( &xReconnect );
+    prvLoseConnection( &xReconnect );
+
+    /* The session is gone, so the subscriptions are replayed */
+    xTestTickCount += testBACKOFF_BASE_MS;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    /* Subscribe is not acknowledged before the link drops again, so it is replayed even if the session is present */
+    prvLoseConnection( &xReconnect );
+    xTestTickCount += testBACKOFF_BASE_MS;
+    xTestSessionPresent = true;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    assert_int_equal( ulOpenCount, 3 );
+    assert_int_equal( ulConnectedCount, 3 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Process_SubscribeFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    assert_int_equal( AzureIoTHubClientReconnect_SetSubscriptions( &xReconnect,
+                                                                   prvTestCloudMessage, NULL,
+                                                                   NULL, NULL, NULL, NULL ),
+                      eAzureIoTSuccess );
+
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSendFailed );
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+
+    assert_false( AzureIoTHubClientReconnect_IsConnected( &xReconnect ) );
+    assert_int_equal( ulCloseCount, 1 );
+    assert_int_equal( ulDisconnectedCount, 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Process_BackoffSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+    uint32_t ulDelays[] = { 100, 200, 400, 800, 800 };
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    xOpenResult = eAzureIoTErrorFailed;
+
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+    assert_int_equal( ulOpenCount, 1 );
+
+    /* Each delay is between half and all of the doubled backoff, capped at the maximum */
+    for( ulIndex = 0; ulIndex < sizeof( ulDelays ) / sizeof( ulDelays[ 0 ] ); ulIndex++ )
+    {
+        xTestTickCount += ( ulDelays[ ulIndex ] / 2 ) - 1;
+        assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+        assert_int_equal( ulOpenCount, ulIndex + 1 );
+
+        xTestTickCount += ( ulDelays[ ulIndex ] / 2 ) + 1;
+        assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+        assert_int_equal( ulOpenCount, ulIndex + 2 );
+    }
+
+    /* A successful connect resets the backoff */
+    xOpenResult = eAzureIoTSuccess;
+    xTestTickCount += testBACKOFF_MAX_MS;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    prvLoseConnection( &xReconnect );
+    xTestTickCount += testBACKOFF_BASE_MS;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    /* No transport was left open by the failed attempts */
+    assert_int_equal( ulCloseCount, 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_GetNextDeadline_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientReconnect_GetNextDeadline( NULL, &ulWaitMilliseconds ),
+                      eAzureIoTErrorInvalidArgument );
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+
+    /* First attempt is due right away */
+    assert_int_equal( AzureIoTHubClientReconnect_GetNextDeadline( &xReconnect, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+
+    /* Then the backoff delay */
+    xOpenResult = eAzureIoTErrorFailed;
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTErrorPending );
+    assert_int_equal( AzureIoTHubClientReconnect_GetNextDeadline( &xReconnect, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_in_range( ulWaitMilliseconds, testBACKOFF_BASE_MS / 2, testBACKOFF_BASE_MS );
+
+    xTestTickCount += ulWaitMilliseconds;
+    assert_int_equal( AzureIoTHubClientReconnect_GetNextDeadline( &xReconnect, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+
+    /* Connected, the hub client keep-alive */
+    xOpenResult = eAzureIoTSuccess;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_GetNextDeadline( &xReconnect, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientReconnect_Reconnect_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientReconnect_t xReconnect;
+
+    ( void ) ppvState;
+
+    prvSetupTestReconnect( &xTestIoTHubClient, &xReconnect );
+    prvConnectAndSubscribe( &xReconnect );
+
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Reconnect( &xReconnect ), eAzureIoTSuccess );
+    assert_false( AzureIoTHubClientReconnect_IsConnected( &xReconnect ) );
+
+    /* Connects again right away */
+    xTestSessionPresent = true;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientReconnect_Process( &xReconnect, 0 ), eAzureIoTSuccess );
+
+    assert_int_equal( ulOpenCount, 2 );
+    assert_int_equal( ulCloseCount, 1 );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Init_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Process_ConnectSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Process_SessionPresentSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Process_SessionLostResubscribeSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Process_SubscribeFailure ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Process_BackoffSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_GetNextDeadline_Success ),
+        cmocka_unit_test( testAzureIoTHubClientReconnect_Reconnect_Success )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_reconnect_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,367 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+#include "azure_iot_hub_client_send_queue.h"
+/*-----------------------------------------------------------*/
+
+#define testITEM_COUNT          ( 4 )
+#define testTELEMETRY_ONE       "{\"seq\":1}"
+#define testTELEMETRY_TWO       "{\"seq\":2}"
+#define testTELEMETRY_THREE     "{\"seq\":3}"
+#define testCOMMAND_RESPONSE    "{\"done\":true}"
+#define testREPORTED            "{\"version\":1}"
+#define testREQUEST_ID          "3"
+/*-----------------------------------------------------------*/
+
+extern AzureIoTMQTTPacketInfo_t xPacketInfo;
+extern AzureIoTMQTTDeserializedInfo_t xDeserializedInfo;
+extern uint16_t usTestPacketId;
+extern const uint8_t * pucPublishPayload;
+extern uint32_t ulDelayReceivePacket;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static uint8_t ucBuffer[ 512 ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static AzureIoTHubClientSendQueueItem_t xItems[ testITEM_COUNT ];
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return 1;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0xFFFFFFFFFFFFFFFF;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestProperties( AzureIoTHubClientPropertiesResponse_t * pxMessage,
+                               void * pvContext )
+{
+    ( void ) pxMessage;
+    ( void ) pvContext;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestSendQueue( AzureIoTHubClient_t * pxTestIoTHubClient,
+                                   AzureIoTHubClientSendQueue_t * pxSendQueue )
+{
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+
+    xPacketInfo.ucType = 0;
+    ulDelayReceivePacket = 0;
+    pucPublishPayload = NULL;
+
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( pxTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( pxSendQueue, pxTestIoTHubClient, xItems, testITEM_COUNT ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSubscribeProperties( AzureIoTHubClient_t * pxTestIoTHubClient )
+{
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( pxTestIoTHubClient, NULL, NULL, NULL, NULL,
+                                                      prvTestProperties, NULL, NULL, NULL ),
+                      eAzureIoTSuccess );
+
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( pxTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    xPacketInfo.ucType = 0;
+}
+/*-----------------------------------------------------------*/
+
+static void prvEnqueueTelemetry( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                                 uint32_t ulProducerID,
+                                 const char * pcTelemetry,
+                                 AzureIoTResult_t xExpectedResult )
+{
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueueTelemetry( pxSendQueue, ulProducerID,
+                                                                   ( const uint8_t * ) pcTelemetry,
+                                                                   ( uint32_t ) strlen( pcTelemetry ),
+                                                                   eAzureIoTHubMessageQoS0 ),
+                      xExpectedResult );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDrainOne( AzureIoTHubClientSendQueue_t * pxSendQueue,
+                         const char * pcExpected )
+{
+    pucPublishPayload = ( const uint8_t * ) pcExpected;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( pxSendQueue, 1 ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Init_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( NULL, &xTestIoTHubClient, xItems, testITEM_COUNT ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( &xSendQueue, NULL, xItems, testITEM_COUNT ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( &xSendQueue, &xTestIoTHubClient, NULL, testITEM_COUNT ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* At least two items, and a power of two */
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( &xSendQueue, &xTestIoTHubClient, xItems, 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( &xSendQueue, &xTestIoTHubClient, xItems, 3 ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Enqueue_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+    AzureIoTHubClientCommandRequest_t xRequest = { 0 };
+    static uint8_t ucLargePayload[ azureiotconfigSEND_QUEUE_PAYLOAD_MAX + 1 ];
+
+    ( void ) ppvState;
+
+    prvSetupTestSendQueue( &xTestIoTHubClient, &xSendQueue );
+
+    prvEnqueueTelemetry( NULL, 0, testTELEMETRY_ONE, eAzureIoTErrorInvalidArgument );
+    prvEnqueueTelemetry( &xSendQueue, azureiotconfigSEND_QUEUE_PRODUCER_MAX, testTELEMETRY_ONE, eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueueTelemetry( &xSendQueue, 0, ucLargePayload, sizeof( ucLargePayload ),
+                                                                   eAzureIoTHubMessageQoS0 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Command response without request ID */
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueueCommandResponse( &xSendQueue, 0, &xRequest, 200, NULL, 0 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueuePropertiesReported( &xSendQueue, 0, NULL, 0 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( NULL, 0 ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientSendQueue_GetProducerCounters( &xSendQueue, azureiotconfigSEND_QUEUE_PRODUCER_MAX,
+                                                                      NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Drain_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+    AzureIoTHubClientCommandRequest_t xRequest = { 0 };
+    uint32_t ulAccepted;
+    uint32_t ulRejected;
+
+    ( void ) ppvState;
+
+    prvSetupTestSendQueue( &xTestIoTHubClient, &xSendQueue );
+    prvSubscribeProperties( &xTestIoTHubClient );
+
+    xRequest.pucRequestID = ( const uint8_t * ) testREQUEST_ID;
+    xRequest.usRequestIDLength = sizeof( testREQUEST_ID ) - 1;
+
+    prvEnqueueTelemetry( &xSendQueue, 0, testTELEMETRY_ONE, eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueueCommandResponse( &xSendQueue, 1, &xRequest, 200,
+                                                                         ( const uint8_t * ) testCOMMAND_RESPONSE,
+                                                                         sizeof( testCOMMAND_RESPONSE ) - 1 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueuePropertiesReported( &xSendQueue, 1,
+                                                                            ( const uint8_t * ) testREPORTED,
+                                                                            sizeof( testREPORTED ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* Sent in the order they were queued */
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvDrainOne( &xSendQueue, testCOMMAND_RESPONSE );
+    prvDrainOne( &xSendQueue, testREPORTED );
+
+    /* Nothing left */
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_GetProducerCounters( &xSendQueue, 0, &ulAccepted, &ulRejected ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulAccepted, 1 );
+    assert_int_equal( ulRejected, 0 );
+    assert_int_equal( AzureIoTHubClientSendQueue_GetProducerCounters( &xSendQueue, 1, &ulAccepted, &ulRejected ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulAccepted, 2 );
+    assert_int_equal( ulRejected, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Enqueue_FullSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+    uint32_t ulAccepted;
+    uint32_t ulRejected;
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    prvSetupTestSendQueue( &xTestIoTHubClient, &xSendQueue );
+
+    for( ulIndex = 0; ulIndex < testITEM_COUNT; ulIndex++ )
+    {
+        prvEnqueueTelemetry( &xSendQueue, 2, testTELEMETRY_ONE, eAzureIoTSuccess );
+    }
+
+    /* Back pressure on the producer */
+    prvEnqueueTelemetry( &xSendQueue, 2, testTELEMETRY_TWO, eAzureIoTErrorOutOfMemory );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_GetProducerCounters( &xSendQueue, 2, &ulAccepted, &ulRejected ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulAccepted, testITEM_COUNT );
+    assert_int_equal( ulRejected, 1 );
+
+    /* Free two slots, the ring wraps around */
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvEnqueueTelemetry( &xSendQueue, 2, testTELEMETRY_TWO, eAzureIoTSuccess );
+    prvEnqueueTelemetry( &xSendQueue, 2, testTELEMETRY_THREE, eAzureIoTSuccess );
+    prvEnqueueTelemetry( &xSendQueue, 2, testTELEMETRY_THREE, eAzureIoTErrorOutOfMemory );
+
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvDrainOne( &xSendQueue, testTELEMETRY_TWO );
+    prvDrainOne( &xSendQueue, testTELEMETRY_THREE );
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_GetProducerCounters( &xSendQueue, 2, &ulAccepted, &ulRejected ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulAccepted, testITEM_COUNT + 2 );
+    assert_int_equal( ulRejected, 2 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Drain_PublishFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+
+    ( void ) ppvState;
+
+    prvSetupTestSendQueue( &xTestIoTHubClient, &xSendQueue );
+
+    prvEnqueueTelemetry( &xSendQueue, 0, testTELEMETRY_ONE, eAzureIoTSuccess );
+    prvEnqueueTelemetry( &xSendQueue, 0, testTELEMETRY_TWO, eAzureIoTSuccess );
+
+    /* The message is kept when the publish fails */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTErrorPublishFailed );
+
+    prvDrainOne( &xSendQueue, testTELEMETRY_ONE );
+    prvDrainOne( &xSendQueue, testTELEMETRY_TWO );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Drain_NotSubscribedFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+
+    ( void ) ppvState;
+
+    prvSetupTestSendQueue( &xTestIoTHubClient, &xSendQueue );
+
+    assert_int_equal( AzureIoTHubClientSendQueue_EnqueuePropertiesReported( &xSendQueue, 0,
+                                                                            ( const uint8_t * ) testREPORTED,
+                                                                            sizeof( testREPORTED ) - 1 ),
+                      eAzureIoTSuccess );
+    prvEnqueueTelemetry( &xSendQueue, 0, testTELEMETRY_ONE, eAzureIoTSuccess );
+
+    /* The reported properties cannot be sent, they are dropped and the telemetry still goes out */
+    pucPublishPayload = ( const uint8_t * ) testTELEMETRY_ONE;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTErrorTopicNotSubscribed );
+    pucPublishPayload = NULL;
+
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientSendQueue_Drain_TopicTooLongFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientSendQueue_t xSendQueue;
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    uint8_t ucLongDeviceId[ azureiotconfigUSERNAME_MAX + azureiotconfigPASSWORD_MAX + azureiotconfigTOPIC_MAX ];
+
+    ( void ) ppvState;
+
+    /* The telemetry topic of this device does not fit the working buffer */
+    memset( ucLongDeviceId, 'd', sizeof( ucLongDeviceId ) );
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( &xTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucLongDeviceId, sizeof( ucLongDeviceId ),
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientSendQueue_Init( &xSendQueue, &xTestIoTHubClient, xItems, testITEM_COUNT ),
+                      eAzureIoTSuccess );
+
+    prvEnqueueTelemetry( &xSendQueue, 0, testTELEMETRY_ONE, eAzureIoTSuccess );
+
+    /* The message can never be sent, it is dropped instead of blocking the queue */
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTErrorOutOfMemory );
+    assert_int_equal( AzureIoTHubClientSendQueue_Drain( &xSendQueue, 0 ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Init_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Enqueue_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Drain_Success ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Enqueue_FullSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Drain_PublishFailure ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Drain_NotSubscribedFailure ),
+        cmocka_unit_test( testAzureIoTHubClientSendQueue_Drain_TopicTooLongFailure )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_send_queue_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,431 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+#include "azure_iot_hub_client_telemetry_batch.h"
+/*-----------------------------------------------------------*/
+
+#define testRECORD_ONE      "{\"temperature\":21.5,\"humidity\":40.25,\"id\":\"s-0001\"}"
+#define testRECORD_TWO      "{\"temperature\":21.6,\"humidity\":40.50,\"id\":\"s-0002\"}"
+#define testRECORD_THREE    "{\"temperature\":21.7,\"humidity\":40.75,\"id\":\"s-0003\"}"
+
+/* Room for two records plus brackets and separator, but not three. */
+#define testSMALL_ARENA_SIZE                                                        \
+    ( 1 + ( sizeof( testRECORD_ONE ) - 1 ) + 1 + ( sizeof( testRECORD_TWO ) - 1 ) + \
+      1 + ( sizeof( testRECORD_THREE ) - 1 ) )
+/*-----------------------------------------------------------*/
+
+extern const uint8_t * pucPublishPayload;
+extern uint16_t usSentQOS;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static uint8_t ucBuffer[ 512 ];
+static uint8_t ucArena[ 512 ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static TickType_t xTestTickCount = 1;
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return xTestTickCount;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0xFFFFFFFFFFFFFFFF;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestIoTHubClient( AzureIoTHubClient_t * pxTestIoTHubClient )
+{
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( pxTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestBatch( AzureIoTHubClient_t * pxTestIoTHubClient,
+                               AzureIoTHubClientTelemetryBatch_t * pxBatch,
+                               AzureIoTHubClientTelemetryBatchOptions_t * pxOptions,
+                               uint32_t ulArenaLength )
+{
+    prvSetupTestIoTHubClient( pxTestIoTHubClient );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Init( pxBatch, pxTestIoTHubClient, pxOptions,
+                                                            ucArena, ulArenaLength ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_OptionsInit_Failure( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_OptionsInit( NULL ), eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_Init_Failure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail init when batch is NULL */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Init( NULL, &xTestIoTHubClient, NULL,
+                                                            ucArena, sizeof( ucArena ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when client is NULL */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Init( &xBatch, NULL, NULL,
+                                                            ucArena, sizeof( ucArena ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when arena is NULL */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Init( &xBatch, &xTestIoTHubClient, NULL,
+                                                            NULL, sizeof( ucArena ) ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail init when arena cannot hold anything past the closing bracket */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Init( &xBatch, &xTestIoTHubClient, NULL,
+                                                            ucArena, 1 ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+
+    ( void ) ppvState;
+
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, NULL, sizeof( ucArena ) );
+
+    /* Fail append when batch is NULL */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( NULL,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail append when record is NULL */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch, NULL,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail append when record length is 0 */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE, 0 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail append when record is not valid JSON */
+    assert_int_not_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                        ( const uint8_t * ) "{\"a\":",
+                                                                        sizeof( "{\"a\":" ) - 1 ),
+                          eAzureIoTSuccess );
+
+    /* Nothing is batched, so flushing does not publish */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_MaxRecordsSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+    AzureIoTHubClientTelemetryBatchOptions_t xOptions;
+    AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+    const char * pcExpected = "[" testRECORD_ONE "," testRECORD_TWO "]";
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulMaxRecords = 2;
+    xOptions.xQOS = eAzureIoTHubMessageQoS1;
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, &xOptions, sizeof( ucArena ) );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* Second record reaches the threshold and sends both as one array */
+    pucPublishPayload = ( const uint8_t * ) pcExpected;
+    usSentQOS = eAzureIoTMQTTQoS1;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_TWO,
+                                                                    sizeof( testRECORD_TWO ) - 1 ),
+                      eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( &xBatch, &xMetrics ), eAzureIoTSuccess );
+    assert_int_equal( xMetrics.ulRecordsAppended, 2 );
+    assert_int_equal( xMetrics.ulRecordsPublished, 2 );
+    assert_int_equal( xMetrics.ulPublishCount, 1 );
+    assert_int_equal( xMetrics.ulCompressionRatioX100, 200 );
+    assert_int_equal( xMetrics.ullPublishedBytes, strlen( pcExpected ) );
+    assert_int_equal( xMetrics.ullRecordBytes, ( sizeof( testRECORD_ONE ) - 1 ) + ( sizeof( testRECORD_TWO ) - 1 ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_ArenaFullSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+    AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+    const char * pcExpected = "[" testRECORD_ONE "," testRECORD_TWO "]";
+
+    ( void ) ppvState;
+
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, NULL, testSMALL_ARENA_SIZE );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_TWO,
+                                                                    sizeof( testRECORD_TWO ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* Third record does not fit, the first two are sent and it starts a new batch */
+    pucPublishPayload = ( const uint8_t * ) pcExpected;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_THREE,
+                                                                    sizeof( testRECORD_THREE ) - 1 ),
+                      eAzureIoTSuccess );
+
+    pucPublishPayload = ( const uint8_t * ) "[" testRECORD_THREE "]";
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( &xBatch, &xMetrics ), eAzureIoTSuccess );
+    assert_int_equal( xMetrics.ulPublishCount, 2 );
+    assert_int_equal( xMetrics.ulCompressionRatioX100, 150 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_ThresholdFlushFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+    AzureIoTHubClientTelemetryBatchOptions_t xOptions;
+    AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulMaxRecords = 2;
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, &xOptions, sizeof( ucArena ) );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* Second record is stored even though sending the batch fails */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_TWO,
+                                                                    sizeof( testRECORD_TWO ) - 1 ),
+                      eAzureIoTErrorPending );
+
+    /* Next flush sends each record once */
+    pucPublishPayload = ( const uint8_t * ) "[" testRECORD_ONE "," testRECORD_TWO "]";
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( &xBatch, &xMetrics ), eAzureIoTSuccess );
+    assert_int_equal( xMetrics.ulRecordsAppended, 2 );
+    assert_int_equal( xMetrics.ulRecordsPublished, 2 );
+    assert_int_equal( xMetrics.ulPublishCount, 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_ArenaFullFlushFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+
+    ( void ) ppvState;
+
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, NULL, testSMALL_ARENA_SIZE );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_TWO,
+                                                                    sizeof( testRECORD_TWO ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* No room is made for the third record, so it is not stored */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_THREE,
+                                                                    sizeof( testRECORD_THREE ) - 1 ),
+                      eAzureIoTErrorPublishFailed );
+
+    pucPublishPayload = ( const uint8_t * ) "[" testRECORD_ONE "," testRECORD_TWO "]";
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_AppendRecord_TooBigFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+
+    ( void ) ppvState;
+
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, NULL, sizeof( testRECORD_ONE ) - 1 );
+
+    /* Record does not fit in an empty arena, nothing is sent */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTErrorOutOfMemory );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_Flush_PublishFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+
+    ( void ) ppvState;
+
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, NULL, sizeof( ucArena ) );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTErrorPublishFailed );
+
+    /* Records are kept and the batch can still grow */
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_TWO,
+                                                                    sizeof( testRECORD_TWO ) - 1 ),
+                      eAzureIoTSuccess );
+
+    pucPublishPayload = ( const uint8_t * ) "[" testRECORD_ONE "," testRECORD_TWO "]";
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Flush( &xBatch ), eAzureIoTSuccess );
+    pucPublishPayload = NULL;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_Process_MaxAgeSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+    AzureIoTHubClientTelemetryBatchOptions_t xOptions;
+    AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Process( NULL ), eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_OptionsInit( &xOptions ), eAzureIoTSuccess );
+    xOptions.ulMaxAgeMilliseconds = 100 * azureiotMILLISECONDS_PER_TICK;
+    prvSetupTestBatch( &xTestIoTHubClient, &xBatch, &xOptions, sizeof( ucArena ) );
+
+    xTestTickCount = 1;
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_AppendRecord( &xBatch,
+                                                                    ( const uint8_t * ) testRECORD_ONE,
+                                                                    sizeof( testRECORD_ONE ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* Not old enough yet */
+    xTestTickCount = 100;
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Process( &xBatch ), eAzureIoTSuccess );
+
+    xTestTickCount = 101;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_Process( &xBatch ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( &xBatch, &xMetrics ), eAzureIoTSuccess );
+    assert_int_equal( xMetrics.ulPublishCount, 1 );
+    assert_int_equal( xMetrics.ulLastFlushLatencyMs, 100 * azureiotMILLISECONDS_PER_TICK );
+    assert_int_equal( xMetrics.ulMaxFlushLatencyMs, 100 * azureiotMILLISECONDS_PER_TICK );
+
+    xTestTickCount = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClientTelemetryBatch_GetMetrics_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClientTelemetryBatch_t xBatch;
+    AzureIoTHubClientTelemetryBatchMetrics_t xMetrics;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( NULL, &xMetrics ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClientTelemetryBatch_GetMetrics( &xBatch, NULL ), eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_OptionsInit_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_Init_Failure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_MaxRecordsSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_ArenaFullSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_ThresholdFlushFailure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_ArenaFullFlushFailure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_AppendRecord_TooBigFailure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_Flush_PublishFailure ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_Process_MaxAgeSuccess ),
+        cmocka_unit_test( testAzureIoTHubClientTelemetryBatch_GetMetrics_InvalidArgFailure )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_telemetry_batch_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,159 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_telemetry_bench.c
+ * @brief Micro-benchmark for the per-message cost of sending telemetry with the Azure IoT Hub Client.
+ *
+ * The "generated" figure forces the client to build the full topic through the embedded SDK for
+ * every message, as it did before the prefix was cached. The "cached" figure uses the prefix computed
+ * at #AzureIoTHubClient_Init and only appends the property suffix. Both go through
+ * #AzureIoTHubClient_SendTelemetryWithTopicBuffer and the cmocka publish mock, so the difference
+ * between them is the topic generation cost.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+#include "azure_iot_message.h"
+/*-----------------------------------------------------------*/
+
+#define benchITERATIONS    ( 100000 )
+/*-----------------------------------------------------------*/
+
+extern uint16_t usSentQOS;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static const uint8_t ucModuleId[] = "testmodule";
+static const uint8_t ucTestTelemetryPayload[] = "{\"temperature\":21.5}";
+static uint8_t ucBuffer[ 512 ];
+static uint8_t ucTopicBuffer[ 256 ];
+static uint8_t ucPropertiesBuffer[ 64 ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return 1;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return 0xFFFFFFFFFFFFFFFF;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvSendTelemetryBench( AzureIoTHubClient_t * pxTestIoTHubClient,
+                                       AzureIoTMessageProperties_t * pxProperties )
+{
+    uint64_t ullStart;
+
+    will_return_count( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess, benchITERATIONS );
+    ullStart = prvGetNanoseconds();
+
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        ( void ) AzureIoTHubClient_SendTelemetryWithTopicBuffer( pxTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 pxProperties, eAzureIoTHubMessageQoS0,
+                                                                 ucTopicBuffer, sizeof( ucTopicBuffer ),
+                                                                 NULL );
+    }
+
+    return prvGetNanoseconds() - ullStart;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_TelemetryBench( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    AzureIoTMessageProperties_t xProperties;
+    AzureIoTMessageProperties_t * pxProperties;
+    uint16_t usTelemetryTopicPrefixLength;
+    uint64_t ullGeneratedNs;
+    uint64_t ullCachedNs;
+
+    ( void ) ppvState;
+
+    xHubClientOptions.pucModuleID = ucModuleId;
+    xHubClientOptions.ulModuleIDLength = sizeof( ucModuleId ) - 1;
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( &xTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+    usTelemetryTopicPrefixLength = xTestIoTHubClient._internal.usTelemetryTopicPrefixLength;
+    assert_true( usTelemetryTopicPrefixLength > 0 );
+
+    assert_int_equal( AzureIoTMessage_PropertiesInit( &xProperties, ucPropertiesBuffer, 0, sizeof( ucPropertiesBuffer ) ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTMessage_PropertiesAppend( &xProperties,
+                                                        ( const uint8_t * ) "sensor", sizeof( "sensor" ) - 1,
+                                                        ( const uint8_t * ) "thermo-1", sizeof( "thermo-1" ) - 1 ),
+                      eAzureIoTSuccess );
+
+    for( uint32_t ulCase = 0; ulCase < 2; ulCase++ )
+    {
+        pxProperties = ( ulCase == 0 ) ? NULL : &xProperties;
+
+        usSentQOS = 0xFF;
+        xTestIoTHubClient._internal.usTelemetryTopicPrefixLength = 0;
+        ullGeneratedNs = prvSendTelemetryBench( &xTestIoTHubClient, pxProperties );
+
+        xTestIoTHubClient._internal.usTelemetryTopicPrefixLength = usTelemetryTopicPrefixLength;
+        ullCachedNs = prvSendTelemetryBench( &xTestIoTHubClient, pxProperties );
+
+        printf( "[ BENCH    ] %-13s generated topic: %6llu ns/msg | cached prefix: %6llu ns/msg\n",
+                ( pxProperties == NULL ) ? "no properties" : "properties",
+                ( unsigned long long ) ( ullGeneratedNs / benchITERATIONS ),
+                ( unsigned long long ) ( ullCachedNs / benchITERATIONS ) );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClient_TelemetryBench )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_telemetry_bench", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -6,6 +6,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
 
 #include <cmocka.h>
@@ -26,6 +27,7 @@
 #define testPROPERTY_MESSAGE                  "{\"desired\":{\"telemetrySendFrequency\":\"5m\"},\"reported\":{\"telemetrySendFrequency\":\"5m\"}}"
 #define testPROPERTY_DESIRED_MESSAGE_TOPIC    "$iothub/twin/PATCH/properties/desired/?$version=1"
 #define testPROPERTY_DESIRED_MESSAGE          "{\"telemetrySendFrequency\":\"5m\"}"
+#define testTELEMETRY_TOPIC                   "devices/testiothub/messages/events/"
 /*-----------------------------------------------------------*/
 
 typedef struct ReceiveTestData
@@ -60,6 +62,13 @@ static AzureIoTTransportInterface_t xTransportInterface =
     .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
 };
 static uint32_t ulReceivedCallbackFunctionId;
+static uint32_t ulReceivedTokenRefreshCount;
+static uint32_t ulTestHMACContext;
+static uint64_t ullTestUnixTime;
+static TickType_t xTestTickCount = 1;
+static uint16_t usReceivedTelemetryAckPacketId;
+static void * pvReceivedTelemetryAckCookie;
+static uint32_t ulReceivedTelemetryAckFailedCount;
 static const ReceiveTestData_t xTestReceiveData[] =
 {
     {
@@ -122,6 +131,51 @@ static const ReceiveTestData_t xTestRandomReceiveData[] =
         .ulCallbackFunctionId = 0
     }
 };
+static const ReceiveTestData_t xTestPrefixOnlyReceiveData[] =
+{
+    {
+        .pucTopic = ( const uint8_t * ) "devices/",
+        .ulTopicLength = sizeof( "devices/" ) - 1,
+        .pucPayload = ( const uint8_t * ) testCLOUD_MESSAGE,
+        .ulPayloadLength = sizeof( testCLOUD_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    },
+    {
+        .pucTopic = ( const uint8_t * ) "$iothub/",
+        .ulTopicLength = sizeof( "$iothub/" ) - 1,
+        .pucPayload = ( const uint8_t * ) testCLOUD_MESSAGE,
+        .ulPayloadLength = sizeof( testCLOUD_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    },
+    {
+        .pucTopic = ( const uint8_t * ) "$iothub/twin/",
+        .ulTopicLength = sizeof( "$iothub/twin/" ) - 1,
+        .pucPayload = ( const uint8_t * ) testPROPERTY_MESSAGE,
+        .ulPayloadLength = sizeof( testPROPERTY_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    },
+    {
+        .pucTopic = ( const uint8_t * ) "$iothub/methods/POST",
+        .ulTopicLength = sizeof( "$iothub/methods/POST" ) - 1,
+        .pucPayload = ( const uint8_t * ) testCOMMAND_MESSAGE,
+        .ulPayloadLength = sizeof( testCOMMAND_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    },
+    {
+        .pucTopic = ( const uint8_t * ) "$iothub/twins/res/200/?$rid=2",
+        .ulTopicLength = sizeof( "$iothub/twins/res/200/?$rid=2" ) - 1,
+        .pucPayload = ( const uint8_t * ) testPROPERTY_MESSAGE,
+        .ulPayloadLength = sizeof( testPROPERTY_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    },
+    {
+        .pucTopic = ( const uint8_t * ) "devicesx/unittest/messages/devicebound/",
+        .ulTopicLength = sizeof( "devicesx/unittest/messages/devicebound/" ) - 1,
+        .pucPayload = ( const uint8_t * ) testCLOUD_MESSAGE,
+        .ulPayloadLength = sizeof( testCLOUD_MESSAGE ) - 1,
+        .ulCallbackFunctionId = 0
+    }
+};
 /*-----------------------------------------------------------*/
 
 TickType_t xTaskGetTickCount( void );
@@ -129,7 +183,7 @@ uint32_t ulGetAllTests();
 
 TickType_t xTaskGetTickCount( void )
 {
-    return 1;
+    return xTestTickCount;
 }
 /*-----------------------------------------------------------*/
 
@@ -139,6 +193,22 @@ static uint64_t prvGetUnixTime( void )
 }
 /*-----------------------------------------------------------*/
 
+static uint64_t prvGetTestUnixTime( void )
+{
+    return ullTestUnixTime;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTokenRefresh( AzureIoTHubClient_t * pxAzureIoTHubClient,
+                                 void * pvContext )
+{
+    assert_true( pxAzureIoTHubClient != NULL );
+    assert_true( pvContext == &ulReceivedTokenRefreshCount );
+
+    ulReceivedTokenRefreshCount++;
+}
+/*-----------------------------------------------------------*/
+
 static uint32_t prvHmacFunction( const uint8_t * pucKey,
                                  uint32_t ulKeyLength,
                                  const uint8_t * pucData,
@@ -159,6 +229,25 @@ static uint32_t prvHmacFunction( const uint8_t * pucKey,
 }
 /*-----------------------------------------------------------*/
 
+static uint32_t prvHmacContextFunction( void * pvHMACContext,
+                                        const uint8_t * pucData,
+                                        uint32_t ulDataLength,
+                                        uint8_t * pucOutput,
+                                        uint32_t ulOutputLength,
+                                        uint32_t * pucBytesCopied )
+{
+    ( void ) pucData;
+    ( void ) ulDataLength;
+    ( void ) pucOutput;
+    ( void ) ulOutputLength;
+    ( void ) pucBytesCopied;
+
+    assert_ptr_equal( pvHMACContext, &ulTestHMACContext );
+
+    return( ( uint32_t ) mock() );
+}
+/*-----------------------------------------------------------*/
+
 static void prvSetupTestIoTHubClient( AzureIoTHubClient_t * pxTestIoTHubClient )
 {
     AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
@@ -176,6 +265,33 @@ static void prvSetupTestIoTHubClient( AzureIoTHubClient_t * pxTestIoTHubClient )
 }
 /*-----------------------------------------------------------*/
 
+static void prvSetupTestIoTHubClientWithSymmetricKey( AzureIoTHubClient_t * pxTestIoTHubClient )
+{
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+
+    xHubClientOptions.xTokenRefreshCallback = prvTestTokenRefresh;
+    xHubClientOptions.pvTokenRefreshCallbackContext = &ulReceivedTokenRefreshCount;
+    ulReceivedTokenRefreshCount = 0;
+    ullTestUnixTime = 1000;
+
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( pxTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetTestUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKey( pxTestIoTHubClient,
+                                                         ucTestSymmetricKey,
+                                                         sizeof( ucTestSymmetricKey ) - 1,
+                                                         prvHmacFunction ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
 static void prvTestCloudMessage( AzureIoTHubClientCloudToDeviceMessageRequest_t * pxMessage,
                                  void * pvContext )
 {
@@ -225,6 +341,22 @@ static void prvTestProperties( AzureIoTHubClientPropertiesResponse_t * pxMessage
 }
 /*-----------------------------------------------------------*/
 
+static void prvTestSubscribeComplete( AzureIoTResult_t xResult,
+                                      void * pvContext )
+{
+    assert_int_equal( xResult, eAzureIoTSuccess );
+    ( *( uint32_t * ) pvContext )++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestSubscribeRejected( AzureIoTResult_t xResult,
+                                      void * pvContext )
+{
+    assert_int_equal( xResult, eAzureIoTErrorSubscribeFailed );
+    ( *( uint32_t * ) pvContext )++;
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_Init_Failure( void ** ppvState )
 {
     AzureIoTHubClient_t xTestIoTHubClient;
@@ -446,6 +578,120 @@ static void testAzureIoTHubClient_Connect_Success( void ** ppvState )
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_Connect_SASTokenCached_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint64_t ullRefreshTime;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClientWithSymmetricKey( &xTestIoTHubClient );
+
+    /* First connect generates the token */
+    will_return( prvHmacFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+    assert_int_not_equal( xTestIoTHubClient._internal.ulSASTokenLength, 0 );
+
+    /* Reconnecting before the refresh margin reuses it, no HMAC */
+    ullRefreshTime = xTestIoTHubClient._internal.ullSASTokenExpiryTimeSecs -
+                     xTestIoTHubClient._internal.ulTokenRefreshMarginSecs;
+    ullTestUnixTime = ullRefreshTime - 1;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+
+    /* Reconnecting within the refresh margin generates a new one */
+    ullTestUnixTime = ullRefreshTime;
+    will_return( prvHmacFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+    assert_true( xTestIoTHubClient._internal.ullSASTokenExpiryTimeSecs >
+                 ( ullRefreshTime + xTestIoTHubClient._internal.ulTokenRefreshMarginSecs ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_Connect_SASTokenFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClientWithSymmetricKey( &xTestIoTHubClient );
+
+    /* Fail if the HMAC fails, and do not cache anything */
+    will_return( prvHmacFunction, 1 );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTErrorFailed );
+    assert_int_equal( xTestIoTHubClient._internal.ulSASTokenLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_Connect_SASTokenContext_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClientWithSymmetricKey( &xTestIoTHubClient );
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKeyContext( &xTestIoTHubClient,
+                                                                prvHmacContextFunction,
+                                                                &ulTestHMACContext ),
+                      eAzureIoTSuccess );
+
+    /* The token is signed with the context, the key set before is dropped */
+    will_return( prvHmacContextFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+    assert_int_not_equal( xTestIoTHubClient._internal.ulSASTokenLength, 0 );
+    assert_int_equal( xTestIoTHubClient._internal.ulDecodedSymmetricKeyLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_Connect_SASTokenContextFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKeyContext( &xTestIoTHubClient,
+                                                                prvHmacContextFunction,
+                                                                &ulTestHMACContext ),
+                      eAzureIoTSuccess );
+
+    will_return( prvHmacContextFunction, 1 );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTErrorFailed );
+    assert_int_equal( xTestIoTHubClient._internal.ulSASTokenLength, 0 );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_Disconnect_InvalidArgFailure( void ** ppvState )
 {
     ( void ) ppvState;
@@ -593,6 +839,295 @@ static void testAzureIoTHubClient_SendTelemetryQOS1WithPacketID_Success( void **
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_SendTelemetryWithTopicBuffer_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint8_t ucTopicBuffer[ 64 ];
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail when client is NULL */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( NULL,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      NULL, eAzureIoTHubMessageQoS0,
+                                                                      ucTopicBuffer, sizeof( ucTopicBuffer ),
+                                                                      NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail when topic buffer is NULL */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( &xTestIoTHubClient,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      NULL, eAzureIoTHubMessageQoS0,
+                                                                      NULL, sizeof( ucTopicBuffer ),
+                                                                      NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail when topic buffer length is 0 */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( &xTestIoTHubClient,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      NULL, eAzureIoTHubMessageQoS0,
+                                                                      ucTopicBuffer, 0,
+                                                                      NULL ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithTopicBuffer_SmallBufferFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint8_t ucTopicBuffer[ sizeof( testTELEMETRY_TOPIC ) - 2 ];
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail if the topic prefix does not fit in the caller buffer */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( &xTestIoTHubClient,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      NULL, eAzureIoTHubMessageQoS0,
+                                                                      ucTopicBuffer, sizeof( ucTopicBuffer ),
+                                                                      NULL ),
+                      eAzureIoTErrorOutOfMemory );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithTopicBuffer_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTMessageProperties_t xProperties;
+    uint8_t ucPropertiesBuffer[ 32 ];
+    uint8_t ucTopicBuffer[ 128 ];
+    uint16_t usPacketId = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+    assert_int_equal( xTestIoTHubClient._internal.usTelemetryTopicPrefixLength, sizeof( testTELEMETRY_TOPIC ) - 1 );
+
+    /* Without properties only the cached prefix is used */
+    usSentQOS = eAzureIoTMQTTQoS0;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( &xTestIoTHubClient,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      NULL, eAzureIoTHubMessageQoS0,
+                                                                      ucTopicBuffer, sizeof( ucTopicBuffer ),
+                                                                      NULL ),
+                      eAzureIoTSuccess );
+    assert_memory_equal( ucTopicBuffer, testTELEMETRY_TOPIC, sizeof( testTELEMETRY_TOPIC ) - 1 );
+
+    /* Properties are appended after the prefix */
+    assert_int_equal( AzureIoTMessage_PropertiesInit( &xProperties, ucPropertiesBuffer, 0, sizeof( ucPropertiesBuffer ) ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTMessage_PropertiesAppend( &xProperties,
+                                                        ( const uint8_t * ) "key", sizeof( "key" ) - 1,
+                                                        ( const uint8_t * ) "value", sizeof( "value" ) - 1 ),
+                      eAzureIoTSuccess );
+
+    usSentQOS = eAzureIoTMQTTQoS1;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithTopicBuffer( &xTestIoTHubClient,
+                                                                      ucTestTelemetryPayload,
+                                                                      sizeof( ucTestTelemetryPayload ) - 1,
+                                                                      &xProperties, eAzureIoTHubMessageQoS1,
+                                                                      ucTopicBuffer, sizeof( ucTopicBuffer ),
+                                                                      &usPacketId ),
+                      eAzureIoTSuccess );
+    assert_memory_equal( ucTopicBuffer, testTELEMETRY_TOPIC "key=value", sizeof( testTELEMETRY_TOPIC "key=value" ) - 1 );
+    assert_int_equal( usPacketId, usTestPacketId );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTelemetryAck( AzureIoTResult_t xResult,
+                                 uint16_t usTelemetryPacketID,
+                                 void * pvCookie,
+                                 uint32_t ulAckLatencyMilliseconds )
+{
+    assert_int_equal( xResult, eAzureIoTSuccess );
+    assert_int_equal( ulAckLatencyMilliseconds, 0 );
+
+    usReceivedTelemetryAckPacketId = usTelemetryPacketID;
+    pvReceivedTelemetryAckCookie = pvCookie;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithCookie_InvalidArgFailure( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    /* Fail SendTelemetryWithCookie when client is NULL */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( NULL,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithCookie_WindowFullFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint16_t usSavedPacketId = usTestPacketId;
+    uint16_t usPacketId = 0;
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    for( ulIndex = 0; ulIndex < azureiotconfigTELEMETRY_INFLIGHT_MAX; ulIndex++ )
+    {
+        usTestPacketId = ( uint16_t ) ( ulIndex + 1 );
+        will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+        assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                     ucTestTelemetryPayload,
+                                                                     sizeof( ucTestTelemetryPayload ) - 1,
+                                                                     NULL, NULL, &usPacketId ),
+                          eAzureIoTSuccess );
+        assert_int_equal( usPacketId, ulIndex + 1 );
+    }
+
+    /* Window is full, nothing should be published */
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
+                      eAzureIoTErrorBusy );
+
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithCookie_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    uint16_t usSavedPacketId = usTestPacketId;
+    uint16_t usPacketId = 0;
+    uint32_t ulCookie = 0;
+
+    ( void ) ppvState;
+
+    xHubClientOptions.xTelemetryAckCallback = prvTestTelemetryAck;
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( &xTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+
+    usTestPacketId = 7;
+    usSentQOS = eAzureIoTMQTTQoS1;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, &ulCookie, &usPacketId ),
+                      eAzureIoTSuccess );
+    assert_int_equal( usPacketId, 7 );
+
+    /* PUBACK for an untracked packet id leaves the window untouched */
+    usReceivedTelemetryAckPacketId = 0;
+    pvReceivedTelemetryAckCookie = NULL;
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBACK;
+    xDeserializedInfo.usPacketIdentifier = 8;
+    ulDelayReceivePacket = 0;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    assert_int_equal( usReceivedTelemetryAckPacketId, 0 );
+
+    xDeserializedInfo.usPacketIdentifier = 7;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    assert_int_equal( usReceivedTelemetryAckPacketId, 7 );
+    assert_ptr_equal( pvReceivedTelemetryAckCookie, &ulCookie );
+    assert_int_equal( xTestIoTHubClient._internal.xTelemetryInFlight[ 0 ]._internal.usPacketID, 0 );
+
+    xPacketInfo.ucType = 0;
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTestTelemetryAckFailed( AzureIoTResult_t xResult,
+                                       uint16_t usTelemetryPacketID,
+                                       void * pvCookie,
+                                       uint32_t ulAckLatencyMilliseconds )
+{
+    ( void ) usTelemetryPacketID;
+    ( void ) pvCookie;
+    ( void ) ulAckLatencyMilliseconds;
+
+    assert_int_equal( xResult, eAzureIoTErrorFailed );
+    ulReceivedTelemetryAckFailedCount++;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SendTelemetryWithCookie_ReconnectWindowFull_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    uint16_t usSavedPacketId = usTestPacketId;
+    bool xSessionPresent;
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    xHubClientOptions.xTelemetryAckCallback = prvTestTelemetryAckFailed;
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Init( &xTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+
+    for( ulIndex = 0; ulIndex < azureiotconfigTELEMETRY_INFLIGHT_MAX; ulIndex++ )
+    {
+        usTestPacketId = ( uint16_t ) ( ulIndex + 1 );
+        will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+        assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                     ucTestTelemetryPayload,
+                                                                     sizeof( ucTestTelemetryPayload ) - 1,
+                                                                     NULL, NULL, NULL ),
+                          eAzureIoTSuccess );
+    }
+
+    /* The connection dropped, the PUBACKs of the full window will never arrive */
+    ulReceivedTelemetryAckFailedCount = 0;
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient, false, &xSessionPresent, 60 ), eAzureIoTSuccess );
+    assert_int_equal( ulReceivedTelemetryAckFailedCount, azureiotconfigTELEMETRY_INFLIGHT_MAX );
+
+    /* The window is free for the new connection right away */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
+                      eAzureIoTSuccess );
+
+    /* Disconnecting reports the remaining one */
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Disconnect( &xTestIoTHubClient ), eAzureIoTSuccess );
+    assert_int_equal( ulReceivedTelemetryAckFailedCount, azureiotconfigTELEMETRY_INFLIGHT_MAX + 1 );
+
+    usTestPacketId = usSavedPacketId;
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_ProcessLoop_InvalidArgFailure( void ** ppvState )
 {
     ( void ) ppvState;
@@ -619,18 +1154,302 @@ static void testAzureIoTHubClient_ProcessLoop_MQTTProcessFailure( void ** ppvSta
 }
 /*-----------------------------------------------------------*/
 
-static void testAzureIoTHubClient_ProcessLoop_Success( void ** ppvState )
+static void testAzureIoTHubClient_ProcessLoop_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient,
+                                                     1234 ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_ProcessLoop_TokenRefresh_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClientWithSymmetricKey( &xTestIoTHubClient );
+
+    will_return( prvHmacFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+
+    /* No notification while the token is fresh */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient,
+                                                     1234 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulReceivedTokenRefreshCount, 0 );
+
+    /* Notified once within the refresh margin */
+    ullTestUnixTime = xTestIoTHubClient._internal.ullSASTokenExpiryTimeSecs -
+                      xTestIoTHubClient._internal.ulTokenRefreshMarginSecs;
+    will_return_count( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess, 2 );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient,
+                                                     1234 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient,
+                                                     1234 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulReceivedTokenRefreshCount, 1 );
+
+    /* Reconnecting renews the token and re-arms the notification */
+    will_return( prvHmacFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+    assert_false( xTestIoTHubClient._internal.xTokenRefreshNotified );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_GetNextDeadline_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( NULL, &ulWaitMilliseconds ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_GetNextDeadline_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulWaitMilliseconds;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    xTestTickCount = 1;
+    prvSetupTestIoTHubClientWithSymmetricKey( &xTestIoTHubClient );
+
+    /* Nothing to wake up for before connecting */
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, UINT32_MAX );
+
+    will_return( prvHmacFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+
+    /* Keep-alive */
+    xTestTickCount += 10000 / azureiotMILLISECONDS_PER_TICK;
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U - 10000 );
+
+    /* PUBACK timeout of tracked telemetry */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
+                      eAzureIoTSuccess );
+    xTestTickCount += 1000 / azureiotMILLISECONDS_PER_TICK;
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS - 1000 );
+
+    /* Deadline passed, the process loop releases the telemetry and restarts the keep-alive period */
+    xTestTickCount += ( azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U ) / azureiotMILLISECONDS_PER_TICK;
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U );
+
+    /* SAS token refresh */
+    ullTestUnixTime = xTestIoTHubClient._internal.ullSASTokenExpiryTimeSecs -
+                      xTestIoTHubClient._internal.ulTokenRefreshMarginSecs - 5;
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 5000 );
+
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Disconnect( &xTestIoTHubClient ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, UINT32_MAX );
+
+    xTestTickCount = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_GetNextDeadline_KeepAliveAfterPublish_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulWaitMilliseconds;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    xTestTickCount = 1;
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient,
+                                                 false,
+                                                 &xSessionPresent,
+                                                 60 ),
+                      eAzureIoTSuccess );
+
+    /* A publish one second into the period moves the keep-alive deadline */
+    xTestTickCount += 1000 / azureiotMILLISECONDS_PER_TICK;
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetry( &xTestIoTHubClient,
+                                                       ucTestTelemetryPayload,
+                                                       sizeof( ucTestTelemetryPayload ) - 1,
+                                                       NULL,
+                                                       eAzureIoTHubMessageQoS0,
+                                                       NULL ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U );
+
+    /* A full period after the connect, the MQTT library has no PING to send yet: the next
+     * deadline is one second away, when it does, and not a whole period later */
+    xTestTickCount += ( azureiotconfigKEEP_ALIVE_TIMEOUT_SECONDS * 1000U - 1000 ) / azureiotMILLISECONDS_PER_TICK;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_GetNextDeadline( &xTestIoTHubClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 1000 );
+
+    xTestTickCount = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_GetStatistics_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientStatistics_t xStatistics;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClient_GetStatistics( NULL, &xStatistics ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTHubClient_GetStatistics( &xTestIoTHubClient, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_GetStatistics_Success( void ** ppvState )
 {
     AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientStatistics_t xStatistics;
+    AzureIoTMQTTPublishInfo_t publishInfo;
+    uint32_t ulIndex;
 
     ( void ) ppvState;
 
+    xTestTickCount = 1;
     prvSetupTestIoTHubClient( &xTestIoTHubClient );
 
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    ulDelayReceivePacket = 0;
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
     will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
-    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient,
-                                                     1234 ),
+    assert_int_equal( AzureIoTHubClient_SubscribeCloudToDeviceMessage( &xTestIoTHubClient,
+                                                                       prvTestCloudMessage,
+                                                                       NULL, ( uint32_t ) -1 ),
+                      eAzureIoTSuccess );
+
+    /* Received for a subscribed feature, then for one which is not */
+    for( ulIndex = 0; ulIndex < 2; ulIndex++ )
+    {
+        will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+        xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBLISH;
+        publishInfo.pcTopicName = xTestReceiveData[ ulIndex ].pucTopic;
+        publishInfo.usTopicNameLength = ( uint16_t ) xTestReceiveData[ ulIndex ].ulTopicLength;
+        publishInfo.pvPayload = xTestReceiveData[ ulIndex ].pucPayload;
+        publishInfo.xPayloadLength = xTestReceiveData[ ulIndex ].ulPayloadLength;
+        xDeserializedInfo.pxPublishInfo = &publishInfo;
+        assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                          eAzureIoTSuccess );
+    }
+
+    /* Sent, then failed to send */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetry( &xTestIoTHubClient,
+                                                       ucTestTelemetryPayload,
+                                                       sizeof( ucTestTelemetryPayload ) - 1,
+                                                       NULL, eAzureIoTHubMessageQoS0, NULL ),
+                      eAzureIoTSuccess );
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClient_SendTelemetry( &xTestIoTHubClient,
+                                                       ucTestTelemetryPayload,
+                                                       sizeof( ucTestTelemetryPayload ) - 1,
+                                                       NULL, eAzureIoTHubMessageQoS0, NULL ),
+                      eAzureIoTErrorPublishFailed );
+
+    /* PUBACK after 5 milliseconds */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
+                      eAzureIoTSuccess );
+    xTestTickCount += 5 / azureiotMILLISECONDS_PER_TICK;
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+
+    /* PUBACK never arrives */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SendTelemetryWithCookie( &xTestIoTHubClient,
+                                                                 ucTestTelemetryPayload,
+                                                                 sizeof( ucTestTelemetryPayload ) - 1,
+                                                                 NULL, NULL, NULL ),
                       eAzureIoTSuccess );
+    xTestTickCount += azureiotconfigTELEMETRY_PUBACK_TIMEOUT_MS / azureiotMILLISECONDS_PER_TICK;
+    xPacketInfo.ucType = 0;
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 0 ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTHubClient_GetStatistics( &xTestIoTHubClient, &xStatistics ), eAzureIoTSuccess );
+    assert_int_equal( xStatistics.xCloudToDevice.ulMessagesReceived, 1 );
+    assert_int_equal( xStatistics.xCloudToDevice.ulBytesReceived, xTestReceiveData[ 0 ].ulPayloadLength );
+    assert_int_equal( xStatistics.xCommands.ulMessagesReceived, 0 );
+    assert_int_equal( xStatistics.ulUnmatchedTopics, 1 );
+    assert_int_equal( xStatistics.xTelemetry.ulMessagesSent, 3 );
+    assert_int_equal( xStatistics.xTelemetry.ulBytesSent, 3 * ( sizeof( ucTestTelemetryPayload ) - 1 ) );
+    assert_int_equal( xStatistics.ulPublishFailures, 1 );
+    assert_int_equal( xStatistics.ulPubackLatencyHistogram[ 3 ], 1 );
+    assert_int_equal( xStatistics.ulPubackTimeouts, 1 );
+
+    /* SUBACK, two publishes and the PUBACK */
+    assert_int_equal( xStatistics.ulCallbackCount, 4 );
+
+    xTestTickCount = 1;
 }
 /*-----------------------------------------------------------*/
 
@@ -978,6 +1797,230 @@ static void testAzureIoTHubClient_SubscribeProperties_MultipleSuccess( void ** p
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_SubscribeAll_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulCompleteCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail SubscribeAll when client is NULL */
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( NULL,
+                                                      prvTestCloudMessage, NULL,
+                                                      prvTestCommand, NULL,
+                                                      prvTestProperties, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail SubscribeAll when no feature callback is set */
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      NULL, NULL,
+                                                      NULL, NULL,
+                                                      NULL, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTErrorInvalidArgument );
+
+    assert_int_equal( ulCompleteCount, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SubscribeAll_SubscribeFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulCompleteCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      prvTestCloudMessage, NULL,
+                                                      prvTestCommand, NULL,
+                                                      prvTestProperties, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTErrorSubscribeFailed );
+
+    assert_int_equal( ulCompleteCount, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SubscribeAll_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTMQTTPublishInfo_t publishInfo;
+    uint32_t ulCompleteCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Returns without waiting for the SUBACK */
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      prvTestCloudMessage, NULL,
+                                                      prvTestCommand, NULL,
+                                                      prvTestProperties, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 0 );
+
+    /* A SUBACK for another packet must not complete it */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = ( uint16_t ) ( usTestPacketId + 1 );
+    ulDelayReceivePacket = 0;
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 0 );
+
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 1 );
+
+    /* Completion is reported only once */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 1 );
+
+    for( size_t index = 0; index < ( sizeof( xTestReceiveData ) / sizeof( ReceiveTestData_t ) ); index++ )
+    {
+        will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+        xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBLISH;
+        xDeserializedInfo.usPacketIdentifier = 1;
+        publishInfo.pcTopicName = xTestReceiveData[ index ].pucTopic;
+        publishInfo.usTopicNameLength = ( uint16_t ) xTestReceiveData[ index ].ulTopicLength;
+        publishInfo.pvPayload = xTestReceiveData[ index ].pucPayload;
+        publishInfo.xPayloadLength = xTestReceiveData[ index ].ulPayloadLength;
+        xDeserializedInfo.pxPublishInfo = &publishInfo;
+        ulReceivedCallbackFunctionId = 0;
+        ulDelayReceivePacket = 0;
+
+        assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                          eAzureIoTSuccess );
+
+        assert_int_equal( ulReceivedCallbackFunctionId, xTestReceiveData[ index ].ulCallbackFunctionId );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SubscribeAll_PartialSuccess( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulCompleteCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      NULL, NULL,
+                                                      prvTestCommand, NULL,
+                                                      NULL, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    ulDelayReceivePacket = 0;
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 1 );
+
+    /* Properties were not part of the subscribe */
+    assert_int_equal( AzureIoTHubClient_RequestPropertiesAsync( &xTestIoTHubClient ),
+                      eAzureIoTErrorTopicNotSubscribed );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SubscribeAll_RejectedFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulCompleteCount = 0;
+    /* Packet identifier, then one return code per topic: C2D, commands and the two properties topics */
+    uint8_t ucSuback[] = { 0x00, 0x01, 0x01, 0x00, 0x80, 0x00 };
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      prvTestCloudMessage, NULL,
+                                                      prvTestCommand, NULL,
+                                                      prvTestProperties, NULL,
+                                                      prvTestSubscribeRejected, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xPacketInfo.pucRemainingData = ucSuback;
+    xPacketInfo.xRemainingLength = sizeof( ucSuback );
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    ulDelayReceivePacket = 0;
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    xPacketInfo.pucRemainingData = NULL;
+    xPacketInfo.xRemainingLength = 0;
+    assert_int_equal( ulCompleteCount, 1 );
+
+    /* The rejected properties topic leaves properties unsubscribed */
+    assert_int_equal( AzureIoTHubClient_RequestPropertiesAsync( &xTestIoTHubClient ),
+                      eAzureIoTErrorTopicNotSubscribed );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_SubscribeAll_BusyFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint32_t ulCompleteCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      NULL, NULL,
+                                                      prvTestCommand, NULL,
+                                                      NULL, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+
+    /* Fail a second SubscribeAll while the first one waits for its SUBACK */
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      prvTestCloudMessage, NULL,
+                                                      NULL, NULL,
+                                                      NULL, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTErrorBusy );
+
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    ulDelayReceivePacket = 0;
+    assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulCompleteCount, 1 );
+
+    /* Once completed, another SubscribeAll can be sent */
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeAll( &xTestIoTHubClient,
+                                                      prvTestCloudMessage, NULL,
+                                                      NULL, NULL,
+                                                      NULL, NULL,
+                                                      prvTestSubscribeComplete, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_UnsubscribeCloudMessage_InvalidArgFailure( void ** ppvState )
 {
     ( void ) ppvState;
@@ -1534,6 +2577,63 @@ static void testAzureIoTHubClient_ReceiveRandomMessages_Success( void ** ppvStat
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_ReceivePrefixOnlyMessages_Success( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTMQTTPublishInfo_t publishInfo;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    xPacketInfo.ucType = azureiotmqttPACKET_TYPE_SUBACK;
+    xDeserializedInfo.usPacketIdentifier = usTestPacketId;
+    ulDelayReceivePacket = 0;
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeCloudToDeviceMessage( &xTestIoTHubClient,
+                                                                       prvTestCloudMessage,
+                                                                       NULL, ( uint32_t ) -1 ),
+                      eAzureIoTSuccess );
+
+    xDeserializedInfo.usPacketIdentifier = ++usTestPacketId;
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeCommand( &xTestIoTHubClient,
+                                                          prvTestCommand,
+                                                          NULL, ( uint32_t ) -1 ),
+                      eAzureIoTSuccess );
+
+    xDeserializedInfo.usPacketIdentifier = ++usTestPacketId;
+    will_return( AzureIoTMQTT_Subscribe, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTHubClient_SubscribeProperties( &xTestIoTHubClient,
+                                                             prvTestProperties,
+                                                             NULL, ( uint32_t ) -1 ),
+                      eAzureIoTSuccess );
+
+    /* Topics which only carry (or almost carry) a known prefix must not reach a callback */
+    for( size_t index = 0; index < ( sizeof( xTestPrefixOnlyReceiveData ) / sizeof( ReceiveTestData_t ) ); index++ )
+    {
+        will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+        xPacketInfo.ucType = azureiotmqttPACKET_TYPE_PUBLISH;
+        xDeserializedInfo.usPacketIdentifier = 1;
+        publishInfo.pcTopicName = xTestPrefixOnlyReceiveData[ index ].pucTopic;
+        publishInfo.usTopicNameLength = ( uint16_t ) xTestPrefixOnlyReceiveData[ index ].ulTopicLength;
+        publishInfo.pvPayload = xTestPrefixOnlyReceiveData[ index ].pucPayload;
+        publishInfo.xPayloadLength = xTestPrefixOnlyReceiveData[ index ].ulPayloadLength;
+        xDeserializedInfo.pxPublishInfo = &publishInfo;
+        ulReceivedCallbackFunctionId = 0;
+        ulDelayReceivePacket = 0;
+
+        assert_int_equal( AzureIoTHubClient_ProcessLoop( &xTestIoTHubClient, 60 ),
+                          eAzureIoTSuccess );
+
+        assert_int_equal( ulReceivedCallbackFunctionId, 0 );
+    }
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_SetSymmetricKey_InvalidArgFailure( void ** ppvState )
 {
     AzureIoTHubClient_t xTestIoTHubClient;
@@ -1564,6 +2664,25 @@ static void testAzureIoTHubClient_SetSymmetricKey_InvalidArgFailure( void ** ppv
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_SetSymmetricKey_KeyTooBigFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    uint8_t ucLongKey[ ( ( azureiotconfigSYMMETRIC_KEY_DECODED_MAX / 3 ) + 2 ) * 4 ];
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail SetSymmetricKey when the decoded key does not fit */
+    memset( ucLongKey, 'A', sizeof( ucLongKey ) );
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKey( &xTestIoTHubClient,
+                                                         ucLongKey,
+                                                         sizeof( ucLongKey ),
+                                                         prvHmacFunction ),
+                      eAzureIoTErrorOutOfMemory );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTHubClient_SetSymmetricKey_Success( void ** ppvState )
 {
     AzureIoTHubClient_t xTestIoTHubClient;
@@ -1580,6 +2699,28 @@ static void testAzureIoTHubClient_SetSymmetricKey_Success( void ** ppvState )
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTHubClient_SetSymmetricKeyContext_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+
+    ( void ) ppvState;
+
+    prvSetupTestIoTHubClient( &xTestIoTHubClient );
+
+    /* Fail SetSymmetricKeyContext when client is NULL */
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKeyContext( NULL,
+                                                                prvHmacContextFunction,
+                                                                &ulTestHMACContext ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail SetSymmetricKeyContext when HMAC Callback is NULL */
+    assert_int_equal( AzureIoTHubClient_SetSymmetricKeyContext( &xTestIoTHubClient,
+                                                                NULL,
+                                                                &ulTestHMACContext ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
 uint32_t ulGetAllTests()
 {
     const struct CMUnitTest tests[] =
@@ -1593,6 +2734,10 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTHubClient_Connect_InvalidArgFailure ),
         cmocka_unit_test( testAzureIoTHubClient_Connect_MQTTConnectFailure ),
         cmocka_unit_test( testAzureIoTHubClient_Connect_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_Connect_SASTokenCached_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_Connect_SASTokenFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_Connect_SASTokenContext_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_Connect_SASTokenContextFailure ),
         cmocka_unit_test( testAzureIoTHubClient_Disconnect_InvalidArgFailure ),
         cmocka_unit_test( testAzureIoTHubClient_Disconnect_MQTTDisconnectFailure ),
         cmocka_unit_test( testAzureIoTHubClient_Disconnect_Success ),
@@ -1601,9 +2746,22 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTHubClient_SendTelemetry_SendFailure ),
         cmocka_unit_test( testAzureIoTHubClient_SendTelemetryQOS0_Success ),
         cmocka_unit_test( testAzureIoTHubClient_SendTelemetryQOS1WithPacketID_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithTopicBuffer_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithTopicBuffer_SmallBufferFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithTopicBuffer_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithCookie_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithCookie_WindowFullFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithCookie_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_SendTelemetryWithCookie_ReconnectWindowFull_Success ),
         cmocka_unit_test( testAzureIoTHubClient_ProcessLoop_InvalidArgFailure ),
         cmocka_unit_test( testAzureIoTHubClient_ProcessLoop_MQTTProcessFailure ),
         cmocka_unit_test( testAzureIoTHubClient_ProcessLoop_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_ProcessLoop_TokenRefresh_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_GetNextDeadline_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_GetNextDeadline_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_GetNextDeadline_KeepAliveAfterPublish_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_GetStatistics_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_GetStatistics_Success ),
         cmocka_unit_test( testAzureIoTHubClient_SubscribeCloudMessage_InvalidArgFailure ),
         cmocka_unit_test( testAzureIoTHubClient_SubscribeCloudMessage_SubscribeFailure ),
         cmocka_unit_test( testAzureIoTHubClient_SubscribeCloudMessage_ReceiveFailure ),
@@ -1622,6 +2780,12 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTHubClient_SubscribeProperties_Success ),
         cmocka_unit_test( testAzureIoTHubClient_SubscribeProperties_DelayedSuccess ),
         cmocka_unit_test( testAzureIoTHubClient_SubscribeProperties_MultipleSuccess ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_InvalidArgFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_SubscribeFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_PartialSuccess ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_RejectedFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SubscribeAll_BusyFailure ),
         cmocka_unit_test( testAzureIoTHubClient_UnsubscribeCloudMessage_InvalidArgFailure ),
         cmocka_unit_test( testAzureIoTHubClient_UnsubscribeCloudMessage_UnsubscribeFailure ),
         cmocka_unit_test( testAzureIoTHubClient_UnsubscribeCloudMessage_Success ),
@@ -1648,8 +2812,11 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTHubClient_RequestPropertiesAsync_Success ),
         cmocka_unit_test( testAzureIoTHubClient_ReceiveMessages_Success ),
         cmocka_unit_test( testAzureIoTHubClient_ReceiveRandomMessages_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_ReceivePrefixOnlyMessages_Success ),
         cmocka_unit_test( testAzureIoTHubClient_SetSymmetricKey_InvalidArgFailure ),
-        cmocka_unit_test( testAzureIoTHubClient_SetSymmetricKey_Success )
+        cmocka_unit_test( testAzureIoTHubClient_SetSymmetricKey_KeyTooBigFailure ),
+        cmocka_unit_test( testAzureIoTHubClient_SetSymmetricKey_Success ),
+        cmocka_unit_test( testAzureIoTHubClient_SetSymmetricKeyContext_InvalidArgFailure )
     };
 
     return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_hub_client_ut", tests, NULL, NULL );
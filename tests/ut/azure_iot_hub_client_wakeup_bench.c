@@ -0,0 +1,349 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_hub_client_wakeup_bench.c
+ * @brief Benchmark for the wake-ups and CPU time of an idle Azure IoT Hub Client on the FreeRTOS POSIX port.
+ *
+ * The bench runs in a FreeRTOS task, like the E2E tests, over an idle MQTT link: the stand-in process loop
+ * blocks the task for the time it is given, as a real socket wait without data would. The "polling" figures
+ * call AzureIoTHubClient_ProcessLoop() with a fixed timeout. The "deadline" figure sleeps for the time given
+ * by AzureIoTHubClient_GetNextDeadline() and then processes without waiting, as a task in tickless idle would.
+ * The CPU time is the one of the bench task only.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "azure_iot_mqtt.h"
+#include "azure_iot_hub_client.h"
+/*-----------------------------------------------------------*/
+
+#define benchWINDOW_MS           ( 2000 )
+#define benchTASK_STACK_SIZE     ( 8 * 1024 )
+#define benchTASK_PRIORITY       ( 2 )
+/*-----------------------------------------------------------*/
+
+typedef struct BenchResult
+{
+    uint32_t ulWakeups;
+    uint64_t ullCpuNs;
+} BenchResult_t;
+
+static const uint8_t ucHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static uint8_t ucBuffer[ 512 ];
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static uint16_t usPacketId = 0;
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests();
+/*-----------------------------------------------------------*/
+
+/* configSUPPORT_STATIC_ALLOCATION is set to 1, so the application must provide the memory of the Idle task. */
+void vApplicationGetIdleTaskMemory( StaticTask_t ** ppxIdleTaskTCBBuffer,
+                                    StackType_t ** ppxIdleTaskStackBuffer,
+                                    uint32_t * pulIdleTaskStackSize )
+{
+    static StaticTask_t xIdleTaskTCB;
+    static StackType_t uxIdleTaskStack[ configMINIMAL_STACK_SIZE ];
+
+    *ppxIdleTaskTCBBuffer = &xIdleTaskTCB;
+    *ppxIdleTaskStackBuffer = uxIdleTaskStack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+/*-----------------------------------------------------------*/
+
+/* configSUPPORT_STATIC_ALLOCATION and configUSE_TIMERS are both set to 1, so the application must provide
+ * the memory of the Timer service task. */
+void vApplicationGetTimerTaskMemory( StaticTask_t ** ppxTimerTaskTCBBuffer,
+                                     StackType_t ** ppxTimerTaskStackBuffer,
+                                     uint32_t * pulTimerTaskStackSize )
+{
+    static StaticTask_t xTimerTaskTCB;
+    static StackType_t uxTimerTaskStack[ configTIMER_TASK_STACK_DEPTH ];
+
+    *ppxTimerTaskTCBBuffer = &xTimerTaskTCB;
+    *ppxTimerTaskStackBuffer = uxTimerTaskStack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+/*-----------------------------------------------------------*/
+
+/* MQTT port of an idle link: nothing is ever received. */
+AzureIoTMQTTResult_t AzureIoTMQTT_Init( AzureIoTMQTTHandle_t xContext,
+                                        const AzureIoTTransportInterface_t * pxTransportInterface,
+                                        AzureIoTMQTTGetCurrentTimeFunc_t xGetTimeFunction,
+                                        AzureIoTMQTTEventCallback_t xUserCallback,
+                                        uint8_t * pucNetworkBuffer,
+                                        size_t xNetworkBufferLength )
+{
+    ( void ) xContext;
+    ( void ) pxTransportInterface;
+    ( void ) xGetTimeFunction;
+    ( void ) xUserCallback;
+    ( void ) pucNetworkBuffer;
+    ( void ) xNetworkBufferLength;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Connect( AzureIoTMQTTHandle_t xContext,
+                                           const AzureIoTMQTTConnectInfo_t * pxConnectInfo,
+                                           const AzureIoTMQTTPublishInfo_t * pxWillInfo,
+                                           uint32_t ulMilliseconds,
+                                           bool * pxSessionPresent )
+{
+    ( void ) xContext;
+    ( void ) pxConnectInfo;
+    ( void ) pxWillInfo;
+    ( void ) ulMilliseconds;
+
+    *pxSessionPresent = false;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Subscribe( AzureIoTMQTTHandle_t xContext,
+                                             const AzureIoTMQTTSubscribeInfo_t * pxSubscriptionList,
+                                             size_t xSubscriptionCount,
+                                             uint16_t usPacketId )
+{
+    ( void ) xContext;
+    ( void ) pxSubscriptionList;
+    ( void ) xSubscriptionCount;
+    ( void ) usPacketId;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Publish( AzureIoTMQTTHandle_t xContext,
+                                           const AzureIoTMQTTPublishInfo_t * pxPublishInfo,
+                                           uint16_t usPacketId )
+{
+    ( void ) xContext;
+    ( void ) pxPublishInfo;
+    ( void ) usPacketId;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Unsubscribe( AzureIoTMQTTHandle_t xContext,
+                                               const AzureIoTMQTTSubscribeInfo_t * pxSubscriptionList,
+                                               size_t xSubscriptionCount,
+                                               uint16_t usPacketId )
+{
+    ( void ) xContext;
+    ( void ) pxSubscriptionList;
+    ( void ) xSubscriptionCount;
+    ( void ) usPacketId;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_Disconnect( AzureIoTMQTTHandle_t xContext )
+{
+    ( void ) xContext;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_ProcessLoop( AzureIoTMQTTHandle_t xContext,
+                                               uint32_t ulMilliseconds )
+{
+    ( void ) xContext;
+
+    /* Wait for data that never comes */
+    if( ulMilliseconds > 0 )
+    {
+        vTaskDelay( pdMS_TO_TICKS( ulMilliseconds ) );
+    }
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+uint16_t AzureIoTMQTT_GetPacketId( AzureIoTMQTTHandle_t xContext )
+{
+    ( void ) xContext;
+
+    return ++usPacketId;
+}
+/*-----------------------------------------------------------*/
+
+AzureIoTMQTTResult_t AzureIoTMQTT_GetSubAckStatusCodes( const AzureIoTMQTTPacketInfo_t * pxSubackPacket,
+                                                        uint8_t ** ppucPayloadStart,
+                                                        size_t * pxPayloadSize )
+{
+    ( void ) pxSubackPacket;
+
+    *ppucPayloadStart = NULL;
+    *pxPayloadSize = 0;
+
+    return eAzureIoTMQTTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return ( uint64_t ) ( xTaskGetTickCount() / configTICK_RATE_HZ );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetThreadCpuNanoseconds( void )
+{
+    struct timespec xTime;
+
+    /* Each task of the POSIX port is a thread */
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPollingBench( AzureIoTHubClient_t * pxTestIoTHubClient,
+                             uint32_t ulTimeoutMilliseconds,
+                             BenchResult_t * pxResult )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    uint64_t ullCpuStart = prvGetThreadCpuNanoseconds();
+
+    pxResult->ulWakeups = 0;
+
+    while( ( xTaskGetTickCount() - xStart ) < pdMS_TO_TICKS( benchWINDOW_MS ) )
+    {
+        assert_int_equal( AzureIoTHubClient_ProcessLoop( pxTestIoTHubClient, ulTimeoutMilliseconds ),
+                          eAzureIoTSuccess );
+        pxResult->ulWakeups++;
+    }
+
+    pxResult->ullCpuNs = prvGetThreadCpuNanoseconds() - ullCpuStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeadlineBench( AzureIoTHubClient_t * pxTestIoTHubClient,
+                              BenchResult_t * pxResult )
+{
+    TickType_t xStart = xTaskGetTickCount();
+    TickType_t xElapsed;
+    TickType_t xWait;
+    uint64_t ullCpuStart = prvGetThreadCpuNanoseconds();
+    uint32_t ulWaitMilliseconds;
+
+    pxResult->ulWakeups = 0;
+
+    while( ( xElapsed = xTaskGetTickCount() - xStart ) < pdMS_TO_TICKS( benchWINDOW_MS ) )
+    {
+        assert_int_equal( AzureIoTHubClient_GetNextDeadline( pxTestIoTHubClient, &ulWaitMilliseconds ),
+                          eAzureIoTSuccess );
+
+        /* Sleep until the deadline, or the end of the window as the link never has data */
+        xWait = pdMS_TO_TICKS( ulWaitMilliseconds );
+
+        if( xWait > ( pdMS_TO_TICKS( benchWINDOW_MS ) - xElapsed ) )
+        {
+            xWait = pdMS_TO_TICKS( benchWINDOW_MS ) - xElapsed;
+        }
+
+        vTaskDelay( xWait );
+
+        assert_int_equal( AzureIoTHubClient_ProcessLoop( pxTestIoTHubClient, 0 ), eAzureIoTSuccess );
+        pxResult->ulWakeups++;
+    }
+
+    pxResult->ullCpuNs = prvGetThreadCpuNanoseconds() - ullCpuStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintResult( const char * pcName,
+                            const BenchResult_t * pxResult )
+{
+    printf( "[ BENCH    ] %-16s | %8.1f wake-ups/s | %10llu ns CPU/s\n", pcName,
+            ( double ) pxResult->ulWakeups * 1000.0 / benchWINDOW_MS,
+            ( unsigned long long ) ( pxResult->ullCpuNs * 1000 / benchWINDOW_MS ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTHubClient_WakeupBench( void ** ppvState )
+{
+    AzureIoTHubClient_t xTestIoTHubClient;
+    AzureIoTHubClientOptions_t xHubClientOptions = { 0 };
+    BenchResult_t xPolling10ms;
+    BenchResult_t xPolling100ms;
+    BenchResult_t xDeadline;
+    bool xSessionPresent;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTHubClient_Init( &xTestIoTHubClient,
+                                              ucHostname, sizeof( ucHostname ) - 1,
+                                              ucDeviceId, sizeof( ucDeviceId ) - 1,
+                                              &xHubClientOptions,
+                                              ucBuffer,
+                                              sizeof( ucBuffer ),
+                                              prvGetUnixTime,
+                                              &xTransportInterface ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTHubClient_Connect( &xTestIoTHubClient, false, &xSessionPresent, 1000 ),
+                      eAzureIoTSuccess );
+
+    prvPollingBench( &xTestIoTHubClient, 10, &xPolling10ms );
+    prvPollingBench( &xTestIoTHubClient, 100, &xPolling100ms );
+    prvDeadlineBench( &xTestIoTHubClient, &xDeadline );
+
+    prvPrintResult( "polling 10 ms", &xPolling10ms );
+    prvPrintResult( "polling 100 ms", &xPolling100ms );
+    prvPrintResult( "deadline", &xDeadline );
+
+    /* An idle client only needs to wake up for the keep-alive */
+    assert_true( xDeadline.ulWakeups < xPolling100ms.ulWakeups );
+
+    assert_int_equal( AzureIoTHubClient_Disconnect( &xTestIoTHubClient ), eAzureIoTSuccess );
+    AzureIoTHubClient_Deinit( &xTestIoTHubClient );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBenchTask( void * pvParameters )
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTHubClient_WakeupBench )
+    };
+
+    ( void ) pvParameters;
+
+    setbuf( stdout, NULL );
+    exit( cmocka_run_group_tests_name( "azure_iot_hub_client_wakeup_bench", tests, NULL, NULL ) );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    /* The bench needs the scheduler, which does not return: the task exits the process */
+    xTaskCreate( prvBenchTask, "BenchTask", benchTASK_STACK_SIZE, NULL, benchTASK_PRIORITY, NULL );
+    vTaskStartScheduler();
+
+    return 1;
+}
+/*-----------------------------------------------------------*/
@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <setjmp.h>
+#include <time.h>
 
 #include <cmocka.h>
 
@@ -22,10 +23,15 @@
 
 #include "threading_alt.h"
 
+#include "azure_iot_crypto.h"
 #include "azure_iot_jws.h"
 /* #include "demo_config.h" */
 #include "FreeRTOSConfig.h"
 
+#define testJWS_STEP_COUNT          ( 7 )
+#define testJWS_BENCH_ITERATIONS    ( 20 )
+#define testJWS_CACHED_STEP_COUNT   ( 5 )
+
 static mbedtls_entropy_context xEntropyContext;
 static mbedtls_ctr_drbg_context xCtrDrgbContext;
 
@@ -180,6 +186,10 @@ static char ucWrongSHAManifestJWS[] = "eyJhbGciOiJSUzI1NiIsInNqd2siOiJleUpoYkdja
                                       "k-O9g03pB-fk1D_3sL1ju364STs87s77DfGK9e0oHbHgfzp4EdgrwRQBvTCWWKG3iT6ByfSH4N0";
 static char ucScratchBuffer[ azureiotjwsSCRATCH_BUFFER_SIZE ];
 
+/* The JWS is decoded in place, so each authentication works on a copy */
+static char ucJWSBuffer[ sizeof( ucValidManifestJWS ) > sizeof( ucWrongSHAManifestJWS ) ?
+                         sizeof( ucValidManifestJWS ) : sizeof( ucWrongSHAManifestJWS ) ];
+
 static int prvInitMbedTLS( mbedtls_entropy_context * pxEntropyContext,
                            mbedtls_ctr_drbg_context * pxCtrDrgbContext )
 {
@@ -223,16 +233,48 @@ static int prvInitMbedTLS( mbedtls_entropy_context * pxEntropyContext,
     return lMbedtlsError;
 }
 
+/* The linker wraps the crypto port, so the test can count the SHA256 and make the nth one from now fail */
+static uint32_t ulSHA256FinishFailCountdown = 0;
+static uint32_t ulSHA256FinishCount = 0;
+
+AzureIoTResult_t __real_AzureIoTCrypto_SHA256Finish( AzureIoTCryptoSHA256Context_t * pxContext,
+                                                     uint8_t * pucOutput,
+                                                     uint32_t ulOutputLength );
+
+AzureIoTResult_t __wrap_AzureIoTCrypto_SHA256Finish( AzureIoTCryptoSHA256Context_t * pxContext,
+                                                     uint8_t * pucOutput,
+                                                     uint32_t ulOutputLength )
+{
+    AzureIoTResult_t xResult = __real_AzureIoTCrypto_SHA256Finish( pxContext, pucOutput, ulOutputLength );
+
+    ulSHA256FinishCount++;
+
+    if( ( ulSHA256FinishFailCountdown != 0 ) && ( --ulSHA256FinishFailCountdown == 0 ) )
+    {
+        return eAzureIoTErrorFailed;
+    }
+
+    return xResult;
+}
+
+static char * prvCopyJWS( const char * pcJWS )
+{
+    memcpy( ucJWSBuffer, pcJWS, strlen( pcJWS ) + 1 );
+    return ucJWSBuffer;
+}
+
 static int setup( void ** state )
 {
     memset( ucScratchBuffer, 0, sizeof( ucScratchBuffer ) );
+    ulSHA256FinishFailCountdown = 0;
+    ulSHA256FinishCount = 0;
     return 0;
 }
 
 static void testAzureIoTJWS_ManifestAuthenticate_Success( void ** ppvState )
 {
     assert_int_equal( AzureIoTJWS_ManifestAuthenticate( ucValidManifest, strlen( ucValidManifest ),
-                                                        ucValidManifestJWS, strlen( ucValidManifestJWS ),
+                                                        prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
                                                         &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
                                                         ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
 }
@@ -240,7 +282,7 @@ static void testAzureIoTJWS_ManifestAuthenticate_Success( void ** ppvState )
 static void testAzureIoTJWS_ManifestAuthenticate_Failure( void ** ppvState )
 {
     assert_int_equal( AzureIoTJWS_ManifestAuthenticate( ucInvalidManifest, strlen( ucInvalidManifest ),
-                                                        ucValidManifestJWS, strlen( ucValidManifestJWS ),
+                                                        prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
                                                         &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
                                                         ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTErrorFailed );
 }
@@ -248,11 +290,283 @@ static void testAzureIoTJWS_ManifestAuthenticate_Failure( void ** ppvState )
 static void testAzureIoTJWS_ManifestAuthenticate_WrongSha_Failure( void ** ppvState )
 {
     assert_int_equal( AzureIoTJWS_ManifestAuthenticate( ucValidManifest, strlen( ucValidManifest ),
-                                                        ucWrongSHAManifestJWS, strlen( ucWrongSHAManifestJWS ),
+                                                        prvCopyJWS( ucWrongSHAManifestJWS ), strlen( ucWrongSHAManifestJWS ),
                                                         &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
                                                         ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTErrorFailed );
 }
 
+static void testAzureIoTJWS_ManifestAuthenticate_JWSOverwritten_Failure( void ** ppvState )
+{
+    char * pcJWS = prvCopyJWS( ucValidManifestJWS );
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticate( ucValidManifest, strlen( ucValidManifest ),
+                                                        pcJWS, strlen( ucValidManifestJWS ),
+                                                        &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                        ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+
+    /* The JWS was decoded in place, so it cannot be authenticated again */
+    assert_memory_not_equal( pcJWS, ucValidManifestJWS, strlen( ucValidManifestJWS ) );
+    assert_int_not_equal( AzureIoTJWS_ManifestAuthenticate( ucValidManifest, strlen( ucValidManifest ),
+                                                            pcJWS, strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+}
+
+static void testAzureIoTJWS_ManifestAuthenticateInit_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTJWS_ManifestContext_t xContext;
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( NULL, ucValidManifest, strlen( ucValidManifest ),
+                                                            prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                            NULL, strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                            prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) - 1 ), eAzureIoTErrorOutOfMemory );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( NULL ), eAzureIoTErrorInvalidArgument );
+}
+
+static void testAzureIoTJWS_ManifestAuthenticateStep_Success( void ** ppvState )
+{
+    AzureIoTJWS_ManifestContext_t xContext;
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                            prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+
+    for( uint32_t ulStep = 1; ulStep < testJWS_STEP_COUNT; ulStep++ )
+    {
+        assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( &xContext ), eAzureIoTErrorPending );
+    }
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( &xContext ), eAzureIoTSuccess );
+
+    /* Once complete, the result does not change */
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( &xContext ), eAzureIoTSuccess );
+}
+
+static void testAzureIoTJWS_ManifestAuthenticateStep_WrongSha_Failure( void ** ppvState )
+{
+    AzureIoTJWS_ManifestContext_t xContext;
+    AzureIoTResult_t xResult;
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                            prvCopyJWS( ucWrongSHAManifestJWS ), strlen( ucWrongSHAManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+
+    do
+    {
+        xResult = AzureIoTJWS_ManifestAuthenticateStep( &xContext );
+    } while( xResult == eAzureIoTErrorPending );
+
+    assert_int_equal( xResult, eAzureIoTErrorFailed );
+
+    /* The failure is kept */
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( &xContext ), eAzureIoTErrorFailed );
+}
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+
+static AzureIoTResult_t prvAuthenticateWithCache( AzureIoTJWS_SigningKeyCache_t * pxCache,
+                                                  const char * pcManifest,
+                                                  char * pcJWS,
+                                                  uint32_t * pulStepCount )
+{
+    AzureIoTJWS_ManifestContext_t xContext;
+    AzureIoTResult_t xResult;
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, pcManifest, strlen( pcManifest ),
+                                                            prvCopyJWS( pcJWS ), strlen( pcJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( &xContext, pxCache ), eAzureIoTSuccess );
+    *pulStepCount = 0;
+
+    do
+    {
+        xResult = AzureIoTJWS_ManifestAuthenticateStep( &xContext );
+        ( *pulStepCount )++;
+    } while( xResult == eAzureIoTErrorPending );
+
+    return xResult;
+}
+
+static void testAzureIoTJWS_SigningKeyCache_InvalidArgFailure( void ** ppvState )
+{
+    AzureIoTJWS_SigningKeyCache_t xCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t xEntries[ 1 ];
+    AzureIoTJWS_ManifestContext_t xContext;
+
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( NULL, xEntries, 1 ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, NULL, 1 ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 0 ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 1 ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                            prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                            &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                            ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( &xContext, NULL ), eAzureIoTErrorInvalidArgument );
+
+    /* Too late once a step ran */
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateStep( &xContext ), eAzureIoTErrorPending );
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateSetSigningKeyCache( &xContext, &xCache ), eAzureIoTErrorInvalidArgument );
+}
+
+static void testAzureIoTJWS_SigningKeyCache_Success( void ** ppvState )
+{
+    AzureIoTJWS_SigningKeyCache_t xCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t xEntries[ 2 ];
+    uint32_t ulStepCount;
+
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 2 ), eAzureIoTSuccess );
+
+    /* First authentication verifies the signing key and caches it */
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+    assert_int_equal( ulStepCount, testJWS_STEP_COUNT );
+
+    /* The next ones skip the JWK */
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+    assert_int_equal( ulStepCount, testJWS_CACHED_STEP_COUNT );
+
+    /* The JWS is still checked with the cached key */
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucInvalidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTErrorFailed );
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucWrongSHAManifestJWS, &ulStepCount ), eAzureIoTErrorFailed );
+}
+
+static void testAzureIoTJWS_ManifestAuthenticateWithCache_Success( void ** ppvState )
+{
+    AzureIoTJWS_SigningKeyCache_t xCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t xEntries[ 1 ];
+
+    /* Without a cache, it is AzureIoTJWS_ManifestAuthenticate() */
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateWithCache( ucValidManifest, strlen( ucValidManifest ),
+                                                                 prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                                 &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                                 ucScratchBuffer, sizeof( ucScratchBuffer ), NULL ), eAzureIoTSuccess );
+
+    /* The JWS, sjwk, JWK and manifest are hashed the first time */
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 1 ), eAzureIoTSuccess );
+    ulSHA256FinishCount = 0;
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateWithCache( ucValidManifest, strlen( ucValidManifest ),
+                                                                 prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                                 &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                                 ucScratchBuffer, sizeof( ucScratchBuffer ), &xCache ), eAzureIoTSuccess );
+    assert_int_equal( ulSHA256FinishCount, 4 );
+
+    /* The JWK is skipped with the cached signing key */
+    ulSHA256FinishCount = 0;
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateWithCache( ucValidManifest, strlen( ucValidManifest ),
+                                                                 prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                                 &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                                 ucScratchBuffer, sizeof( ucScratchBuffer ), &xCache ), eAzureIoTSuccess );
+    assert_int_equal( ulSHA256FinishCount, 3 );
+
+    assert_int_equal( AzureIoTJWS_ManifestAuthenticateWithCache( ucInvalidManifest, strlen( ucInvalidManifest ),
+                                                                 prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                                 &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                                 ucScratchBuffer, sizeof( ucScratchBuffer ), &xCache ), eAzureIoTErrorFailed );
+}
+
+static void testAzureIoTJWS_SigningKeyCache_SJWKHashFailure( void ** ppvState )
+{
+    AzureIoTJWS_SigningKeyCache_t xCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t xEntries[ 1 ];
+    uint32_t ulStepCount;
+
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 1 ), eAzureIoTSuccess );
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+
+    /* The signing input is hashed first, the sjwk second. Without the sjwk hash, the cache is not used. */
+    ulSHA256FinishFailCountdown = 2;
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTErrorFailed );
+    assert_int_equal( ulStepCount, 2 );
+
+    /* The cached key is still there for the next authentication */
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+    assert_int_equal( ulStepCount, testJWS_CACHED_STEP_COUNT );
+}
+
+static void testAzureIoTJWS_SigningKeyCache_LatencyBench( void ** ppvState )
+{
+    AzureIoTJWS_SigningKeyCache_t xCache;
+    AzureIoTJWS_SigningKeyCacheEntry_t xEntries[ 1 ];
+    uint32_t ulStepCount;
+    uint64_t ullStart;
+
+    assert_int_equal( AzureIoTJWS_SigningKeyCacheInit( &xCache, xEntries, 1 ), eAzureIoTSuccess );
+    assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+
+    ullStart = prvGetNanoseconds();
+
+    for( uint32_t ulIteration = 0; ulIteration < testJWS_BENCH_ITERATIONS; ulIteration++ )
+    {
+        assert_int_equal( prvAuthenticateWithCache( &xCache, ucValidManifest, ucValidManifestJWS, &ulStepCount ), eAzureIoTSuccess );
+    }
+
+    printf( "[ BENCH    ] %10llu ns/authentication with cached signing key\n",
+            ( unsigned long long ) ( ( prvGetNanoseconds() - ullStart ) / testJWS_BENCH_ITERATIONS ) );
+}
+
+static void testAzureIoTJWS_ManifestAuthenticateStep_LatencyBench( void ** ppvState )
+{
+    AzureIoTJWS_ManifestContext_t xContext;
+    uint64_t ullStepMaxNs[ testJWS_STEP_COUNT ] = { 0 };
+    uint64_t ullTotalNs = 0;
+    uint64_t ullStart;
+    uint64_t ullElapsed;
+    uint32_t ulStep;
+    AzureIoTResult_t xResult;
+
+    for( uint32_t ulIteration = 0; ulIteration < testJWS_BENCH_ITERATIONS; ulIteration++ )
+    {
+        assert_int_equal( AzureIoTJWS_ManifestAuthenticateInit( &xContext, ucValidManifest, strlen( ucValidManifest ),
+                                                                prvCopyJWS( ucValidManifestJWS ), strlen( ucValidManifestJWS ),
+                                                                &xADURootKeys[ 0 ], sizeof( xADURootKeys ) / sizeof( xADURootKeys[ 0 ] ),
+                                                                ucScratchBuffer, sizeof( ucScratchBuffer ) ), eAzureIoTSuccess );
+        ulStep = 0;
+
+        do
+        {
+            ullStart = prvGetNanoseconds();
+            xResult = AzureIoTJWS_ManifestAuthenticateStep( &xContext );
+            ullElapsed = prvGetNanoseconds() - ullStart;
+            ullTotalNs += ullElapsed;
+
+            if( ullElapsed > ullStepMaxNs[ ulStep ] )
+            {
+                ullStepMaxNs[ ulStep ] = ullElapsed;
+            }
+
+            ulStep++;
+        } while( xResult == eAzureIoTErrorPending );
+
+        assert_int_equal( xResult, eAzureIoTSuccess );
+        assert_int_equal( ulStep, testJWS_STEP_COUNT );
+    }
+
+    for( ulStep = 0; ulStep < testJWS_STEP_COUNT; ulStep++ )
+    {
+        printf( "[ BENCH    ] step %u | %10llu ns worst case\n", ( unsigned ) ulStep, ( unsigned long long ) ullStepMaxNs[ ulStep ] );
+    }
+
+    printf( "[ BENCH    ] %10llu ns/authentication\n", ( unsigned long long ) ( ullTotalNs / testJWS_BENCH_ITERATIONS ) );
+}
+
 uint32_t ulGetAllTests()
 {
     if( prvInitMbedTLS( &xEntropyContext, &xCtrDrgbContext ) != 0 )
@@ -263,9 +577,19 @@ uint32_t ulGetAllTests()
 
     const struct CMUnitTest tests[] =
     {
-        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_Success,          setup ),
-        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_Failure,          setup ),
-        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_WrongSha_Failure, setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_Success,                setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_Failure,                setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_WrongSha_Failure,       setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticate_JWSOverwritten_Failure, setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticateInit_InvalidArgFailure,  setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticateStep_Success,            setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticateStep_WrongSha_Failure,   setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticateStep_LatencyBench,       setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_SigningKeyCache_InvalidArgFailure,           setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_SigningKeyCache_Success,                     setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_SigningKeyCache_SJWKHashFailure,             setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_ManifestAuthenticateWithCache_Success,       setup ),
+        cmocka_unit_test_setup( testAzureIoTJWS_SigningKeyCache_LatencyBench,                setup ),
     };
 
     return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_jws_ut", tests, NULL, NULL );
@@ -0,0 +1,218 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_log.h"
+/*-----------------------------------------------------------*/
+
+#define testHEADER_SIZE        ( 8 )
+#define testTICK_COUNT         ( 0x12345678 )
+#define testFORMAT_NUMBER      "value %u"
+#define testFORMAT_STRING      "value %u %.*s"
+#define testFORMAT_STAR_WIDTH  "value %*d"
+/*-----------------------------------------------------------*/
+
+static uint8_t ucReadBuffer[ azureiotconfigDEFERRED_LOG_BUFFER_SIZE ];
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+void vPortEnterCritical( void );
+void vPortExitCritical( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return testTICK_COUNT;
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+}
+/*-----------------------------------------------------------*/
+
+static int prvTestSetup( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    /* Start every test with an empty ring */
+    while( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ) != 0 )
+    {
+    }
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredRead_InvalidArgFailure( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    AzureIoTLog_DeferredInfo( testFORMAT_NUMBER, 1 );
+
+    assert_int_equal( AzureIoTLog_DeferredRead( NULL, sizeof( ucReadBuffer ) ), 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredRead_RecordSuccess( void ** ppvState )
+{
+    const char * pcFormat = testFORMAT_STRING;
+    const char * pcRecordFormat;
+    uint16_t usLength;
+    uint32_t ulTickCount;
+    uint32_t ulPosition = testHEADER_SIZE;
+    int lValue;
+    uint16_t usStringLength;
+
+    ( void ) ppvState;
+
+    AzureIoTLog_DeferredWarn( pcFormat, 7, 3, "abcdef" );
+
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ),
+                      testHEADER_SIZE + sizeof( pcFormat ) + 2 * sizeof( int ) + sizeof( uint16_t ) + 3 );
+
+    memcpy( &usLength, ucReadBuffer, sizeof( usLength ) );
+    assert_int_equal( usLength, testHEADER_SIZE + sizeof( pcFormat ) + 2 * sizeof( int ) + sizeof( uint16_t ) + 3 );
+    assert_int_equal( ucReadBuffer[ 2 ], azureiotlogLEVEL_WARN );
+    assert_int_equal( ucReadBuffer[ 3 ], 0 );
+    memcpy( &ulTickCount, &ucReadBuffer[ 4 ], sizeof( ulTickCount ) );
+    assert_int_equal( ulTickCount, testTICK_COUNT );
+
+    memcpy( &pcRecordFormat, &ucReadBuffer[ ulPosition ], sizeof( pcRecordFormat ) );
+    assert_ptr_equal( pcRecordFormat, pcFormat );
+    ulPosition += sizeof( pcRecordFormat );
+
+    memcpy( &lValue, &ucReadBuffer[ ulPosition ], sizeof( lValue ) );
+    assert_int_equal( lValue, 7 );
+    ulPosition += sizeof( lValue );
+
+    memcpy( &lValue, &ucReadBuffer[ ulPosition ], sizeof( lValue ) );
+    assert_int_equal( lValue, 3 );
+    ulPosition += sizeof( lValue );
+
+    memcpy( &usStringLength, &ucReadBuffer[ ulPosition ], sizeof( usStringLength ) );
+    assert_int_equal( usStringLength, 3 );
+    ulPosition += sizeof( usStringLength );
+    assert_memory_equal( &ucReadBuffer[ ulPosition ], "abc", 3 );
+
+    /* Ring is now empty */
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ), 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredRead_TruncatedSuccess( void ** ppvState )
+{
+    char ucLongString[ azureiotconfigDEFERRED_LOG_RECORD_MAX ];
+    uint32_t ulIndex;
+    uint32_t ulLength;
+
+    ( void ) ppvState;
+
+    memset( ucLongString, 'a', sizeof( ucLongString ) - 1 );
+    ucLongString[ sizeof( ucLongString ) - 1 ] = '\0';
+
+    /* Each string is capped, but enough of them overflow the record */
+    AzureIoTLog_DeferredError( "%s %s %s %s %s %s %s %s", ucLongString, ucLongString, ucLongString, ucLongString,
+                               ucLongString, ucLongString, ucLongString, ucLongString );
+
+    ulLength = AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) );
+    assert_true( ulLength <= azureiotconfigDEFERRED_LOG_RECORD_MAX );
+    assert_int_equal( ucReadBuffer[ 2 ], azureiotlogLEVEL_ERROR );
+    assert_int_equal( ucReadBuffer[ 3 ], azureiotlogFLAG_TRUNCATED );
+
+    for( ulIndex = testHEADER_SIZE + sizeof( void * ) + sizeof( uint16_t );
+         ulIndex < testHEADER_SIZE + sizeof( void * ) + sizeof( uint16_t ) + azureiotconfigDEFERRED_LOG_STRING_MAX;
+         ulIndex++ )
+    {
+        assert_int_equal( ucReadBuffer[ ulIndex ], 'a' );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredRead_SmallBufferSuccess( void ** ppvState )
+{
+    uint32_t ulRecordLength = testHEADER_SIZE + sizeof( void * ) + sizeof( int );
+
+    ( void ) ppvState;
+
+    AzureIoTLog_DeferredInfo( testFORMAT_NUMBER, 1 );
+    AzureIoTLog_DeferredInfo( testFORMAT_NUMBER, 2 );
+
+    /* Only whole records are read */
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, ulRecordLength - 1 ), 0 );
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, ulRecordLength + 1 ), ulRecordLength );
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ), ulRecordLength );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredGetDropped_FullSuccess( void ** ppvState )
+{
+    uint32_t ulRecordLength = testHEADER_SIZE + sizeof( void * ) + sizeof( int );
+    uint32_t ulRecordCount = azureiotconfigDEFERRED_LOG_BUFFER_SIZE / ulRecordLength;
+    uint32_t ulDropped = AzureIoTLog_DeferredGetDropped();
+    uint32_t ulIndex;
+
+    ( void ) ppvState;
+
+    for( ulIndex = 0; ulIndex < ulRecordCount + 2; ulIndex++ )
+    {
+        AzureIoTLog_DeferredDebug( testFORMAT_NUMBER, ulIndex );
+    }
+
+    assert_int_equal( AzureIoTLog_DeferredGetDropped(), ulDropped + 2 );
+    assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ), ulRecordCount * ulRecordLength );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTLog_DeferredRead_WrapAroundSuccess( void ** ppvState )
+{
+    uint32_t ulRecordLength = testHEADER_SIZE + sizeof( void * ) + 2 * sizeof( int );
+    uint32_t ulRecordCount = azureiotconfigDEFERRED_LOG_BUFFER_SIZE / ulRecordLength;
+    uint32_t ulIndex;
+    int lValue;
+
+    ( void ) ppvState;
+
+    /* Write past the end of the ring several times, reading as we go */
+    for( ulIndex = 0; ulIndex < ulRecordCount * 3; ulIndex++ )
+    {
+        AzureIoTLog_DeferredInfo( testFORMAT_STAR_WIDTH, 4, ( int ) ulIndex );
+
+        assert_int_equal( AzureIoTLog_DeferredRead( ucReadBuffer, sizeof( ucReadBuffer ) ), ulRecordLength );
+        memcpy( &lValue, &ucReadBuffer[ testHEADER_SIZE + sizeof( void * ) ], sizeof( lValue ) );
+        assert_int_equal( lValue, 4 );
+        memcpy( &lValue, &ucReadBuffer[ testHEADER_SIZE + sizeof( void * ) + sizeof( int ) ], sizeof( lValue ) );
+        assert_int_equal( lValue, ulIndex );
+    }
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredRead_InvalidArgFailure, prvTestSetup ),
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredRead_RecordSuccess, prvTestSetup ),
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredRead_TruncatedSuccess, prvTestSetup ),
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredRead_SmallBufferSuccess, prvTestSetup ),
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredGetDropped_FullSuccess, prvTestSetup ),
+        cmocka_unit_test_setup( testAzureIoTLog_DeferredRead_WrapAroundSuccess, prvTestSetup )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_log_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,317 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_provisioning_cache.h"
+/*-----------------------------------------------------------*/
+
+static const uint8_t ucHubHostname[] = "unittest.azure-devices.net";
+static const uint8_t ucDeviceId[] = "testiothub";
+static const uint8_t ucEndpoint[] = "unittest.azure-devices-provisioning.net";
+static const uint8_t ucIDScope[] = "0ne000A247E";
+static const uint8_t ucRegistrationId[] = "testregistration";
+static const uint8_t ucOtherRegistrationId[] = "otherregistration";
+static uint8_t ucStorageBuffer[ azureiotprovisioningcacheRECORD_MAX ];
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests();
+
+static void prvSetupTestStorage( AzureIoTProvisioningStorage_t * pxStorage )
+{
+    memset( ucStorageBuffer, 0, sizeof( ucStorageBuffer ) );
+    assert_int_equal( AzureIoTRAMProvisioningStorage_Init( pxStorage, ucStorageBuffer, sizeof( ucStorageBuffer ) ),
+                      eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvInitTestCache( AzureIoTProvisioningCache_t * pxCache,
+                                          AzureIoTProvisioningStorage_t * pxStorage )
+{
+    return AzureIoTProvisioningCache_Init( pxCache, pxStorage,
+                                           ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                           ucIDScope, sizeof( ucIDScope ) - 1,
+                                           ucRegistrationId, sizeof( ucRegistrationId ) - 1 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Init_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+
+    assert_int_equal( prvInitTestCache( NULL, &xStorage ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( prvInitTestCache( &xCache, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail if the registration is missing */
+    assert_int_equal( AzureIoTProvisioningCache_Init( &xCache, &xStorage,
+                                                      NULL, 0,
+                                                      ucIDScope, sizeof( ucIDScope ) - 1,
+                                                      ucRegistrationId, sizeof( ucRegistrationId ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningCache_Init( &xCache, &xStorage,
+                                                      ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                                      NULL, 0,
+                                                      ucRegistrationId, sizeof( ucRegistrationId ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningCache_Init( &xCache, &xStorage,
+                                                      ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                                      ucIDScope, sizeof( ucIDScope ) - 1,
+                                                      NULL, 0 ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Init_Empty_Success( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Store_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    uint8_t ucLongHostname[ azureiotconfigPROVISIONING_CACHE_HOSTNAME_MAX + 1 ];
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTProvisioningCache_Store( NULL,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       NULL, 0,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       NULL, 0 ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail when the hostname is bigger than configured */
+    memset( ucLongHostname, 'a', sizeof( ucLongHostname ) );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucLongHostname, sizeof( ucLongHostname ),
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTErrorOutOfMemory );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Store_Reload_Success( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* A new cache on the same storage, as after a reboot, returns the assignment */
+    memset( &xCache, 0xA5, sizeof( xCache ) );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulHubHostnameLength, sizeof( ucHubHostname ) - 1 );
+    assert_memory_equal( pucHubHostname, ucHubHostname, ulHubHostnameLength );
+    assert_int_equal( ulDeviceIdLength, sizeof( ucDeviceId ) - 1 );
+    assert_memory_equal( pucDeviceId, ucDeviceId, ulDeviceIdLength );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Init_CorruptRecord_Success( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+    uint8_t ucRecord[] = { 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x40, 'h', 'u', 'b' };
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+    assert_int_equal( AzureIoTProvisioningStorage_Write( &xStorage, ucRecord, sizeof( ucRecord ) ), eAzureIoTSuccess );
+
+    /* A truncated record is dropped, so the device provisions again */
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+    assert_int_equal( AzureIoTProvisioningStorage_Read( &xStorage, ucRecord, sizeof( ucRecord ), &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Init_ReadFailure( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+    uint8_t ucLargeBuffer[ azureiotprovisioningcacheRECORD_MAX + 1 ];
+    uint8_t ucRecord[ azureiotprovisioningcacheRECORD_MAX + 1 ] = { 0 };
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTRAMProvisioningStorage_Init( &xStorage, ucLargeBuffer, sizeof( ucLargeBuffer ) ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningStorage_Write( &xStorage, ucRecord, sizeof( ucRecord ) ), eAzureIoTSuccess );
+
+    /* The storage fails the read, so the error is returned and the record is left alone */
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTErrorOutOfMemory );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+    assert_int_equal( AzureIoTProvisioningStorage_Read( &xStorage, ucRecord, sizeof( ucRecord ), &ulDeviceIdLength ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulDeviceIdLength, sizeof( ucRecord ) );
+
+    /* The cache can still store a new assignment */
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulDeviceIdLength, sizeof( ucDeviceId ) - 1 );
+    assert_memory_equal( pucDeviceId, ucDeviceId, ulDeviceIdLength );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Invalidate_Success( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTProvisioningCache_Invalidate( NULL ), eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningCache_Invalidate( &xCache ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+
+    /* Still gone after a reboot */
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningCache_Init_OtherRegistration_Success( void ** ppvState )
+{
+    AzureIoTProvisioningCache_t xCache;
+    AzureIoTProvisioningStorage_t xStorage;
+    const uint8_t * pucHubHostname;
+    const uint8_t * pucDeviceId;
+    uint32_t ulHubHostnameLength;
+    uint32_t ulDeviceIdLength;
+    uint8_t ucRecord[ azureiotprovisioningcacheRECORD_MAX ];
+
+    ( void ) ppvState;
+
+    prvSetupTestStorage( &xStorage );
+    assert_int_equal( prvInitTestCache( &xCache, &xStorage ), eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_Store( &xCache,
+                                                       ucHubHostname, sizeof( ucHubHostname ) - 1,
+                                                       ucDeviceId, sizeof( ucDeviceId ) - 1 ),
+                      eAzureIoTSuccess );
+
+    /* The assignment of another registration ID is dropped, so the device provisions again */
+    assert_int_equal( AzureIoTProvisioningCache_Init( &xCache, &xStorage,
+                                                      ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                                      ucIDScope, sizeof( ucIDScope ) - 1,
+                                                      ucOtherRegistrationId, sizeof( ucOtherRegistrationId ) - 1 ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningCache_GetDeviceAndHub( &xCache,
+                                                                 &pucHubHostname, &ulHubHostnameLength,
+                                                                 &pucDeviceId, &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+    assert_int_equal( AzureIoTProvisioningStorage_Read( &xStorage, ucRecord, sizeof( ucRecord ), &ulDeviceIdLength ),
+                      eAzureIoTErrorItemNotFound );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTProvisioningCache_Init_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Init_Empty_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Store_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Store_Reload_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Init_CorruptRecord_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Init_ReadFailure ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Init_OtherRegistration_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningCache_Invalidate_Success )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_provisioning_cache_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
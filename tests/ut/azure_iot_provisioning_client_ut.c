@@ -73,10 +73,28 @@ static const uint8_t ucInvalidHubResponse[] = "{ \
           \"etag\":\"XXXXXXXXXXX=\"\
          }\
 }";
+/* Assigned response with a custom allocation payload that is bigger than the old 640 byte response copy. */
+#define testPAYLOAD_PADDING_64    "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+static const uint8_t ucLargeAssignedHubResponse[] = "{ \
+    \"operationId\":\"4.002305f54fc89692.b1f11200-8776-4b5d-867b-dc21c4b59c12\",\"status\":\"assigned\",\"registrationState\": \
+         {\"registrationId\":\"reg_id\",\"createdDateTimeUtc\":\"2019-12-27T19:51:41.6630592Z\",\"assignedHub\":\"unittest.azure-iothub.com\", \
+          \"deviceId\":\"UnitTest\",\"status\":\"assigned\",\"substatus\":\"initialAssignment\",\"lastUpdatedDateTimeUtc\":\"2019-12-27T19:51:41.8579703Z\", \
+          \"payload\":{\"padding\":\"" testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64
+                                                     testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64
+                                                     testPAYLOAD_PADDING_64 testPAYLOAD_PADDING_64 "\"}, \
+          \"etag\":\"XXXXXXXXXXX=\"\
+         }\
+}";
 static const uint8_t ucCustomPayload[] = "{\"modelId\":\"UnitTest\"}";
 static uint8_t ucTopicBuffer[ 128 ];
 static uint32_t ulRequestId = 1;
 static uint64_t ullUnixTime = 0;
+static TickType_t xTestTickCount = 1;
+static AzureIoTProvisioningClientProgress_t xProgressEvents[ 16 ];
+static uint32_t ulProgressEventCount = 0;
+static AzureIoTResult_t xCompleteResult;
+static uint32_t ulCompleteCount = 0;
+static uint32_t ulTestHMACContext;
 /*-----------------------------------------------------------*/
 
 TickType_t xTaskGetTickCount( void );
@@ -93,7 +111,7 @@ static uint32_t prvHmacFunction( const uint8_t * pucKey,
 
 TickType_t xTaskGetTickCount( void )
 {
-    return 1;
+    return xTestTickCount;
 }
 /*-----------------------------------------------------------*/
 
@@ -123,6 +141,49 @@ static uint32_t prvHmacFunction( const uint8_t * pucKey,
 }
 /*-----------------------------------------------------------*/
 
+static uint32_t prvHmacContextFunction( void * pvHMACContext,
+                                        const uint8_t * pucData,
+                                        uint32_t ulDataLength,
+                                        uint8_t * pucOutput,
+                                        uint32_t ulOutputLength,
+                                        uint32_t * pucBytesCopied )
+{
+    ( void ) pucData;
+    ( void ) ulDataLength;
+    ( void ) pucOutput;
+    ( void ) ulOutputLength;
+    ( void ) pucBytesCopied;
+
+    assert_ptr_equal( pvHMACContext, &ulTestHMACContext );
+
+    return( ( uint32_t ) mock() );
+}
+/*-----------------------------------------------------------*/
+
+static void prvProgressCallback( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                 AzureIoTProvisioningClientProgress_t xProgress,
+                                 void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+
+    assert_ptr_equal( pvContext, &ulCompleteCount );
+    assert_true( ulProgressEventCount < sizeof( xProgressEvents ) / sizeof( xProgressEvents[ 0 ] ) );
+    xProgressEvents[ ulProgressEventCount++ ] = xProgress;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompleteCallback( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                 AzureIoTResult_t xResult,
+                                 void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+
+    assert_ptr_equal( pvContext, &ulCompleteCount );
+    xCompleteResult = xResult;
+    ulCompleteCount++;
+}
+/*-----------------------------------------------------------*/
+
 static void prvGenerateResponse( AzureIoTMQTTPublishInfo_t * pxPublishInfo,
                                  uint32_t ulAssignedResponseAfter,
                                  const uint8_t * pucAssignedResponse,
@@ -498,6 +559,49 @@ static void testAzureIoTProvisioningClient_SymmetricKeySet_Success( void ** ppvS
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTProvisioningClient_SymmetricKeyContextSet_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+
+    ( void ) ppvState;
+
+    /* Fail AzureIoTProvisioningClient_SetSymmetricKeyContext when null client is passed */
+    assert_int_not_equal( AzureIoTProvisioningClient_SetSymmetricKeyContext( NULL,
+                                                                             prvHmacContextFunction,
+                                                                             &ulTestHMACContext ),
+                          eAzureIoTSuccess );
+
+    /* Fail AzureIoTProvisioningClient_SetSymmetricKeyContext when null hashing function is passed */
+    assert_int_not_equal( AzureIoTProvisioningClient_SetSymmetricKeyContext( &xTestProvisioningClient,
+                                                                             NULL,
+                                                                             &ulTestHMACContext ),
+                          eAzureIoTSuccess );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningClient_SymmetricKeyContextSet_Success( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+    assert_int_equal( AzureIoTProvisioningClient_SetSymmetricKeyContext( &xTestProvisioningClient,
+                                                                         prvHmacContextFunction,
+                                                                         &ulTestHMACContext ),
+                      eAzureIoTSuccess );
+
+    /* The token is signed with the context instead of the key set before */
+    xPacketInfo.ucType = 0;
+    will_return( prvHmacContextFunction, 0 );
+    will_return( AzureIoTMQTT_Connect, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTProvisioningClient_Register_ConnectFailure( void ** ppvState )
 {
     AzureIoTProvisioningClient_t xTestProvisioningClient;
@@ -783,6 +887,52 @@ static void testAzureIoTProvisioningClient_Register_QueryInvalidResponseFailure(
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTProvisioningClient_Register_QueryLargeResponse_Success( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+    AzureIoTMQTTPublishInfo_t xPublishInfo;
+    uint8_t ucTestDevice[ 128 ];
+    uint32_t ulTestDeviceLength = sizeof( ucTestDevice );
+    uint8_t ucTestHostname[ 128 ];
+    uint32_t ulTestHostnameLength = sizeof( ucTestHostname );
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+    prvRegister( &xTestProvisioningClient );
+
+    /* Publish Registration Query */
+    will_return( AzureIoTMQTT_Publish, eAzureIoTMQTTSuccess );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = 0;
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    /* Large registration response, parsed in place */
+    prvGenerateResponse( &xPublishInfo, 0, ucLargeAssignedHubResponse, sizeof( ucLargeAssignedHubResponse ) - 1 );
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    /* Process response */
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTSuccess );
+
+    assert_int_equal( AzureIoTProvisioningClient_GetDeviceAndHub( &xTestProvisioningClient,
+                                                                  ucTestHostname, &ulTestHostnameLength,
+                                                                  ucTestDevice, &ulTestDeviceLength ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulTestDeviceLength, sizeof( ucDeviceId ) - 1 );
+    assert_memory_equal( ucTestDevice, ucDeviceId, ulTestDeviceLength );
+    assert_int_equal( ulTestHostnameLength, sizeof( ucHubEndpoint ) - 1 );
+    assert_memory_equal( ucTestHostname, ucHubEndpoint, ulTestHostnameLength );
+
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTProvisioningClient_Register_Success( void ** ppvState )
 {
     AzureIoTProvisioningClient_t xTestProvisioningClient;
@@ -798,6 +948,279 @@ static void testAzureIoTProvisioningClient_Register_Success( void ** ppvState )
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoTProvisioningClient_RegisterAsync_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+
+    /* Fail if client is NULL */
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( NULL, prvCompleteCallback,
+                                                                prvProgressCallback, &ulCompleteCount ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail if complete callback is NULL */
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( &xTestProvisioningClient, NULL,
+                                                                prvProgressCallback, &ulCompleteCount ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Fail to process before the registration is started */
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorFailed );
+
+    /* Fail to start twice */
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( &xTestProvisioningClient, prvCompleteCallback,
+                                                                NULL, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( &xTestProvisioningClient, prvCompleteCallback,
+                                                                NULL, &ulCompleteCount ),
+                      eAzureIoTErrorFailed );
+
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningClient_RegisterAsync_Success( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+    AzureIoTMQTTPublishInfo_t xPublishInfo;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+    ulProgressEventCount = 0;
+    ulCompleteCount = 0;
+
+    /* No registration in progress */
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTErrorFailed );
+
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( &xTestProvisioningClient, prvCompleteCallback,
+                                                                prvProgressCallback, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+
+    /* Callbacks only run from the process loop */
+    assert_int_equal( ulProgressEventCount, 0 );
+
+    /* Connect, subscribe and publish the registration request */
+    prvRegistrationConnectStep( &xTestProvisioningClient );
+    prvRegistrationSubscribeStep( &xTestProvisioningClient );
+    prvRegistrationAckSubscribeStep( &xTestProvisioningClient );
+    prvRegistrationPublishStep( &xTestProvisioningClient );
+
+    /* Waiting for the response, nothing to do before the response timeout */
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS );
+
+    xTestTickCount += 1000;
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS - 1000 );
+
+    /* Registration response with retry-after */
+    prvGenerateGoodResponse( &xPublishInfo, 5 );
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    xPacketInfo.ucType = 0;
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    /* Deadline is the retry-after time of the service */
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 5000 );
+
+    /* Nothing happens before the deadline */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    ullUnixTime += 4;
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 1000 );
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+    assert_int_equal( ulProgressEventCount, 4 );
+
+    /* Deadline reached */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    ullUnixTime += 1;
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    prvQuery( &xTestProvisioningClient );
+
+    assert_int_equal( ulCompleteCount, 1 );
+    assert_int_equal( xCompleteResult, eAzureIoTSuccess );
+    assert_int_equal( ulProgressEventCount, 5 );
+    assert_int_equal( xProgressEvents[ 0 ], eAzureIoTProvisioningProgressConnecting );
+    assert_int_equal( xProgressEvents[ 1 ], eAzureIoTProvisioningProgressSubscribing );
+    assert_int_equal( xProgressEvents[ 2 ], eAzureIoTProvisioningProgressRequesting );
+    assert_int_equal( xProgressEvents[ 3 ], eAzureIoTProvisioningProgressWaiting );
+    assert_int_equal( xProgressEvents[ 4 ], eAzureIoTProvisioningProgressRequesting );
+
+    /* Registration is complete */
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTErrorFailed );
+
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+    xTestTickCount = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningClient_RegisterAsync_ResponseTimeout_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+    ulProgressEventCount = 0;
+    ulCompleteCount = 0;
+
+    assert_int_equal( AzureIoTProvisioningClient_RegisterAsync( &xTestProvisioningClient, prvCompleteCallback,
+                                                                NULL, &ulCompleteCount ),
+                      eAzureIoTSuccess );
+
+    prvRegistrationConnectStep( &xTestProvisioningClient );
+    prvRegistrationSubscribeStep( &xTestProvisioningClient );
+    prvRegistrationAckSubscribeStep( &xTestProvisioningClient );
+    prvRegistrationPublishStep( &xTestProvisioningClient );
+
+    /* The service never answers */
+    xTestTickCount += azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS;
+    assert_int_equal( AzureIoTProvisioningClient_GetNextDeadline( &xTestProvisioningClient, &ulWaitMilliseconds ),
+                      eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+
+    assert_int_equal( AzureIoTProvisioningClient_ProcessLoop( &xTestProvisioningClient,
+                                                              azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorServerError );
+    assert_int_equal( ulCompleteCount, 1 );
+    assert_int_equal( xCompleteResult, eAzureIoTErrorServerError );
+
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+    xTestTickCount = 1;
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningClient_Disconnect_Success( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+
+    ( void ) ppvState;
+
+    prvSetupTestProvisioningClient( &xTestProvisioningClient );
+
+    assert_int_equal( AzureIoTProvisioningClient_Disconnect( NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Nothing is sent before the connection */
+    assert_int_equal( AzureIoTProvisioningClient_Disconnect( &xTestProvisioningClient ),
+                      eAzureIoTSuccess );
+
+    prvRegistrationConnectStep( &xTestProvisioningClient );
+
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSendFailed );
+    assert_int_equal( AzureIoTProvisioningClient_Disconnect( &xTestProvisioningClient ),
+                      eAzureIoTErrorFailed );
+
+    will_return( AzureIoTMQTT_Disconnect, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_Disconnect( &xTestProvisioningClient ),
+                      eAzureIoTSuccess );
+
+    /* Already disconnected */
+    assert_int_equal( AzureIoTProvisioningClient_Disconnect( &xTestProvisioningClient ),
+                      eAzureIoTSuccess );
+
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningClient_Register_Timing_Success( void ** ppvState )
+{
+    AzureIoTProvisioningClient_t xTestProvisioningClient;
+    AzureIoTProvisioningClientOptions_t xProvisioningOptions;
+    AzureIoTProvisioningClientTiming_t xTiming;
+    AzureIoTMQTTPublishInfo_t xPublishInfo;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTProvisioningClient_OptionsInit( &xProvisioningOptions ), eAzureIoTSuccess );
+    assert_null( xProvisioningOptions.pxTiming );
+    xProvisioningOptions.pxTiming = &xTiming;
+
+    will_return( AzureIoTMQTT_Init, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_Init( &xTestProvisioningClient,
+                                                       &ucEndpoint[ 0 ], sizeof( ucEndpoint ),
+                                                       &ucIdScope[ 0 ], sizeof( ucIdScope ),
+                                                       &ucRegistrationId[ 0 ], sizeof( ucRegistrationId ),
+                                                       &xProvisioningOptions, ucBuffer, sizeof( ucBuffer ),
+                                                       prvGetUnixTime,
+                                                       &xTransportInterface ),
+                      eAzureIoTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_SetSymmetricKey( &xTestProvisioningClient,
+                                                                  ucSymmetricKey, sizeof( ucSymmetricKey ) - 1,
+                                                                  prvHmacFunction ),
+                      eAzureIoTSuccess );
+
+    xTestTickCount = 1000;
+    prvRegistrationConnectStep( &xTestProvisioningClient );
+
+    xTestTickCount += 10;
+    prvRegistrationSubscribeStep( &xTestProvisioningClient );
+
+    xTestTickCount += 20;
+    prvRegistrationAckSubscribeStep( &xTestProvisioningClient );
+
+    xTestTickCount += 5;
+    prvRegistrationPublishStep( &xTestProvisioningClient );
+
+    /* Registration response */
+    xTestTickCount += 40;
+    prvGenerateGoodResponse( &xPublishInfo, 1 );
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    /* Read response */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    /* Wait for timeout */
+    will_return( AzureIoTMQTT_ProcessLoop, eAzureIoTMQTTSuccess );
+    ullUnixTime += 2;
+    xTestTickCount += 2000;
+    assert_int_equal( AzureIoTProvisioningClient_Register( &xTestProvisioningClient,
+                                                           azureiotprovisioningNO_WAIT ),
+                      eAzureIoTErrorPending );
+
+    prvQuery( &xTestProvisioningClient );
+
+    assert_int_equal( xTiming.ulConnectMilliseconds, 0 );
+    assert_int_equal( xTiming.ulSubscribeMilliseconds, 30 * azureiotMILLISECONDS_PER_TICK );
+    assert_int_equal( xTiming.ulRequestMilliseconds, 45 * azureiotMILLISECONDS_PER_TICK );
+    assert_int_equal( xTiming.ulWaitingMilliseconds, 2000 * azureiotMILLISECONDS_PER_TICK );
+    assert_int_equal( xTiming.ulTotalMilliseconds, 2075 * azureiotMILLISECONDS_PER_TICK );
+    assert_int_equal( xTiming.ulPollCount, 10 );
+    assert_int_equal( xTiming.ulRetryCount, 1 );
+
+    xTestTickCount = 1;
+    AzureIoTProvisioningClient_Deinit( &xTestProvisioningClient );
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTProvisioningClient_GetDeviceAndHub_Failure( void ** ppvState )
 {
     AzureIoTProvisioningClient_t xTestProvisioningClient;
@@ -941,6 +1364,8 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTProvisioningClient_Deinit_Success ),
         cmocka_unit_test( testAzureIoTProvisioningClient_SymmetricKeySet_Failure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_SymmetricKeySet_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_SymmetricKeyContextSet_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_SymmetricKeyContextSet_Success ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_ConnectFailure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_SubscribeFailure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_SubscribeAckFailure ),
@@ -951,7 +1376,13 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_QueryFailure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_QueryDeviceDisabledResponseFailure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_QueryInvalidResponseFailure ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_Register_QueryLargeResponse_Success ),
         cmocka_unit_test( testAzureIoTProvisioningClient_Register_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_RegisterAsync_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_RegisterAsync_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_RegisterAsync_ResponseTimeout_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_Disconnect_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningClient_Register_Timing_Success ),
         cmocka_unit_test( testAzureIoTProvisioningClient_GetDeviceAndHub_Failure ),
         cmocka_unit_test( testAzureIoTProvisioningClient_GetDeviceAndHub_Success ),
         cmocka_unit_test( testAzureIoTProvisioningClient_WithCustomPayload_Failure ),
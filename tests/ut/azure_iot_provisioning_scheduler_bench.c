@@ -0,0 +1,198 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_scheduler_bench.c
+ * @brief Benchmark for registering many provisioning clients from one task against the DPS stand-in.
+ *
+ * The clock of the clients is simulated: when no client has work, it jumps to the next deadline, as a task
+ * sleeping for the time given by AzureIoTProvisioningScheduler_GetNextDeadline() would. The "registrations/s" figure is
+ * therefore bound by the retry-after of the stand-in, and shows the effect of overlapping the waits. The
+ * "ns/registration" figure is the CPU time spent by the middleware and the stand-in for one registration.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_provisioning_scheduler.h"
+/*-----------------------------------------------------------*/
+
+#define benchCLIENT_COUNT    ( 64 )
+#define benchITERATIONS      ( 20 )
+/*-----------------------------------------------------------*/
+
+extern uint32_t ulStandInRetryAfterSeconds;
+
+static const uint8_t ucEndpoint[] = "unittest.azure-devices-provisioning.net";
+static const uint8_t ucIdScope[] = "0ne000A247E";
+static const uint8_t ucRegistrationId[] = "UnitTest";
+static const uint8_t ucSymmetricKey[] = "ABC12345";
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static AzureIoTProvisioningClient_t xBenchProvisioningClients[ benchCLIENT_COUNT ];
+static uint8_t ucBuffers[ benchCLIENT_COUNT ][ 1024 ];
+static AzureIoTProvisioningSchedulerEntry_t xEntries[ benchCLIENT_COUNT ];
+static uint64_t ullTimeMs = 0;
+static uint32_t ulSuccessCount;
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return ( TickType_t ) ullTimeMs;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return ullTimeMs / 1000;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetNanoseconds( void )
+{
+    struct timespec xTime;
+
+    clock_gettime( CLOCK_MONOTONIC, &xTime );
+
+    return ( ( uint64_t ) xTime.tv_sec * 1000000000ULL ) + ( uint64_t ) xTime.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHmacFunction( const uint8_t * pucKey,
+                                 uint32_t ulKeyLength,
+                                 const uint8_t * pucData,
+                                 uint32_t ulDataLength,
+                                 uint8_t * pucOutput,
+                                 uint32_t ulOutputLength,
+                                 uint32_t * pucBytesCopied )
+{
+    ( void ) pucKey;
+    ( void ) ulKeyLength;
+    ( void ) pucData;
+    ( void ) ulDataLength;
+    ( void ) pucOutput;
+    ( void ) ulOutputLength;
+    ( void ) pucBytesCopied;
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvTransport( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                      void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+    ( void ) pvContext;
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompleteCallback( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                 AzureIoTResult_t xResult,
+                                 void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+    ( void ) pvContext;
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        ulSuccessCount++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSchedulerBench( uint32_t ulMaxActive )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+    uint32_t ulWaitMilliseconds;
+    uint64_t ullSimulatedMs = 0;
+    uint64_t ullStartTimeMs;
+    uint64_t ullElapsedNs = 0;
+    uint64_t ullStart;
+
+    ulSuccessCount = 0;
+
+    for( uint32_t ulIteration = 0; ulIteration < benchITERATIONS; ulIteration++ )
+    {
+        assert_int_equal( AzureIoTProvisioningScheduler_Init( &xScheduler, xEntries, benchCLIENT_COUNT, ulMaxActive,
+                                                              prvGetUnixTime, prvTransport, prvTransport,
+                                                              prvCompleteCallback, NULL ),
+                          eAzureIoTSuccess );
+
+        for( uint32_t ulIndex = 0; ulIndex < benchCLIENT_COUNT; ulIndex++ )
+        {
+            assert_int_equal( AzureIoTProvisioningClient_Init( &xBenchProvisioningClients[ ulIndex ],
+                                                               ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                                               ucIdScope, sizeof( ucIdScope ) - 1,
+                                                               ucRegistrationId, sizeof( ucRegistrationId ) - 1,
+                                                               NULL, ucBuffers[ ulIndex ], sizeof( ucBuffers[ ulIndex ] ),
+                                                               prvGetUnixTime, &xTransportInterface ),
+                              eAzureIoTSuccess );
+            assert_int_equal( AzureIoTProvisioningClient_SetSymmetricKey( &xBenchProvisioningClients[ ulIndex ],
+                                                                          ucSymmetricKey, sizeof( ucSymmetricKey ) - 1,
+                                                                          prvHmacFunction ),
+                              eAzureIoTSuccess );
+            assert_int_equal( AzureIoTProvisioningScheduler_Add( &xScheduler, &xBenchProvisioningClients[ ulIndex ] ),
+                              eAzureIoTSuccess );
+        }
+
+        ullStartTimeMs = ullTimeMs;
+        ullStart = prvGetNanoseconds();
+
+        while( AzureIoTProvisioningScheduler_Process( &xScheduler ) == eAzureIoTErrorPending )
+        {
+            if( AzureIoTProvisioningScheduler_GetNextDeadline( &xScheduler, &ulWaitMilliseconds ) == eAzureIoTSuccess )
+            {
+                ullTimeMs += ulWaitMilliseconds;
+            }
+        }
+
+        ullElapsedNs += prvGetNanoseconds() - ullStart;
+        ullSimulatedMs += ullTimeMs - ullStartTimeMs;
+    }
+
+    assert_int_equal( ulSuccessCount, benchCLIENT_COUNT * benchITERATIONS );
+
+    printf( "[ BENCH    ] %2u connections | %8.2f registrations/s | %8llu ns/registration\n",
+            ( unsigned ) ulMaxActive,
+            ( double ) ulSuccessCount * 1000.0 / ( double ) ullSimulatedMs,
+            ( unsigned long long ) ( ullElapsedNs / ulSuccessCount ) );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_RegistrationBench( void ** ppvState )
+{
+    ( void ) ppvState;
+
+    ulStandInRetryAfterSeconds = 1;
+
+    prvSchedulerBench( 1 );
+    prvSchedulerBench( 8 );
+    prvSchedulerBench( benchCLIENT_COUNT );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_RegistrationBench )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_provisioning_scheduler_bench", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,378 @@
+/* Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License. */
+
+/**
+ * @file azure_iot_provisioning_scheduler_ut.c
+ * @brief Unit tests for the provisioning scheduler, against the DPS stand-in MQTT port.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+
+#include <cmocka.h>
+
+#include "azure_iot_provisioning_scheduler.h"
+/*-----------------------------------------------------------*/
+
+#define testCLIENT_COUNT    ( 8 )
+#define testMAX_ACTIVE      ( 3 )
+/*-----------------------------------------------------------*/
+
+extern uint32_t ulStandInRetryAfterSeconds;
+extern uint32_t ulStandInRequestCount;
+extern uint32_t ulStandInProcessLoopCount;
+extern uint32_t ulStandInDisconnectCount;
+extern bool xStandInHoldResponses;
+
+static const uint8_t ucEndpoint[] = "unittest.azure-devices-provisioning.net";
+static const uint8_t ucIdScope[] = "0ne000A247E";
+static const uint8_t ucRegistrationId[] = "UnitTest";
+static const uint8_t ucSymmetricKey[] = "ABC12345";
+static AzureIoTTransportInterface_t xTransportInterface =
+{
+    .pxNetworkContext = NULL,
+    .xSend            = ( AzureIoTTransportSend_t ) 0xA5A5A5A5,
+    .xRecv            = ( AzureIoTTransportRecv_t ) 0xACACACAC
+};
+static AzureIoTProvisioningClient_t xTestProvisioningClients[ testCLIENT_COUNT ];
+static uint8_t ucBuffers[ testCLIENT_COUNT ][ 1024 ];
+static AzureIoTProvisioningSchedulerEntry_t xEntries[ testCLIENT_COUNT ];
+static uint64_t ullTimeMs = 0;
+static uint32_t ulOpenCount;
+static uint32_t ulOpenTransports;
+static uint32_t ulCloseCount;
+static uint32_t ulMaxOpenTransports;
+static uint32_t ulSuccessCount;
+static uint32_t ulFailureCount;
+static AzureIoTProvisioningClient_t * pxFailOpenClient;
+/*-----------------------------------------------------------*/
+
+TickType_t xTaskGetTickCount( void );
+uint32_t ulGetAllTests();
+
+TickType_t xTaskGetTickCount( void )
+{
+    return ( TickType_t ) ullTimeMs;
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvGetUnixTime( void )
+{
+    return ullTimeMs / 1000;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvHmacFunction( const uint8_t * pucKey,
+                                 uint32_t ulKeyLength,
+                                 const uint8_t * pucData,
+                                 uint32_t ulDataLength,
+                                 uint8_t * pucOutput,
+                                 uint32_t ulOutputLength,
+                                 uint32_t * pucBytesCopied )
+{
+    ( void ) pucKey;
+    ( void ) ulKeyLength;
+    ( void ) pucData;
+    ( void ) ulDataLength;
+    ( void ) pucOutput;
+    ( void ) ulOutputLength;
+    ( void ) pucBytesCopied;
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvOpenTransport( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                          void * pvContext )
+{
+    assert_ptr_equal( pvContext, &ulOpenCount );
+
+    ulOpenCount++;
+
+    if( pxAzureProvClient == pxFailOpenClient )
+    {
+        return eAzureIoTErrorFailed;
+    }
+
+    ulOpenTransports++;
+
+    if( ulOpenTransports > ulMaxOpenTransports )
+    {
+        ulMaxOpenTransports = ulOpenTransports;
+    }
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static AzureIoTResult_t prvCloseTransport( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                           void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+
+    assert_ptr_equal( pvContext, &ulOpenCount );
+    assert_true( ulOpenTransports > 0 );
+    ulOpenTransports--;
+
+    /* The MQTT connection is disconnected before its transport is closed */
+    assert_int_equal( ulStandInDisconnectCount, ++ulCloseCount );
+
+    return eAzureIoTSuccess;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompleteCallback( AzureIoTProvisioningClient_t * pxAzureProvClient,
+                                 AzureIoTResult_t xResult,
+                                 void * pvContext )
+{
+    ( void ) pxAzureProvClient;
+
+    assert_ptr_equal( pvContext, &ulOpenCount );
+
+    if( xResult == eAzureIoTSuccess )
+    {
+        ulSuccessCount++;
+    }
+    else
+    {
+        ulFailureCount++;
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetupTestScheduler( AzureIoTProvisioningScheduler_t * pxScheduler )
+{
+    ulOpenCount = 0;
+    ulOpenTransports = 0;
+    ulCloseCount = 0;
+    ulMaxOpenTransports = 0;
+    ulSuccessCount = 0;
+    ulFailureCount = 0;
+    pxFailOpenClient = NULL;
+    ulStandInRetryAfterSeconds = 2;
+    ulStandInDisconnectCount = 0;
+    xStandInHoldResponses = false;
+
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( pxScheduler, xEntries, testCLIENT_COUNT, testMAX_ACTIVE,
+                                                          prvGetUnixTime, prvOpenTransport, prvCloseTransport,
+                                                          prvCompleteCallback, &ulOpenCount ),
+                      eAzureIoTSuccess );
+
+    for( uint32_t ulIndex = 0; ulIndex < testCLIENT_COUNT; ulIndex++ )
+    {
+        assert_int_equal( AzureIoTProvisioningClient_Init( &xTestProvisioningClients[ ulIndex ],
+                                                           ucEndpoint, sizeof( ucEndpoint ) - 1,
+                                                           ucIdScope, sizeof( ucIdScope ) - 1,
+                                                           ucRegistrationId, sizeof( ucRegistrationId ) - 1,
+                                                           NULL, ucBuffers[ ulIndex ], sizeof( ucBuffers[ ulIndex ] ),
+                                                           prvGetUnixTime, &xTransportInterface ),
+                          eAzureIoTSuccess );
+        assert_int_equal( AzureIoTProvisioningClient_SetSymmetricKey( &xTestProvisioningClients[ ulIndex ],
+                                                                      ucSymmetricKey, sizeof( ucSymmetricKey ) - 1,
+                                                                      prvHmacFunction ),
+                          eAzureIoTSuccess );
+        assert_int_equal( AzureIoTProvisioningScheduler_Add( pxScheduler, &xTestProvisioningClients[ ulIndex ] ),
+                          eAzureIoTSuccess );
+    }
+}
+/*-----------------------------------------------------------*/
+
+/* Run the scheduler, jumping the clock to the next deadline when nothing is due. */
+static void prvRunTestScheduler( AzureIoTProvisioningScheduler_t * pxScheduler )
+{
+    uint32_t ulWaitMilliseconds;
+    uint32_t ulProcessCount = 0;
+
+    while( AzureIoTProvisioningScheduler_Process( pxScheduler ) == eAzureIoTErrorPending )
+    {
+        assert_int_equal( AzureIoTProvisioningScheduler_GetNextDeadline( pxScheduler, &ulWaitMilliseconds ), eAzureIoTSuccess );
+        ullTimeMs += ulWaitMilliseconds;
+
+        assert_true( ++ulProcessCount < 1000 );
+    }
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_Init_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+
+    ( void ) ppvState;
+
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( NULL, xEntries, testCLIENT_COUNT, testMAX_ACTIVE,
+                                                          prvGetUnixTime, prvOpenTransport, prvCloseTransport,
+                                                          prvCompleteCallback, &ulOpenCount ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( &xScheduler, NULL, testCLIENT_COUNT, testMAX_ACTIVE,
+                                                          prvGetUnixTime, prvOpenTransport, prvCloseTransport,
+                                                          prvCompleteCallback, &ulOpenCount ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( &xScheduler, xEntries, testCLIENT_COUNT, 0,
+                                                          prvGetUnixTime, prvOpenTransport, prvCloseTransport,
+                                                          prvCompleteCallback, &ulOpenCount ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( &xScheduler, xEntries, testCLIENT_COUNT, testMAX_ACTIVE,
+                                                          prvGetUnixTime, NULL, prvCloseTransport,
+                                                          prvCompleteCallback, &ulOpenCount ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_Init( &xScheduler, xEntries, testCLIENT_COUNT, testMAX_ACTIVE,
+                                                          prvGetUnixTime, prvOpenTransport, prvCloseTransport,
+                                                          NULL, &ulOpenCount ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_Add_Failure( void ** ppvState )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    prvSetupTestScheduler( &xScheduler );
+
+    assert_int_equal( AzureIoTProvisioningScheduler_Add( NULL, &xTestProvisioningClients[ 0 ] ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_Add( &xScheduler, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+
+    /* Every entry is used */
+    assert_int_equal( AzureIoTProvisioningScheduler_Add( &xScheduler, &xTestProvisioningClients[ 0 ] ),
+                      eAzureIoTErrorOutOfMemory );
+
+    /* Queued entries can start now */
+    assert_int_equal( AzureIoTProvisioningScheduler_GetNextDeadline( &xScheduler, &ulWaitMilliseconds ), eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_Process_Success( void ** ppvState )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+    uint64_t ullStartTimeMs;
+    uint32_t ulWaitMilliseconds;
+
+    ( void ) ppvState;
+
+    prvSetupTestScheduler( &xScheduler );
+    ullStartTimeMs = ullTimeMs;
+
+    prvRunTestScheduler( &xScheduler );
+
+    assert_int_equal( ulSuccessCount, testCLIENT_COUNT );
+    assert_int_equal( ulFailureCount, 0 );
+    assert_int_equal( ulOpenCount, testCLIENT_COUNT );
+    assert_int_equal( ulOpenTransports, 0 );
+    assert_int_equal( ulMaxOpenTransports, testMAX_ACTIVE );
+
+    /* The retry-after waits of the active clients overlap: one wait per group of active clients */
+    assert_int_equal( ullTimeMs - ullStartTimeMs,
+                      ( ( testCLIENT_COUNT + testMAX_ACTIVE - 1 ) / testMAX_ACTIVE ) * ulStandInRetryAfterSeconds * 1000 );
+
+    /* Nothing left to do */
+    assert_int_equal( AzureIoTProvisioningScheduler_GetNextDeadline( &xScheduler, &ulWaitMilliseconds ), eAzureIoTErrorFailed );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_Process_OpenTransportFailure( void ** ppvState )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+
+    ( void ) ppvState;
+
+    prvSetupTestScheduler( &xScheduler );
+    pxFailOpenClient = &xTestProvisioningClients[ 1 ];
+
+    prvRunTestScheduler( &xScheduler );
+
+    assert_int_equal( ulSuccessCount, testCLIENT_COUNT - 1 );
+    assert_int_equal( ulFailureCount, 1 );
+    assert_int_equal( ulOpenTransports, 0 );
+    assert_true( ulMaxOpenTransports <= testMAX_ACTIVE );
+}
+/*-----------------------------------------------------------*/
+
+static void testAzureIoTProvisioningScheduler_Process_WaitsForResponse( void ** ppvState )
+{
+    AzureIoTProvisioningScheduler_t xScheduler;
+    uint32_t ulRequestCount;
+    uint32_t ulProcessLoopCount;
+    uint32_t ulWaitMilliseconds;
+    uint32_t ulProcessCount = 0;
+
+    ( void ) ppvState;
+
+    prvSetupTestScheduler( &xScheduler );
+    xStandInHoldResponses = true;
+
+    /* Run the active clients up to their registration request */
+    ulRequestCount = ulStandInRequestCount;
+
+    while( ulStandInRequestCount < ulRequestCount + testMAX_ACTIVE )
+    {
+        assert_int_equal( AzureIoTProvisioningScheduler_Process( &xScheduler ), eAzureIoTErrorPending );
+        assert_true( ++ulProcessCount < 100 );
+    }
+
+    /* Nothing to do before the response timeout */
+    assert_int_equal( AzureIoTProvisioningScheduler_GetNextDeadline( &xScheduler, &ulWaitMilliseconds ), eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS );
+
+    /* No client is processed while the service has not answered */
+    ulProcessLoopCount = ulStandInProcessLoopCount;
+
+    for( ulProcessCount = 0; ulProcessCount < 10; ulProcessCount++ )
+    {
+        ullTimeMs += azureiotconfigPROVISIONING_RESPONSE_TIMEOUT_MS / 20;
+        assert_int_equal( AzureIoTProvisioningScheduler_Process( &xScheduler ), eAzureIoTErrorPending );
+    }
+
+    assert_int_equal( ulStandInProcessLoopCount, ulProcessLoopCount );
+
+    /* Queued clients have no transport data to report */
+    assert_int_equal( AzureIoTProvisioningScheduler_NotifyData( NULL, &xTestProvisioningClients[ 0 ] ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_NotifyData( &xScheduler, NULL ),
+                      eAzureIoTErrorInvalidArgument );
+    assert_int_equal( AzureIoTProvisioningScheduler_NotifyData( &xScheduler, &xTestProvisioningClients[ testMAX_ACTIVE ] ),
+                      eAzureIoTErrorItemNotFound );
+
+    /* The responses arrive */
+    xStandInHoldResponses = false;
+
+    for( uint32_t ulIndex = 0; ulIndex < testMAX_ACTIVE; ulIndex++ )
+    {
+        assert_int_equal( AzureIoTProvisioningScheduler_NotifyData( &xScheduler, &xTestProvisioningClients[ ulIndex ] ),
+                          eAzureIoTSuccess );
+    }
+
+    assert_int_equal( AzureIoTProvisioningScheduler_GetNextDeadline( &xScheduler, &ulWaitMilliseconds ), eAzureIoTSuccess );
+    assert_int_equal( ulWaitMilliseconds, 0 );
+    assert_int_equal( AzureIoTProvisioningScheduler_Process( &xScheduler ), eAzureIoTErrorPending );
+    assert_int_equal( ulStandInProcessLoopCount, ulProcessLoopCount + testMAX_ACTIVE );
+
+    prvRunTestScheduler( &xScheduler );
+
+    assert_int_equal( ulSuccessCount, testCLIENT_COUNT );
+    assert_int_equal( ulFailureCount, 0 );
+    assert_int_equal( ulOpenTransports, 0 );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulGetAllTests()
+{
+    const struct CMUnitTest tests[] =
+    {
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_Init_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_Add_Failure ),
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_Process_Success ),
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_Process_OpenTransportFailure ),
+        cmocka_unit_test( testAzureIoTProvisioningScheduler_Process_WaitsForResponse )
+    };
+
+    return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_provisioning_scheduler_ut", tests, NULL, NULL );
+}
+/*-----------------------------------------------------------*/
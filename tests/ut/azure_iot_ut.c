@@ -53,6 +53,22 @@ uint32_t ulFixedHMAC( const uint8_t * pucKey,
 }
 /*-----------------------------------------------------------*/
 
+uint32_t ulFixedHMACContext( void * pvHMACContext,
+                             const uint8_t * pucData,
+                             uint32_t ulDataLength,
+                             uint8_t * pucOutput,
+                             uint32_t ulOutputLength,
+                             uint32_t * pulBytesCopied )
+{
+    assert_ptr_equal( pvHMACContext, ucFixedHMACSHA256 );
+
+    memcpy( pucOutput, ucFixedHMACSHA256, sizeof( ucFixedHMACSHA256 ) );
+    *pulBytesCopied = sizeof( ucFixedHMACSHA256 );
+
+    return 0;
+}
+/*-----------------------------------------------------------*/
+
 static void testAzureIoTMessagePropertiesInit_Failure( void ** ppvState )
 {
     AzureIoTMessageProperties_t xTestMessageProperties;
@@ -249,6 +265,32 @@ static void testAzureIoT_Base64HMACCalculateSuccess()
 }
 /*-----------------------------------------------------------*/
 
+static void testAzureIoT_HMACContextBase64EncodeSuccess()
+{
+    uint8_t ucOutBuffer[ 512 ];
+    uint32_t ulOutBufferLength;
+
+    assert_int_equal( AzureIoT_HMACContextBase64Encode( ulFixedHMACContext,
+                                                        ( void * ) ucFixedHMACSHA256,
+                                                        ucURLEncodedHMACSHA256Message,
+                                                        sizeof( ucURLEncodedHMACSHA256Message ) - 1,
+                                                        ucBuffer, sizeof( ucBuffer ), ucOutBuffer,
+                                                        sizeof( ucOutBuffer ), &ulOutBufferLength ),
+                      eAzureIoTSuccess );
+    assert_int_equal( sizeof( ucURLEncodedHMACSHA256Base64 ) - 1, ulOutBufferLength );
+    assert_memory_equal( ucURLEncodedHMACSHA256Base64, ucOutBuffer, ulOutBufferLength );
+
+    /* Fail with no HMAC function */
+    assert_int_equal( AzureIoT_HMACContextBase64Encode( NULL,
+                                                        ( void * ) ucFixedHMACSHA256,
+                                                        ucURLEncodedHMACSHA256Message,
+                                                        sizeof( ucURLEncodedHMACSHA256Message ) - 1,
+                                                        ucBuffer, sizeof( ucBuffer ), ucOutBuffer,
+                                                        sizeof( ucOutBuffer ), &ulOutBufferLength ),
+                      eAzureIoTErrorInvalidArgument );
+}
+/*-----------------------------------------------------------*/
+
 /*
  * Private test functions
  */
@@ -278,6 +320,22 @@ static void testAzureIoT_TranslateCoreError( void ** state )
     assert_int_equal( eAzureIoTErrorFailed, AzureIoT_TranslateCoreError( AZ_ERROR_HTTP_INVALID_STATE ) );
 }
 
+static void testAzureIoT_FNV1a( void ** state )
+{
+    const uint8_t ucFooBar[] = "foobar";
+
+    /* Published FNV-1a test vectors */
+    assert_int_equal( AzureIoT_FNV1a32( azureiotFNV1A_32_OFFSET_BASIS, ucFooBar, 0 ), azureiotFNV1A_32_OFFSET_BASIS );
+    assert_int_equal( AzureIoT_FNV1a32( azureiotFNV1A_32_OFFSET_BASIS, ucFooBar, sizeof( ucFooBar ) - 1 ), 0xBF9CF968U );
+    assert_true( AzureIoT_FNV1a64( azureiotFNV1A_64_OFFSET_BASIS, ucFooBar, sizeof( ucFooBar ) - 1 ) == 0x85944171F73967E8ULL );
+
+    /* Hashing in parts continues the same hash */
+    assert_int_equal( AzureIoT_FNV1a32( AzureIoT_FNV1a32( azureiotFNV1A_32_OFFSET_BASIS, ucFooBar, 3 ), ucFooBar + 3, 3 ),
+                      0xBF9CF968U );
+    assert_true( AzureIoT_FNV1a64( AzureIoT_FNV1a64( azureiotFNV1A_64_OFFSET_BASIS, ucFooBar, 3 ), ucFooBar + 3, 3 ) ==
+                 0x85944171F73967E8ULL );
+}
+
 uint32_t ulGetAllTests()
 {
     const struct CMUnitTest tests[] =
@@ -291,7 +349,9 @@ uint32_t ulGetAllTests()
         cmocka_unit_test( testAzureIoTInit_Success ),
         cmocka_unit_test( testAzureIoTInit_LogSuccess ),
         cmocka_unit_test( testAzureIoT_Base64HMACCalculateSuccess ),
-        cmocka_unit_test( testAzureIoT_TranslateCoreError )
+        cmocka_unit_test( testAzureIoT_HMACContextBase64EncodeSuccess ),
+        cmocka_unit_test( testAzureIoT_TranslateCoreError ),
+        cmocka_unit_test( testAzureIoT_FNV1a )
     };
 
     return ( uint32_t ) cmocka_run_group_tests_name( "azure_iot_ut", tests, NULL, NULL );
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT License.
+
+"""Decode the records of the deferred logging backend (azure_iot_log.h).
+
+Usage: azure_iot_log_decode.py <firmware.elf> <records.bin> [--tick-rate-hz N]
+
+The format strings are read from the loadable segments of the firmware ELF file, which also gives the
+pointer size and byte order of the device. The records file is the raw output of AzureIoTLog_DeferredRead().
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+LEVELS = {1: "ERROR", 2: "WARN", 3: "INFO", 4: "DEBUG"}
+FLAG_TRUNCATED = 0x1
+HEADER_SIZE = 8
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|z|j|t)?([diouxXcspfeEgG%])")
+
+
+class Firmware:
+    def __init__(self, path):
+        with open(path, "rb") as elf:
+            self.data = elf.read()
+
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError("not an ELF file")
+
+        self.pointer_size = 8 if self.data[4] == 2 else 4
+        self.endian = "<" if self.data[5] == 1 else ">"
+        self.segments = []
+
+        if self.pointer_size == 8:
+            phoff, = struct.unpack_from(self.endian + "Q", self.data, 0x20)
+            phentsize, phnum = struct.unpack_from(self.endian + "HH", self.data, 0x36)
+            layout = "IIQQQQQQ"
+        else:
+            phoff, = struct.unpack_from(self.endian + "I", self.data, 0x1C)
+            phentsize, phnum = struct.unpack_from(self.endian + "HH", self.data, 0x2A)
+            layout = "IIIIIIII"
+
+        for index in range(phnum):
+            fields = struct.unpack_from(self.endian + layout, self.data, phoff + index * phentsize)
+
+            if self.pointer_size == 8:
+                p_type, _, p_offset, p_vaddr, _, p_filesz = fields[:6]
+            else:
+                p_type, p_offset, p_vaddr, _, p_filesz = fields[:5]
+
+            # PT_LOAD
+            if p_type == 1:
+                self.segments.append((p_vaddr, p_offset, p_filesz))
+
+    def string_at(self, address):
+        for vaddr, offset, size in self.segments:
+            if vaddr <= address < vaddr + size:
+                start = offset + address - vaddr
+                end = self.data.index(b"\0", start)
+                return self.data[start:end].decode("utf-8", "replace")
+
+        return None
+
+
+class Record:
+    def __init__(self, firmware, payload):
+        self.firmware = firmware
+        self.payload = payload
+        self.position = 0
+
+    def take(self, layout):
+        value, = struct.unpack_from(self.firmware.endian + layout, self.payload, self.position)
+        self.position += struct.calcsize(layout)
+        return value
+
+    def take_bytes(self):
+        length = self.take("H")
+        value = self.payload[self.position:self.position + length]
+        self.position += length
+        return value.decode("utf-8", "replace")
+
+
+def integer_layout(length, conversion, firmware):
+    signed = conversion in "di"
+    pointer = "q" if firmware.pointer_size == 8 else "i"
+
+    if length == "ll":
+        layout = "q"
+    elif length == "l":
+        layout = pointer
+    elif length in ("z", "j", "t"):
+        layout = pointer
+    else:
+        layout = "i"
+
+    return layout if signed else layout.upper()
+
+
+def format_message(firmware, format_string, record):
+    output = []
+    last = 0
+
+    for match in CONVERSION.finditer(format_string):
+        output.append(format_string[last:match.start()])
+        last = match.end()
+        flags, width, precision, length, conversion = match.groups()
+
+        if conversion == "%":
+            output.append("%")
+            continue
+
+        try:
+            if width == "*":
+                width = str(record.take("i"))
+
+            if precision == "*":
+                precision = str(record.take("i"))
+
+            spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+
+            if conversion == "s":
+                output.append((spec + "s") % record.take_bytes())
+            elif conversion == "p":
+                output.append(hex(record.take("Q" if firmware.pointer_size == 8 else "I")))
+            elif conversion in "feEgG":
+                output.append((spec + conversion) % record.take("d"))
+            elif conversion == "c":
+                output.append(chr(record.take("i") & 0xFF))
+            else:
+                value = record.take(integer_layout(length, conversion, firmware))
+                output.append((spec + ("d" if conversion in "diu" else conversion)) % value)
+        except struct.error:
+            output.append("<missing>")
+            last = len(format_string)
+            break
+
+    output.append(format_string[last:])
+
+    return "".join(output)
+
+
+def decode(firmware, data, tick_rate_hz):
+    position = 0
+
+    while position + HEADER_SIZE <= len(data):
+        length, level, flags, tick = struct.unpack_from(firmware.endian + "HBBI", data, position)
+
+        if length < HEADER_SIZE:
+            raise ValueError("corrupted record at offset %d" % position)
+
+        record = Record(firmware, data[position + HEADER_SIZE:position + length])
+        position += length
+        address = record.take("Q" if firmware.pointer_size == 8 else "I")
+        format_string = firmware.string_at(address)
+
+        if format_string is None:
+            message = "<unknown format string 0x%x>" % address
+        else:
+            message = format_message(firmware, format_string, record)
+
+        if flags & FLAG_TRUNCATED:
+            message += " <truncated>"
+
+        print("[%10.3f] [%s] %s" % (tick / tick_rate_hz, LEVELS.get(level, str(level)), message.rstrip("\r\n")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode deferred Azure IoT middleware log records.")
+    parser.add_argument("elf", help="firmware ELF file holding the format strings")
+    parser.add_argument("records", help="records read with AzureIoTLog_DeferredRead()")
+    parser.add_argument("--tick-rate-hz", type=int, default=1000, help="configTICK_RATE_HZ of the firmware")
+    arguments = parser.parse_args()
+
+    with open(arguments.records, "rb") as records:
+        decode(Firmware(arguments.elf), records.read(), arguments.tick_rate_hz)
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())